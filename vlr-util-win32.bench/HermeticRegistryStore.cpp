@@ -0,0 +1,90 @@
+#include "pch.h"
+#include "HermeticRegistryStore.h"
+
+#include <vlr-util-win32/RegistryAccess.h>
+
+using namespace vlr;
+using namespace vlr::win32;
+
+CHermeticRegistryStore& CHermeticRegistryStore::GetSharedInstance()
+{
+	static CHermeticRegistryStore theInstance;
+	static const SResult srInitialize = [&] {
+		SResult sr;
+
+		sr = theInstance.Create();
+		VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+		sr = theInstance.PopulateTestData();
+		VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+		return SResult{ SResult::Success };
+	}();
+	(void)srInitialize;
+
+	return theInstance;
+}
+
+SResult CHermeticRegistryStore::Create()
+{
+	return m_oAppHive.Create(_T("vrb"));
+}
+
+SResult CHermeticRegistryStore::PopulateTestData()
+{
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(m_oAppHive.GetRootKey());
+
+	SResult sr;
+
+	auto oReg = CRegistryAccess{ m_oAppHive.GetRootKey() };
+
+	sr = oReg.EnsureKeyExists(svzKey_Values);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	sr = oReg.WriteValue_String(svzKey_Values, svzValueName_SZ, vlr::tstring{ _T("value") });
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	sr = oReg.WriteValue_DWORD(svzKey_Values, svzValueName_DWORD, 42);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	sr = oReg.WriteValue_QWORD(svzKey_Values, svzValueName_QWORD, 42);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	sr = oReg.WriteValue_MultiSz(svzKey_Values, svzValueName_MultiSz, { _T("value1"), _T("value2"), _T("value3") });
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	sr = oReg.WriteValue_Binary(svzKey_Values, svzValueName_Binary, std::vector<BYTE>(256, BYTE{ 0x5A }));
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	sr = oReg.WriteValue_Binary(svzKey_Values, svzValueName_Binary_Large, std::vector<BYTE>(nBinaryLargeSize, BYTE{ 0xA5 }));
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	sr = oReg.EnsureKeyExists(svzKey_ManyValues);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	for (size_t i = 0; i < nManyValuesCount; ++i)
+	{
+		auto sValueName = fmt::format(_T("value{:03}"), i);
+		if (i % 2 == 0)
+		{
+			sr = oReg.WriteValue_DWORD(svzKey_ManyValues, sValueName, static_cast<DWORD>(i));
+		}
+		else
+		{
+			sr = oReg.WriteValue_String(svzKey_ManyValues, sValueName, fmt::format(_T("string value {}"), i));
+		}
+		VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	}
+
+	sr = oReg.EnsureKeyExists(svzKey_Subkeys);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	for (size_t i = 0; i < nSubkeysCount; ++i)
+	{
+		auto sSubkeyName = fmt::format(_T("subkey{:03}"), i);
+		auto sSubkeyPath = MakeRegistryPath<TCHAR>(svzKey_Subkeys, sSubkeyName);
+		sr = oReg.EnsureKeyExists(sSubkeyPath);
+		VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+		sr = oReg.WriteValue_DWORD(sSubkeyPath, svzValueName_DWORD, static_cast<DWORD>(i));
+		VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	}
+
+	return SResult::Success;
+}
+
+void CHermeticRegistryStore::Destroy()
+{
+	m_oAppHive.Destroy();
+}
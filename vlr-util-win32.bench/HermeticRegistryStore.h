@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vlr-util/util.includes.h>
+#include <vlr-util/util.Result.h>
+
+#include <vlr-util-win32/registry.AppHive.h>
+
+// This is a private, in-process registry store for benchmarks, populated with test data. It is backed by an
+// application hive (see registry::CAppHive), so it is not visible to other processes, does not touch the user or
+// machine registry, and is discarded when the instance is destroyed.
+
+class CHermeticRegistryStore
+{
+protected:
+	vlr::win32::registry::CAppHive m_oAppHive;
+
+public:
+	static constexpr auto svzKey_Values = vlr::tzstring_view{ _T("values") };
+	static constexpr auto svzKey_ManyValues = vlr::tzstring_view{ _T("values\\many") };
+	static constexpr auto svzKey_Subkeys = vlr::tzstring_view{ _T("subkeys") };
+	static constexpr size_t nManyValuesCount = 64;
+	static constexpr size_t nSubkeysCount = 32;
+
+	static constexpr auto svzValueName_SZ = vlr::tzstring_view{ _T("testString") };
+	static constexpr auto svzValueName_DWORD = vlr::tzstring_view{ _T("testDWORD") };
+	static constexpr auto svzValueName_QWORD = vlr::tzstring_view{ _T("testQWORD") };
+	static constexpr auto svzValueName_MultiSz = vlr::tzstring_view{ _T("testMultiSz") };
+	static constexpr auto svzValueName_Binary = vlr::tzstring_view{ _T("testBinary") };
+	static constexpr auto svzValueName_Binary_Large = vlr::tzstring_view{ _T("testBinary_Large") };
+	static constexpr size_t nBinaryLargeSize = 512 * 1024;
+
+public:
+	// Note: Shared instance is created (and populated) on first use, and lives for the duration of the process.
+	static CHermeticRegistryStore& GetSharedInstance();
+
+	vlr::SResult Create();
+	vlr::SResult PopulateTestData();
+	void Destroy();
+
+	inline HKEY GetRootKey() const
+	{
+		return m_oAppHive.GetRootKey();
+	}
+
+public:
+	CHermeticRegistryStore() = default;
+	CHermeticRegistryStore(const CHermeticRegistryStore&) = delete;
+};
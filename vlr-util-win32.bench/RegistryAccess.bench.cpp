@@ -0,0 +1,887 @@
+#include "pch.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <fmt/format.h>
+
+#include "vlr-util/cpp_namespace.h"
+#include "vlr-util/StringCompare.h"
+#include "vlr-util/util.data_adaptor.MultiSZ.h"
+
+#include "vlr-util-win32/RegistryAccess.h"
+#include "vlr-util-win32/RegistryAccess_Export.h"
+#include "vlr-util-win32/RegistryAccess_Search.h"
+#include "vlr-util-win32/RegistryAccess_Shared.h"
+#include "vlr-util-win32/strings.Base64.h"
+#include "vlr-util-win32/strings.CaseFold.h"
+#include "vlr-util-win32/strings.FindSubstring.h"
+
+#include "HermeticRegistryStore.h"
+
+using namespace vlr;
+using namespace vlr::win32;
+
+// Note: Conversion benchmarks do not touch the registry; the remaining benchmarks run against the hermetic
+// store, so results do not depend on the state of the machine registry.
+
+namespace {
+
+constexpr auto svzSampleString = tzstring_view{ _T("The quick brown fox jumps over the lazy dog") };
+
+template <typename TString>
+TString MakeSampleString(size_t nLength)
+{
+	using TChar = typename TString::value_type;
+	TString sValue;
+	sValue.reserve(nLength);
+	for (size_t i = 0; i < nLength; ++i)
+	{
+		sValue.push_back(static_cast<TChar>('a' + (i % 26)));
+	}
+	return sValue;
+}
+
+std::vector<vlr::tstring> MakeSampleMultiSzCollection(size_t nElementCount)
+{
+	std::vector<vlr::tstring> arrValueCollection;
+	arrValueCollection.reserve(nElementCount);
+	for (size_t i = 0; i < nElementCount; ++i)
+	{
+		arrValueCollection.push_back(fmt::format(_T("value{}"), i));
+	}
+	return arrValueCollection;
+}
+
+auto GetHermeticRegistryAccess()
+{
+	return CRegistryAccess{ CHermeticRegistryStore::GetSharedInstance().GetRootKey() };
+}
+
+void SkipIfHermeticStoreUnavailable(benchmark::State& state)
+{
+	if (!CHermeticRegistryStore::GetSharedInstance().GetRootKey())
+	{
+		state.SkipWithError("Hermetic registry store could not be created");
+	}
+}
+
+} // namespace
+
+//////////////////////////////////////////////////////////////////////////
+// MakeRegistryPath
+
+static void BM_MakeRegistryPath(benchmark::State& state)
+{
+	static constexpr auto svzPrefix = tzstring_view{ _T("SOFTWARE\\vlr-test\\") };
+	static constexpr auto svzComponent = tzstring_view{ _T("\\subkey\\") };
+
+	for (auto _ : state)
+	{
+		auto sPath = MakeRegistryPath<TCHAR>(svzPrefix, svzComponent);
+		benchmark::DoNotOptimize(sPath);
+	}
+}
+BENCHMARK(BM_MakeRegistryPath);
+
+//////////////////////////////////////////////////////////////////////////
+// Value <-> registry data conversions
+
+template <typename TString>
+static void BM_ConvertValueToRegData_String(benchmark::State& state)
+{
+	const auto oReg = CRegistryAccess{};
+	const auto sValue = MakeSampleString<TString>(static_cast<size_t>(state.range(0)));
+	DWORD dwType{};
+	std::vector<BYTE> arrData;
+
+	for (auto _ : state)
+	{
+		auto sr = oReg.convertValueToRegData_String(sValue, dwType, arrData);
+		benchmark::DoNotOptimize(sr);
+		benchmark::DoNotOptimize(arrData.data());
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_ConvertValueToRegData_String, std::string)->RangeMultiplier(8)->Range(8, 8 << 9);
+BENCHMARK_TEMPLATE(BM_ConvertValueToRegData_String, std::wstring)->RangeMultiplier(8)->Range(8, 8 << 9);
+
+template <typename TString>
+static void BM_ConvertValueToRegData_StringView(benchmark::State& state)
+{
+	const auto oReg = CRegistryAccess{};
+	const auto sValue = MakeSampleString<TString>(static_cast<size_t>(state.range(0)));
+	const auto svValue = std::basic_string_view<typename TString::value_type>{ sValue };
+	DWORD dwType{};
+	std::vector<BYTE> arrData;
+
+	for (auto _ : state)
+	{
+		auto sr = oReg.convertValueToRegData_String(svValue, dwType, arrData);
+		benchmark::DoNotOptimize(sr);
+		benchmark::DoNotOptimize(arrData.data());
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_ConvertValueToRegData_StringView, std::string)->RangeMultiplier(8)->Range(8, 8 << 9);
+BENCHMARK_TEMPLATE(BM_ConvertValueToRegData_StringView, std::wstring)->RangeMultiplier(8)->Range(8, 8 << 9);
+
+template <typename TString>
+static void BM_ConvertRegDataToValue_String(benchmark::State& state)
+{
+	const auto oReg = CRegistryAccess{};
+	DWORD dwType{};
+	std::vector<BYTE> arrData;
+	oReg.convertValueToRegData_String(MakeSampleString<vlr::tstring>(static_cast<size_t>(state.range(0))), dwType, arrData);
+	TString sValue;
+
+	for (auto _ : state)
+	{
+		auto sr = oReg.convertRegDataToValue_String(dwType, arrData, sValue);
+		benchmark::DoNotOptimize(sr);
+		benchmark::DoNotOptimize(sValue.data());
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(arrData.size()));
+}
+BENCHMARK_TEMPLATE(BM_ConvertRegDataToValue_String, std::string)->RangeMultiplier(8)->Range(8, 8 << 9);
+BENCHMARK_TEMPLATE(BM_ConvertRegDataToValue_String, std::wstring)->RangeMultiplier(8)->Range(8, 8 << 9);
+
+template <typename TString>
+static void BM_ConvertValueToRegDataDirect_String_NativeType(benchmark::State& state)
+{
+	const auto oReg = CRegistryAccess{};
+	const auto sValue = MakeSampleString<TString>(static_cast<size_t>(state.range(0)));
+	DWORD dwType{};
+	std::vector<BYTE> arrData;
+
+	for (auto _ : state)
+	{
+		auto sr = oReg.convertValueToRegDataDirect_String_NativeType(sValue, dwType, arrData);
+		benchmark::DoNotOptimize(sr);
+		benchmark::DoNotOptimize(arrData.data());
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_ConvertValueToRegDataDirect_String_NativeType, std::string)->RangeMultiplier(8)->Range(8, 8 << 9);
+BENCHMARK_TEMPLATE(BM_ConvertValueToRegDataDirect_String_NativeType, std::wstring)->RangeMultiplier(8)->Range(8, 8 << 9);
+
+template <typename TString>
+static void BM_ConvertRegDataToValueDirect_String_NativeType(benchmark::State& state)
+{
+	const auto oReg = CRegistryAccess{};
+	DWORD dwType{};
+	std::vector<BYTE> arrData;
+	oReg.convertValueToRegDataDirect_String_NativeType(MakeSampleString<TString>(static_cast<size_t>(state.range(0))), dwType, arrData);
+	TString sValue;
+
+	for (auto _ : state)
+	{
+		auto sr = oReg.convertRegDataToValueDirect_String_NativeType(dwType, arrData, sValue);
+		benchmark::DoNotOptimize(sr);
+		benchmark::DoNotOptimize(sValue.data());
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(arrData.size()));
+}
+BENCHMARK_TEMPLATE(BM_ConvertRegDataToValueDirect_String_NativeType, std::string)->RangeMultiplier(8)->Range(8, 8 << 9);
+BENCHMARK_TEMPLATE(BM_ConvertRegDataToValueDirect_String_NativeType, std::wstring)->RangeMultiplier(8)->Range(8, 8 << 9);
+
+static void BM_ConvertValueToRegData_DWORD(benchmark::State& state)
+{
+	const auto oReg = CRegistryAccess{};
+	DWORD dwType{};
+	std::vector<BYTE> arrData;
+
+	for (auto _ : state)
+	{
+		auto sr = oReg.convertValueToRegData_DWORD(DWORD{ 42 }, dwType, arrData);
+		benchmark::DoNotOptimize(sr);
+		benchmark::DoNotOptimize(arrData.data());
+	}
+}
+BENCHMARK(BM_ConvertValueToRegData_DWORD);
+
+static void BM_ConvertRegDataToValue_DWORD(benchmark::State& state)
+{
+	const auto oReg = CRegistryAccess{};
+	DWORD dwType{};
+	std::vector<BYTE> arrData;
+	oReg.convertValueToRegData_DWORD(DWORD{ 42 }, dwType, arrData);
+	DWORD dwValue{};
+
+	for (auto _ : state)
+	{
+		auto sr = oReg.convertRegDataToValue_DWORD(dwType, arrData, dwValue);
+		benchmark::DoNotOptimize(sr);
+		benchmark::DoNotOptimize(dwValue);
+	}
+}
+BENCHMARK(BM_ConvertRegDataToValue_DWORD);
+
+// Note: Coercion table dispatch, for a native type read (fast path) and a parsed string
+static void BM_CoerceRegData_DWORD(benchmark::State& state)
+{
+	const auto dwData = DWORD{ 42 };
+	const auto spanData = cpp::span<const BYTE>{ reinterpret_cast<const BYTE*>(&dwData), sizeof(dwData) };
+	DWORD dwValue{};
+
+	for (auto _ : state)
+	{
+		auto sr = registry::CoerceRegData(REG_DWORD, spanData, dwValue, registry::CoercionMode::Strict);
+		benchmark::DoNotOptimize(sr);
+		benchmark::DoNotOptimize(dwValue);
+	}
+}
+BENCHMARK(BM_CoerceRegData_DWORD);
+
+static void BM_CoerceRegData_DWORD_FromString(benchmark::State& state)
+{
+	constexpr auto svData = vlr::tstring_view{ _T("4294967295") };
+	const auto spanData = cpp::span<const BYTE>{ reinterpret_cast<const BYTE*>(svData.data()), svData.size() * sizeof(TCHAR) };
+	DWORD dwValue{};
+
+	for (auto _ : state)
+	{
+		auto sr = registry::CoerceRegData(REG_SZ, spanData, dwValue, registry::CoercionMode::NumericParse);
+		benchmark::DoNotOptimize(sr);
+		benchmark::DoNotOptimize(dwValue);
+	}
+}
+BENCHMARK(BM_CoerceRegData_DWORD_FromString);
+
+static void BM_ConvertValueToRegData_QWORD(benchmark::State& state)
+{
+	const auto oReg = CRegistryAccess{};
+	DWORD dwType{};
+	std::vector<BYTE> arrData;
+
+	for (auto _ : state)
+	{
+		auto sr = oReg.convertValueToRegData_QWORD(CRegistryAccess::QWORD{ 42 }, dwType, arrData);
+		benchmark::DoNotOptimize(sr);
+		benchmark::DoNotOptimize(arrData.data());
+	}
+}
+BENCHMARK(BM_ConvertValueToRegData_QWORD);
+
+static void BM_ConvertRegDataToValue_QWORD(benchmark::State& state)
+{
+	const auto oReg = CRegistryAccess{};
+	DWORD dwType{};
+	std::vector<BYTE> arrData;
+	oReg.convertValueToRegData_QWORD(CRegistryAccess::QWORD{ 42 }, dwType, arrData);
+	CRegistryAccess::QWORD qwValue{};
+
+	for (auto _ : state)
+	{
+		auto sr = oReg.convertRegDataToValue_QWORD(dwType, arrData, qwValue);
+		benchmark::DoNotOptimize(sr);
+		benchmark::DoNotOptimize(qwValue);
+	}
+}
+BENCHMARK(BM_ConvertRegDataToValue_QWORD);
+
+static void BM_ConvertValueToRegData_MultiSz(benchmark::State& state)
+{
+	const auto oReg = CRegistryAccess{};
+	const auto arrValueCollection = MakeSampleMultiSzCollection(static_cast<size_t>(state.range(0)));
+	DWORD dwType{};
+	std::vector<BYTE> arrData;
+
+	for (auto _ : state)
+	{
+		auto sr = oReg.convertValueToRegData_MultiSz(arrValueCollection, dwType, arrData);
+		benchmark::DoNotOptimize(sr);
+		benchmark::DoNotOptimize(arrData.data());
+	}
+	state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_ConvertValueToRegData_MultiSz)->RangeMultiplier(4)->Range(1, 1 << 10);
+
+static void BM_ConvertRegDataToValue_MultiSz(benchmark::State& state)
+{
+	const auto oReg = CRegistryAccess{};
+	DWORD dwType{};
+	std::vector<BYTE> arrData;
+	oReg.convertValueToRegData_MultiSz(MakeSampleMultiSzCollection(static_cast<size_t>(state.range(0))), dwType, arrData);
+	std::vector<vlr::tstring> arrValueCollection;
+
+	for (auto _ : state)
+	{
+		arrValueCollection.clear();
+		auto sr = oReg.convertRegDataToValue_MultiSz(dwType, arrData, arrValueCollection);
+		benchmark::DoNotOptimize(sr);
+		benchmark::DoNotOptimize(arrValueCollection.data());
+	}
+	state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_ConvertRegDataToValue_MultiSz)->RangeMultiplier(4)->Range(1, 1 << 10);
+
+static void BM_ConvertValueToRegData_Binary(benchmark::State& state)
+{
+	const auto oReg = CRegistryAccess{};
+	const auto arrBinaryData = std::vector<BYTE>(static_cast<size_t>(state.range(0)), BYTE{ 0x5A });
+	DWORD dwType{};
+	std::vector<BYTE> arrData;
+
+	for (auto _ : state)
+	{
+		auto sr = oReg.convertValueToRegData_Binary(arrBinaryData, dwType, arrData);
+		benchmark::DoNotOptimize(sr);
+		benchmark::DoNotOptimize(arrData.data());
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_ConvertValueToRegData_Binary)->RangeMultiplier(16)->Range(16, 1 << 20);
+
+static void BM_ConvertRegDataToValue_Binary(benchmark::State& state)
+{
+	const auto oReg = CRegistryAccess{};
+	const auto arrData = std::vector<BYTE>(static_cast<size_t>(state.range(0)), BYTE{ 0x5A });
+	std::vector<BYTE> arrBinaryData;
+
+	for (auto _ : state)
+	{
+		auto sr = oReg.convertRegDataToValue_Binary(REG_BINARY, arrData, arrBinaryData);
+		benchmark::DoNotOptimize(sr);
+		benchmark::DoNotOptimize(arrBinaryData.data());
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_ConvertRegDataToValue_Binary)->RangeMultiplier(16)->Range(16, 1 << 20);
+
+static void BM_ConvertRegDataToValue_Binary_AsFallback(benchmark::State& state)
+{
+	const auto oReg = CRegistryAccess{};
+	DWORD dwType{};
+	std::vector<BYTE> arrData;
+	oReg.convertValueToRegData_String(vlr::tstring{ svzSampleString }, dwType, arrData);
+	std::vector<BYTE> arrBinaryData;
+
+	for (auto _ : state)
+	{
+		auto sr = oReg.convertRegDataToValue_Binary_AsFallback(dwType, arrData, arrBinaryData);
+		benchmark::DoNotOptimize(sr);
+		benchmark::DoNotOptimize(arrBinaryData.data());
+	}
+}
+BENCHMARK(BM_ConvertRegDataToValue_Binary_AsFallback);
+
+//////////////////////////////////////////////////////////////////////////
+// MultiSZ packing/unpacking
+
+static void BM_MultiSZ_ToMultiSz(benchmark::State& state)
+{
+	const auto arrValueCollection = MakeSampleMultiSzCollection(static_cast<size_t>(state.range(0)));
+	std::vector<BYTE> arrData;
+
+	for (auto _ : state)
+	{
+		auto sr = util::data_adaptor::HelperFor_MultiSZ<TCHAR>{}.ToMultiSz(arrValueCollection, arrData);
+		benchmark::DoNotOptimize(sr);
+		benchmark::DoNotOptimize(arrData.data());
+	}
+	state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_MultiSZ_ToMultiSz)->RangeMultiplier(4)->Range(1, 1 << 12);
+
+static void BM_MultiSZ_ToStructuredData(benchmark::State& state)
+{
+	std::vector<BYTE> arrData;
+	util::data_adaptor::HelperFor_MultiSZ<TCHAR>{}.ToMultiSz(MakeSampleMultiSzCollection(static_cast<size_t>(state.range(0))), arrData);
+	std::vector<vlr::tstring> arrValueCollection;
+
+	for (auto _ : state)
+	{
+		arrValueCollection.clear();
+		auto sr = util::data_adaptor::HelperFor_MultiSZ<TCHAR>{}.ToStructuredData(reinterpret_cast<const TCHAR*>(arrData.data()), arrValueCollection);
+		benchmark::DoNotOptimize(sr);
+		benchmark::DoNotOptimize(arrValueCollection.data());
+	}
+	state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_MultiSZ_ToStructuredData)->RangeMultiplier(4)->Range(1, 1 << 12);
+
+//////////////////////////////////////////////////////////////////////////
+// Value map entry population (per type)
+
+static void BM_PopulateValueMapEntryFromEnumValueData(benchmark::State& state)
+{
+	const auto oReg = CRegistryAccess{};
+	std::vector<BYTE> arrData;
+	DWORD dwType{};
+	switch (state.range(0))
+	{
+	case REG_SZ:
+		oReg.convertValueToRegData_String(vlr::tstring{ svzSampleString }, dwType, arrData);
+		break;
+	case REG_DWORD:
+		oReg.convertValueToRegData_DWORD(DWORD{ 42 }, dwType, arrData);
+		break;
+	case REG_QWORD:
+		oReg.convertValueToRegData_QWORD(CRegistryAccess::QWORD{ 42 }, dwType, arrData);
+		break;
+	case REG_MULTI_SZ:
+		oReg.convertValueToRegData_MultiSz(MakeSampleMultiSzCollection(8), dwType, arrData);
+		break;
+	case REG_BINARY:
+	default:
+		oReg.convertValueToRegData_Binary(std::vector<BYTE>(256, BYTE{ 0x5A }), dwType, arrData);
+		break;
+	}
+	const auto oEnumValueData = CRegistryAccess::EnumValueData{}
+		.withName(_T("value"))
+		.withType(dwType)
+		.withData(arrData);
+
+	for (auto _ : state)
+	{
+		CRegistryAccess::ValueMapEntry oValueMapEntry;
+		auto sr = oReg.populateValueMapEntryFromEnumValueData(oEnumValueData, oValueMapEntry);
+		benchmark::DoNotOptimize(sr);
+		benchmark::DoNotOptimize(oValueMapEntry);
+	}
+}
+BENCHMARK(BM_PopulateValueMapEntryFromEnumValueData)
+	->ArgName("regType")
+	->Arg(REG_SZ)
+	->Arg(REG_DWORD)
+	->Arg(REG_QWORD)
+	->Arg(REG_MULTI_SZ)
+	->Arg(REG_BINARY);
+
+//////////////////////////////////////////////////////////////////////////
+// Full read/enumeration paths (hermetic store)
+
+static void BM_ReadValue_String(benchmark::State& state)
+{
+	SkipIfHermeticStoreUnavailable(state);
+	const auto oReg = GetHermeticRegistryAccess();
+	vlr::tstring sValue;
+
+	for (auto _ : state)
+	{
+		auto sr = oReg.ReadValue_String(CHermeticRegistryStore::svzKey_Values, CHermeticRegistryStore::svzValueName_SZ, sValue);
+		benchmark::DoNotOptimize(sr);
+		benchmark::DoNotOptimize(sValue.data());
+	}
+}
+BENCHMARK(BM_ReadValue_String);
+
+static void BM_ReadValue_DWORD(benchmark::State& state)
+{
+	SkipIfHermeticStoreUnavailable(state);
+	const auto oReg = GetHermeticRegistryAccess();
+	DWORD dwValue{};
+
+	for (auto _ : state)
+	{
+		auto sr = oReg.ReadValue_DWORD(CHermeticRegistryStore::svzKey_Values, CHermeticRegistryStore::svzValueName_DWORD, dwValue);
+		benchmark::DoNotOptimize(sr);
+		benchmark::DoNotOptimize(dwValue);
+	}
+}
+BENCHMARK(BM_ReadValue_DWORD);
+
+static void BM_ReadValue_QWORD(benchmark::State& state)
+{
+	SkipIfHermeticStoreUnavailable(state);
+	const auto oReg = GetHermeticRegistryAccess();
+	CRegistryAccess::QWORD qwValue{};
+
+	for (auto _ : state)
+	{
+		auto sr = oReg.ReadValue_QWORD(CHermeticRegistryStore::svzKey_Values, CHermeticRegistryStore::svzValueName_QWORD, qwValue);
+		benchmark::DoNotOptimize(sr);
+		benchmark::DoNotOptimize(qwValue);
+	}
+}
+BENCHMARK(BM_ReadValue_QWORD);
+
+static void BM_ReadValue_MultiSz(benchmark::State& state)
+{
+	SkipIfHermeticStoreUnavailable(state);
+	const auto oReg = GetHermeticRegistryAccess();
+	std::vector<vlr::tstring> arrValueCollection;
+
+	for (auto _ : state)
+	{
+		arrValueCollection.clear();
+		auto sr = oReg.ReadValue_MultiSz(CHermeticRegistryStore::svzKey_Values, CHermeticRegistryStore::svzValueName_MultiSz, arrValueCollection);
+		benchmark::DoNotOptimize(sr);
+		benchmark::DoNotOptimize(arrValueCollection.data());
+	}
+}
+BENCHMARK(BM_ReadValue_MultiSz);
+
+static void BM_ReadValue_Binary(benchmark::State& state)
+{
+	SkipIfHermeticStoreUnavailable(state);
+	const auto oReg = GetHermeticRegistryAccess();
+	std::vector<BYTE> arrData;
+
+	for (auto _ : state)
+	{
+		auto sr = oReg.ReadValue_Binary(CHermeticRegistryStore::svzKey_Values, CHermeticRegistryStore::svzValueName_Binary, arrData);
+		benchmark::DoNotOptimize(sr);
+		benchmark::DoNotOptimize(arrData.data());
+	}
+}
+BENCHMARK(BM_ReadValue_Binary);
+
+static void BM_ReadValue_Binary_Large(benchmark::State& state)
+{
+	SkipIfHermeticStoreUnavailable(state);
+	const auto oReg = GetHermeticRegistryAccess();
+	std::vector<BYTE> arrData;
+
+	for (auto _ : state)
+	{
+		auto sr = oReg.ReadValue_Binary(CHermeticRegistryStore::svzKey_Values, CHermeticRegistryStore::svzValueName_Binary_Large, arrData);
+		benchmark::DoNotOptimize(sr);
+		benchmark::DoNotOptimize(arrData.data());
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(CHermeticRegistryStore::nBinaryLargeSize));
+}
+BENCHMARK(BM_ReadValue_Binary_Large);
+
+static void BM_ReadValue_Binary_Large_IntoBuffer(benchmark::State& state)
+{
+	SkipIfHermeticStoreUnavailable(state);
+	const auto oReg = GetHermeticRegistryAccess();
+	// Note: Caller-owned buffer, reused across reads
+	std::vector<BYTE> arrBuffer(CHermeticRegistryStore::nBinaryLargeSize);
+
+	for (auto _ : state)
+	{
+		size_t nDataSize{};
+		auto sr = oReg.ReadValue_Binary(CHermeticRegistryStore::svzKey_Values, CHermeticRegistryStore::svzValueName_Binary_Large, cpp::span<BYTE>{ arrBuffer }, nDataSize);
+		benchmark::DoNotOptimize(sr);
+		benchmark::DoNotOptimize(nDataSize);
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(CHermeticRegistryStore::nBinaryLargeSize));
+}
+BENCHMARK(BM_ReadValue_Binary_Large_IntoBuffer);
+
+static void BM_ReadValue_Binary_Large_Chunked(benchmark::State& state)
+{
+	SkipIfHermeticStoreUnavailable(state);
+	const auto oReg = GetHermeticRegistryAccess();
+	auto fOnBinaryChunk = [](cpp::span<const BYTE> spanChunk, size_t /*nOffset*/, size_t /*nTotalSize*/) -> SResult
+	{
+		benchmark::DoNotOptimize(spanChunk.data());
+		return SResult::Success;
+	};
+
+	for (auto _ : state)
+	{
+		auto sr = oReg.ReadValue_Binary(CHermeticRegistryStore::svzKey_Values, CHermeticRegistryStore::svzValueName_Binary_Large, fOnBinaryChunk, static_cast<size_t>(state.range(0)));
+		benchmark::DoNotOptimize(sr);
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(CHermeticRegistryStore::nBinaryLargeSize));
+}
+BENCHMARK(BM_ReadValue_Binary_Large_Chunked)->ArgName("chunkSize")->Arg(4 << 10)->Arg(64 << 10);
+
+static void BM_EnumAllValues(benchmark::State& state)
+{
+	SkipIfHermeticStoreUnavailable(state);
+	const auto oReg = GetHermeticRegistryAccess();
+
+	for (auto _ : state)
+	{
+		size_t nValueCount = 0;
+		auto sr = oReg.EnumAllValues(CHermeticRegistryStore::svzKey_ManyValues, [&](const CRegistryAccess::EnumValueData& /*oEnumValueData*/)
+		{
+			++nValueCount;
+			return SResult::Success;
+		});
+		benchmark::DoNotOptimize(sr);
+		benchmark::DoNotOptimize(nValueCount);
+	}
+	state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * CHermeticRegistryStore::nManyValuesCount);
+}
+BENCHMARK(BM_EnumAllValues);
+
+static void BM_RealAllValuesIntoMap(benchmark::State& state)
+{
+	SkipIfHermeticStoreUnavailable(state);
+	const auto oReg = GetHermeticRegistryAccess();
+
+	for (auto _ : state)
+	{
+		std::unordered_map<vlr::tstring, CRegistryAccess::ValueMapEntry> mapNameToValue;
+		auto sr = oReg.RealAllValuesIntoMap(CHermeticRegistryStore::svzKey_ManyValues, mapNameToValue);
+		benchmark::DoNotOptimize(sr);
+		benchmark::DoNotOptimize(mapNameToValue);
+	}
+	state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * CHermeticRegistryStore::nManyValuesCount);
+}
+BENCHMARK(BM_RealAllValuesIntoMap);
+
+static void BM_RealAllValuesIntoMap_Interned(benchmark::State& state)
+{
+	SkipIfHermeticStoreUnavailable(state);
+	const auto oReg = GetHermeticRegistryAccess();
+	// Note: Shared across reads, as for a crawl across similar keys
+	auto oNameInternPool = registry::CNameInternPool{};
+
+	for (auto _ : state)
+	{
+		std::unordered_map<vlr::tstring_view, CRegistryAccess::ValueMapEntry> mapNameToValue;
+		auto sr = oReg.RealAllValuesIntoMap(CHermeticRegistryStore::svzKey_ManyValues, mapNameToValue, oNameInternPool);
+		benchmark::DoNotOptimize(sr);
+		benchmark::DoNotOptimize(mapNameToValue);
+	}
+	state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * CHermeticRegistryStore::nManyValuesCount);
+}
+BENCHMARK(BM_RealAllValuesIntoMap_Interned);
+
+static void BM_EnumAllSubkeys(benchmark::State& state)
+{
+	SkipIfHermeticStoreUnavailable(state);
+	const auto oReg = GetHermeticRegistryAccess();
+
+	for (auto _ : state)
+	{
+		size_t nSubkeyCount = 0;
+		auto sr = oReg.EnumAllSubkeys(CHermeticRegistryStore::svzKey_Subkeys, [&](const CRegistryAccess::EnumSubkeyData& /*oEnumSubkeyData*/)
+		{
+			++nSubkeyCount;
+			return SResult::Success;
+		});
+		benchmark::DoNotOptimize(sr);
+		benchmark::DoNotOptimize(nSubkeyCount);
+	}
+	state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * CHermeticRegistryStore::nSubkeysCount);
+}
+BENCHMARK(BM_EnumAllSubkeys);
+
+static void BM_EnumAllSubkeysWithInfo(benchmark::State& state)
+{
+	SkipIfHermeticStoreUnavailable(state);
+	const auto oReg = GetHermeticRegistryAccess();
+	const auto options = CRegistryAccess::Options_EnumSubkeysWithInfo{}
+		.withMaxPrefetchInFlight(static_cast<size_t>(state.range(0)));
+
+	for (auto _ : state)
+	{
+		size_t nSubkeyCount = 0;
+		auto sr = oReg.EnumAllSubkeysWithInfo(CHermeticRegistryStore::svzKey_Subkeys, [&](const CRegistryAccess::EnumSubkeyWithInfoData& /*oEnumSubkeyWithInfoData*/)
+		{
+			++nSubkeyCount;
+			return SResult::Success;
+		}, options);
+		benchmark::DoNotOptimize(sr);
+		benchmark::DoNotOptimize(nSubkeyCount);
+	}
+	state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * CHermeticRegistryStore::nSubkeysCount);
+}
+BENCHMARK(BM_EnumAllSubkeysWithInfo)->ArgName("prefetch")->Arg(0)->Arg(1)->Arg(8);
+
+//////////////////////////////////////////////////////////////////////////
+// Search
+
+// Note: Worst-ish case for the literal kernel; the needle only matches at the very end of the haystack
+static void BM_FindSubstring_StdFind(benchmark::State& state)
+{
+	const auto swHaystack = MakeSampleString<std::wstring>(static_cast<size_t>(state.range(0))) + L"needle";
+	const auto svNeedle = std::wstring_view{ L"needle" };
+
+	for (auto _ : state)
+	{
+		auto nIndex = std::wstring_view{ swHaystack }.find(svNeedle);
+		benchmark::DoNotOptimize(nIndex);
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(swHaystack.size() * sizeof(wchar_t)));
+}
+BENCHMARK(BM_FindSubstring_StdFind)->RangeMultiplier(8)->Range(16, 16 << 12);
+
+static void BM_FindSubstring(benchmark::State& state)
+{
+	const auto swHaystack = MakeSampleString<std::wstring>(static_cast<size_t>(state.range(0))) + L"needle";
+	const auto svNeedle = std::wstring_view{ L"needle" };
+
+	for (auto _ : state)
+	{
+		auto nIndex = win32::strings::FindSubstring<wchar_t>(swHaystack, svNeedle);
+		benchmark::DoNotOptimize(nIndex);
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(swHaystack.size() * sizeof(wchar_t)));
+}
+BENCHMARK(BM_FindSubstring)->RangeMultiplier(8)->Range(16, 16 << 12);
+
+static void BM_FindSubstring_CaseInsensitive(benchmark::State& state)
+{
+	const auto swHaystack = MakeSampleString<std::wstring>(static_cast<size_t>(state.range(0))) + L"needle";
+	const auto svNeedle = std::wstring_view{ L"NEEDLE" };
+
+	for (auto _ : state)
+	{
+		auto nIndex = win32::strings::FindSubstring_CaseInsensitive<wchar_t>(swHaystack, svNeedle);
+		benchmark::DoNotOptimize(nIndex);
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(swHaystack.size() * sizeof(wchar_t)));
+}
+BENCHMARK(BM_FindSubstring_CaseInsensitive)->RangeMultiplier(8)->Range(16, 16 << 12);
+
+static void BM_AreEqual_CaseInsensitive_StringCompare(benchmark::State& state)
+{
+	const auto swLHS = MakeSampleString<std::wstring>(static_cast<size_t>(state.range(0)));
+	auto swRHS = swLHS;
+	std::transform(swRHS.begin(), swRHS.end(), swRHS.begin(), [](wchar_t wch) { return static_cast<wchar_t>(::towupper(wch)); });
+
+	for (auto _ : state)
+	{
+		auto bEqual = StringCompare::CI().AreEqual(swLHS, swRHS);
+		benchmark::DoNotOptimize(bEqual);
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(swLHS.size() * sizeof(wchar_t)));
+}
+BENCHMARK(BM_AreEqual_CaseInsensitive_StringCompare)->RangeMultiplier(8)->Range(8, 8 << 6);
+
+static void BM_AreEqual_CaseInsensitive_CaseFold(benchmark::State& state)
+{
+	const auto swLHS = MakeSampleString<std::wstring>(static_cast<size_t>(state.range(0)));
+	auto swRHS = swLHS;
+	std::transform(swRHS.begin(), swRHS.end(), swRHS.begin(), [](wchar_t wch) { return static_cast<wchar_t>(::towupper(wch)); });
+
+	for (auto _ : state)
+	{
+		auto bEqual = win32::strings::AreEqual_CaseInsensitive<wchar_t>(swLHS, swRHS);
+		benchmark::DoNotOptimize(bEqual);
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(swLHS.size() * sizeof(wchar_t)));
+}
+BENCHMARK(BM_AreEqual_CaseInsensitive_CaseFold)->RangeMultiplier(8)->Range(8, 8 << 6);
+
+static void BM_Hash_CaseInsensitive(benchmark::State& state)
+{
+	const auto swValue = MakeSampleString<std::wstring>(static_cast<size_t>(state.range(0)));
+
+	for (auto _ : state)
+	{
+		auto nHash = win32::strings::Hash_CaseInsensitive<wchar_t>(swValue);
+		benchmark::DoNotOptimize(nHash);
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(swValue.size() * sizeof(wchar_t)));
+}
+BENCHMARK(BM_Hash_CaseInsensitive)->RangeMultiplier(8)->Range(8, 8 << 6);
+
+static void BM_AppendBase64(benchmark::State& state)
+{
+	auto arrData = std::vector<BYTE>(static_cast<size_t>(state.range(0)));
+	std::generate(arrData.begin(), arrData.end(), [nValue = BYTE{}]() mutable { return nValue += 37; });
+	std::string saOutput;
+
+	for (auto _ : state)
+	{
+		saOutput.clear();
+		win32::strings::AppendBase64(arrData.data(), arrData.size(), saOutput);
+		benchmark::DoNotOptimize(saOutput.data());
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(arrData.size()));
+}
+BENCHMARK(BM_AppendBase64)->RangeMultiplier(16)->Range(16, 1 << 20);
+
+static void BM_AppendBase64_Scalar(benchmark::State& state)
+{
+	auto arrData = std::vector<BYTE>(static_cast<size_t>(state.range(0)));
+	std::generate(arrData.begin(), arrData.end(), [nValue = BYTE{}]() mutable { return nValue += 37; });
+	auto saOutput = std::string(win32::strings::GetBase64EncodedLength(arrData.size()), '\0');
+
+	for (auto _ : state)
+	{
+		win32::strings::detail::EncodeBase64_Scalar(arrData.data(), arrData.size(), saOutput.data());
+		benchmark::DoNotOptimize(saOutput.data());
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(arrData.size()));
+}
+BENCHMARK(BM_AppendBase64_Scalar)->RangeMultiplier(16)->Range(16, 1 << 20);
+
+static void BM_ReadValue_Coerced_DWORD(benchmark::State& state)
+{
+	SkipIfHermeticStoreUnavailable(state);
+	const auto oReg = GetHermeticRegistryAccess();
+	DWORD dwValue{};
+
+	for (auto _ : state)
+	{
+		auto sr = oReg.ReadValue_Coerced(CHermeticRegistryStore::svzKey_Values, CHermeticRegistryStore::svzValueName_DWORD, dwValue);
+		benchmark::DoNotOptimize(sr);
+		benchmark::DoNotOptimize(dwValue);
+	}
+}
+BENCHMARK(BM_ReadValue_Coerced_DWORD);
+
+static void BM_Export_NDJson(benchmark::State& state)
+{
+	SkipIfHermeticStoreUnavailable(state);
+	const auto oRegExport = CRegistryAccessExport{ GetHermeticRegistryAccess() };
+	size_t nBytesPerExport = 0;
+
+	for (auto _ : state)
+	{
+		CRegistryAccessExport::Result_Export oResult;
+		auto sr = oRegExport.ExportToCallback(_T(""), [&](std::string_view svOutput)
+		{
+			benchmark::DoNotOptimize(svOutput.data());
+			return SResult::Success;
+		}, {}, &oResult);
+		benchmark::DoNotOptimize(sr);
+		nBytesPerExport = oResult.m_nBytesWritten;
+	}
+	state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(nBytesPerExport));
+}
+BENCHMARK(BM_Export_NDJson);
+
+static void BM_Search_Literal(benchmark::State& state)
+{
+	SkipIfHermeticStoreUnavailable(state);
+	const auto oRegSearch = CRegistryAccessSearch{ GetHermeticRegistryAccess() };
+	const auto options = CRegistryAccessSearch::Options_Search{}
+		.withThreadCount(static_cast<size_t>(state.range(0)));
+
+	for (auto _ : state)
+	{
+		CRegistryAccessSearch::Result_Search oResult;
+		auto sr = oRegSearch.Search(_T(""), _T("fox"), [&](const CRegistryAccessSearch::SearchMatch& /*oSearchMatch*/)
+		{
+			return SResult::Success;
+		}, options, &oResult);
+		benchmark::DoNotOptimize(sr);
+		benchmark::DoNotOptimize(oResult);
+	}
+}
+BENCHMARK(BM_Search_Literal)->ArgName("threads")->Arg(1)->Arg(4)->UseRealTime();
+
+// Note: Contention comparison; each thread either uses its own instance (opening the key on every read), or all
+// threads share one instance with per-thread handle caches.
+
+static void BM_ReadValue_DWORD_PerThreadInstance(benchmark::State& state)
+{
+	SkipIfHermeticStoreUnavailable(state);
+	const auto oReg = GetHermeticRegistryAccess();
+	DWORD dwValue{};
+
+	for (auto _ : state)
+	{
+		auto sr = oReg.ReadValue_DWORD(CHermeticRegistryStore::svzKey_Values, CHermeticRegistryStore::svzValueName_DWORD, dwValue);
+		benchmark::DoNotOptimize(sr);
+		benchmark::DoNotOptimize(dwValue);
+	}
+}
+BENCHMARK(BM_ReadValue_DWORD_PerThreadInstance)->ThreadRange(1, 64)->UseRealTime();
+
+static void BM_Shared_ReadValue_DWORD(benchmark::State& state)
+{
+	SkipIfHermeticStoreUnavailable(state);
+	static const auto oRegShared = CRegistryAccessShared{ GetHermeticRegistryAccess() };
+	DWORD dwValue{};
+
+	for (auto _ : state)
+	{
+		auto sr = oRegShared.ReadValue_DWORD(CHermeticRegistryStore::svzKey_Values, CHermeticRegistryStore::svzValueName_DWORD, dwValue);
+		benchmark::DoNotOptimize(sr);
+		benchmark::DoNotOptimize(dwValue);
+	}
+}
+BENCHMARK(BM_Shared_ReadValue_DWORD)->ThreadRange(1, 64)->UseRealTime();
@@ -0,0 +1,46 @@
+// vlr-util-win32.bench.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+
+#include "pch.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Note: Results are always written in JSON (machine-readable) form, so they can be tracked release over release.
+// If the command line does not specify an output file, a default is added here. Any of the standard
+// benchmark flags (eg: --benchmark_filter, --benchmark_out) can still be passed explicitly.
+
+static constexpr auto pszDefaultOutputFileArg = "--benchmark_out=vlr-util-win32.bench.json";
+static constexpr auto pszDefaultOutputFormatArg = "--benchmark_out_format=json";
+
+int main(int argc, char** argv)
+{
+	auto arrCommandLine = std::vector<char*>{ argv, argv + argc };
+
+	bool bHasOutputFileArg = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strncmp(argv[i], "--benchmark_out=", std::strlen("--benchmark_out=")) == 0)
+		{
+			bHasOutputFileArg = true;
+		}
+	}
+	if (!bHasOutputFileArg)
+	{
+		arrCommandLine.push_back(const_cast<char*>(pszDefaultOutputFileArg));
+		arrCommandLine.push_back(const_cast<char*>(pszDefaultOutputFormatArg));
+	}
+
+	int nArgCount = static_cast<int>(arrCommandLine.size());
+	benchmark::Initialize(&nArgCount, arrCommandLine.data());
+	if (benchmark::ReportUnrecognizedArguments(nArgCount, arrCommandLine.data()))
+	{
+		return 1;
+	}
+
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+
+	return 0;
+}
@@ -3,6 +3,9 @@
 
 #include <gtest/gtest.h>
 
+#include <vlr-util/ActionOnDestruction.h>
+#include <vlr-util/StringCompare.h>
+
 using namespace vlr;
 using namespace vlr::win32;
 
@@ -42,3 +45,158 @@ TEST(AppOptionSource_Registry, ReadAllValuesFromPathAsOptions)
 		EXPECT_EQ(oAppOptions.GetCount_SpecifiedValues(), nCurrentCountSpecifiedValues);
 	}
 }
+
+TEST(AppOptionSource_Registry, ReloadChangedValuesFromPathAsOptions)
+{
+	static constexpr auto svzTestKey = tzstring_view{ _T("SOFTWARE\\vlr-test\\AppOptionReload") };
+	static constexpr auto svzValueName_A = tzstring_view{ _T("optionA") };
+	static constexpr auto svzValueName_B = tzstring_view{ _T("optionB") };
+
+	SResult sr;
+
+	CAppOptions oAppOptions;
+
+	auto oReg = CRegistryAccess{ HKEY_CURRENT_USER };
+	sr = oReg.EnsureKeyExists(svzTestKey);
+	ASSERT_TRUE(sr.isSuccess());
+	auto onDestroy_DeleteKey = MakeActionOnDestruction([&] { oReg.DeleteKey(svzTestKey); });
+	sr = oReg.WriteValue_DWORD(svzTestKey, svzValueName_A, 1);
+	ASSERT_EQ(sr, S_OK);
+
+	CAppOptionSource_Registry oAppOptionSource_Registry;
+	oAppOptionSource_Registry.withAppOptionsOverride(&oAppOptions);
+
+	// First reload applies everything
+	{
+		CAppOptionSource_Registry::Result_IncrementalReload oResult;
+		sr = oAppOptionSource_Registry.ReloadChangedValuesFromPathAsOptions(oReg, svzTestKey, &oResult);
+		EXPECT_EQ(sr, S_OK);
+		EXPECT_FALSE(oResult.m_bSkippedUnchangedKey);
+		EXPECT_EQ(oResult.m_nAddedCount, 1U);
+		EXPECT_EQ(oResult.m_nChangedCount, 0U);
+
+		SPCAppOptionSpecifiedValue spSpecifiedValue;
+		sr = oAppOptions.FindSpecifiedValueByName(svzValueName_A, spSpecifiedValue);
+		EXPECT_EQ(sr, S_OK);
+	}
+
+	// Nothing changed; either skipped by write time, or enumerated with nothing applied
+	{
+		CAppOptionSource_Registry::Result_IncrementalReload oResult;
+		sr = oAppOptionSource_Registry.ReloadChangedValuesFromPathAsOptions(oReg, svzTestKey, &oResult);
+		EXPECT_TRUE(sr.isSuccess());
+		EXPECT_EQ(oResult.m_nAddedCount, 0U);
+		EXPECT_EQ(oResult.m_nChangedCount, 0U);
+		EXPECT_TRUE(oResult.m_arrRemovedOptionNames.empty());
+	}
+
+	// One changed, one added
+	sr = oReg.WriteValue_DWORD(svzTestKey, svzValueName_A, 2);
+	ASSERT_EQ(sr, S_OK);
+	sr = oReg.WriteValue_String(svzTestKey, svzValueName_B, vlr::tstring{ _T("value") });
+	ASSERT_EQ(sr, S_OK);
+	{
+		CAppOptionSource_Registry::Result_IncrementalReload oResult;
+		sr = oAppOptionSource_Registry.ReloadChangedValuesFromPathAsOptions(oReg, svzTestKey, &oResult);
+		EXPECT_EQ(sr, S_OK);
+		EXPECT_EQ(oResult.m_nAddedCount, 1U);
+		EXPECT_EQ(oResult.m_nChangedCount, 1U);
+	}
+
+	// One removed
+	sr = oReg.DeleteValue(svzTestKey, svzValueName_A);
+	ASSERT_EQ(sr, S_OK);
+	{
+		CAppOptionSource_Registry::Result_IncrementalReload oResult;
+		sr = oAppOptionSource_Registry.ReloadChangedValuesFromPathAsOptions(oReg, svzTestKey, &oResult);
+		EXPECT_EQ(sr, S_OK);
+		EXPECT_EQ(oResult.m_nAddedCount, 0U);
+		EXPECT_EQ(oResult.m_nChangedCount, 0U);
+		ASSERT_EQ(oResult.m_arrRemovedOptionNames.size(), 1U);
+		EXPECT_TRUE(StringCompare::CS().AreEqual(oResult.m_arrRemovedOptionNames[0], svzValueName_A));
+	}
+
+	// A value of an unsupported type is never applied, so its deletion is not a removal
+	static constexpr auto svzValueName_C = tzstring_view{ _T("optionC") };
+	static constexpr BYTE arrBinaryData[] = { 0x01, 0x02, 0x03 };
+	sr = oReg.WriteValue_Binary(svzTestKey, svzValueName_C, arrBinaryData);
+	ASSERT_EQ(sr, S_OK);
+	{
+		CAppOptionSource_Registry::Result_IncrementalReload oResult;
+		sr = oAppOptionSource_Registry.ReloadChangedValuesFromPathAsOptions(oReg, svzTestKey, &oResult);
+		EXPECT_EQ(sr, S_OK);
+		EXPECT_EQ(oResult.m_nAddedCount, 0U);
+		EXPECT_EQ(oResult.m_nChangedCount, 0U);
+		EXPECT_TRUE(oResult.m_arrRemovedOptionNames.empty());
+	}
+	sr = oReg.DeleteValue(svzTestKey, svzValueName_C);
+	ASSERT_EQ(sr, S_OK);
+	{
+		CAppOptionSource_Registry::Result_IncrementalReload oResult;
+		sr = oAppOptionSource_Registry.ReloadChangedValuesFromPathAsOptions(oReg, svzTestKey, &oResult);
+		EXPECT_EQ(sr, S_OK);
+		EXPECT_TRUE(oResult.m_arrRemovedOptionNames.empty());
+	}
+
+	// An applied value which changes to an unsupported type is a removal (and is not reported again once deleted)
+	sr = oReg.WriteValue_Binary(svzTestKey, svzValueName_B, arrBinaryData);
+	ASSERT_EQ(sr, S_OK);
+	{
+		CAppOptionSource_Registry::Result_IncrementalReload oResult;
+		sr = oAppOptionSource_Registry.ReloadChangedValuesFromPathAsOptions(oReg, svzTestKey, &oResult);
+		EXPECT_EQ(sr, S_OK);
+		EXPECT_EQ(oResult.m_nAddedCount, 0U);
+		EXPECT_EQ(oResult.m_nChangedCount, 0U);
+		ASSERT_EQ(oResult.m_arrRemovedOptionNames.size(), 1U);
+		EXPECT_TRUE(StringCompare::CS().AreEqual(oResult.m_arrRemovedOptionNames[0], svzValueName_B));
+	}
+	sr = oReg.DeleteValue(svzTestKey, svzValueName_B);
+	ASSERT_EQ(sr, S_OK);
+	{
+		CAppOptionSource_Registry::Result_IncrementalReload oResult;
+		sr = oAppOptionSource_Registry.ReloadChangedValuesFromPathAsOptions(oReg, svzTestKey, &oResult);
+		EXPECT_EQ(sr, S_OK);
+		EXPECT_TRUE(oResult.m_arrRemovedOptionNames.empty());
+	}
+}
+
+TEST(AppOptionSource_Registry, ReadLayeredValuesAsOptions)
+{
+	SResult sr;
+
+	CAppOptions oAppOptions;
+
+	CAppOptionSource_Registry oAppOptionSource_Registry;
+	oAppOptionSource_Registry.withAppOptionsOverride(&oAppOptions);
+
+	auto arrLayers = std::vector<CAppOptionSource_Registry::Layer>{
+		{ CRegistryAccess{ HKEY_LOCAL_MACHINE }, _T("SOFTWARE\\Microsoft\\Windows\\CurrentVersion") },
+		{ CRegistryAccess{ HKEY_CURRENT_USER }, _T("SOFTWARE\\BlahBlah\\NotThere") },
+		{ CRegistryAccess{ HKEY_CURRENT_USER }, _T("SOFTWARE\\vlr-test") },
+	};
+
+	CAppOptionSource_Registry::Result_LayeredRead oResult;
+	sr = oAppOptionSource_Registry.ReadLayeredValuesAsOptions(arrLayers, &oResult);
+	EXPECT_EQ(sr, S_OK);
+	ASSERT_EQ(oResult.m_arrLayerResults.size(), arrLayers.size());
+	EXPECT_EQ(oResult.m_arrLayerResults[0], S_OK);
+	// Missing layer is not a failure
+	EXPECT_EQ(oResult.m_arrLayerResults[1], S_FALSE);
+	EXPECT_EQ(oResult.m_arrLayerResults[2], S_OK);
+
+	// Each merged option is added once
+	EXPECT_EQ(oAppOptions.GetCount_SpecifiedValues(), oResult.m_nAppliedCount);
+	EXPECT_GE(oResult.m_nAppliedCount, 5U);
+
+	// Options from both existing layers should be present
+	{
+		SPCAppOptionSpecifiedValue spSpecifiedValue;
+		sr = oAppOptions.FindSpecifiedValueByName(_T("ProgramFilesDir"), spSpecifiedValue);
+		EXPECT_EQ(sr, S_OK);
+	}
+	{
+		SPCAppOptionSpecifiedValue spSpecifiedValue;
+		sr = oAppOptions.FindSpecifiedValueByName(_T("testDWORD"), spSpecifiedValue);
+		EXPECT_EQ(sr, S_OK);
+	}
+}
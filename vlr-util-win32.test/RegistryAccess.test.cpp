@@ -1,14 +1,35 @@
 #include "pch.h"
 
+#include <algorithm>
+#include <cstring>
+#include <thread>
 #include <vector>
 #include <fmt/format.h>
 
+#include "vlr-util/ActionOnDestruction.h"
 #include "vlr-util/cpp_namespace.h"
 #include "vlr-util/StringCompare.h"
 #include "vlr-util/util.data_adaptor.MultiSZ.h"
 #include "vlr-util/util.convert.StringConversion.h"
 
+#include "vlr-util-win32/AutoCleanupTypedefs.h"
+#include "vlr-util-win32/filesystem.Functions.h"
+#include "vlr-util-win32/registry.RegKey.h"
 #include "vlr-util-win32/RegistryAccess.h"
+#include "vlr-util-win32/RegistryAccess_Async.h"
+#include "vlr-util-win32/RegistryAccess_Atomic.h"
+#include "vlr-util-win32/RegistryAccess_CopyTree.h"
+#include "vlr-util-win32/RegistryAccess_Crawler.h"
+#include "vlr-util-win32/RegistryAccess_Diff.h"
+#include "vlr-util-win32/RegistryAccess_DualView.h"
+#include "vlr-util-win32/RegistryAccess_Export.h"
+#include "vlr-util-win32/RegistryAccess_Index.h"
+#include "vlr-util-win32/RegistryAccess_Instrumentation.h"
+#include "vlr-util-win32/RegistryAccess_Search.h"
+#include "vlr-util-win32/RegistryAccess_Shared.h"
+#include "vlr-util-win32/RegistryAccess_TraceRecorder.h"
+#include "vlr-util-win32/RegistryAccess_TraceReplay.h"
+#include "vlr-util-win32/RegistryAccess_WriteBehind.h"
 
 using namespace vlr;
 using namespace vlr::win32;
@@ -629,6 +650,163 @@ TEST(RegistryAccess, ReadValue_WithDefault)
 	}
 }
 
+TEST(RegistryAccess, ReadValue_Coerced)
+{
+	SResult sr;
+
+	static constexpr auto svzTestValueName_NumericSZ = vlr::tzstring_view{ _T("testNumericString") };
+	static constexpr auto svzTestValueName_LargeSZ = vlr::tzstring_view{ _T("testLargeString") };
+
+	auto oReg = CRegistryAccess{ HKEY_CURRENT_USER };
+	auto fDeleteTestValues = [&] {
+		oReg.DeleteValue(svzTestKey, svzTestValueName_NumericSZ);
+		oReg.DeleteValue(svzTestKey, svzTestValueName_LargeSZ);
+	};
+	fDeleteTestValues();
+	auto oOnDestroy_DeleteTestValues = MakeActionOnDestruction(fDeleteTestValues);
+
+	ASSERT_EQ(oReg.WriteValue_String(svzTestKey, svzTestValueName_NumericSZ, vlr::tstring{ _T("42") }), SResult::Success);
+	// Note: Larger than the stack buffer, so read through the overflow path
+	const auto sLargeValue = vlr::tstring(1000, _T('7'));
+	ASSERT_EQ(oReg.WriteValue_String(svzTestKey, svzTestValueName_LargeSZ, sLargeValue), SResult::Success);
+
+	{
+		DWORD dwValue{};
+		sr = oReg.ReadValue_Coerced(svzTestKey, svzTestValueName_DWORD, dwValue, registry::CoercionMode::Strict);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_EQ(dwValue, nTestValue_DWORD);
+
+		sr = oReg.ReadValue_Coerced(svzTestKey, svzTestValueName_QWORD, dwValue, registry::CoercionMode::Strict);
+		EXPECT_EQ(sr.asHRESULT(), E_UNEXPECTED);
+		dwValue = 0;
+		sr = oReg.ReadValue_Coerced(svzTestKey, svzTestValueName_QWORD, dwValue);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_EQ(dwValue, nTestValue_DWORD);
+
+		sr = oReg.ReadValue_Coerced(svzTestKey, svzTestValueName_NumericSZ, dwValue);
+		EXPECT_EQ(sr.asHRESULT(), E_UNEXPECTED);
+		dwValue = 0;
+		sr = oReg.ReadValue_Coerced(svzTestKey, svzTestValueName_NumericSZ, dwValue, registry::CoercionMode::NumericParse);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_EQ(dwValue, 42U);
+
+		sr = oReg.ReadValue_Coerced(svzTestKey, svzTestValueName_SZ, dwValue, registry::CoercionMode::NumericParse);
+		EXPECT_EQ(sr.asHRESULT(), __HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+		sr = oReg.ReadValue_Coerced(svzTestKey, svzTestValueName_LargeSZ, dwValue, registry::CoercionMode::NumericParse);
+		EXPECT_EQ(sr.asHRESULT(), __HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW));
+	}
+	{
+		bool bValue{};
+		sr = oReg.ReadValue_Coerced(svzTestKey, svzTestValueName_DWORD, bValue, registry::CoercionMode::Strict);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_TRUE(bValue);
+
+		bValue = true;
+		sr = oReg.ReadValue_Coerced(svzTestKey, svzTestValueName_Invalid, bValue, false);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_FALSE(bValue);
+	}
+	{
+		vlr::tstring sValue;
+		sr = oReg.ReadValue_Coerced(svzTestKey, svzTestValueName_QWORD, sValue);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_EQ(sValue, _T("42"));
+
+		sr = oReg.ReadValue_Coerced(svzTestKey, svzTestValueName_LargeSZ, sValue, registry::CoercionMode::Strict);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_EQ(sValue, sLargeValue);
+	}
+}
+
+TEST(RegistryAccess, ReadValue_Binary_Streaming)
+{
+	SResult sr;
+
+	static constexpr auto svzTestValueName_LargeBinary = vlr::tzstring_view{ _T("testLargeBinary") };
+
+	auto oReg = CRegistryAccess{ HKEY_CURRENT_USER };
+	auto fDeleteTestValues = [&] {
+		oReg.DeleteValue(svzTestKey, svzTestValueName_LargeBinary);
+	};
+	fDeleteTestValues();
+	auto oOnDestroy_DeleteTestValues = MakeActionOnDestruction(fDeleteTestValues);
+
+	auto arrLargeValue = std::vector<BYTE>(300 * 1024);
+	for (size_t i = 0; i < arrLargeValue.size(); ++i)
+	{
+		arrLargeValue[i] = static_cast<BYTE>(i * 7);
+	}
+	ASSERT_EQ(oReg.WriteValue_Binary(svzTestKey, svzTestValueName_LargeBinary, arrLargeValue), SResult::Success);
+
+	{
+		std::vector<BYTE> arrData;
+		sr = oReg.ReadValue_Binary(svzTestKey, svzTestValueName_LargeBinary, arrData);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_EQ(arrData, arrLargeValue);
+
+		// Note: The result is unchanged on failure
+		sr = oReg.ReadValue_Binary(svzTestKey, svzTestValueName_DWORD, arrData);
+		EXPECT_EQ(sr.asHRESULT(), E_UNEXPECTED);
+		EXPECT_EQ(arrData.size(), arrLargeValue.size());
+
+		// Note: A value which fits the default buffer is read with one query
+		sr = oReg.ReadValue_Binary(svzTestKey, svzTestValueName_BINARY, arrData);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_EQ(arrData, arrTestValue_Binary);
+	}
+	{
+		std::array<BYTE, 16> arrBuffer{};
+		size_t nDataSize{};
+		sr = oReg.ReadValue_Binary(svzTestKey, svzTestValueName_BINARY, cpp::span<BYTE>{ arrBuffer }, nDataSize);
+		EXPECT_EQ(sr, SResult::Success);
+		ASSERT_EQ(nDataSize, arrTestValue_Binary.size());
+		EXPECT_TRUE(std::equal(arrTestValue_Binary.begin(), arrTestValue_Binary.end(), arrBuffer.begin()));
+
+		sr = oReg.ReadValue_Binary(svzTestKey, svzTestValueName_LargeBinary, cpp::span<BYTE>{ arrBuffer }, nDataSize);
+		EXPECT_EQ(sr.asHRESULT(), __HRESULT_FROM_WIN32(ERROR_MORE_DATA));
+		EXPECT_EQ(nDataSize, arrLargeValue.size());
+
+		std::vector<BYTE> arrLargeBuffer(nDataSize);
+		sr = oReg.ReadValue_Binary(svzTestKey, svzTestValueName_LargeBinary, cpp::span<BYTE>{ arrLargeBuffer }, nDataSize);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_EQ(arrLargeBuffer, arrLargeValue);
+
+		sr = oReg.ReadValue_Binary(svzTestKey, svzTestValueName_SZ, cpp::span<BYTE>{ arrBuffer }, nDataSize);
+		EXPECT_EQ(sr.asHRESULT(), E_UNEXPECTED);
+		sr = oReg.ReadValue_Binary(svzTestKey, svzTestValueName_Invalid, cpp::span<BYTE>{ arrBuffer }, nDataSize);
+		EXPECT_EQ(sr.asHRESULT(), __HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+	}
+	{
+		static constexpr size_t nChunkSize = 64 * 1024;
+		std::vector<BYTE> arrData;
+		size_t nChunkCount = 0;
+		auto fOnBinaryChunk = [&](cpp::span<const BYTE> spanChunk, size_t nOffset, size_t nTotalSize) -> SResult
+		{
+			EXPECT_EQ(nOffset, arrData.size());
+			EXPECT_EQ(nTotalSize, arrLargeValue.size());
+			EXPECT_LE(spanChunk.size(), nChunkSize);
+			arrData.insert(arrData.end(), spanChunk.begin(), spanChunk.end());
+			++nChunkCount;
+			return SResult::Success;
+		};
+		sr = oReg.ReadValue_Binary(svzTestKey, svzTestValueName_LargeBinary, fOnBinaryChunk, nChunkSize);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_EQ(nChunkCount, 5U);
+		EXPECT_EQ(arrData, arrLargeValue);
+
+		// Note: Failure from the callback stops the read
+		nChunkCount = 0;
+		auto fOnBinaryChunk_Stop = [&](cpp::span<const BYTE> /*spanChunk*/, size_t /*nOffset*/, size_t /*nTotalSize*/) -> SResult
+		{
+			++nChunkCount;
+			return E_ABORT;
+		};
+		sr = oReg.ReadValue_Binary(svzTestKey, svzTestValueName_LargeBinary, fOnBinaryChunk_Stop, nChunkSize);
+		EXPECT_EQ(sr.asHRESULT(), E_ABORT);
+		EXPECT_EQ(nChunkCount, 1U);
+	}
+}
+
 TEST(RegistryAccess, DeleteValue)
 {
 	SResult sr;
@@ -716,6 +894,96 @@ TEST(RegistryAccess, EnumAllValues)
 	EXPECT_EQ(m_bReadTestValue_Binary, true);
 }
 
+TEST(RegistryAccess, EnumValueData_TypedViews)
+{
+	SResult sr;
+
+	size_t nTestValuesRead = 0;
+
+	auto oReg = CRegistryAccess{ HKEY_CURRENT_USER };
+
+	auto fOnEnumValueData = [&](const CRegistryAccess::EnumValueData& oEnumValueData)
+	{
+		if (StringCompare::CS().AreEqual(oEnumValueData.m_svName, svzTestValueName_SZ))
+		{
+			auto oStringView = oEnumValueData.AsStringView();
+			EXPECT_TRUE(oStringView.has_value());
+			EXPECT_TRUE(StringCompare::CS().AreEqual(oStringView.value_or(vlr::tstring_view{}), svzTestValue_SZ));
+			EXPECT_FALSE(oEnumValueData.AsDWORD().has_value());
+			EXPECT_FALSE(oEnumValueData.AsMultiSzRange().has_value());
+			++nTestValuesRead;
+		}
+		else if (StringCompare::CS().AreEqual(oEnumValueData.m_svName, svzTestValueName_DWORD))
+		{
+			EXPECT_EQ(oEnumValueData.AsDWORD(), std::optional<DWORD>{ nTestValue_DWORD });
+			EXPECT_FALSE(oEnumValueData.AsQWORD().has_value());
+			++nTestValuesRead;
+		}
+		else if (StringCompare::CS().AreEqual(oEnumValueData.m_svName, svzTestValueName_QWORD))
+		{
+			EXPECT_EQ(oEnumValueData.AsQWORD(), std::optional<QWORD>{ nTestValue_QWORD });
+			EXPECT_FALSE(oEnumValueData.AsDWORD().has_value());
+			++nTestValuesRead;
+		}
+		else if (StringCompare::CS().AreEqual(oEnumValueData.m_svName, svzTestValueName_MultiSz))
+		{
+			auto oMultiSzRange = oEnumValueData.AsMultiSzRange();
+			EXPECT_TRUE(oMultiSzRange.has_value());
+			std::vector<vlr::tstring> arrValues;
+			for (const auto& svElement : oMultiSzRange.value_or(CRegistryAccess::MultiSzRange{}))
+			{
+				arrValues.emplace_back(svElement);
+			}
+			EXPECT_EQ(arrValues, arrTestValue_MultiSz);
+			EXPECT_FALSE(oEnumValueData.AsStringView().has_value());
+			++nTestValuesRead;
+		}
+		else if (StringCompare::CS().AreEqual(oEnumValueData.m_svName, svzTestValueName_BINARY))
+		{
+			auto oBinary = oEnumValueData.AsBinary();
+			EXPECT_TRUE(oBinary.has_value());
+			if (oBinary.has_value())
+			{
+				EXPECT_TRUE(std::equal(oBinary->begin(), oBinary->end(), arrTestValue_Binary.begin(), arrTestValue_Binary.end()));
+			}
+			++nTestValuesRead;
+		}
+
+		return SResult::Success;
+	};
+
+	sr = oReg.EnumAllValues(svzTestKey, fOnEnumValueData);
+	EXPECT_EQ(sr, S_OK);
+	EXPECT_EQ(nTestValuesRead, 5U);
+
+	// Note: Malformed data (wrong size, missing terminators)
+	{
+		const auto arrData = std::vector<BYTE>{ 0x01, 0x02, 0x03 };
+		auto oEnumValueData = CRegistryAccess::EnumValueData{}.withType(REG_DWORD).withData(arrData);
+		EXPECT_FALSE(oEnumValueData.AsDWORD().has_value());
+		oEnumValueData.withType(REG_SZ);
+		EXPECT_EQ(oEnumValueData.AsStringView().has_value(), (sizeof(TCHAR) == 1));
+	}
+	{
+		static constexpr TCHAR arrChars[] = { _T('a'), _T('\0'), _T('b'), _T('c') };
+		auto spanData = cpp::span<const BYTE>{ reinterpret_cast<const BYTE*>(arrChars), sizeof(arrChars) };
+		auto oEnumValueData = CRegistryAccess::EnumValueData{}.withType(REG_MULTI_SZ).withData(spanData);
+		auto oMultiSzRange = oEnumValueData.AsMultiSzRange();
+		ASSERT_TRUE(oMultiSzRange.has_value());
+		auto arrValues = std::vector<vlr::tstring_view>{ oMultiSzRange->begin(), oMultiSzRange->end() };
+		EXPECT_EQ(arrValues, (std::vector<vlr::tstring_view>{ _T("a"), _T("bc") }));
+
+		oEnumValueData.withType(REG_SZ);
+		EXPECT_EQ(oEnumValueData.AsStringView(), std::optional<vlr::tstring_view>{ vlr::tstring_view{ arrChars, std::size(arrChars) } });
+	}
+	{
+		auto oEnumValueData = CRegistryAccess::EnumValueData{}.withType(REG_MULTI_SZ);
+		auto oMultiSzRange = oEnumValueData.AsMultiSzRange();
+		ASSERT_TRUE(oMultiSzRange.has_value());
+		EXPECT_TRUE(oMultiSzRange->empty());
+	}
+}
+
 TEST(RegistryAccess, RealAllValuesIntoMap)
 {
 	SResult sr;
@@ -936,3 +1204,1882 @@ TEST(RegistryAccess, ReadAllSubkeysIntoVector)
 	EXPECT_EQ(m_bReadTestSubkey_1, true);
 	EXPECT_EQ(m_bReadTestSubkey_2, true);
 }
+
+TEST(RegistryAccess, ReadIntoCollections_Interned)
+{
+	SResult sr;
+
+	auto oReg = CRegistryAccess{ HKEY_CURRENT_USER };
+	auto oNameInternPool = registry::CNameInternPool{};
+
+	std::unordered_map<vlr::tstring_view, CRegistryAccess::ValueMapEntry> mapNameToValue;
+	sr = oReg.RealAllValuesIntoMap(svzTestKey, mapNameToValue, oNameInternPool);
+	EXPECT_EQ(sr, SResult::Success);
+	auto fFindValue = [&](vlr::tzstring_view svzValueName)
+	{
+		return mapNameToValue.find(vlr::tstring_view{ svzValueName.data(), svzValueName.size() });
+	};
+	{
+		auto iter = fFindValue(svzTestValueName_DWORD);
+		ASSERT_NE(iter, mapNameToValue.end());
+		ASSERT_NE(iter->second.m_spValue_DWORD, nullptr);
+		EXPECT_EQ(*iter->second.m_spValue_DWORD, nTestValue_DWORD);
+		EXPECT_TRUE(iter->second.m_sValueName.empty());
+	}
+	{
+		auto iter = fFindValue(svzTestValueName_SZ);
+		ASSERT_NE(iter, mapNameToValue.end());
+		ASSERT_NE(iter->second.m_spValue_SZ, nullptr);
+		EXPECT_EQ(StringCompare::CS().AreEqual(*iter->second.m_spValue_SZ, svzTestValue_SZ), true);
+	}
+
+	// Note: A second read (eg: of a similar key) reuses the pooled names
+	auto nNameCount = oNameInternPool.GetStats().m_nNameCount;
+	EXPECT_EQ(nNameCount, mapNameToValue.size());
+	std::unordered_map<vlr::tstring_view, CRegistryAccess::ValueMapEntry> mapNameToValue_Again;
+	sr = oReg.RealAllValuesIntoMap(svzTestKey, mapNameToValue_Again, oNameInternPool);
+	EXPECT_EQ(sr, SResult::Success);
+	EXPECT_EQ(oNameInternPool.GetStats().m_nNameCount, nNameCount);
+	for (const auto& mapEntry : mapNameToValue_Again)
+	{
+		auto iter = mapNameToValue.find(mapEntry.first);
+		ASSERT_NE(iter, mapNameToValue.end());
+		EXPECT_EQ(iter->first.data(), mapEntry.first.data());
+	}
+
+	std::vector<vlr::tzstring_view> arrSubkeyNames;
+	sr = oReg.ReadAllSubkeysIntoVector(svzTestKey, arrSubkeyNames, oNameInternPool);
+	EXPECT_EQ(sr, SResult::Success);
+	auto fHasSubkey = [&](vlr::tstring_view svSubkeyName)
+	{
+		return std::any_of(arrSubkeyNames.begin(), arrSubkeyNames.end(), [&](const auto& svzName) {
+			return StringCompare::CS().AreEqual(svzName, svSubkeyName);
+		});
+	};
+	EXPECT_TRUE(fHasSubkey(svzTestValueSubkeyName_1));
+	EXPECT_TRUE(fHasSubkey(svzTestValueSubkeyName_2));
+}
+
+TEST(RegistryAccess, EnumAllSubkeysWithInfo)
+{
+	SResult sr;
+
+	auto oReg = CRegistryAccess{ HKEY_CURRENT_USER };
+
+	// Note: Check with prefetch disabled (inline), and with a window smaller and larger than the subkey count
+	for (size_t nMaxPrefetchInFlight : { size_t{ 0 }, size_t{ 1 }, size_t{ 16 } })
+	{
+		bool m_bReadTestSubkey_1 = false;
+		bool m_bReadTestSubkey_2 = false;
+		std::optional<DWORD> odwLastIndex;
+
+		auto fOnEnumSubkeyWithInfoData = [&](const CRegistryAccess::EnumSubkeyWithInfoData& oEnumSubkeyWithInfoData)
+		{
+			// Results should be delivered in enumeration order
+			if (odwLastIndex.has_value())
+			{
+				EXPECT_EQ(oEnumSubkeyWithInfoData.m_dwIndex, odwLastIndex.value() + 1);
+			}
+			odwLastIndex = oEnumSubkeyWithInfoData.m_dwIndex;
+
+			EXPECT_EQ(oEnumSubkeyWithInfoData.m_srKeyInfo, SResult::Success);
+
+			if (StringCompare::CS().AreEqual(oEnumSubkeyWithInfoData.m_svName, svzTestValueSubkeyName_1))
+			{
+				m_bReadTestSubkey_1 = true;
+			}
+			if (StringCompare::CS().AreEqual(oEnumSubkeyWithInfoData.m_svName, svzTestValueSubkeyName_2))
+			{
+				m_bReadTestSubkey_2 = true;
+			}
+
+			return SResult::Success;
+		};
+
+		const auto oOptions = CRegistryAccess::Options_EnumSubkeysWithInfo{}
+		.withMaxPrefetchInFlight(nMaxPrefetchInFlight);
+		sr = oReg.EnumAllSubkeysWithInfo(svzTestKey, fOnEnumSubkeyWithInfoData, oOptions);
+		EXPECT_EQ(sr, S_OK);
+
+		EXPECT_EQ(m_bReadTestSubkey_1, true);
+		EXPECT_EQ(m_bReadTestSubkey_2, true);
+	}
+
+	// Key info for the parent should agree with the enumeration
+	{
+		CRegistryAccess::KeyInfo oKeyInfo{};
+		sr = oReg.ReadKeyInfo(svzTestKey, oKeyInfo);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_GE(oKeyInfo.m_dwSubkeyCount, 2U);
+		EXPECT_GE(oKeyInfo.m_dwValueCount, 5U);
+	}
+}
+
+TEST(RegistryAccess, Instrumentation)
+{
+	namespace Instrumentation = RegistryAccess::Instrumentation;
+
+	EXPECT_EQ(Instrumentation::GetLatencyHistogramBucket(0), 0U);
+	EXPECT_EQ(Instrumentation::GetLatencyHistogramBucket(1), 1U);
+	EXPECT_EQ(Instrumentation::GetLatencyHistogramBucket(3), 2U);
+	EXPECT_EQ(Instrumentation::GetLatencyHistogramBucket(1024), 11U);
+	EXPECT_EQ(Instrumentation::GetLatencyHistogramBucket(~uint64_t{}), Instrumentation::LatencyHistogramBucketCount - 1);
+
+	SResult sr;
+
+	auto oSnapshot_Before = Instrumentation::GetSnapshot();
+
+	auto oReg = CRegistryAccess{ HKEY_CURRENT_USER };
+	DWORD dwValue{};
+	sr = oReg.ReadValue_DWORD(svzTestKey, svzTestValueName_DWORD, dwValue);
+	EXPECT_EQ(sr, SResult::Success);
+	sr = oReg.ReadValue_DWORD(svzTestKey, svzTestValueName_Invalid, dwValue);
+	EXPECT_NE(sr, SResult::Success);
+
+	// Note: The callback's time is the caller's, so should not be counted in the enumerate latency
+	static constexpr auto durCallbackSleep = std::chrono::milliseconds{ 20 };
+	size_t nCallbackCount = 0;
+	sr = oReg.EnumAllValues(svzTestKey, [&](const CRegistryAccess::EnumValueData&) -> SResult
+	{
+		++nCallbackCount;
+		std::this_thread::sleep_for(durCallbackSleep);
+		return SResult::Success;
+	});
+	EXPECT_EQ(sr, SResult::Success);
+	EXPECT_GE(nCallbackCount, 5U);
+
+	// CRegKey reads are counted through the same instrumentation
+	auto oSnapshot_BeforeRegKey = Instrumentation::GetSnapshot();
+	{
+		auto oRegKey_Base = registry::CRegKey{ HKEY_CURRENT_USER };
+		registry::CRegKey oRegKey_Test;
+		HRESULT hr = oRegKey_Base.OpenKey(svzTestKey, oRegKey_Test, registry::Options_OpenKey{}.WithAccess_Read());
+		ASSERT_EQ(hr, S_OK);
+		registry::Result_GetValue oResult_GetValue;
+		auto oOptions_SmallBuffer = registry::Options_GetValue{};
+		oOptions_SmallBuffer.m_nInitialBufferSize = 1;
+		hr = oRegKey_Test.GetValue(svzTestValueName_DWORD, oResult_GetValue, oOptions_SmallBuffer);
+		EXPECT_EQ(hr, S_OK);
+	}
+
+	auto oSnapshot_After = Instrumentation::GetSnapshot();
+
+	const auto& oOpenStats_Before = oSnapshot_Before.ForOperation(Instrumentation::Open);
+	const auto& oOpenStats_After = oSnapshot_After.ForOperation(Instrumentation::Open);
+	const auto& oQueryStats_Before = oSnapshot_Before.ForOperation(Instrumentation::Query);
+	const auto& oQueryStats_BeforeRegKey = oSnapshot_BeforeRegKey.ForOperation(Instrumentation::Query);
+	const auto& oQueryStats_After = oSnapshot_After.ForOperation(Instrumentation::Query);
+	const auto& oEnumerateStats_Before = oSnapshot_Before.ForOperation(Instrumentation::Enumerate);
+	const auto& oEnumerateStats_After = oSnapshot_After.ForOperation(Instrumentation::Enumerate);
+	if constexpr (VLR_WIN32_CONFIG_REGISTRY_INSTRUMENTATION)
+	{
+		EXPECT_GE(oOpenStats_After.m_nCount, oOpenStats_Before.m_nCount + 4);
+		EXPECT_GE(oQueryStats_After.m_nCount, oQueryStats_Before.m_nCount + 3);
+		EXPECT_GE(oQueryStats_After.m_nByteCount, oQueryStats_Before.m_nByteCount + 2 * sizeof(DWORD));
+		EXPECT_GT(oQueryStats_After.GetApproxLatencyPercentileMicroseconds(50), 0U);
+
+		// The missing value is an error
+		EXPECT_GE(oQueryStats_BeforeRegKey.m_nErrorCount, oQueryStats_Before.m_nErrorCount + 1);
+
+		// The CRegKey read: one query, which grew the buffer once
+		EXPECT_GE(oQueryStats_After.m_nCount, oQueryStats_BeforeRegKey.m_nCount + 1);
+		EXPECT_GE(oQueryStats_After.m_nRetryCount, oQueryStats_BeforeRegKey.m_nRetryCount + 1);
+		EXPECT_EQ(oQueryStats_After.m_nErrorCount, oQueryStats_BeforeRegKey.m_nErrorCount);
+
+		EXPECT_GE(oEnumerateStats_After.m_nCount, oEnumerateStats_Before.m_nCount + 1);
+		auto nEnumerateLatencyMicroseconds = oEnumerateStats_After.m_nTotalLatencyMicroseconds - oEnumerateStats_Before.m_nTotalLatencyMicroseconds;
+		EXPECT_LT(nEnumerateLatencyMicroseconds, static_cast<uint64_t>(std::chrono::microseconds{ durCallbackSleep }.count()));
+	}
+	else
+	{
+		EXPECT_EQ(oOpenStats_After.m_nCount, 0U);
+		EXPECT_EQ(oQueryStats_After.m_nCount, 0U);
+		EXPECT_EQ(oEnumerateStats_After.m_nCount, 0U);
+	}
+}
+
+TEST(RegistryAccess, Async)
+{
+	auto oReg = CRegistryAccess{ HKEY_CURRENT_USER };
+	auto oRegAsync = CRegistryAccessAsync{ oReg, CRegistryAccessAsync::Options_Async{}.withThreadCount(1) };
+
+	// Note: These are queued together, so they should be served from one batch (one open, one enumeration)
+	auto oFuture_SZ = oRegAsync.ReadValue_String(svzTestKey, svzTestValueName_SZ);
+	auto oFuture_DWORD = oRegAsync.ReadValue_DWORD(svzTestKey, svzTestValueName_DWORD);
+	auto oFuture_QWORD = oRegAsync.ReadValue_QWORD(svzTestKey, svzTestValueName_QWORD);
+	auto oFuture_MultiSz = oRegAsync.ReadValue_MultiSz(svzTestKey, svzTestValueName_MultiSz);
+	auto oFuture_Binary = oRegAsync.ReadValue_Binary(svzTestKey, svzTestValueName_BINARY);
+	auto oFuture_Invalid = oRegAsync.ReadValue_DWORD(svzTestKey, svzTestValueName_Invalid);
+	auto oFuture_Map = oRegAsync.ReadAllValuesIntoMap(svzTestKey);
+
+	{
+		auto oResult = oFuture_SZ.get();
+		EXPECT_EQ(oResult.m_sr, SResult::Success);
+		EXPECT_EQ(StringCompare::CS().AreEqual(oResult.m_tValue, svzTestValue_SZ), true);
+	}
+	{
+		auto oResult = oFuture_DWORD.get();
+		EXPECT_EQ(oResult.m_sr, SResult::Success);
+		EXPECT_EQ(oResult.m_tValue, nTestValue_DWORD);
+	}
+	{
+		auto oResult = oFuture_QWORD.get();
+		EXPECT_EQ(oResult.m_sr, SResult::Success);
+		EXPECT_EQ(oResult.m_tValue, nTestValue_QWORD);
+	}
+	{
+		auto oResult = oFuture_MultiSz.get();
+		EXPECT_EQ(oResult.m_sr, SResult::Success);
+		EXPECT_EQ(oResult.m_tValue.size(), arrTestValue_MultiSz.size());
+	}
+	{
+		auto oResult = oFuture_Binary.get();
+		EXPECT_EQ(oResult.m_sr, SResult::Success);
+		ValidateReadDataMatch_Binary(REG_BINARY, oResult.m_tValue);
+	}
+	{
+		auto oResult = oFuture_Invalid.get();
+		EXPECT_EQ(oResult.m_sr.asHRESULT(), __HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+	}
+	{
+		auto oResult = oFuture_Map.get();
+		EXPECT_EQ(oResult.m_sr, SResult::Success);
+		EXPECT_GE(oResult.m_tValue.size(), 5U);
+	}
+	{
+		auto oStats = oRegAsync.GetStats();
+		EXPECT_EQ(oStats.m_nRequestsQueued, 7U);
+		EXPECT_EQ(oStats.m_nEnumerations, 1U);
+		EXPECT_LE(oStats.m_nKeyOpens, oStats.m_nBatchesQueued);
+	}
+
+	// Note: A burst of requests for one key is queued much faster than the I/O thread serves them, so they are
+	// coalesced into few batches (and key opens)
+	{
+		static constexpr size_t nBurstCount = 64;
+		auto oStats_Before = oRegAsync.GetStats();
+
+		std::vector<std::future<CRegistryAccessAsync::AsyncResult<DWORD>>> arrFutures;
+		for (size_t i = 0; i < nBurstCount; ++i)
+		{
+			arrFutures.push_back(oRegAsync.ReadValue_DWORD(svzTestKey, svzTestValueName_DWORD));
+		}
+		for (auto& oFuture : arrFutures)
+		{
+			auto oResult = oFuture.get();
+			EXPECT_EQ(oResult.m_sr, SResult::Success);
+			EXPECT_EQ(oResult.m_tValue, nTestValue_DWORD);
+		}
+
+		auto oStats = oRegAsync.GetStats();
+		EXPECT_EQ(oStats.m_nRequestsQueued - oStats_Before.m_nRequestsQueued, nBurstCount);
+		EXPECT_LT(oStats.m_nBatchesQueued - oStats_Before.m_nBatchesQueued, nBurstCount);
+		EXPECT_LT(oStats.m_nKeyOpens - oStats_Before.m_nKeyOpens, nBurstCount);
+		EXPECT_EQ(oStats.m_nValueQueries - oStats_Before.m_nValueQueries, nBurstCount);
+	}
+
+	// Invalid key fails the request, rather than throwing from the future
+	{
+		auto oResult = oRegAsync.ReadValue_DWORD(svzBaseKey_Invalid, svzTestValueName_DWORD).get();
+		EXPECT_FALSE(oResult.m_sr.isSuccess());
+	}
+
+	// Cancelled before being served
+	{
+		auto oCancellationToken = CRegistryAccessAsync::CCancellationToken{};
+		oCancellationToken.Cancel();
+		const auto oOptions = CRegistryAccessAsync::Options_Request{}
+		.withCancellationToken(oCancellationToken);
+		auto oResult = oRegAsync.ReadValue_DWORD(svzTestKey, svzTestValueName_DWORD, oOptions).get();
+		EXPECT_EQ(oResult.m_sr.asHRESULT(), __HRESULT_FROM_WIN32(ERROR_CANCELLED));
+	}
+
+	// Deadline already passed
+	{
+		const auto oOptions = CRegistryAccessAsync::Options_Request{}
+		.withDeadline(std::chrono::steady_clock::now() - std::chrono::seconds{ 1 });
+		auto oResult = oRegAsync.ReadValue_DWORD(svzTestKey, svzTestValueName_DWORD, oOptions).get();
+		EXPECT_EQ(oResult.m_sr.asHRESULT(), __HRESULT_FROM_WIN32(ERROR_TIMEOUT));
+	}
+}
+
+TEST(RegistryAccess, DualView)
+{
+	SResult sr;
+
+	auto oRegDualView = CRegistryAccessDualView{ HKEY_CURRENT_USER };
+
+	// Note: HKCU\SOFTWARE is shared between the views (not redirected), so the test key is only read once
+	{
+		std::vector<CRegistryAccessDualView::DualViewSubkeyData> arrSubkeys;
+		sr = oRegDualView.EnumAllSubkeys(svzTestKey, arrSubkeys);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_GE(arrSubkeys.size(), 2U);
+		size_t nTestSubkeyCount = 0;
+		for (const auto& oSubkeyData : arrSubkeys)
+		{
+			EXPECT_EQ(oSubkeyData.m_dwViewFlags, RegistryAccess::RegistryView_Both);
+			if (StringCompare::CS().AreEqual(oSubkeyData.m_sName, svzTestValueSubkeyName_1)
+				|| StringCompare::CS().AreEqual(oSubkeyData.m_sName, svzTestValueSubkeyName_2))
+			{
+				++nTestSubkeyCount;
+			}
+		}
+		EXPECT_EQ(nTestSubkeyCount, 2U);
+	}
+	{
+		std::vector<CRegistryAccessDualView::DualViewValueMap> arrValueMaps;
+		sr = oRegDualView.ReadAllValuesIntoMaps(svzTestKey, arrValueMaps);
+		EXPECT_EQ(sr, SResult::Success);
+		ASSERT_EQ(arrValueMaps.size(), 1U);
+		EXPECT_EQ(arrValueMaps[0].m_dwViewFlags, RegistryAccess::RegistryView_Both);
+		auto iterValue = arrValueMaps[0].m_mapNameToValue.find(vlr::tstring{ svzTestValueName_DWORD });
+		ASSERT_NE(iterValue, arrValueMaps[0].m_mapNameToValue.end());
+		ASSERT_NE(iterValue->second.m_spValue_DWORD, nullptr);
+		EXPECT_EQ(*iterValue->second.m_spValue_DWORD, nTestValue_DWORD);
+	}
+
+	// Key missing from both views
+	{
+		std::vector<CRegistryAccessDualView::DualViewSubkeyData> arrSubkeys;
+		sr = oRegDualView.EnumAllSubkeys(svzBaseKey_Invalid, arrSubkeys);
+		EXPECT_EQ(sr.asHRESULT(), __HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+	}
+
+	// Kernel name is the full object path
+	{
+		HKEY hKey{};
+		sr = CRegistryAccess{ HKEY_CURRENT_USER }.OpenKey(svzTestKey, KEY_READ, hKey);
+		ASSERT_EQ(sr, SResult::Success);
+		auto onDestroy_CloseRegKey = AutoCloseRegKey{ hKey };
+
+		std::wstring swKernelKeyName;
+		sr = CRegistryAccessDualView::GetKernelKeyName(hKey, swKernelKeyName);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_TRUE(StringCompare::CI().StringHasPrefix(swKernelKeyName, L"\\REGISTRY\\USER\\"));
+	}
+
+	// Note: HKLM\SOFTWARE is redirected (the 32-bit view is WOW6432Node), so the views are read separately and merged;
+	// children which are the same key in both views (eg: Classes, which is shared) are only returned once
+	{
+		static constexpr auto svzRedirectedKey = vlr::tzstring_view{ _T("SOFTWARE") };
+
+		auto fMakeRegForView = [](RegistryAccess::SEWow64KeyAccessOption eWow64KeyAccessOption)
+		{
+			auto oReg = CRegistryAccess{ HKEY_LOCAL_MACHINE };
+			oReg.SetWow64KeyAccessOption(eWow64KeyAccessOption);
+			return oReg;
+		};
+		const auto oReg_32bit = fMakeRegForView(RegistryAccess::Wow64KeyAccessOption::UseExplicit32bit);
+		const auto oReg_64bit = fMakeRegForView(RegistryAccess::Wow64KeyAccessOption::UseExplicit64bit);
+		auto fGetSubkeyNames = [&](const CRegistryAccess& oReg)
+		{
+			std::vector<vlr::tstring> arrNames;
+			auto srEnum = oReg.EnumAllSubkeys(svzRedirectedKey, [&](const CRegistryAccess::EnumSubkeyData& oEnumSubkeyData) -> SResult
+			{
+				arrNames.emplace_back(oEnumSubkeyData.m_svName);
+				return SResult::Success;
+			});
+			EXPECT_EQ(srEnum, SResult::Success);
+			return arrNames;
+		};
+		const auto arrNames_32bit = fGetSubkeyNames(oReg_32bit);
+		const auto arrNames_64bit = fGetSubkeyNames(oReg_64bit);
+
+		auto oRegDualView_Machine = CRegistryAccessDualView{ HKEY_LOCAL_MACHINE };
+		std::vector<CRegistryAccessDualView::DualViewSubkeyData> arrSubkeys;
+		sr = oRegDualView_Machine.EnumAllSubkeys(svzRedirectedKey, arrSubkeys);
+		ASSERT_EQ(sr, SResult::Success);
+
+		// Merge order: the 64-bit view's subkeys (in its enumeration order), then the subkeys only in the 32-bit view
+		ASSERT_GE(arrSubkeys.size(), arrNames_64bit.size());
+		for (size_t i = 0; i < arrSubkeys.size(); ++i)
+		{
+			if (i < arrNames_64bit.size())
+			{
+				EXPECT_EQ(arrSubkeys[i].m_sName, arrNames_64bit[i]);
+				EXPECT_NE(arrSubkeys[i].m_dwViewFlags & RegistryAccess::RegistryView_64bit, 0U);
+			}
+			else
+			{
+				EXPECT_EQ(arrSubkeys[i].m_dwViewFlags, RegistryAccess::RegistryView_32bit);
+			}
+			if (StringCompare::CI().AreEqual(arrSubkeys[i].m_sName, _T("WOW6432Node")))
+			{
+				EXPECT_EQ(arrSubkeys[i].m_dwViewFlags, RegistryAccess::RegistryView_64bit);
+			}
+		}
+
+		// Each view's subkeys are tagged with that view
+		auto fGetSortedNamesForView = [&](DWORD dwViewFlag)
+		{
+			std::vector<vlr::tstring> arrNames;
+			for (const auto& oSubkeyData : arrSubkeys)
+			{
+				if (oSubkeyData.m_dwViewFlags & dwViewFlag)
+				{
+					arrNames.push_back(oSubkeyData.m_sName);
+				}
+			}
+			std::sort(arrNames.begin(), arrNames.end());
+			return arrNames;
+		};
+		auto fGetSorted = [](std::vector<vlr::tstring> arrNames)
+		{
+			std::sort(arrNames.begin(), arrNames.end());
+			return arrNames;
+		};
+		EXPECT_EQ(fGetSortedNamesForView(RegistryAccess::RegistryView_32bit), fGetSorted(arrNames_32bit));
+		EXPECT_EQ(fGetSortedNamesForView(RegistryAccess::RegistryView_64bit), fGetSorted(arrNames_64bit));
+
+		// Dedupe: a name in both views is one entry (tagged with both) if it is the same key, else one per view
+		size_t nSharedSubkeyCount = 0;
+		for (const auto& sName : arrNames_32bit)
+		{
+			if (std::find(arrNames_64bit.begin(), arrNames_64bit.end(), sName) == arrNames_64bit.end())
+			{
+				continue;
+			}
+			HKEY hKey_32bit{};
+			HKEY hKey_64bit{};
+			auto sSubkeyPath = MakeRegistryPath(svzRedirectedKey, vlr::tstring_view{ sName });
+			if (!oReg_32bit.OpenKey(sSubkeyPath, KEY_READ, hKey_32bit).isSuccess())
+			{
+				continue;
+			}
+			auto onDestroy_CloseRegKey_32bit = AutoCloseRegKey{ hKey_32bit };
+			if (!oReg_64bit.OpenKey(sSubkeyPath, KEY_READ, hKey_64bit).isSuccess())
+			{
+				continue;
+			}
+			auto onDestroy_CloseRegKey_64bit = AutoCloseRegKey{ hKey_64bit };
+			std::wstring swKernelKeyName_32bit;
+			std::wstring swKernelKeyName_64bit;
+			ASSERT_EQ(CRegistryAccessDualView::GetKernelKeyName(hKey_32bit, swKernelKeyName_32bit), SResult::Success);
+			ASSERT_EQ(CRegistryAccessDualView::GetKernelKeyName(hKey_64bit, swKernelKeyName_64bit), SResult::Success);
+			bool bIsSameKey = StringCompare::CI().AreEqual(swKernelKeyName_32bit, swKernelKeyName_64bit);
+
+			auto nEntryCount = std::count_if(arrSubkeys.begin(), arrSubkeys.end(), [&](const CRegistryAccessDualView::DualViewSubkeyData& oSubkeyData)
+			{
+				return (oSubkeyData.m_sName == sName);
+			});
+			if (bIsSameKey)
+			{
+				++nSharedSubkeyCount;
+				EXPECT_EQ(nEntryCount, 1);
+			}
+			else
+			{
+				EXPECT_EQ(nEntryCount, 2);
+			}
+		}
+		EXPECT_GT(nSharedSubkeyCount, 0U);
+
+		std::vector<CRegistryAccessDualView::DualViewValueMap> arrValueMaps;
+		sr = oRegDualView_Machine.ReadAllValuesIntoMaps(svzRedirectedKey, arrValueMaps);
+		EXPECT_EQ(sr, SResult::Success);
+		ASSERT_EQ(arrValueMaps.size(), 2U);
+		EXPECT_EQ(arrValueMaps[0].m_dwViewFlags, RegistryAccess::RegistryView_64bit);
+		EXPECT_EQ(arrValueMaps[1].m_dwViewFlags, RegistryAccess::RegistryView_32bit);
+	}
+}
+
+TEST(RegistryAccess, Search)
+{
+	SResult sr;
+
+	auto oRegSearch = CRegistryAccessSearch{ CRegistryAccess{ HKEY_CURRENT_USER } };
+
+	// Literal (case-insensitive) over string data; matches testString and testMultiSz
+	{
+		std::vector<vlr::tstring> arrMatchedValueNames;
+		const auto oOptions = CRegistryAccessSearch::Options_Search{}
+		.withSearchTargets(RegistryAccess::SearchTarget_ValueData)
+		.withMaxDepth(0);
+		CRegistryAccessSearch::Result_Search oResult;
+		sr = oRegSearch.Search(svzTestKey, _T("VALUE"), [&](const CRegistryAccessSearch::SearchMatch& oSearchMatch)
+		{
+			EXPECT_TRUE(StringCompare::CI().AreEqual(oSearchMatch.m_svKeyPath, svzTestKey));
+			EXPECT_EQ(oSearchMatch.m_eMatchedTarget, RegistryAccess::SearchTarget_ValueData);
+			arrMatchedValueNames.emplace_back(oSearchMatch.m_svValueName);
+			return SResult::Success;
+		}, oOptions, &oResult);
+		EXPECT_EQ(sr, SResult::Success);
+		// Note: Other tests may leave copies of the test values, so check for the specific names
+		EXPECT_EQ(oResult.m_nMatchCount, arrMatchedValueNames.size());
+		EXPECT_NE(std::find(arrMatchedValueNames.begin(), arrMatchedValueNames.end(), vlr::tstring{ svzTestValueName_SZ }), arrMatchedValueNames.end());
+		EXPECT_NE(std::find(arrMatchedValueNames.begin(), arrMatchedValueNames.end(), vlr::tstring{ svzTestValueName_MultiSz }), arrMatchedValueNames.end());
+		EXPECT_EQ(oResult.m_nKeysVisited, 1U);
+		EXPECT_GE(oResult.m_nValuesVisited, 5U);
+	}
+
+	// Literal, case-sensitive
+	{
+		size_t nMatchCount = 0;
+		const auto oOptions = CRegistryAccessSearch::Options_Search{}
+		.withSearchTargets(RegistryAccess::SearchTarget_ValueData)
+		.withCaseInsensitive(false)
+		.withMaxDepth(0);
+		sr = oRegSearch.Search(svzTestKey, _T("VALUE"), [&](const CRegistryAccessSearch::SearchMatch&)
+		{
+			++nMatchCount;
+			return SResult::Success;
+		}, oOptions);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_EQ(nMatchCount, 0U);
+	}
+
+	// Glob over key names, across the subtree
+	{
+		std::vector<vlr::tstring> arrMatchedKeyPaths;
+		const auto oOptions = CRegistryAccessSearch::Options_Search{}
+		.withMatchMode(RegistryAccess::SearchMatchMode::Glob)
+		.withSearchTargets(RegistryAccess::SearchTarget_KeyName);
+		sr = oRegSearch.Search(svzTestKey, _T("subkey?"), [&](const CRegistryAccessSearch::SearchMatch& oSearchMatch)
+		{
+			arrMatchedKeyPaths.emplace_back(oSearchMatch.m_svKeyPath);
+			return SResult::Success;
+		}, oOptions);
+		EXPECT_EQ(sr, SResult::Success);
+		ASSERT_EQ(arrMatchedKeyPaths.size(), 2U);
+		std::sort(arrMatchedKeyPaths.begin(), arrMatchedKeyPaths.end());
+		EXPECT_TRUE(StringCompare::CS().AreEqual(arrMatchedKeyPaths[0], MakeRegistryPath(svzTestKey, svzTestValueSubkeyName_1)));
+		EXPECT_TRUE(StringCompare::CS().AreEqual(arrMatchedKeyPaths[1], MakeRegistryPath(svzTestKey, svzTestValueSubkeyName_2)));
+	}
+
+	// Regex over value names
+	{
+		size_t nMatchCount = 0;
+		const auto oOptions = CRegistryAccessSearch::Options_Search{}
+		.withMatchMode(RegistryAccess::SearchMatchMode::Regex)
+		.withSearchTargets(RegistryAccess::SearchTarget_ValueName)
+		.withMaxDepth(0);
+		sr = oRegSearch.Search(svzTestKey, _T("^test[DQ]WORD$"), [&](const CRegistryAccessSearch::SearchMatch&)
+		{
+			++nMatchCount;
+			return SResult::Success;
+		}, oOptions);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_EQ(nMatchCount, 2U);
+	}
+
+	// Invalid regex
+	{
+		const auto oOptions = CRegistryAccessSearch::Options_Search{}
+		.withMatchMode(RegistryAccess::SearchMatchMode::Regex);
+		sr = oRegSearch.Search(svzTestKey, _T("(unclosed"), [&](const CRegistryAccessSearch::SearchMatch&)
+		{
+			return SResult::Success;
+		}, oOptions);
+		EXPECT_EQ(sr, E_INVALIDARG);
+	}
+
+	// Callback failure stops the search, and is returned
+	{
+		size_t nMatchCount = 0;
+		sr = oRegSearch.Search(svzTestKey, _T("test"), [&](const CRegistryAccessSearch::SearchMatch&)
+		{
+			++nMatchCount;
+			return SResult{ E_ABORT };
+		});
+		EXPECT_EQ(sr, E_ABORT);
+		EXPECT_EQ(nMatchCount, 1U);
+	}
+}
+
+TEST(RegistryAccess, Index)
+{
+	SResult sr;
+
+	{
+		std::vector<vlr::tstring> arrTokens;
+		CRegistryAccessIndex::TokenizeText(_T("{0002DF01-0000-c000} C:\\Windows\\x.dll"), arrTokens);
+		const auto arrTokens_Expected = std::vector<vlr::tstring>{ _T("0002DF01"), _T("0000"), _T("C000"), _T("WINDOWS"), _T("DLL") };
+		EXPECT_EQ(arrTokens, arrTokens_Expected);
+	}
+
+	auto oIndex = CRegistryAccessIndex{ CRegistryAccess{ HKEY_CURRENT_USER }, svzTestKey };
+
+	CRegistryAccessIndex::Result_Refresh oResult;
+	sr = oIndex.Refresh(&oResult);
+	EXPECT_EQ(sr, SResult::Success);
+	EXPECT_GE(oResult.m_nKeysVisited, 3U);
+	EXPECT_EQ(oResult.m_nKeysReindexed, oResult.m_nKeysVisited);
+	EXPECT_EQ(oIndex.GetKeyCount(), oResult.m_nKeysVisited);
+
+	auto fContainsTestKey = [](const std::vector<vlr::tstring>& arrKeyPaths)
+	{
+		return std::any_of(arrKeyPaths.begin(), arrKeyPaths.end(), [](const vlr::tstring& sKeyPath)
+		{
+			return StringCompare::CI().AreEqual(sKeyPath, svzTestKey);
+		});
+	};
+
+	std::vector<vlr::tstring> arrKeyPaths;
+	// String data (in a multi-sz), value name, and key name
+	sr = oIndex.Query(_T("VALUE2"), arrKeyPaths);
+	EXPECT_EQ(sr, SResult::Success);
+	EXPECT_TRUE(fContainsTestKey(arrKeyPaths));
+	sr = oIndex.Query(_T("testDWORD"), arrKeyPaths);
+	EXPECT_EQ(sr, SResult::Success);
+	EXPECT_TRUE(fContainsTestKey(arrKeyPaths));
+	sr = oIndex.Query(svzTestValueSubkeyName_1, arrKeyPaths);
+	EXPECT_EQ(sr, SResult::Success);
+	ASSERT_EQ(arrKeyPaths.size(), 1U);
+	EXPECT_TRUE(StringCompare::CI().AreEqual(arrKeyPaths[0], MakeRegistryPath(svzTestKey, svzTestValueSubkeyName_1)));
+	sr = oIndex.Query(_T("tokenNotInTestData"), arrKeyPaths);
+	EXPECT_EQ(sr, SResult::Success);
+	EXPECT_TRUE(arrKeyPaths.empty());
+	sr = oIndex.Query(_T("\\ -"), arrKeyPaths);
+	EXPECT_EQ(sr, E_INVALIDARG);
+
+	// Tokens match separately, but not as a phrase
+	{
+		const auto oOptions = CRegistryAccessIndex::Options_Query{}
+		.withVerifyPhrase(true);
+		sr = oIndex.Query(_T("value1"), arrKeyPaths, oOptions);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_TRUE(fContainsTestKey(arrKeyPaths));
+		sr = oIndex.Query(_T("testString testDWORD"), arrKeyPaths);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_TRUE(fContainsTestKey(arrKeyPaths));
+		sr = oIndex.Query(_T("testString testDWORD"), arrKeyPaths, oOptions);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_FALSE(fContainsTestKey(arrKeyPaths));
+	}
+
+	// Incremental refresh; keys which were not written very recently are reused rather than re-read
+	// Note: Write times within the last couple of seconds are not trusted (those keys are always re-read), so wait until
+	// the test keys' are, and refresh once to record them
+	std::this_thread::sleep_for(std::chrono::milliseconds{ 2500 });
+	sr = oIndex.Refresh(&oResult);
+	EXPECT_EQ(sr, SResult::Success);
+	EXPECT_EQ(oResult.m_nKeysReused + oResult.m_nKeysReindexed, oResult.m_nKeysVisited);
+	EXPECT_EQ(oResult.m_nKeysRemoved, 0U);
+	{
+		static constexpr auto svzTestValueName_Index = vlr::tzstring_view{ _T("testIndexRefresh") };
+
+		auto oReg = CRegistryAccess{ HKEY_CURRENT_USER };
+		auto sModifiedKeyPath = MakeRegistryPath(svzTestKey, svzTestValueSubkeyName_1);
+		auto onDestroy_DeleteValue = MakeActionOnDestruction([&] {
+			oReg.DeleteValue(sModifiedKeyPath, svzTestValueName_Index);
+		});
+		ASSERT_EQ(oReg.WriteValue_DWORD(sModifiedKeyPath, svzTestValueName_Index, nTestValue_DWORD), SResult::Success);
+
+		// Only the modified key is re-read
+		sr = oIndex.Refresh(&oResult);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_GT(oResult.m_nKeysReused, 0U);
+		EXPECT_EQ(oResult.m_nKeysReindexed, 1U);
+		EXPECT_EQ(oResult.m_nKeysReused + oResult.m_nKeysReindexed, oResult.m_nKeysVisited);
+		EXPECT_EQ(oResult.m_nKeysRemoved, 0U);
+		sr = oIndex.Query(svzTestValueName_Index, arrKeyPaths);
+		EXPECT_EQ(sr, SResult::Success);
+		ASSERT_EQ(arrKeyPaths.size(), 1U);
+		EXPECT_TRUE(StringCompare::CI().AreEqual(arrKeyPaths[0], sModifiedKeyPath));
+	}
+
+	// Save, and load into a new instance
+	TCHAR pszTempPath[MAX_PATH]{};
+	::GetTempPath(MAX_PATH, pszTempPath);
+	auto sIndexFilePath = vlr::tstring{ pszTempPath } + _T("vlr-test.RegistryAccessIndex.bin");
+	auto onDestroy_DeleteIndexFile = MakeActionOnDestruction([&] {
+		::DeleteFile(sIndexFilePath.c_str());
+	});
+
+	sr = oIndex.SaveToFile(sIndexFilePath);
+	EXPECT_EQ(sr, SResult::Success);
+	{
+		auto oIndex_Loaded = CRegistryAccessIndex{ CRegistryAccess{ HKEY_CURRENT_USER }, svzTestKey };
+		sr = oIndex_Loaded.LoadFromFile(sIndexFilePath);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_EQ(oIndex_Loaded.GetKeyCount(), oIndex.GetKeyCount());
+		EXPECT_EQ(oIndex_Loaded.GetTokenCount(), oIndex.GetTokenCount());
+		sr = oIndex_Loaded.Query(_T("VALUE2"), arrKeyPaths);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_TRUE(fContainsTestKey(arrKeyPaths));
+	}
+	{
+		auto oIndex_OtherRoot = CRegistryAccessIndex{ CRegistryAccess{ HKEY_CURRENT_USER }, svzBaseKey_Invalid };
+		sr = oIndex_OtherRoot.LoadFromFile(sIndexFilePath);
+		EXPECT_EQ(sr.asHRESULT(), __HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+	}
+	{
+		const auto arrGarbage = std::vector<BYTE>{ 0x01, 0x02, 0x03 };
+		sr = filesystem::WriteFileContents(sIndexFilePath, arrGarbage.data(), arrGarbage.size());
+		ASSERT_EQ(sr, SResult::Success);
+		sr = oIndex.LoadFromFile(sIndexFilePath);
+		EXPECT_EQ(sr.asHRESULT(), __HRESULT_FROM_WIN32(ERROR_BAD_FORMAT));
+		// Note: A failed load leaves the existing index in place
+		EXPECT_GE(oIndex.GetKeyCount(), 3U);
+	}
+}
+
+TEST(RegistryAccess, WriteBehind)
+{
+	SResult sr;
+
+	static constexpr auto svzTestValueName_DWORD_WriteBehind = vlr::tzstring_view{ _T("testDWORD_Copy") };
+	static constexpr auto svzTestValueName_QWORD_WriteBehind = vlr::tzstring_view{ _T("testQWORD_Copy") };
+
+	auto oReg = CRegistryAccess{ HKEY_CURRENT_USER };
+
+	{
+		// Note: Long interval and high threshold, so only the explicit flush writes
+		const auto oOptions = CRegistryAccessWriteBehind::Options_WriteBehind{}
+			.withFlushInterval(std::chrono::hours{ 1 })
+			.withFlushThreshold(1000);
+		auto oRegWriteBehind = CRegistryAccessWriteBehind{ oReg, oOptions };
+
+		for (DWORD i = 0; i < 100; ++i)
+		{
+			sr = oRegWriteBehind.WriteValue_DWORD(svzTestKey, svzTestValueName_DWORD_WriteBehind, i);
+			EXPECT_EQ(sr, SResult::Success);
+		}
+		sr = oRegWriteBehind.WriteValue_DWORD(svzTestKey, svzTestValueName_DWORD_WriteBehind, nTestValue_DWORD);
+		EXPECT_EQ(sr, SResult::Success);
+
+		sr = oRegWriteBehind.Flush();
+		EXPECT_EQ(sr, SResult::Success);
+		auto oStats = oRegWriteBehind.GetStats();
+		EXPECT_EQ(oStats.m_nWritesRequested, 101U);
+		EXPECT_EQ(oStats.m_nWritesCoalesced, 100U);
+		EXPECT_EQ(oStats.m_nKeysOpened, 1U);
+		EXPECT_EQ(oStats.m_nValuesWritten, 1U);
+
+		DWORD dwValue{};
+		sr = oReg.ReadValue_DWORD(svzTestKey, svzTestValueName_DWORD_WriteBehind, dwValue);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_EQ(dwValue, nTestValue_DWORD);
+
+		sr = oRegWriteBehind.Flush();
+		EXPECT_EQ(sr, SResult::Success_NoWorkDone);
+
+		// Note: Writes to a key which does not exist fail at flush time, and are dropped
+		sr = oRegWriteBehind.WriteValue_DWORD(svzBaseKey_Invalid, svzTestValueName_DWORD_WriteBehind, nTestValue_DWORD);
+		EXPECT_EQ(sr, SResult::Success);
+		sr = oRegWriteBehind.Flush();
+		EXPECT_EQ(sr.asHRESULT(), __HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+		oStats = oRegWriteBehind.GetStats();
+		EXPECT_EQ(oStats.m_nValuesFailed, 1U);
+		sr = oRegWriteBehind.Flush();
+		EXPECT_EQ(sr, SResult::Success_NoWorkDone);
+	}
+	{
+		// Note: Values still buffered at destruction are flushed
+		{
+			auto oRegWriteBehind = CRegistryAccessWriteBehind{ oReg, CRegistryAccessWriteBehind::Options_WriteBehind{}
+				.withFlushInterval(std::chrono::hours{ 1 }) };
+			sr = oRegWriteBehind.WriteValue_QWORD(svzTestKey, svzTestValueName_QWORD_WriteBehind, nTestValue_QWORD + 1);
+			EXPECT_EQ(sr, SResult::Success);
+			sr = oRegWriteBehind.WriteValue_QWORD(svzTestKey, svzTestValueName_QWORD_WriteBehind, nTestValue_QWORD);
+			EXPECT_EQ(sr, SResult::Success);
+		}
+		QWORD qwValue{};
+		sr = oReg.ReadValue_QWORD(svzTestKey, svzTestValueName_QWORD_WriteBehind, qwValue);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_EQ(qwValue, nTestValue_QWORD);
+	}
+	{
+		// Note: Reaching the threshold triggers a background flush without waiting for the interval
+		const auto oOptions = CRegistryAccessWriteBehind::Options_WriteBehind{}
+			.withFlushInterval(std::chrono::hours{ 1 })
+			.withFlushThreshold(1);
+		auto oRegWriteBehind = CRegistryAccessWriteBehind{ oReg, oOptions };
+		sr = oRegWriteBehind.WriteValue_DWORD(svzTestKey, svzTestValueName_DWORD_WriteBehind, nTestValue_DWORD);
+		EXPECT_EQ(sr, SResult::Success);
+
+		auto tpDeadline = std::chrono::steady_clock::now() + std::chrono::seconds{ 10 };
+		while ((oRegWriteBehind.GetStats().m_nFlushCount == 0) && (std::chrono::steady_clock::now() < tpDeadline))
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds{ 10 });
+		}
+		EXPECT_EQ(oRegWriteBehind.GetStats().m_nValuesWritten, 1U);
+	}
+}
+
+TEST(RegistryAccess, Atomic)
+{
+	SResult sr;
+
+	static constexpr auto svzTestValueName_Counter = vlr::tzstring_view{ _T("testQWORD_Counter") };
+	static constexpr size_t nThreadCount = 8;
+	static constexpr size_t nIncrementsPerThread = 100;
+
+	auto oReg = CRegistryAccess{ HKEY_CURRENT_USER };
+	auto fDeleteCounter = [&] {
+		oReg.DeleteValue(svzTestKey, svzTestValueName_Counter);
+	};
+	fDeleteCounter();
+	auto oOnDestroy_DeleteCounter = MakeActionOnDestruction(fDeleteCounter);
+
+	for (const auto& oOptions : {
+		CRegistryAccessAtomic::Options_Atomic{},
+		CRegistryAccessAtomic::Options_Atomic{}.withCrossProcessLock(_T("Local\\vlr-test-atomic")) })
+	{
+		fDeleteCounter();
+		auto oRegAtomic = CRegistryAccessAtomic{ oReg, oOptions };
+
+		// Note: Concurrent increments must not lose updates
+		std::vector<std::thread> arrThreads;
+		for (size_t i = 0; i < nThreadCount; ++i)
+		{
+			arrThreads.emplace_back([&] {
+				for (size_t j = 0; j < nIncrementsPerThread; ++j)
+				{
+					EXPECT_EQ(oRegAtomic.Add_QWORD(svzTestKey, svzTestValueName_Counter, 1), SResult::Success);
+				}
+			});
+		}
+		for (auto& oThread : arrThreads)
+		{
+			oThread.join();
+		}
+
+		QWORD qwValue{};
+		sr = oReg.ReadValue_QWORD(svzTestKey, svzTestValueName_Counter, qwValue);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_EQ(qwValue, nThreadCount * nIncrementsPerThread);
+		auto oStats = oRegAtomic.GetStats();
+		EXPECT_EQ(oStats.m_nOperations, nThreadCount * nIncrementsPerThread);
+		EXPECT_LE(oStats.m_nContendedOperations, oStats.m_nOperations);
+	}
+
+	auto oRegAtomic = CRegistryAccessAtomic{ oReg };
+	{
+		QWORD qwOriginalValue{};
+		sr = oRegAtomic.CompareExchange_QWORD(svzTestKey, svzTestValueName_Counter, 0, 1, qwOriginalValue);
+		EXPECT_EQ(sr, SResult::Success_NoWorkDone);
+		EXPECT_EQ(qwOriginalValue, nThreadCount * nIncrementsPerThread);
+		sr = oRegAtomic.CompareExchange_QWORD(svzTestKey, svzTestValueName_Counter, qwOriginalValue, 5, qwOriginalValue);
+		EXPECT_EQ(sr, SResult::Success);
+	}
+	{
+		QWORD qwNewValue{};
+		sr = oRegAtomic.Max_QWORD(svzTestKey, svzTestValueName_Counter, 3, &qwNewValue);
+		EXPECT_EQ(sr, SResult::Success_NoWorkDone);
+		EXPECT_EQ(qwNewValue, 5U);
+		sr = oRegAtomic.Max_QWORD(svzTestKey, svzTestValueName_Counter, 7, &qwNewValue);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_EQ(qwNewValue, 7U);
+	}
+	{
+		// Note: Type mismatch (the counter is a QWORD)
+		DWORD dwNewValue{};
+		sr = oRegAtomic.Add_DWORD(svzTestKey, svzTestValueName_Counter, 1, &dwNewValue);
+		EXPECT_EQ(sr.isSuccess(), false);
+
+		sr = oRegAtomic.Add_DWORD(svzBaseKey_Invalid, svzTestValueName_Counter, 1);
+		EXPECT_EQ(sr.asHRESULT(), __HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+	}
+	{
+		fDeleteCounter();
+		auto oRegAtomic_NoMissing = CRegistryAccessAtomic{ oReg, CRegistryAccessAtomic::Options_Atomic{}.withTreatMissingValueAsZero(false) };
+		sr = oRegAtomic_NoMissing.Add_QWORD(svzTestKey, svzTestValueName_Counter, 1);
+		EXPECT_EQ(sr.asHRESULT(), __HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+	}
+	{
+		// Note: The lock name is pinned, so that 32-bit and 64-bit builds (and other versions) are known to agree
+		auto oRegAtomic_CrossProcess = CRegistryAccessAtomic{ oReg, CRegistryAccessAtomic::Options_Atomic{}.withCrossProcessLock(_T("Local\\vlr-test-atomic")) };
+		auto sLockName = oRegAtomic_CrossProcess.GetCrossProcessLockName(_T("Software\\vlr-test"), _T("testQWORD_Counter"));
+		EXPECT_EQ(sLockName, _T("Local\\vlr-test-atomic.8BE868DD199BC661"));
+		EXPECT_EQ(oRegAtomic_CrossProcess.GetCrossProcessLockName(_T("SOFTWARE\\VLR-TEST"), _T("TESTqword_counter")), sLockName);
+		EXPECT_NE(oRegAtomic_CrossProcess.GetCrossProcessLockName(_T("Software\\vlr-test"), _T("testQWORD_Other")), sLockName);
+	}
+}
+
+TEST(RegistryAccess, Crawler)
+{
+	SResult sr;
+
+	using CrawlChangeKind = RegistryAccess::CrawlChangeKind;
+
+	auto sCrawlKey = fmt::format(_T("{}\\{}"), svzBaseKey_Test, _T("testCrawler"));
+	auto sSubkey_A = fmt::format(_T("{}\\{}"), sCrawlKey, _T("A"));
+	auto sSubkey_B = fmt::format(_T("{}\\{}"), sCrawlKey, _T("B"));
+
+	auto oReg = CRegistryAccess{ HKEY_CURRENT_USER };
+	const auto oDeleteKeyOptions = CRegistryAccess::Options_DeleteKeysOrValues{}
+		.withSafeDeletePath(svzBaseKey_Test);
+	auto fDeleteTestKeys = [&] {
+		oReg.DeleteKey(sSubkey_A, oDeleteKeyOptions);
+		oReg.DeleteKey(sSubkey_B, oDeleteKeyOptions);
+		oReg.DeleteKey(sCrawlKey, oDeleteKeyOptions);
+	};
+	fDeleteTestKeys();
+	auto onDestroy_DeleteTestKeys = MakeActionOnDestruction(fDeleteTestKeys);
+
+	ASSERT_EQ(oReg.EnsureKeyExists(sSubkey_A), SResult::Success);
+	ASSERT_EQ(oReg.EnsureKeyExists(sSubkey_B), SResult::Success);
+	ASSERT_EQ(oReg.WriteValue_DWORD(sSubkey_A, svzTestValueName_DWORD, nTestValue_DWORD), SResult::Success);
+
+	std::vector<std::pair<CrawlChangeKind, vlr::tstring>> arrChanges;
+	auto fOnCrawlChange = [&](const CRegistryAccessCrawler::CrawlChange& oCrawlChange)
+	{
+		arrChanges.emplace_back(oCrawlChange.m_eChangeKind, vlr::tstring{ oCrawlChange.m_svKeyPath });
+		return SResult::Success;
+	};
+	auto fHasChange = [&](CrawlChangeKind eChangeKind, const vlr::tstring& sKeyPath)
+	{
+		return std::any_of(arrChanges.begin(), arrChanges.end(), [&](const auto& oChange)
+		{
+			return (oChange.first == eChangeKind) && StringCompare::CI().AreEqual(oChange.second, sKeyPath);
+		});
+	};
+
+	auto oCrawler = CRegistryAccessCrawler{ oReg, sCrawlKey };
+	CRegistryAccessCrawler::Result_Crawl oResult;
+
+	// Note: The first crawl reports every key as added
+	sr = oCrawler.Crawl(fOnCrawlChange, {}, &oResult);
+	EXPECT_EQ(sr, SResult::Success);
+	EXPECT_TRUE(oResult.m_bCompleted);
+	EXPECT_EQ(oResult.m_nKeysVisited, 3U);
+	EXPECT_EQ(arrChanges.size(), 3U);
+	EXPECT_TRUE(fHasChange(CrawlChangeKind::KeyAdded, sCrawlKey));
+	EXPECT_TRUE(fHasChange(CrawlChangeKind::KeyAdded, sSubkey_A));
+	EXPECT_TRUE(fHasChange(CrawlChangeKind::KeyAdded, sSubkey_B));
+
+	// Note: Nothing changed; keys written very recently are re-read, but have the same content
+	arrChanges.clear();
+	sr = oCrawler.Crawl(fOnCrawlChange, {}, &oResult);
+	EXPECT_EQ(sr, SResult::Success);
+	EXPECT_EQ(arrChanges.size(), 0U);
+
+	arrChanges.clear();
+	ASSERT_EQ(oReg.WriteValue_DWORD(sSubkey_A, svzTestValueName_DWORD, nTestValue_DWORD + 1), SResult::Success);
+	ASSERT_EQ(oReg.DeleteKey(sSubkey_B, oDeleteKeyOptions), SResult::Success);
+	sr = oCrawler.Crawl(fOnCrawlChange, {}, &oResult);
+	EXPECT_EQ(sr, SResult::Success);
+	EXPECT_EQ(arrChanges.size(), 2U);
+	EXPECT_TRUE(fHasChange(CrawlChangeKind::ValuesChanged, sSubkey_A));
+	EXPECT_TRUE(fHasChange(CrawlChangeKind::KeyRemoved, sSubkey_B));
+	EXPECT_EQ(oCrawler.GetKeyCount(), 2U);
+
+	// Note: Write times within the last couple of seconds are not trusted (those keys are always re-read), so wait
+	// until the root's is, for it to be seen as unchanged
+	const auto oPruneOptions = CRegistryAccessCrawler::Options_Crawl{}
+		.withCrawlMode(RegistryAccess::CrawlMode::PruneUnchangedSubtrees);
+	std::this_thread::sleep_for(std::chrono::milliseconds{ 2500 });
+	arrChanges.clear();
+	sr = oCrawler.Crawl(fOnCrawlChange, oPruneOptions, &oResult);
+	EXPECT_EQ(sr, SResult::Success);
+	EXPECT_EQ(arrChanges.size(), 0U);
+
+	// A value changed in a child of an unchanged key: the parent's values are not re-read, but the child is visited
+	arrChanges.clear();
+	ASSERT_EQ(oReg.WriteValue_DWORD(sSubkey_A, svzTestValueName_DWORD, nTestValue_DWORD + 2), SResult::Success);
+	sr = oCrawler.Crawl(fOnCrawlChange, oPruneOptions, &oResult);
+	EXPECT_EQ(sr, SResult::Success);
+	EXPECT_EQ(oResult.m_nKeysVisited, 2U);
+	EXPECT_EQ(oResult.m_nKeysValuesRead, 1U);
+	EXPECT_EQ(arrChanges.size(), 1U);
+	EXPECT_TRUE(fHasChange(CrawlChangeKind::ValuesChanged, sSubkey_A));
+
+	// Stop after the first key, then resume from the checkpoint in a new instance
+	TCHAR pszTempPath[MAX_PATH]{};
+	::GetTempPath(MAX_PATH, pszTempPath);
+	auto sCheckpointFilePath = vlr::tstring{ pszTempPath } + _T("vlr-test.RegistryAccessCrawler.bin");
+	auto onDestroy_DeleteCheckpointFile = MakeActionOnDestruction([&] {
+		::DeleteFile(sCheckpointFilePath.c_str());
+	});
+	{
+		arrChanges.clear();
+		auto oCrawler_Interrupted = CRegistryAccessCrawler{ oReg, sCrawlKey };
+		sr = oCrawler_Interrupted.Crawl(fOnCrawlChange, CRegistryAccessCrawler::Options_Crawl{}
+			.withCheckpointFile(sCheckpointFilePath)
+			.withMaxKeysToVisit(1), &oResult);
+		EXPECT_EQ(sr, SResult::Success_WithNuance);
+		EXPECT_FALSE(oResult.m_bCompleted);
+		EXPECT_TRUE(oCrawler_Interrupted.IsCrawlInProgress());
+		EXPECT_EQ(arrChanges.size(), 1U);
+		EXPECT_TRUE(fHasChange(CrawlChangeKind::KeyAdded, sCrawlKey));
+	}
+	{
+		arrChanges.clear();
+		auto oCrawler_Resumed = CRegistryAccessCrawler{ oReg, sCrawlKey };
+		sr = oCrawler_Resumed.LoadCheckpoint(sCheckpointFilePath);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_TRUE(oCrawler_Resumed.IsCrawlInProgress());
+		sr = oCrawler_Resumed.Crawl(fOnCrawlChange, CRegistryAccessCrawler::Options_Crawl{}
+			.withCheckpointFile(sCheckpointFilePath), &oResult);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_TRUE(oResult.m_bCompleted);
+		EXPECT_EQ(oResult.m_nKeysVisited, 1U);
+		EXPECT_EQ(arrChanges.size(), 1U);
+		EXPECT_TRUE(fHasChange(CrawlChangeKind::KeyAdded, sSubkey_A));
+		EXPECT_FALSE(oCrawler_Resumed.IsCrawlInProgress());
+	}
+	{
+		auto oCrawler_OtherRoot = CRegistryAccessCrawler{ oReg, svzBaseKey_Invalid };
+		sr = oCrawler_OtherRoot.LoadCheckpoint(sCheckpointFilePath);
+		EXPECT_EQ(sr.asHRESULT(), __HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+	}
+}
+
+TEST(RegistryAccess, CopyTree)
+{
+	SResult sr;
+
+	using CopyTreePolicy = RegistryAccess::CopyTreePolicy;
+
+	static constexpr auto svzExtraValueName = vlr::tzstring_view{ _T("testExtra") };
+
+	auto sSourceKey = fmt::format(_T("{}\\{}"), svzBaseKey_Test, _T("testCopySource"));
+	auto sSourceSubkey = fmt::format(_T("{}\\{}"), sSourceKey, _T("A"));
+	auto sDestKey = fmt::format(_T("{}\\{}"), svzBaseKey_Test, _T("testCopyDest"));
+	auto sDestSubkey = fmt::format(_T("{}\\{}"), sDestKey, _T("A"));
+
+	auto oReg = CRegistryAccess{ HKEY_CURRENT_USER };
+	const auto oDeleteKeyOptions = CRegistryAccess::Options_DeleteKeysOrValues{}
+		.withSafeDeletePath(svzBaseKey_Test);
+	auto fDeleteTestKeys = [&] {
+		oReg.DeleteKey(sSourceSubkey, oDeleteKeyOptions);
+		oReg.DeleteKey(sSourceKey, oDeleteKeyOptions);
+		oReg.DeleteKey(sDestSubkey, oDeleteKeyOptions);
+		oReg.DeleteKey(sDestKey, oDeleteKeyOptions);
+	};
+	fDeleteTestKeys();
+	auto onDestroy_DeleteTestKeys = MakeActionOnDestruction(fDeleteTestKeys);
+
+	ASSERT_EQ(oReg.EnsureKeyExists(sSourceSubkey), SResult::Success);
+	ASSERT_EQ(oReg.WriteValue_DWORD(sSourceKey, svzTestValueName_DWORD, nTestValue_DWORD), SResult::Success);
+	ASSERT_EQ(oReg.WriteValue_QWORD(sSourceSubkey, svzTestValueName_QWORD, nTestValue_QWORD), SResult::Success);
+	ASSERT_EQ(oReg.EnsureKeyExists(sDestKey), SResult::Success);
+	ASSERT_EQ(oReg.WriteValue_DWORD(sDestKey, svzTestValueName_DWORD, nTestValue_DWORD + 1), SResult::Success);
+	ASSERT_EQ(oReg.WriteValue_DWORD(sDestKey, svzExtraValueName, nTestValue_DWORD), SResult::Success);
+
+	auto oCopyTree = CRegistryAccessCopyTree{ oReg, oReg };
+	CRegistryAccessCopyTree::Result_CopyTree oResult;
+
+	std::vector<vlr::tstring> arrProgressKeyPaths;
+	sr = oCopyTree.CopyTree(sSourceKey, sDestKey, CRegistryAccessCopyTree::Options_CopyTree{}
+		.withPolicy(CopyTreePolicy::SkipExisting)
+		.withProgress([&](vlr::tstring_view svKeyPath, const CRegistryAccessCopyTree::Result_CopyTree& /*oResultSoFar*/)
+		{
+			arrProgressKeyPaths.emplace_back(svKeyPath);
+			return SResult::Success;
+		}), &oResult);
+	EXPECT_EQ(sr, SResult::Success);
+	EXPECT_EQ(oResult.m_nKeysCopied, 2U);
+	EXPECT_EQ(oResult.m_nKeysCreated, 1U);
+	EXPECT_EQ(oResult.m_nValuesWritten, 1U);
+	EXPECT_EQ(oResult.m_nValuesSkipped, 1U);
+	ASSERT_EQ(arrProgressKeyPaths.size(), 2U);
+	EXPECT_TRUE(arrProgressKeyPaths[0].empty());
+	EXPECT_TRUE(StringCompare::CI().AreEqual(arrProgressKeyPaths[1], _T("A")));
+	{
+		DWORD dwValue{};
+		QWORD qwValue{};
+		EXPECT_EQ(oReg.ReadValue_DWORD(sDestKey, svzTestValueName_DWORD, dwValue), SResult::Success);
+		EXPECT_EQ(dwValue, nTestValue_DWORD + 1);
+		EXPECT_EQ(oReg.ReadValue_QWORD(sDestSubkey, svzTestValueName_QWORD, qwValue), SResult::Success);
+		EXPECT_EQ(qwValue, nTestValue_QWORD);
+	}
+
+	sr = oCopyTree.CopyTree(sSourceKey, sDestKey, CRegistryAccessCopyTree::Options_CopyTree{}
+		.withPolicy(CopyTreePolicy::Merge), &oResult);
+	EXPECT_EQ(sr, SResult::Success);
+	EXPECT_EQ(oResult.m_nKeysCreated, 0U);
+	EXPECT_EQ(oResult.m_nValuesWritten, 2U);
+	EXPECT_EQ(oResult.m_nValuesDeleted, 0U);
+	{
+		DWORD dwValue{};
+		EXPECT_EQ(oReg.ReadValue_DWORD(sDestKey, svzTestValueName_DWORD, dwValue), SResult::Success);
+		EXPECT_EQ(dwValue, nTestValue_DWORD);
+		EXPECT_EQ(oReg.ReadValue_DWORD(sDestKey, svzExtraValueName, dwValue), SResult::Success);
+	}
+
+	sr = oCopyTree.CopyTree(sSourceKey, sDestKey, CRegistryAccessCopyTree::Options_CopyTree{}
+		.withPolicy(CopyTreePolicy::Overwrite), &oResult);
+	EXPECT_EQ(sr, SResult::Success);
+	EXPECT_EQ(oResult.m_nValuesWritten, 2U);
+	EXPECT_EQ(oResult.m_nValuesDeleted, 1U);
+	{
+		DWORD dwType{};
+		DWORD dwSize{};
+		sr = oReg.ReadValueInfo(sDestKey, svzExtraValueName, dwType, dwSize);
+		EXPECT_EQ(sr.asHRESULT(), __HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+	}
+
+	// Note: A failure from the progress callback stops the copy
+	sr = oCopyTree.CopyTree(sSourceKey, sDestKey, CRegistryAccessCopyTree::Options_CopyTree{}
+		.withProgress([&](vlr::tstring_view /*svKeyPath*/, const CRegistryAccessCopyTree::Result_CopyTree& /*oResultSoFar*/)
+		{
+			return SResult{ E_ABORT };
+		}), &oResult);
+	EXPECT_EQ(sr.asHRESULT(), E_ABORT);
+	EXPECT_EQ(oResult.m_nKeysCopied, 1U);
+
+	sr = oCopyTree.CopyTree(sSourceKey, sSourceSubkey, {}, &oResult);
+	EXPECT_EQ(sr.asHRESULT(), E_INVALIDARG);
+
+	// Note: HKCU\SOFTWARE is shared between the 32-bit and 64-bit views, so these are the same keys in both views
+	{
+		auto oReg_32bit = CRegistryAccess{ HKEY_CURRENT_USER };
+		oReg_32bit.SetWow64KeyAccessOption(RegistryAccess::Wow64KeyAccessOption::UseExplicit32bit);
+		auto oReg_64bit = CRegistryAccess{ HKEY_CURRENT_USER };
+		oReg_64bit.SetWow64KeyAccessOption(RegistryAccess::Wow64KeyAccessOption::UseExplicit64bit);
+		auto oCopyTree_CrossView = CRegistryAccessCopyTree{ oReg_32bit, oReg_64bit };
+
+		sr = oCopyTree_CrossView.CopyTree(sSourceKey, sSourceKey, {}, &oResult);
+		EXPECT_EQ(sr.asHRESULT(), E_INVALIDARG);
+		sr = oCopyTree_CrossView.CopyTree(sSourceKey, sSourceSubkey, {}, &oResult);
+		EXPECT_EQ(sr.asHRESULT(), E_INVALIDARG);
+		// Note: Also for a destination which does not exist yet (and is not created)
+		auto sSourceSubkey_New = fmt::format(_T("{}\\{}"), sSourceSubkey, _T("New"));
+		sr = oCopyTree_CrossView.CopyTree(sSourceKey, sSourceSubkey_New, {}, &oResult);
+		EXPECT_EQ(sr.asHRESULT(), E_INVALIDARG);
+		CRegistryAccess::KeyInfo oKeyInfo{};
+		sr = oReg.ReadKeyInfo(sSourceSubkey_New, oKeyInfo);
+		EXPECT_EQ(sr.asHRESULT(), __HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+
+		sr = oCopyTree_CrossView.CopyTree(sSourceKey, sDestKey, {}, &oResult);
+		EXPECT_EQ(sr, SResult::Success);
+	}
+
+	sr = oCopyTree.CopyTree(svzBaseKey_Invalid, sDestKey, {}, &oResult);
+	EXPECT_EQ(sr.asHRESULT(), __HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+}
+
+TEST(RegistryAccess, Export)
+{
+	SResult sr;
+
+	using ExportFormat = RegistryAccess::ExportFormat;
+
+	auto oReg = CRegistryAccess{ HKEY_CURRENT_USER };
+	auto oRegExport = CRegistryAccessExport{ oReg };
+
+	auto fExportToString = [&](const CRegistryAccessExport::Options_Export& options, std::string& saOutput, CRegistryAccessExport::Result_Export& oResult)
+	{
+		saOutput.clear();
+		return oRegExport.ExportToCallback(svzTestKey, [&](std::string_view svOutput)
+		{
+			saOutput += svOutput;
+			return SResult::Success;
+		}, options, &oResult);
+	};
+
+	std::string saOutput;
+	CRegistryAccessExport::Result_Export oResult;
+	sr = fExportToString({}, saOutput, oResult);
+	EXPECT_EQ(sr, SResult::Success);
+	EXPECT_GE(oResult.m_nKeysExported, 3U);
+	EXPECT_EQ(oResult.m_nBytesWritten, saOutput.size());
+	EXPECT_EQ(static_cast<size_t>(std::count(saOutput.begin(), saOutput.end(), '\n')), oResult.m_nKeysExported);
+	EXPECT_EQ(saOutput.rfind("{\"key\":\"SOFTWARE\\\\vlr-test\",\"values\":[", 0), 0U);
+	EXPECT_NE(saOutput.find("{\"name\":\"testString\",\"type\":\"REG_SZ\",\"data\":\"value\"}"), std::string::npos);
+	EXPECT_NE(saOutput.find("{\"name\":\"testDWORD\",\"type\":\"REG_DWORD\",\"data\":42}"), std::string::npos);
+	EXPECT_NE(saOutput.find("{\"name\":\"testQWORD\",\"type\":\"REG_QWORD\",\"data\":42}"), std::string::npos);
+	EXPECT_NE(saOutput.find("{\"name\":\"testMultiSz\",\"type\":\"REG_MULTI_SZ\",\"data\":[\"value1\",\"value2\"]}"), std::string::npos);
+	EXPECT_NE(saOutput.find("{\"name\":\"testBinary\",\"type\":\"REG_BINARY\",\"base64\":\"EjRWeA==\"}"), std::string::npos);
+	EXPECT_NE(saOutput.find("{\"key\":\"SOFTWARE\\\\vlr-test\\\\Subkey1\""), std::string::npos);
+
+	// Note: A small output buffer writes the same output, in more chunks
+	{
+		std::string saOutput_SmallBuffer;
+		CRegistryAccessExport::Result_Export oResult_SmallBuffer;
+		sr = fExportToString(CRegistryAccessExport::Options_Export{}
+			.withOutputBufferSize(16), saOutput_SmallBuffer, oResult_SmallBuffer);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_EQ(saOutput_SmallBuffer, saOutput);
+	}
+
+	{
+		std::string saOutput_Json;
+		CRegistryAccessExport::Result_Export oResult_Json;
+		sr = fExportToString(CRegistryAccessExport::Options_Export{}
+			.withFormat(ExportFormat::Json), saOutput_Json, oResult_Json);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_EQ(oResult_Json.m_nKeysExported, oResult.m_nKeysExported);
+		EXPECT_EQ(saOutput_Json.rfind("[\n{\"key\":", 0), 0U);
+		EXPECT_EQ(saOutput_Json.substr(saOutput_Json.size() - 4), "}\n]\n");
+		EXPECT_NE(saOutput_Json.find("]},\n{\"key\":"), std::string::npos);
+	}
+
+	{
+		TCHAR pszTempPath[MAX_PATH]{};
+		::GetTempPath(MAX_PATH, pszTempPath);
+		auto sExportFilePath = vlr::tstring{ pszTempPath } + _T("vlr-test.RegistryAccessExport.ndjson");
+		auto onDestroy_DeleteExportFile = MakeActionOnDestruction([&] {
+			::DeleteFile(sExportFilePath.c_str());
+		});
+		{
+			HANDLE hFile = ::CreateFile(sExportFilePath.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+			ASSERT_NE(hFile, INVALID_HANDLE_VALUE);
+			auto onDestroy_CloseFile = MakeActionOnDestruction([&] {
+				::CloseHandle(hFile);
+			});
+			sr = oRegExport.ExportToFileHandle(svzTestKey, hFile);
+			EXPECT_EQ(sr, SResult::Success);
+		}
+		std::vector<BYTE> arrFileData;
+		EXPECT_EQ(filesystem::ReadFileContents(sExportFilePath, arrFileData), S_OK);
+		EXPECT_EQ(std::string(arrFileData.begin(), arrFileData.end()), saOutput);
+	}
+
+	// Note: A failure from the sink stops the export
+	{
+		size_t nOutputCallCount = 0;
+		sr = oRegExport.ExportToCallback(svzTestKey, [&](std::string_view /*svOutput*/)
+		{
+			++nOutputCallCount;
+			return SResult{ E_ABORT };
+		}, CRegistryAccessExport::Options_Export{}
+			.withOutputBufferSize(16));
+		EXPECT_EQ(sr.asHRESULT(), E_ABORT);
+		EXPECT_EQ(nOutputCallCount, 1U);
+	}
+	// Note: Including a sink failure with a code which is skippable for key reads, in a subkey's record
+	{
+		CRegistryAccessExport::Result_Export oResult_SinkFailure;
+		sr = oRegExport.ExportToCallback(svzTestKey, [&](std::string_view svOutput) -> SResult
+		{
+			if (svOutput.find("Subkey") != std::string_view::npos)
+			{
+				return SResult::For_win32_ErrorCode(ERROR_ACCESS_DENIED);
+			}
+			return SResult::Success;
+		}, CRegistryAccessExport::Options_Export{}
+			.withOutputBufferSize(16), &oResult_SinkFailure);
+		EXPECT_EQ(sr.asHRESULT(), __HRESULT_FROM_WIN32(ERROR_ACCESS_DENIED));
+		EXPECT_EQ(oResult_SinkFailure.m_nKeysSkipped, 0U);
+		EXPECT_LT(oResult_SinkFailure.m_nKeysExported, oResult.m_nKeysExported);
+	}
+
+	sr = oRegExport.ExportToCallback(svzBaseKey_Invalid, [&](std::string_view /*svOutput*/)
+	{
+		return SResult::Success;
+	});
+	EXPECT_EQ(sr.asHRESULT(), __HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+}
+
+TEST(RegistryAccess, EnumPage)
+{
+	SResult sr;
+
+	static constexpr DWORD dwValueCount = 10;
+	static constexpr DWORD dwPageSize = 4;
+
+	auto sPagingKey = fmt::format(_T("{}\\{}"), svzBaseKey_Test, _T("testPaging"));
+	auto sSubkey_A = fmt::format(_T("{}\\{}"), sPagingKey, _T("A"));
+	auto sSubkey_B = fmt::format(_T("{}\\{}"), sPagingKey, _T("B"));
+
+	auto oReg = CRegistryAccess{ HKEY_CURRENT_USER };
+	const auto oDeleteKeyOptions = CRegistryAccess::Options_DeleteKeysOrValues{}
+		.withSafeDeletePath(svzBaseKey_Test);
+	auto fDeleteTestKeys = [&] {
+		oReg.DeleteKey(sSubkey_A, oDeleteKeyOptions);
+		oReg.DeleteKey(sSubkey_B, oDeleteKeyOptions);
+		oReg.DeleteKey(sPagingKey, oDeleteKeyOptions);
+	};
+	fDeleteTestKeys();
+	auto onDestroy_DeleteTestKeys = MakeActionOnDestruction(fDeleteTestKeys);
+
+	ASSERT_EQ(oReg.EnsureKeyExists(sSubkey_A), SResult::Success);
+	ASSERT_EQ(oReg.EnsureKeyExists(sSubkey_B), SResult::Success);
+	for (DWORD i = 0; i < dwValueCount; ++i)
+	{
+		ASSERT_EQ(oReg.WriteValue_DWORD(sPagingKey, fmt::format(_T("value{}"), i), i), SResult::Success);
+	}
+
+	std::vector<vlr::tstring> arrValueNames;
+	auto fOnEnumValueData = [&](const CRegistryAccess::EnumValueData& oEnumValueData)
+	{
+		arrValueNames.emplace_back(oEnumValueData.m_svName);
+		return SResult::Success;
+	};
+
+	// Page through all values with tokens
+	{
+		CRegistryAccess::Result_EnumPage oResult;
+		sr = oReg.EnumValuesPage(sPagingKey, 0, dwPageSize, fOnEnumValueData, &oResult);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_EQ(oResult.m_dwEntryCount, dwPageSize);
+		EXPECT_EQ(oResult.m_dwTotalCount, dwValueCount);
+		size_t nPageCount = 1;
+		while (oResult.m_bHasMore)
+		{
+			auto oPageToken = oResult.m_oNextPageToken;
+			sr = oReg.EnumValuesPage(sPagingKey, oPageToken, dwPageSize, fOnEnumValueData, &oResult);
+			ASSERT_EQ(sr, SResult::Success);
+			++nPageCount;
+		}
+		EXPECT_EQ(nPageCount, 3U);
+		EXPECT_EQ(oResult.m_dwEntryCount, dwValueCount - 2 * dwPageSize);
+
+		EXPECT_EQ(arrValueNames.size(), dwValueCount);
+		std::sort(arrValueNames.begin(), arrValueNames.end());
+		EXPECT_EQ(std::unique(arrValueNames.begin(), arrValueNames.end()), arrValueNames.end());
+	}
+
+	// A page past the end is empty
+	{
+		arrValueNames.clear();
+		CRegistryAccess::Result_EnumPage oResult;
+		sr = oReg.EnumValuesPage(sPagingKey, dwValueCount, dwPageSize, fOnEnumValueData, &oResult);
+		EXPECT_TRUE(sr.isSuccess());
+		EXPECT_EQ(oResult.m_dwEntryCount, 0U);
+		EXPECT_FALSE(oResult.m_bHasMore);
+		EXPECT_EQ(arrValueNames.size(), 0U);
+	}
+
+	// A token is rejected once the key has been written
+	{
+		CRegistryAccess::Result_EnumPage oResult;
+		sr = oReg.EnumValuesPage(sPagingKey, 0, dwPageSize, fOnEnumValueData, &oResult);
+		ASSERT_EQ(sr, SResult::Success);
+		ASSERT_TRUE(oResult.m_bHasMore);
+		auto oPageToken = oResult.m_oNextPageToken;
+
+		// Note: The last write time has clock tick resolution
+		::Sleep(50);
+		ASSERT_EQ(oReg.WriteValue_DWORD(sPagingKey, _T("value0"), dwValueCount), SResult::Success);
+
+		arrValueNames.clear();
+		sr = oReg.EnumValuesPage(sPagingKey, oPageToken, dwPageSize, fOnEnumValueData, &oResult);
+		EXPECT_EQ(sr.asHRESULT(), E_CHANGED_STATE);
+		EXPECT_EQ(arrValueNames.size(), 0U);
+	}
+
+	{
+		std::vector<vlr::tstring> arrSubkeyNames;
+		auto fOnEnumSubkeyData = [&](const CRegistryAccess::EnumSubkeyData& oEnumSubkeyData)
+		{
+			arrSubkeyNames.emplace_back(oEnumSubkeyData.m_svName);
+			return SResult::Success;
+		};
+
+		CRegistryAccess::Result_EnumPage oResult;
+		sr = oReg.EnumSubkeysPage(sPagingKey, 0, 1, fOnEnumSubkeyData, &oResult);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_EQ(oResult.m_dwTotalCount, 2U);
+		EXPECT_TRUE(oResult.m_bHasMore);
+		sr = oReg.EnumSubkeysPage(sPagingKey, oResult.m_oNextPageToken, 1, fOnEnumSubkeyData, &oResult);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_FALSE(oResult.m_bHasMore);
+		ASSERT_EQ(arrSubkeyNames.size(), 2U);
+		EXPECT_FALSE(StringCompare::CI().AreEqual(arrSubkeyNames[0], arrSubkeyNames[1]));
+	}
+}
+
+TEST(RegistryAccess, Shared)
+{
+	SResult sr;
+
+	static constexpr size_t nThreadCount = 8;
+	static constexpr size_t nReadsPerThread = 50;
+
+	auto sSharedKey = fmt::format(_T("{}\\{}"), svzBaseKey_Test, _T("testShared"));
+
+	auto oReg = CRegistryAccess{ HKEY_CURRENT_USER };
+	const auto oDeleteKeyOptions = CRegistryAccess::Options_DeleteKeysOrValues{}
+		.withSafeDeletePath(svzBaseKey_Test);
+	auto fDeleteTestKeys = [&] {
+		oReg.DeleteKey(sSharedKey, oDeleteKeyOptions);
+	};
+	fDeleteTestKeys();
+	auto onDestroy_DeleteTestKeys = MakeActionOnDestruction(fDeleteTestKeys);
+
+	auto oRegShared = CRegistryAccessShared{ oReg };
+
+	// Note: Each thread opens the key once, and then reads from its cached handle
+	{
+		std::vector<std::thread> arrThreads;
+		for (size_t i = 0; i < nThreadCount; ++i)
+		{
+			arrThreads.emplace_back([&] {
+				for (size_t j = 0; j < nReadsPerThread; ++j)
+				{
+					DWORD dwValue{};
+					EXPECT_EQ(oRegShared.ReadValue_DWORD(svzTestKey, svzTestValueName_DWORD, dwValue), SResult::Success);
+					EXPECT_EQ(dwValue, nTestValue_DWORD);
+				}
+			});
+		}
+		for (auto& oThread : arrThreads)
+		{
+			oThread.join();
+		}
+
+		// Note: The threads have exited, so their caches were released (handles closed)
+		auto oStats = oRegShared.GetStats();
+		EXPECT_EQ(oStats.m_nThreadCaches, 0U);
+		EXPECT_EQ(oStats.m_nThreadCachesReleased, nThreadCount);
+		EXPECT_EQ(oStats.m_nHandleCacheMisses, nThreadCount);
+		EXPECT_EQ(oStats.m_nHandleCacheHits, nThreadCount * (nReadsPerThread - 1));
+		EXPECT_EQ(oStats.m_nHandlesEvicted, nThreadCount);
+
+		// The released caches are pruned when a thread next starts using the instance; their counts are kept
+		DWORD dwValue{};
+		EXPECT_EQ(oRegShared.ReadValue_DWORD(svzTestKey, svzTestValueName_DWORD, dwValue), SResult::Success);
+		oStats = oRegShared.GetStats();
+		EXPECT_EQ(oStats.m_nThreadCaches, 1U);
+		EXPECT_EQ(oStats.m_nThreadCachesReleased, nThreadCount);
+		EXPECT_EQ(oStats.m_nHandleCacheMisses, nThreadCount + 1);
+		EXPECT_EQ(oStats.m_nHandleCacheHits, nThreadCount * (nReadsPerThread - 1));
+	}
+
+	// A thread's caches of destroyed instances are dropped; a new instance gets a new cache
+	{
+		for (size_t i = 0; i < 2; ++i)
+		{
+			auto oRegShared_Temp = CRegistryAccessShared{ oReg };
+			DWORD dwValue{};
+			EXPECT_EQ(oRegShared_Temp.ReadValue_DWORD(svzTestKey, svzTestValueName_DWORD, dwValue), SResult::Success);
+			auto oStats = oRegShared_Temp.GetStats();
+			EXPECT_EQ(oStats.m_nThreadCaches, 1U);
+			EXPECT_EQ(oStats.m_nHandleCacheMisses, 1U);
+		}
+	}
+
+	// Writes, and reads of the written values, through the shared instance
+	{
+		ASSERT_EQ(oRegShared.EnsureKeyExists(sSharedKey), SResult::Success);
+		EXPECT_EQ(oRegShared.WriteValue_String(sSharedKey, svzTestValueName_SZ, _T("shared")), SResult::Success);
+		EXPECT_EQ(oRegShared.WriteValue_QWORD(sSharedKey, svzTestValueName_QWORD, nTestValue_QWORD), SResult::Success);
+
+		vlr::tstring sValue;
+		sr = oRegShared.ReadValue_String(sSharedKey, svzTestValueName_SZ, sValue);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_EQ(sValue, _T("shared"));
+
+		size_t nValueCount = 0;
+		sr = oRegShared.EnumAllValues(sSharedKey, [&](const CRegistryAccess::EnumValueData& /*oEnumValueData*/)
+		{
+			// Note: Nested calls on the same thread must work while the cached handle is in use
+			QWORD qwValue{};
+			EXPECT_EQ(oRegShared.ReadValue_QWORD(sSharedKey, svzTestValueName_QWORD, qwValue), SResult::Success);
+			EXPECT_EQ(qwValue, nTestValue_QWORD);
+			++nValueCount;
+			return SResult::Success;
+		});
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_EQ(nValueCount, 2U);
+
+		EXPECT_EQ(oRegShared.DeleteValue(sSharedKey, svzTestValueName_SZ), SResult::Success);
+		sr = oRegShared.ReadValue_String(sSharedKey, svzTestValueName_SZ, sValue);
+		EXPECT_EQ(sr.asHRESULT(), __HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+	}
+
+	// A key deleted and re-created by someone else is re-opened, rather than read through the stale handle
+	{
+		DWORD dwValue{};
+		ASSERT_EQ(oRegShared.WriteValue_DWORD(sSharedKey, svzTestValueName_DWORD, 1), SResult::Success);
+		ASSERT_EQ(oRegShared.ReadValue_DWORD(sSharedKey, svzTestValueName_DWORD, dwValue), SResult::Success);
+
+		ASSERT_EQ(oReg.DeleteKey(sSharedKey, oDeleteKeyOptions), SResult::Success);
+		ASSERT_EQ(oReg.WriteValue_DWORD(sSharedKey, svzTestValueName_DWORD, 2), SResult::Success);
+
+		sr = oRegShared.ReadValue_DWORD(sSharedKey, svzTestValueName_DWORD, dwValue);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_EQ(dwValue, 2U);
+	}
+
+	// Invalidate closes the cached handles on the next call
+	{
+		auto oStats_Before = oRegShared.GetStats();
+		oRegShared.Invalidate();
+		DWORD dwValue{};
+		EXPECT_EQ(oRegShared.ReadValue_DWORD(svzTestKey, svzTestValueName_DWORD, dwValue), SResult::Success);
+		auto oStats_After = oRegShared.GetStats();
+		EXPECT_GT(oStats_After.m_nHandlesEvicted, oStats_Before.m_nHandlesEvicted);
+		EXPECT_EQ(oStats_After.m_nHandleCacheMisses, oStats_Before.m_nHandleCacheMisses + 1);
+	}
+
+	// DeleteKey through the shared instance invalidates the caches
+	{
+		EXPECT_EQ(oRegShared.DeleteKey(sSharedKey, oDeleteKeyOptions), SResult::Success);
+		EXPECT_FALSE(oReg.DoesKeyExist(sSharedKey));
+	}
+}
+
+TEST(RegistryAccess, TraceRecordAndReplay)
+{
+	namespace Trace = RegistryAccess::Trace;
+
+	SResult sr;
+
+	static constexpr size_t nThreadCount = 2;
+	static constexpr size_t nReadsPerThread = 10;
+
+	auto sTraceKey = fmt::format(_T("{}\\{}"), svzBaseKey_Test, _T("testTrace"));
+
+	auto oReg = CRegistryAccess{ HKEY_CURRENT_USER };
+	const auto oDeleteKeyOptions = CRegistryAccess::Options_DeleteKeysOrValues{}
+		.withSafeDeletePath(svzBaseKey_Test);
+	auto fDeleteTestKeys = [&] {
+		oReg.DeleteKey(sTraceKey, oDeleteKeyOptions);
+	};
+	fDeleteTestKeys();
+	auto onDestroy_DeleteTestKeys = MakeActionOnDestruction(fDeleteTestKeys);
+
+	// Record a workload on three threads
+	static constexpr auto durCallbackSleep = std::chrono::milliseconds{ 20 };
+	size_t nSubkeyCount = 0;
+	auto spTraceRecorder = std::make_shared<CRegistryAccessTraceRecorder>();
+	{
+		auto oRegTraced = oReg;
+		oRegTraced.SetTraceRecorder(spTraceRecorder);
+
+		DWORD dwValue{};
+		vlr::tstring sValue;
+		DWORD dwType{};
+		DWORD dwSize{};
+		EXPECT_EQ(oRegTraced.EnsureKeyExists(sTraceKey), SResult::Success);
+		EXPECT_EQ(oRegTraced.WriteValue_DWORD(sTraceKey, svzTestValueName_DWORD, 7), SResult::Success);
+		EXPECT_EQ(oRegTraced.ReadValue_DWORD(svzTestKey, svzTestValueName_DWORD, dwValue), SResult::Success);
+		EXPECT_EQ(oRegTraced.ReadValue_String(svzTestKey, svzTestValueName_SZ, sValue), SResult::Success);
+		EXPECT_FALSE(oRegTraced.ReadValueInfo(svzTestKey, svzTestValueName_Invalid, dwType, dwSize).isSuccess());
+		// Note: The callback's time is the caller's, so should not be recorded as part of the enumeration
+		EXPECT_EQ(oRegTraced.EnumAllSubkeys(svzTestKey, [&](const CRegistryAccess::EnumSubkeyData& /*oEnumSubkeyData*/)
+		{
+			++nSubkeyCount;
+			std::this_thread::sleep_for(durCallbackSleep);
+			return SResult::Success;
+		}), SResult::Success);
+		EXPECT_TRUE(oRegTraced.DoesKeyExist(svzTestKey));
+
+		std::vector<std::thread> arrThreads;
+		for (size_t i = 0; i < nThreadCount; ++i)
+		{
+			arrThreads.emplace_back([&] {
+				for (size_t j = 0; j < nReadsPerThread; ++j)
+				{
+					DWORD dwValue_Thread{};
+					EXPECT_EQ(oRegTraced.ReadValue_DWORD(svzTestKey, svzTestValueName_DWORD, dwValue_Thread), SResult::Success);
+				}
+			});
+		}
+		for (auto& oThread : arrThreads)
+		{
+			oThread.join();
+		}
+
+		// Note: Nothing is recorded once the recorder is removed
+		oRegTraced.SetTraceRecorder(nullptr);
+		EXPECT_EQ(oRegTraced.ReadValue_DWORD(svzTestKey, svzTestValueName_DWORD, dwValue), SResult::Success);
+	}
+	fDeleteTestKeys();
+
+	static constexpr size_t nRecordCount = 7 + nThreadCount * nReadsPerThread;
+	auto oStats = spTraceRecorder->GetStats();
+	EXPECT_EQ(oStats.m_nRecordCount, nRecordCount);
+	EXPECT_EQ(oStats.m_nDroppedCount, 0U);
+	EXPECT_EQ(oStats.m_nThreadCount, nThreadCount + 1);
+
+	auto oTraceData = spTraceRecorder->GetTraceData();
+	ASSERT_EQ(oTraceData.m_arrRecords.size(), nRecordCount);
+	{
+		const auto& oRecord = oTraceData.m_arrRecords[1];
+		EXPECT_EQ(oRecord.m_eOperationType, Trace::WriteValue);
+		EXPECT_EQ(oTraceData.GetName(oRecord.m_nKeyNameId), vlr::tstring_view{ sTraceKey });
+		EXPECT_EQ(oTraceData.GetName(oRecord.m_nValueNameId), vlr::tstring_view{ svzTestValueName_DWORD.data(), svzTestValueName_DWORD.size() });
+		EXPECT_EQ(oRecord.m_dwType, static_cast<uint32_t>(REG_DWORD));
+		EXPECT_EQ(oRecord.m_nDataSize, sizeof(DWORD));
+		EXPECT_EQ(oRecord.m_hrResult, S_OK);
+		EXPECT_EQ(oRecord.m_nThreadIndex, 0U);
+	}
+	{
+		const auto& oRecord = oTraceData.m_arrRecords[4];
+		EXPECT_EQ(oRecord.m_eOperationType, Trace::QueryValueInfo);
+		EXPECT_EQ(oRecord.m_hrResult, __HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+	}
+	EXPECT_EQ(oTraceData.m_arrRecords[0].m_eOperationType, Trace::CreateKey);
+	{
+		const auto& oRecord = oTraceData.m_arrRecords[5];
+		EXPECT_EQ(oRecord.m_eOperationType, Trace::EnumSubkeys);
+		EXPECT_GE(nSubkeyCount, 2U);
+		EXPECT_EQ(oRecord.m_nDataSize, nSubkeyCount);
+		EXPECT_LT(oRecord.m_nDurationMicroseconds, static_cast<uint32_t>(std::chrono::microseconds{ durCallbackSleep }.count()));
+	}
+	EXPECT_EQ(oTraceData.m_arrRecords[6].m_eOperationType, Trace::OpenKey);
+	// Note: Names are stored once
+	EXPECT_EQ(oTraceData.m_arrNames.size(), 6U);
+
+	// Save, and load
+	TCHAR pszTempPath[MAX_PATH]{};
+	::GetTempPath(MAX_PATH, pszTempPath);
+	auto sTraceFilePath = vlr::tstring{ pszTempPath } + _T("vlr-test.RegistryAccessTrace.bin");
+	auto onDestroy_DeleteTraceFile = MakeActionOnDestruction([&] {
+		::DeleteFile(sTraceFilePath.c_str());
+	});
+	sr = spTraceRecorder->SaveToFile(sTraceFilePath);
+	ASSERT_EQ(sr, SResult::Success);
+	{
+		Trace::TraceData oTraceData_Loaded;
+		sr = oTraceData_Loaded.LoadFromFile(sTraceFilePath);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_EQ(oTraceData_Loaded.m_arrNames, oTraceData.m_arrNames);
+		EXPECT_EQ(oTraceData_Loaded.m_nThreadCount, oTraceData.m_nThreadCount);
+		ASSERT_EQ(oTraceData_Loaded.m_arrRecords.size(), oTraceData.m_arrRecords.size());
+		EXPECT_EQ(std::memcmp(oTraceData_Loaded.m_arrRecords.data(), oTraceData.m_arrRecords.data(), nRecordCount * sizeof(Trace::TraceRecord)), 0);
+	}
+	{
+		const auto arrGarbage = std::vector<BYTE>{ 0x01, 0x02, 0x03 };
+		sr = filesystem::WriteFileContents(sTraceFilePath, arrGarbage.data(), arrGarbage.size());
+		ASSERT_EQ(sr, SResult::Success);
+		Trace::TraceData oTraceData_Loaded;
+		sr = oTraceData_Loaded.LoadFromFile(sTraceFilePath);
+		EXPECT_EQ(sr.asHRESULT(), __HRESULT_FROM_WIN32(ERROR_BAD_FORMAT));
+	}
+
+	// Replay (read-only, so the create and write are skipped), with the recorded and with fewer threads
+	auto oReplay = CRegistryAccessTraceReplay{ oReg };
+	for (size_t nReplayThreadCount : { size_t{ 0 }, size_t{ 2 } })
+	{
+		auto oResult = CRegistryAccessTraceReplay::Result_Replay{};
+		sr = oReplay.Replay(oTraceData, CRegistryAccessTraceReplay::Options_Replay{}.withThreadCount(nReplayThreadCount), &oResult);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_EQ(oResult.m_nThreadCount, (nReplayThreadCount == 0) ? nThreadCount + 1 : nReplayThreadCount);
+		EXPECT_EQ(oResult.m_nOperationCount, nRecordCount - 2);
+		EXPECT_EQ(oResult.m_nSkippedCount, 2U);
+		EXPECT_EQ(oResult.m_nErrorCount, 1U);
+		EXPECT_EQ(oResult.m_nResultMismatchCount, 0U);
+		EXPECT_EQ(oResult.m_oLatencyStats.m_nCount, nRecordCount - 2);
+		EXPECT_EQ(oResult.m_arrLatencyStatsByOperation[Trace::ReadValue].m_nCount, 2 + nThreadCount * nReadsPerThread);
+		EXPECT_LE(oResult.m_oLatencyStats.m_nP50Microseconds, oResult.m_oLatencyStats.m_nP99Microseconds);
+		EXPECT_LE(oResult.m_oLatencyStats.m_nP99Microseconds, oResult.m_oLatencyStats.m_nMaxMicroseconds);
+	}
+	{
+		auto oResult = CRegistryAccessTraceReplay::Result_Replay{};
+		sr = oReplay.Replay(oTraceData, CRegistryAccessTraceReplay::Options_Replay{}.withSpeedFactor(100.0), &oResult);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_EQ(oResult.m_nOperationCount, nRecordCount - 2);
+		EXPECT_EQ(oResult.m_nResultMismatchCount, 0U);
+		sr = oReplay.Replay(oTraceData, CRegistryAccessTraceReplay::Options_Replay{}.withSpeedFactor(0.0));
+		EXPECT_EQ(sr.asHRESULT(), E_INVALIDARG);
+	}
+
+	// Replay with writes, against the key being written
+	{
+		auto oResult = CRegistryAccessTraceReplay::Result_Replay{};
+		sr = oReplay.Replay(oTraceData, CRegistryAccessTraceReplay::Options_Replay{}.withReplayWrites().withThreadCount(1), &oResult);
+		EXPECT_EQ(sr, SResult::Success);
+		EXPECT_EQ(oResult.m_nOperationCount, nRecordCount);
+		EXPECT_EQ(oResult.m_nSkippedCount, 0U);
+		EXPECT_EQ(oResult.m_nResultMismatchCount, 0U);
+		DWORD dwValue{};
+		EXPECT_EQ(oReg.ReadValue_DWORD(sTraceKey, svzTestValueName_DWORD, dwValue), SResult::Success);
+	}
+
+	// Records past the limit are dropped
+	{
+		auto spTraceRecorder_Limited = std::make_shared<CRegistryAccessTraceRecorder>(CRegistryAccessTraceRecorder::Options{}.withMaxRecordCount(2));
+		auto oRegTraced = oReg;
+		oRegTraced.SetTraceRecorder(spTraceRecorder_Limited);
+		for (size_t i = 0; i < 3; ++i)
+		{
+			oRegTraced.DoesKeyExist(svzTestKey);
+		}
+		EXPECT_EQ(spTraceRecorder_Limited->GetStats().m_nRecordCount, 2U);
+		EXPECT_EQ(spTraceRecorder_Limited->GetStats().m_nDroppedCount, 1U);
+	}
+}
+
+TEST(RegistryAccess, TraceReplayPrepareTarget)
+{
+	namespace Trace = RegistryAccess::Trace;
+
+	SResult sr;
+
+	static constexpr auto svzMissingValueName = vlr::tzstring_view{ _T("testMissing") };
+
+	auto sPrepareKey = fmt::format(_T("{}\{}"), svzBaseKey_Test, _T("testTracePrepare"));
+	auto sPrepareKey_Read = fmt::format(_T("{}\{}"), sPrepareKey, _T("Read"));
+	auto sPrepareKey_Created = fmt::format(_T("{}\{}"), sPrepareKey, _T("Created"));
+	auto sPrepareKey_Missing = fmt::format(_T("{}\{}"), sPrepareKey, _T("Missing"));
+
+	auto oReg = CRegistryAccess{ HKEY_CURRENT_USER };
+	const auto oDeleteKeyOptions = CRegistryAccess::Options_DeleteKeysOrValues{}
+		.withSafeDeletePath(svzBaseKey_Test);
+	auto fDeleteTestKeys = [&] {
+		oReg.DeleteKey(sPrepareKey_Read, oDeleteKeyOptions);
+		oReg.DeleteKey(sPrepareKey_Created, oDeleteKeyOptions);
+		oReg.DeleteKey(sPrepareKey_Missing, oDeleteKeyOptions);
+		oReg.DeleteKey(sPrepareKey, oDeleteKeyOptions);
+	};
+	fDeleteTestKeys();
+	auto onDestroy_DeleteTestKeys = MakeActionOnDestruction(fDeleteTestKeys);
+
+	// A trace which read a DWORD and a binary value, and enumerated a key, which all existed; failed to find a value
+	// and a key; and created a key
+	auto oTraceData = Trace::TraceData{};
+	auto fAddName = [&](vlr::tstring sName)
+	{
+		oTraceData.m_arrNames.push_back(std::move(sName));
+		return static_cast<uint32_t>(oTraceData.m_arrNames.size() - 1);
+	};
+	auto nKeyNameId_Read = fAddName(sPrepareKey_Read);
+	auto nKeyNameId_Created = fAddName(sPrepareKey_Created);
+	auto nKeyNameId_Missing = fAddName(sPrepareKey_Missing);
+	auto nValueNameId_DWORD = fAddName(vlr::tstring{ svzTestValueName_DWORD });
+	auto nValueNameId_BINARY = fAddName(vlr::tstring{ svzTestValueName_BINARY });
+	auto nValueNameId_Missing = fAddName(vlr::tstring{ svzMissingValueName });
+	auto fAddRecord = [&](Trace::OperationType eOperationType, uint32_t nKeyNameId, uint32_t nValueNameId, DWORD dwType, uint32_t nDataSize, HRESULT hrResult)
+	{
+		auto& oRecord = oTraceData.m_arrRecords.emplace_back();
+		oRecord.m_eOperationType = eOperationType;
+		oRecord.m_nKeyNameId = nKeyNameId;
+		oRecord.m_nValueNameId = nValueNameId;
+		oRecord.m_dwType = dwType;
+		oRecord.m_nDataSize = nDataSize;
+		oRecord.m_hrResult = hrResult;
+	};
+	fAddRecord(Trace::ReadValue, nKeyNameId_Read, nValueNameId_DWORD, REG_DWORD, sizeof(DWORD), S_OK);
+	fAddRecord(Trace::ReadValue, nKeyNameId_Read, nValueNameId_BINARY, REG_BINARY, 100, S_OK);
+	fAddRecord(Trace::QueryValueInfo, nKeyNameId_Read, nValueNameId_Missing, 0, 0, __HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+	fAddRecord(Trace::EnumValues, nKeyNameId_Read, 0, 0, 2, S_OK);
+	fAddRecord(Trace::OpenKey, nKeyNameId_Missing, 0, 0, 0, S_FALSE);
+	fAddRecord(Trace::CreateKey, nKeyNameId_Created, 0, 0, 0, S_OK);
+
+	auto oReplay = CRegistryAccessTraceReplay{ oReg };
+	sr = oReplay.PrepareTarget(oTraceData);
+	ASSERT_EQ(sr, SResult::Success);
+
+	// The values read are written with the recorded type and size; nothing is made for the failed reads
+	DWORD dwType{};
+	DWORD dwSize{};
+	sr = oReg.ReadValueInfo(sPrepareKey_Read, svzTestValueName_DWORD, dwType, dwSize);
+	EXPECT_EQ(sr, SResult::Success);
+	EXPECT_EQ(dwType, static_cast<DWORD>(REG_DWORD));
+	EXPECT_EQ(dwSize, sizeof(DWORD));
+	sr = oReg.ReadValueInfo(sPrepareKey_Read, svzTestValueName_BINARY, dwType, dwSize);
+	EXPECT_EQ(sr, SResult::Success);
+	EXPECT_EQ(dwType, static_cast<DWORD>(REG_BINARY));
+	EXPECT_EQ(dwSize, 100U);
+	sr = oReg.ReadValueInfo(sPrepareKey_Read, svzMissingValueName, dwType, dwSize);
+	EXPECT_FALSE(sr.isSuccess());
+	EXPECT_FALSE(oReg.DoesKeyExist(sPrepareKey_Missing));
+	// Note: Creates are left to the replay
+	EXPECT_FALSE(oReg.DoesKeyExist(sPrepareKey_Created));
+
+	// Preparing again leaves the target as is
+	sr = oReplay.PrepareTarget(oTraceData);
+	EXPECT_EQ(sr, SResult::Success);
+
+	// The replay then sees the same results as the recording
+	auto oResult = CRegistryAccessTraceReplay::Result_Replay{};
+	sr = oReplay.Replay(oTraceData, CRegistryAccessTraceReplay::Options_Replay{}.withReplayWrites(), &oResult);
+	EXPECT_EQ(sr, SResult::Success);
+	EXPECT_EQ(oResult.m_nOperationCount, oTraceData.m_arrRecords.size());
+	EXPECT_EQ(oResult.m_nResultMismatchCount, 0U);
+	EXPECT_TRUE(oReg.DoesKeyExist(sPrepareKey_Created));
+}
+
+TEST(RegistryAccess, Diff)
+{
+	using ChangeType = RegistryAccess::ChangeType;
+
+	SResult sr;
+
+	static constexpr auto svzExtraValueName = vlr::tzstring_view{ _T("testExtra") };
+
+	auto sSourceKey = fmt::format(_T("{}\\{}"), svzBaseKey_Test, _T("testDiffSource"));
+	auto sTargetKey = fmt::format(_T("{}\\{}"), svzBaseKey_Test, _T("testDiffTarget"));
+
+	auto oReg = CRegistryAccess{ HKEY_CURRENT_USER };
+	const auto oDeleteKeyOptions = CRegistryAccess::Options_DeleteKeysOrValues{}
+		.withSafeDeletePath(svzBaseKey_Test);
+	auto fDeleteTestKeys = [&] {
+		for (const auto& sKey : { sSourceKey, sTargetKey })
+		{
+			for (const auto* pszSubkeyName : { _T("A"), _T("B"), _T("C") })
+			{
+				oReg.DeleteKey(fmt::format(_T("{}\\{}"), sKey, pszSubkeyName), oDeleteKeyOptions);
+			}
+			oReg.DeleteKey(sKey, oDeleteKeyOptions);
+		}
+	};
+	fDeleteTestKeys();
+	auto onDestroy_DeleteTestKeys = MakeActionOnDestruction(fDeleteTestKeys);
+
+	// Source: testDWORD, testExtra, A\testQWORD, B\testDWORD
+	// Target: testDWORD (changed), testString, A\testQWORD, C\testDWORD
+	ASSERT_EQ(oReg.WriteValue_DWORD(sSourceKey, svzTestValueName_DWORD, nTestValue_DWORD), SResult::Success);
+	ASSERT_EQ(oReg.WriteValue_DWORD(sSourceKey, svzExtraValueName, nTestValue_DWORD), SResult::Success);
+	ASSERT_EQ(oReg.WriteValue_QWORD(fmt::format(_T("{}\\A"), sSourceKey), svzTestValueName_QWORD, nTestValue_QWORD), SResult::Success);
+	ASSERT_EQ(oReg.WriteValue_DWORD(fmt::format(_T("{}\\B"), sSourceKey), svzTestValueName_DWORD, nTestValue_DWORD), SResult::Success);
+	ASSERT_EQ(oReg.WriteValue_DWORD(sTargetKey, svzTestValueName_DWORD, nTestValue_DWORD + 1), SResult::Success);
+	ASSERT_EQ(oReg.WriteValue_String(sTargetKey, svzTestValueName_SZ, vlr::tstring{ svzTestValue_SZ }), SResult::Success);
+	ASSERT_EQ(oReg.WriteValue_QWORD(fmt::format(_T("{}\\A"), sTargetKey), svzTestValueName_QWORD, nTestValue_QWORD), SResult::Success);
+	ASSERT_EQ(oReg.WriteValue_DWORD(fmt::format(_T("{}\\C"), sTargetKey), svzTestValueName_DWORD, nTestValue_DWORD), SResult::Success);
+
+	auto oDiff = CRegistryAccessDiff{};
+	auto oSource = CRegistryDiffSource{ oReg, sSourceKey };
+	auto oTarget = CRegistryDiffSource{ oReg, sTargetKey };
+
+	RegistryAccess::ChangeSet oChangeSet;
+	CRegistryAccessDiff::Result_Diff oResult;
+	sr = oDiff.Diff(oSource, oTarget, oChangeSet, {}, &oResult);
+	EXPECT_EQ(sr, SResult::Success);
+	ASSERT_EQ(oChangeSet.size(), 6U);
+	EXPECT_EQ(oChangeSet[0].m_eChangeType, ChangeType::ModifyValue);
+	EXPECT_TRUE(StringCompare::CI().AreEqual(oChangeSet[0].m_sValueName, svzTestValueName_DWORD));
+	EXPECT_EQ(oChangeSet[0].m_dwType, static_cast<DWORD>(REG_DWORD));
+	ASSERT_EQ(oChangeSet[0].m_arrData_Source.size(), sizeof(DWORD));
+	{
+		DWORD dwValue{};
+		std::memcpy(&dwValue, oChangeSet[0].m_arrData_Source.data(), sizeof(dwValue));
+		EXPECT_EQ(dwValue, nTestValue_DWORD);
+	}
+	EXPECT_EQ(oChangeSet[1].m_eChangeType, ChangeType::RemoveValue);
+	EXPECT_TRUE(StringCompare::CI().AreEqual(oChangeSet[1].m_sValueName, svzExtraValueName));
+	EXPECT_EQ(oChangeSet[2].m_eChangeType, ChangeType::AddValue);
+	EXPECT_TRUE(StringCompare::CI().AreEqual(oChangeSet[2].m_sValueName, svzTestValueName_SZ));
+	EXPECT_EQ(oChangeSet[3].m_eChangeType, ChangeType::RemoveKey);
+	EXPECT_TRUE(StringCompare::CI().AreEqual(oChangeSet[3].m_sKeyPath, _T("B")));
+	EXPECT_EQ(oChangeSet[4].m_eChangeType, ChangeType::AddKey);
+	EXPECT_TRUE(StringCompare::CI().AreEqual(oChangeSet[4].m_sKeyPath, _T("C")));
+	EXPECT_EQ(oChangeSet[5].m_eChangeType, ChangeType::AddValue);
+	EXPECT_TRUE(StringCompare::CI().AreEqual(oChangeSet[5].m_sKeyPath, _T("C")));
+	EXPECT_EQ(oResult.m_nKeysCompared, 2U);
+	EXPECT_EQ(oResult.m_nValuesCompared, 2U);
+	EXPECT_EQ(oResult.m_nValuesModified, 1U);
+	// Note: The DWORDs (42 and 43) differ in the first byte; the QWORDs are equal
+	EXPECT_EQ(oResult.m_nBytesCompared, 1U + sizeof(QWORD));
+
+	// Note: A failure from the callback stops the diff
+	size_t nChangeCount = 0;
+	sr = oDiff.DiffToCallback(oSource, oTarget, [&](const RegistryAccess::RegistryChange& /*oChange*/)
+	{
+		++nChangeCount;
+		return SResult{ E_ABORT };
+	});
+	EXPECT_EQ(sr.asHRESULT(), E_ABORT);
+	EXPECT_EQ(nChangeCount, 1U);
+
+	// Applying the change set to the source makes it match the target
+	CRegistryAccessDiff::Result_Apply oResult_Apply;
+	sr = oDiff.ApplyChanges(oReg, sSourceKey, oChangeSet, &oResult_Apply);
+	EXPECT_EQ(sr, SResult::Success);
+	EXPECT_EQ(oResult_Apply.m_nChangesApplied, 6U);
+	EXPECT_EQ(oResult_Apply.m_nKeysRemoved, 1U);
+	EXPECT_FALSE(oReg.DoesKeyExist(fmt::format(_T("{}\\B"), sSourceKey)));
+	sr = oDiff.Diff(oSource, oTarget, oChangeSet);
+	EXPECT_EQ(sr, SResult::Success);
+	EXPECT_TRUE(oChangeSet.empty());
+
+	// Snapshot source
+	registry::HiveKey oSnapshot;
+	sr = oDiff.CaptureSnapshot(oTarget, oSnapshot);
+	EXPECT_EQ(sr, SResult::Success);
+	EXPECT_EQ(oSnapshot.m_arrValues.size(), 2U);
+	EXPECT_EQ(oSnapshot.m_arrSubkeys.size(), 2U);
+	sr = oDiff.Diff(CRegistryDiffSource{ oSnapshot }, oTarget, oChangeSet);
+	EXPECT_EQ(sr, SResult::Success);
+	EXPECT_TRUE(oChangeSet.empty());
+	oSnapshot.AddValue_DWORD(std::wstring_view{ svzExtraValueName.data(), svzExtraValueName.size() }, nTestValue_DWORD);
+	sr = oDiff.Diff(CRegistryDiffSource{ oSnapshot }, oTarget, oChangeSet);
+	EXPECT_EQ(sr, SResult::Success);
+	ASSERT_EQ(oChangeSet.size(), 1U);
+	EXPECT_EQ(oChangeSet[0].m_eChangeType, ChangeType::RemoveValue);
+
+	// A missing root is an absent tree
+	sr = oDiff.Diff(oSource, CRegistryDiffSource{ oReg, svzBaseKey_Invalid }, oChangeSet);
+	EXPECT_EQ(sr, SResult::Success);
+	ASSERT_EQ(oChangeSet.size(), 1U);
+	EXPECT_EQ(oChangeSet[0].m_eChangeType, ChangeType::RemoveKey);
+	EXPECT_TRUE(oChangeSet[0].m_sKeyPath.empty());
+}
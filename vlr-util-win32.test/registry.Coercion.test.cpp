@@ -0,0 +1,130 @@
+#include "pch.h"
+
+#include <string>
+
+#include "vlr-util-win32/registry.Coercion.h"
+
+using namespace vlr;
+using namespace vlr::win32;
+using namespace vlr::win32::registry;
+
+namespace {
+
+template <typename TData, typename TValue>
+SResult Coerce(DWORD dwType, const TData& tData, TValue& tValue, CoercionMode eMode)
+{
+	return CoerceRegData(dwType, cpp::span<const BYTE>{ reinterpret_cast<const BYTE*>(&tData), sizeof(tData) }, tValue, eMode);
+}
+
+template <typename TValue>
+SResult CoerceString(vlr::tstring_view svData, TValue& tValue, CoercionMode eMode)
+{
+	return CoerceRegData(REG_SZ, cpp::span<const BYTE>{ reinterpret_cast<const BYTE*>(svData.data()), svData.size() * sizeof(TCHAR) }, tValue, eMode);
+}
+
+} // namespace
+
+TEST(RegistryCoercion, Table)
+{
+	static_assert(IsCoercionSupported<DWORD>(REG_DWORD, CoercionMode::Strict));
+	static_assert(!IsCoercionSupported<DWORD>(REG_QWORD, CoercionMode::Strict));
+	static_assert(IsCoercionSupported<DWORD>(REG_QWORD, CoercionMode::Lenient));
+	static_assert(!IsCoercionSupported<DWORD>(REG_SZ, CoercionMode::Lenient));
+	static_assert(IsCoercionSupported<DWORD>(REG_SZ, CoercionMode::NumericParse));
+	static_assert(!IsCoercionSupported<DWORD>(REG_MULTI_SZ, CoercionMode::NumericParse));
+	static_assert(IsCoercionSupported<bool>(REG_DWORD, CoercionMode::Strict));
+	static_assert(IsCoercionSupported<std::wstring>(REG_EXPAND_SZ, CoercionMode::Strict));
+	static_assert(!IsCoercionSupported<std::wstring>(REG_DWORD, CoercionMode::Strict));
+	static_assert(!IsCoercionSupported<std::string>(REG_QWORD + 1, CoercionMode::NumericParse));
+}
+
+TEST(RegistryCoercion, Numeric)
+{
+	DWORD dwValue{};
+	uint64_t qwValue{};
+
+	EXPECT_EQ(Coerce(REG_DWORD, DWORD{ 42 }, dwValue, CoercionMode::Strict), SResult::Success);
+	EXPECT_EQ(dwValue, 42U);
+	EXPECT_EQ(Coerce(REG_QWORD, uint64_t{ 42 }, dwValue, CoercionMode::Strict).asHRESULT(), E_UNEXPECTED);
+
+	EXPECT_EQ(Coerce(REG_QWORD, uint64_t{ 43 }, dwValue, CoercionMode::Lenient), SResult::Success);
+	EXPECT_EQ(dwValue, 43U);
+	EXPECT_EQ(Coerce(REG_QWORD, uint64_t{ 1 } << 32, dwValue, CoercionMode::Lenient).asHRESULT(), __HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW));
+	EXPECT_EQ(Coerce(REG_DWORD, DWORD{ 44 }, qwValue, CoercionMode::Lenient), SResult::Success);
+	EXPECT_EQ(qwValue, 44U);
+	EXPECT_EQ(Coerce(REG_DWORD_BIG_ENDIAN, DWORD{ 0x2A000000 }, dwValue, CoercionMode::Lenient), SResult::Success);
+	EXPECT_EQ(dwValue, 42U);
+	EXPECT_EQ(Coerce(REG_BINARY, DWORD{ 45 }, dwValue, CoercionMode::Lenient), SResult::Success);
+	EXPECT_EQ(dwValue, 45U);
+	EXPECT_EQ(Coerce(REG_BINARY, DWORD{ 45 }, qwValue, CoercionMode::Lenient).asHRESULT(), __HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+}
+
+TEST(RegistryCoercion, NumericParse)
+{
+	DWORD dwValue{};
+	uint64_t qwValue{};
+
+	EXPECT_EQ(CoerceString(_T("42"), dwValue, CoercionMode::Lenient).asHRESULT(), E_UNEXPECTED);
+	EXPECT_EQ(CoerceString(_T("42"), dwValue, CoercionMode::NumericParse), SResult::Success);
+	EXPECT_EQ(dwValue, 42U);
+	EXPECT_EQ(CoerceString(_T(" 0x2a "), dwValue, CoercionMode::NumericParse), SResult::Success);
+	EXPECT_EQ(dwValue, 42U);
+	// Note: The terminator (and anything after it) is not part of the string
+	EXPECT_EQ(CoerceString(vlr::tstring_view{ _T("7\0junk"), 6 }, dwValue, CoercionMode::NumericParse), SResult::Success);
+	EXPECT_EQ(dwValue, 7U);
+	EXPECT_EQ(CoerceString(_T("18446744073709551615"), qwValue, CoercionMode::NumericParse), SResult::Success);
+	EXPECT_EQ(qwValue, 18446744073709551615ULL);
+
+	EXPECT_EQ(CoerceString(_T("4294967296"), dwValue, CoercionMode::NumericParse).asHRESULT(), __HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW));
+	EXPECT_EQ(CoerceString(_T("18446744073709551616"), qwValue, CoercionMode::NumericParse).asHRESULT(), __HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW));
+	EXPECT_EQ(CoerceString(_T(""), dwValue, CoercionMode::NumericParse).asHRESULT(), __HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+	EXPECT_EQ(CoerceString(_T("-1"), dwValue, CoercionMode::NumericParse).asHRESULT(), __HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+	EXPECT_EQ(CoerceString(_T("12ab"), dwValue, CoercionMode::NumericParse).asHRESULT(), __HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+	EXPECT_EQ(CoerceString(_T("0x"), dwValue, CoercionMode::NumericParse).asHRESULT(), __HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+}
+
+TEST(RegistryCoercion, BoolAndString)
+{
+	bool bValue{};
+	EXPECT_EQ(Coerce(REG_DWORD, DWORD{ 2 }, bValue, CoercionMode::Strict), SResult::Success);
+	EXPECT_TRUE(bValue);
+	EXPECT_EQ(Coerce(REG_QWORD, uint64_t{ 0 }, bValue, CoercionMode::Lenient), SResult::Success);
+	EXPECT_FALSE(bValue);
+	EXPECT_EQ(CoerceString(_T("True"), bValue, CoercionMode::NumericParse), SResult::Success);
+	EXPECT_TRUE(bValue);
+	EXPECT_EQ(CoerceString(_T("0"), bValue, CoercionMode::NumericParse), SResult::Success);
+	EXPECT_FALSE(bValue);
+	EXPECT_EQ(CoerceString(_T("maybe"), bValue, CoercionMode::NumericParse).asHRESULT(), __HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+
+	std::string saValue;
+	std::wstring swValue;
+	EXPECT_EQ(CoerceString(_T("value"), saValue, CoercionMode::Strict), SResult::Success);
+	EXPECT_EQ(saValue, "value");
+	EXPECT_EQ(Coerce(REG_DWORD, DWORD{ 42 }, swValue, CoercionMode::Strict).asHRESULT(), E_UNEXPECTED);
+	EXPECT_EQ(Coerce(REG_DWORD, DWORD{ 42 }, swValue, CoercionMode::Lenient), SResult::Success);
+	EXPECT_EQ(swValue, L"42");
+	EXPECT_EQ(Coerce(REG_QWORD, uint64_t{ 42 }, saValue, CoercionMode::Lenient), SResult::Success);
+	EXPECT_EQ(saValue, "42");
+}
+
+TEST(RegistryCoercion, Counts)
+{
+	DWORD dwValue{};
+	bool bValue{};
+
+	auto oCounts_Before = GetCoercionCounts();
+	EXPECT_EQ(Coerce(REG_DWORD, DWORD{ 42 }, dwValue, CoercionMode::Strict), SResult::Success);
+	EXPECT_EQ(Coerce(REG_DWORD, DWORD{ 1 }, bValue, CoercionMode::Strict), SResult::Success);
+	EXPECT_EQ(Coerce(REG_QWORD, uint64_t{ 1 }, bValue, CoercionMode::Lenient), SResult::Success);
+	EXPECT_EQ(Coerce(REG_QWORD, uint64_t{ 42 }, dwValue, CoercionMode::Lenient), SResult::Success);
+	EXPECT_EQ(Coerce(REG_QWORD, uint64_t{ 42 }, dwValue, CoercionMode::Lenient), SResult::Success);
+	// Note: Disallowed conversions are not counted
+	EXPECT_EQ(Coerce(REG_QWORD, uint64_t{ 42 }, dwValue, CoercionMode::Strict).asHRESULT(), E_UNEXPECTED);
+	auto oCounts_After = GetCoercionCounts();
+
+	// Note: Native type reads are not coercions
+	EXPECT_EQ(oCounts_After.Get(Target_DWORD, REG_DWORD), oCounts_Before.Get(Target_DWORD, REG_DWORD));
+	EXPECT_EQ(oCounts_After.Get(Target_DWORD, REG_QWORD), oCounts_Before.Get(Target_DWORD, REG_QWORD) + 2);
+	EXPECT_EQ(oCounts_After.Get(Target_Bool, REG_DWORD), oCounts_Before.Get(Target_Bool, REG_DWORD));
+	EXPECT_EQ(oCounts_After.Get(Target_Bool, REG_QWORD), oCounts_Before.Get(Target_Bool, REG_QWORD) + 1);
+}
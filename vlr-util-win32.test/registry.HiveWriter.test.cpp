@@ -0,0 +1,211 @@
+#include "pch.h"
+
+#include <cstring>
+
+#include "vlr-util-win32/registry.HiveWriter.h"
+
+using namespace vlr;
+using namespace vlr::win32;
+using namespace vlr::win32::registry;
+
+namespace {
+
+HiveKey MakeTestTree()
+{
+	HiveKey oRootKey;
+	auto& oKey = oRootKey.AddSubkey(L"Software").AddSubkey(L"vlr-test");
+	oKey.AddValue_DWORD(L"testDWORD", 42);
+	oKey.AddValue_QWORD(L"testQWORD", 42);
+	oKey.AddValue_String(L"testString", L"value");
+	oKey.AddValue_MultiString(L"testMultiSz", { L"a", L"bc" });
+	std::vector<uint8_t> arrBigData(100000);
+	for (size_t nIndex = 0; nIndex < arrBigData.size(); ++nIndex)
+	{
+		arrBigData[nIndex] = static_cast<uint8_t>(nIndex * 7);
+	}
+	oKey.AddValue(L"testBinary_Big", REG_BINARY, std::move(arrBigData));
+
+	auto& oManyKey = oRootKey.AddSubkey(L"Many");
+	for (int nIndex = 0; nIndex < 1500; ++nIndex)
+	{
+		oManyKey.AddSubkey(L"key" + std::to_wstring((nIndex * 7919) % 1500)).AddValue_DWORD(L"index", nIndex);
+	}
+
+	return oRootKey;
+}
+
+uint32_t ReadUInt32(const std::vector<uint8_t>& arrData, size_t nOffset)
+{
+	uint32_t nValue{};
+	std::memcpy(&nValue, arrData.data() + nOffset, sizeof(nValue));
+	return nValue;
+}
+
+} // namespace
+
+TEST(RegistryHiveWriter, Format)
+{
+	auto oRootKey = MakeTestTree();
+
+	std::vector<uint8_t> arrHive;
+	size_t nOutputCount = 0;
+	auto fOnOutput = [&](cpp::span<const uint8_t> spanOutput) -> SResult
+	{
+		arrHive.insert(arrHive.end(), spanOutput.begin(), spanOutput.end());
+		++nOutputCount;
+		return SResult::Success;
+	};
+
+	Result_HiveWriter oResult;
+	auto sr = CHiveWriter{}.WriteToCallback(oRootKey, fOnOutput, Options_HiveWriter{}.withLastWriteTime(0x01D0000000000000), &oResult);
+	ASSERT_EQ(sr, SResult::Success);
+	EXPECT_EQ(oResult.m_nKeyCount, 1504U);
+	EXPECT_EQ(oResult.m_nValueCount, 1505U);
+	EXPECT_EQ(oResult.m_nBigDataValueCount, 1U);
+	EXPECT_EQ(oResult.m_nFileSize, arrHive.size());
+	// Note: The base block, then one call per bin
+	EXPECT_EQ(nOutputCount, oResult.m_nHiveBinCount + 1);
+
+	// Base block
+	ASSERT_GE(arrHive.size(), 8192U);
+	EXPECT_EQ(std::memcmp(arrHive.data(), "regf", 4), 0);
+	EXPECT_EQ(ReadUInt32(arrHive, 4), ReadUInt32(arrHive, 8));
+	EXPECT_EQ(ReadUInt32(arrHive, 20), 1U);
+	EXPECT_EQ(ReadUInt32(arrHive, 24), 5U);
+	EXPECT_EQ(ReadUInt32(arrHive, 40) + 4096, arrHive.size());
+	uint32_t nChecksum = 0;
+	for (size_t nOffset = 0; nOffset < 508; nOffset += 4)
+	{
+		nChecksum ^= ReadUInt32(arrHive, nOffset);
+	}
+	EXPECT_EQ(ReadUInt32(arrHive, 508), nChecksum);
+
+	// Note: Bins are contiguous, and their cells exactly fill them
+	size_t nBinCount = 0;
+	for (size_t nBinOffset = 4096; nBinOffset < arrHive.size(); ++nBinCount)
+	{
+		ASSERT_EQ(std::memcmp(arrHive.data() + nBinOffset, "hbin", 4), 0);
+		EXPECT_EQ(ReadUInt32(arrHive, nBinOffset + 4), nBinOffset - 4096);
+		auto nBinSize = ReadUInt32(arrHive, nBinOffset + 8);
+		ASSERT_EQ(nBinSize % 4096, 0U);
+		ASSERT_GT(nBinSize, 0U);
+
+		size_t nCellOffset = nBinOffset + 32;
+		while (nCellOffset < nBinOffset + nBinSize)
+		{
+			auto nCellSize = static_cast<int32_t>(ReadUInt32(arrHive, nCellOffset));
+			auto nCellSize_Abs = static_cast<size_t>(nCellSize < 0 ? -nCellSize : nCellSize);
+			ASSERT_GT(nCellSize_Abs, 0U);
+			ASSERT_EQ(nCellSize_Abs % 8, 0U);
+			nCellOffset += nCellSize_Abs;
+		}
+		EXPECT_EQ(nCellOffset, nBinOffset + nBinSize);
+		nBinOffset += nBinSize;
+	}
+	EXPECT_EQ(nBinCount, oResult.m_nHiveBinCount);
+
+	// Note: Output is deterministic for a fixed last write time
+	std::vector<uint8_t> arrHive_Again;
+	sr = CHiveWriter{}.WriteToCallback(oRootKey, [&](cpp::span<const uint8_t> spanOutput) -> SResult
+	{
+		arrHive_Again.insert(arrHive_Again.end(), spanOutput.begin(), spanOutput.end());
+		return SResult::Success;
+	}, Options_HiveWriter{}.withLastWriteTime(0x01D0000000000000));
+	EXPECT_EQ(sr, SResult::Success);
+	EXPECT_EQ(arrHive_Again, arrHive);
+}
+
+TEST(RegistryHiveWriter, InvalidTree)
+{
+	auto fOnOutput = [&](cpp::span<const uint8_t> /*spanOutput*/) -> SResult
+	{
+		ADD_FAILURE() << "Nothing should be written for an invalid tree";
+		return SResult::Success;
+	};
+
+	HiveKey oRootKey_DuplicateKey;
+	oRootKey_DuplicateKey.AddSubkey(L"Name");
+	oRootKey_DuplicateKey.AddSubkey(L"NAME");
+	EXPECT_EQ(CHiveWriter{}.WriteToCallback(oRootKey_DuplicateKey, fOnOutput).asHRESULT(), E_INVALIDARG);
+
+	HiveKey oRootKey_DuplicateValue;
+	oRootKey_DuplicateValue.AddValue_DWORD(L"Name", 1);
+	oRootKey_DuplicateValue.AddValue_DWORD(L"name", 2);
+	EXPECT_EQ(CHiveWriter{}.WriteToCallback(oRootKey_DuplicateValue, fOnOutput).asHRESULT(), E_INVALIDARG);
+
+	HiveKey oRootKey_InvalidName;
+	oRootKey_InvalidName.AddSubkey(L"a\\b");
+	EXPECT_EQ(CHiveWriter{}.WriteToCallback(oRootKey_InvalidName, fOnOutput).asHRESULT(), E_INVALIDARG);
+
+	HiveKey oRootKey_EmptyName;
+	oRootKey_EmptyName.AddSubkey(L"");
+	EXPECT_EQ(CHiveWriter{}.WriteToCallback(oRootKey_EmptyName, fOnOutput).asHRESULT(), E_INVALIDARG);
+}
+
+TEST(RegistryHiveWriter, OutputFailure)
+{
+	auto oRootKey = MakeTestTree();
+
+	size_t nOutputCount = 0;
+	auto fOnOutput = [&](cpp::span<const uint8_t> /*spanOutput*/) -> SResult
+	{
+		return (++nOutputCount < 3) ? SResult::Success : SResult::For_win32_ErrorCode(ERROR_DISK_FULL);
+	};
+	auto sr = CHiveWriter{}.WriteToCallback(oRootKey, fOnOutput);
+	EXPECT_EQ(sr.asHRESULT(), __HRESULT_FROM_WIN32(ERROR_DISK_FULL));
+	EXPECT_EQ(nOutputCount, 3U);
+}
+
+TEST(RegistryHiveWriter, LoadWrittenHive)
+{
+	TCHAR pszTempPath[MAX_PATH]{};
+	::GetTempPath(MAX_PATH, pszTempPath);
+	auto pathHive = std::filesystem::path{ pszTempPath } / _T("vlr-test.HiveWriter.hiv");
+
+	auto oRootKey = MakeTestTree();
+	auto sr = CHiveWriter{}.WriteToFile(oRootKey, pathHive);
+	ASSERT_EQ(sr, SResult::Success);
+	auto oOnDestroy_RemoveFile = MakeActionOnDestruction([&] {
+		std::error_code ec;
+		std::filesystem::remove(pathHive, ec);
+	});
+
+	// Note: App hives can be loaded without privileges
+	HKEY hKey_Hive{};
+	auto lResult = ::RegLoadAppKeyW(pathHive.c_str(), &hKey_Hive, KEY_READ, 0, 0);
+	ASSERT_EQ(lResult, ERROR_SUCCESS);
+	auto oOnDestroy_CloseKey = MakeActionOnDestruction([&] {
+		::RegCloseKey(hKey_Hive);
+	});
+
+	DWORD dwValue{};
+	DWORD dwDataSize = sizeof(dwValue);
+	lResult = ::RegGetValueW(hKey_Hive, L"Software\\vlr-test", L"testDWORD", RRF_RT_REG_DWORD, nullptr, &dwValue, &dwDataSize);
+	EXPECT_EQ(lResult, ERROR_SUCCESS);
+	EXPECT_EQ(dwValue, 42U);
+
+	wchar_t pszValue[16]{};
+	dwDataSize = sizeof(pszValue);
+	lResult = ::RegGetValueW(hKey_Hive, L"SOFTWARE\\VLR-TEST", L"testString", RRF_RT_REG_SZ, nullptr, pszValue, &dwDataSize);
+	EXPECT_EQ(lResult, ERROR_SUCCESS);
+	EXPECT_STREQ(pszValue, L"value");
+
+	std::vector<uint8_t> arrBigData(100000);
+	dwDataSize = static_cast<DWORD>(arrBigData.size());
+	lResult = ::RegGetValueW(hKey_Hive, L"Software\\vlr-test", L"testBinary_Big", RRF_RT_REG_BINARY, nullptr, arrBigData.data(), &dwDataSize);
+	EXPECT_EQ(lResult, ERROR_SUCCESS);
+	EXPECT_EQ(dwDataSize, 100000U);
+	EXPECT_EQ(arrBigData[99999], static_cast<uint8_t>(99999 * 7));
+
+	// Note: Lookup through the hash leaves (under an index root)
+	dwDataSize = sizeof(dwValue);
+	lResult = ::RegGetValueW(hKey_Hive, L"Many\\key1234", L"index", RRF_RT_REG_DWORD, nullptr, &dwValue, &dwDataSize);
+	EXPECT_EQ(lResult, ERROR_SUCCESS);
+	HKEY hKey_Many{};
+	ASSERT_EQ(::RegOpenKeyExW(hKey_Hive, L"Many", 0, KEY_READ, &hKey_Many), ERROR_SUCCESS);
+	DWORD dwSubkeyCount{};
+	lResult = ::RegQueryInfoKeyW(hKey_Many, nullptr, nullptr, nullptr, &dwSubkeyCount, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr);
+	::RegCloseKey(hKey_Many);
+	EXPECT_EQ(lResult, ERROR_SUCCESS);
+	EXPECT_EQ(dwSubkeyCount, 1500U);
+}
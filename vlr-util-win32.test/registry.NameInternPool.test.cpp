@@ -0,0 +1,85 @@
+#include "pch.h"
+
+#include <thread>
+#include <vector>
+#include <fmt/format.h>
+
+#include "vlr-util-win32/registry.NameInternPool.h"
+
+using namespace vlr;
+using namespace vlr::win32;
+using namespace vlr::win32::registry;
+
+TEST(RegistryNameInternPool, Intern)
+{
+	auto oPool = CNameInternPool{};
+
+	auto svzName1 = oPool.Intern(_T("DisplayName"));
+	auto svzName2 = oPool.Intern(vlr::tstring{ _T("DisplayName") });
+	EXPECT_EQ(svzName1.data(), svzName2.data());
+	EXPECT_EQ(vlr::tstring_view{ svzName1.data() }, _T("DisplayName"));
+	// Note: Pooled by exact spelling
+	auto svzName3 = oPool.Intern(_T("displayname"));
+	EXPECT_NE(svzName1.data(), svzName3.data());
+	auto svzEmpty = oPool.Intern(_T(""));
+	EXPECT_EQ(svzEmpty.size(), 0U);
+
+	auto oStats = oPool.GetStats();
+	EXPECT_EQ(oStats.m_nNameCount, 3U);
+	EXPECT_EQ(oStats.m_nLookupCount, 4U);
+	EXPECT_EQ(oStats.m_nHitCount, 1U);
+}
+
+TEST(RegistryNameInternPool, StableViews)
+{
+	// Note: Small blocks, so the pool adds many blocks (and a dedicated block for the long name)
+	auto oPool = CNameInternPool{ 16 };
+
+	std::vector<vlr::tzstring_view> arrNames;
+	for (size_t i = 0; i < 1000; ++i)
+	{
+		arrNames.push_back(oPool.Intern(fmt::format(_T("value{}"), i)));
+	}
+	const auto sLongName = vlr::tstring(100, _T('x'));
+	auto svzLongName = oPool.Intern(sLongName);
+
+	for (size_t i = 0; i < arrNames.size(); ++i)
+	{
+		EXPECT_EQ(vlr::tstring_view{ arrNames[i].data() }, fmt::format(_T("value{}"), i));
+	}
+	EXPECT_EQ(vlr::tstring_view{ svzLongName.data() }, sLongName);
+	EXPECT_EQ(oPool.GetStats().m_nNameCount, 1001U);
+}
+
+TEST(RegistryNameInternPool, Threads)
+{
+	auto oPool = CNameInternPool{};
+
+	static constexpr size_t nThreadCount = 8;
+	static constexpr size_t nNameCount = 200;
+	std::vector<std::vector<const TCHAR*>> arrThreadResults(nThreadCount);
+	std::vector<std::thread> arrThreads;
+	for (size_t nThread = 0; nThread < nThreadCount; ++nThread)
+	{
+		arrThreads.emplace_back([&, nThread] {
+			for (size_t i = 0; i < nNameCount; ++i)
+			{
+				arrThreadResults[nThread].push_back(oPool.Intern(fmt::format(_T("name{}"), i)).data());
+			}
+		});
+	}
+	for (auto& oThread : arrThreads)
+	{
+		oThread.join();
+	}
+
+	// Note: Every thread gets the same pooled copy of each name
+	for (size_t nThread = 1; nThread < nThreadCount; ++nThread)
+	{
+		EXPECT_EQ(arrThreadResults[nThread], arrThreadResults[0]);
+	}
+	auto oStats = oPool.GetStats();
+	EXPECT_EQ(oStats.m_nNameCount, nNameCount);
+	EXPECT_EQ(oStats.m_nLookupCount, nThreadCount * nNameCount);
+	EXPECT_EQ(oStats.m_nHitCount, (nThreadCount - 1) * nNameCount);
+}
@@ -0,0 +1,101 @@
+#include "pch.h"
+
+#include "vlr-util-win32/registry.KeyHandle.h"
+#include "vlr-util-win32/registry.RegKey.h"
+
+using namespace vlr;
+using namespace vlr::win32;
+using namespace vlr::win32::registry;
+
+static constexpr auto svzTestKey = vlr::wzstring_view{ L"SOFTWARE\\vlr-test" };
+static constexpr auto svzTestSubkey = vlr::wzstring_view{ L"Subkey1" };
+static constexpr auto svzTestValueName_DWORD = vlr::wzstring_view{ L"testDWORD" };
+static constexpr DWORD nTestValue_DWORD = 42;
+
+TEST(RegistryKeyHandle, BaseKeyNotClosed)
+{
+	auto oKeyHandle = CKeyHandle{ HKEY_CURRENT_USER };
+	EXPECT_TRUE(oKeyHandle.IsValid());
+	EXPECT_EQ(oKeyHandle.Get(), HKEY_CURRENT_USER);
+
+	// Note: Close on a base key only clears the handle
+	EXPECT_EQ(oKeyHandle.Close(), ERROR_SUCCESS);
+	EXPECT_FALSE(oKeyHandle.IsValid());
+}
+
+TEST(RegistryKeyHandle, MoveAndShare)
+{
+	HKEY hKey{};
+	auto lResult = ::RegOpenKeyExW(HKEY_CURRENT_USER, svzTestKey, 0, KEY_READ, &hKey);
+	ASSERT_EQ(lResult, ERROR_SUCCESS);
+
+	auto oKeyHandle = CKeyHandle{ hKey };
+	auto oKeyHandle_Moved = CKeyHandle{ std::move(oKeyHandle) };
+	EXPECT_FALSE(oKeyHandle.IsValid());
+	EXPECT_EQ(oKeyHandle_Moved.Get(), hKey);
+
+	auto oSharedKeyHandle = CSharedKeyHandle{ std::move(oKeyHandle_Moved) };
+	EXPECT_FALSE(oKeyHandle_Moved.IsValid());
+	EXPECT_EQ(oSharedKeyHandle.Get(), hKey);
+	EXPECT_EQ(oSharedKeyHandle.GetRefCount(), 1U);
+	{
+		auto oSharedKeyHandle_Copy = oSharedKeyHandle;
+		EXPECT_EQ(oSharedKeyHandle_Copy.Get(), hKey);
+		EXPECT_EQ(oSharedKeyHandle.GetRefCount(), 2U);
+	}
+	EXPECT_EQ(oSharedKeyHandle.GetRefCount(), 1U);
+
+	// Key should still be usable while any reference is held
+	DWORD dwSubkeyCount{};
+	lResult = ::RegQueryInfoKeyW(oSharedKeyHandle.Get(), NULL, NULL, NULL, &dwSubkeyCount, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+	EXPECT_EQ(lResult, ERROR_SUCCESS);
+}
+
+TEST(RegistryRegKey, OpenKeyAndGetValue)
+{
+	HRESULT hr;
+
+	auto oRegKey_Base = CRegKey{ HKEY_CURRENT_USER };
+	EXPECT_TRUE(oRegKey_Base.IsBaseKey());
+
+	CRegKey oRegKey_Test;
+	hr = oRegKey_Base.OpenKey(svzTestKey, oRegKey_Test, Options_OpenKey{}.WithAccess_Read());
+	ASSERT_EQ(hr, S_OK);
+	EXPECT_TRUE(oRegKey_Test.IsValid());
+	EXPECT_FALSE(oRegKey_Test.IsBaseKey());
+	EXPECT_FALSE(oRegKey_Test.IsShared());
+
+	// Nested open from an opened (non-base) key
+	CRegKey oRegKey_Subkey;
+	hr = oRegKey_Test.OpenKey(svzTestSubkey, oRegKey_Subkey, Options_OpenKey{}.WithAccess_Read());
+	EXPECT_EQ(hr, S_OK);
+	EXPECT_TRUE(oRegKey_Subkey.IsValid());
+
+	Result_GetValue oResult;
+	hr = oRegKey_Test.GetValue(svzTestValueName_DWORD, oResult);
+	ASSERT_EQ(hr, S_OK);
+	auto odwValue = oResult.m_oValue.GetValue_DWORD();
+	ASSERT_TRUE(odwValue.has_value());
+	EXPECT_EQ(odwValue.value(), nTestValue_DWORD);
+
+	// A small initial buffer should grow and retry
+	Result_GetValue oResult_SmallBuffer;
+	auto oOptions_SmallBuffer = Options_GetValue{};
+	oOptions_SmallBuffer.m_nInitialBufferSize = 1;
+	hr = oRegKey_Test.GetValue(svzTestValueName_DWORD, oResult_SmallBuffer, oOptions_SmallBuffer);
+	EXPECT_EQ(hr, S_OK);
+	EXPECT_EQ(oResult_SmallBuffer.m_oValue.GetValue_DWORD().value_or(0), nTestValue_DWORD);
+
+	// Sharing keeps the same handle in both instances
+	auto ohKey = oRegKey_Test.GetHKEY();
+	auto oRegKey_Shared = oRegKey_Test.Share();
+	EXPECT_TRUE(oRegKey_Test.IsShared());
+	EXPECT_TRUE(oRegKey_Shared.IsShared());
+	EXPECT_EQ(oRegKey_Shared.GetHKEY(), ohKey);
+
+	oRegKey_Test.Clear();
+	EXPECT_FALSE(oRegKey_Test.IsValid());
+	Result_GetValue oResult_Shared;
+	hr = oRegKey_Shared.GetValue(svzTestValueName_DWORD, oResult_Shared);
+	EXPECT_EQ(hr, S_OK);
+}
@@ -0,0 +1,78 @@
+#include "pch.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "vlr-util-win32/strings.Base64.h"
+
+using namespace vlr;
+using namespace vlr::win32;
+
+namespace {
+
+std::string EncodeBase64(std::string_view svaData)
+{
+	std::string saResult;
+	win32::strings::AppendBase64(reinterpret_cast<const BYTE*>(svaData.data()), svaData.size(), saResult);
+	return saResult;
+}
+
+} // namespace
+
+TEST(strings, Base64_Encode)
+{
+	// RFC 4648 test vectors
+	EXPECT_EQ(EncodeBase64(""), "");
+	EXPECT_EQ(EncodeBase64("f"), "Zg==");
+	EXPECT_EQ(EncodeBase64("fo"), "Zm8=");
+	EXPECT_EQ(EncodeBase64("foo"), "Zm9v");
+	EXPECT_EQ(EncodeBase64("foob"), "Zm9vYg==");
+	EXPECT_EQ(EncodeBase64("fooba"), "Zm9vYmE=");
+	EXPECT_EQ(EncodeBase64("foobar"), "Zm9vYmFy");
+
+	// Long enough for the vectorized path, and covering every index of the alphabet
+	EXPECT_EQ(EncodeBase64("Many hands make light work."), "TWFueSBoYW5kcyBtYWtlIGxpZ2h0IHdvcmsu");
+	{
+		std::vector<BYTE> arrData;
+		for (size_t i = 0; i < 64; i += 4)
+		{
+			// Note: Four 6-bit indices (i, i+1, i+2, i+3) packed into three bytes
+			auto nTriple = static_cast<uint32_t>((i << 18) | ((i + 1) << 12) | ((i + 2) << 6) | (i + 3));
+			arrData.push_back(static_cast<BYTE>(nTriple >> 16));
+			arrData.push_back(static_cast<BYTE>(nTriple >> 8));
+			arrData.push_back(static_cast<BYTE>(nTriple));
+		}
+		std::string saResult;
+		win32::strings::AppendBase64(arrData.data(), arrData.size(), saResult);
+		EXPECT_EQ(saResult, "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/");
+	}
+
+	// Appends to existing output
+	{
+		std::string saResult = "prefix:";
+		win32::strings::AppendBase64(reinterpret_cast<const BYTE*>("foobar"), 6, saResult);
+		EXPECT_EQ(saResult, "prefix:Zm9vYmFy");
+	}
+}
+
+TEST(strings, Base64_MatchesScalar)
+{
+	auto oRandom = std::mt19937{ 42 };
+	for (size_t nDataSize = 0; nDataSize < 200; ++nDataSize)
+	{
+		auto arrData = std::vector<BYTE>(nDataSize);
+		for (auto& nByte : arrData)
+		{
+			nByte = static_cast<BYTE>(oRandom());
+		}
+
+		std::string saResult;
+		win32::strings::AppendBase64(arrData.data(), arrData.size(), saResult);
+
+		auto saResult_Scalar = std::string(win32::strings::GetBase64EncodedLength(nDataSize), '\0');
+		win32::strings::detail::EncodeBase64_Scalar(arrData.data(), arrData.size(), saResult_Scalar.data());
+
+		EXPECT_EQ(saResult, saResult_Scalar) << "size " << nDataSize;
+	}
+}
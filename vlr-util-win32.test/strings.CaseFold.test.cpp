@@ -0,0 +1,187 @@
+#include "pch.h"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "vlr-util-win32/strings.CaseFold.h"
+
+using namespace vlr;
+using namespace vlr::win32;
+
+TEST(strings, CaseFold_AreEqual)
+{
+	EXPECT_TRUE(win32::strings::AreEqual_CaseInsensitive<wchar_t>(L"", L""));
+	EXPECT_TRUE(win32::strings::AreEqual_CaseInsensitive<wchar_t>(L"Software\\Microsoft", L"SOFTWARE\\microsoft"));
+	EXPECT_FALSE(win32::strings::AreEqual_CaseInsensitive<wchar_t>(L"Software", L"Softwar"));
+	EXPECT_FALSE(win32::strings::AreEqual_CaseInsensitive<wchar_t>(L"Software", L"Softwarx"));
+	EXPECT_TRUE(win32::strings::AreEqual_CaseInsensitive<char>("Kernel32.DLL", "kernel32.dll"));
+
+	// Note: '@' / '`' and '[' / '{' differ by 0x20, but are not letters
+	EXPECT_FALSE(win32::strings::AreEqual_CaseInsensitive<wchar_t>(L"@", L"`"));
+	EXPECT_FALSE(win32::strings::AreEqual_CaseInsensitive<wchar_t>(L"[", L"{"));
+
+	// Differences past the first full block, and in the tail
+	{
+		auto swValue_Lower = std::wstring(20, L'a') + L"tail";
+		auto swValue_Upper = std::wstring(20, L'A') + L"TAIL";
+		EXPECT_TRUE(win32::strings::AreEqual_CaseInsensitive<wchar_t>(swValue_Lower, swValue_Upper));
+		swValue_Upper.back() = L'X';
+		EXPECT_FALSE(win32::strings::AreEqual_CaseInsensitive<wchar_t>(swValue_Lower, swValue_Upper));
+	}
+
+	// Non-ASCII chars are folded via the invariant locale
+	{
+		auto swValue_Lower = std::wstring(10, L'x') + L"\x00E9t\x00E9";
+		auto swValue_Upper = std::wstring(10, L'X') + L"\x00C9T\x00C9";
+		EXPECT_TRUE(win32::strings::AreEqual_CaseInsensitive<wchar_t>(swValue_Lower, swValue_Upper));
+		EXPECT_FALSE(win32::strings::AreEqual_CaseInsensitive<wchar_t>(swValue_Lower, std::wstring(10, L'X') + L"ETE"));
+	}
+}
+
+TEST(strings, CaseFold_HasPrefix)
+{
+	EXPECT_TRUE(win32::strings::HasPrefix_CaseInsensitive<wchar_t>(L"SOFTWARE\\vlr-test\\Subkey1", L"software\\VLR-TEST"));
+	EXPECT_TRUE(win32::strings::HasPrefix_CaseInsensitive<wchar_t>(L"SOFTWARE", L""));
+	EXPECT_FALSE(win32::strings::HasPrefix_CaseInsensitive<wchar_t>(L"SOFTWARE", L"SOFTWARE\\vlr-test"));
+	EXPECT_FALSE(win32::strings::HasPrefix_CaseInsensitive<wchar_t>(L"SOFTWARE\\vlr-test", L"SOFTWARE\\vlr-tesx"));
+}
+
+TEST(strings, CaseFold_Hash)
+{
+	EXPECT_EQ(win32::strings::Hash_CaseInsensitive<wchar_t>(L"Software\\Microsoft\\Windows"), win32::strings::Hash_CaseInsensitive<wchar_t>(L"SOFTWARE\\microsoft\\WINDOWS"));
+	EXPECT_EQ(win32::strings::Hash_CaseInsensitive<wchar_t>(L"\x00E9t\x00E9"), win32::strings::Hash_CaseInsensitive<wchar_t>(L"\x00C9T\x00C9"));
+	EXPECT_NE(win32::strings::Hash_CaseInsensitive<wchar_t>(L"abc"), win32::strings::Hash_CaseInsensitive<wchar_t>(L"abd"));
+
+	win32::strings::unordered_map_CaseInsensitive<int, wchar_t> mapNameToValue;
+	mapNameToValue[L"Kernel32.dll"] = 1;
+	mapNameToValue[L"KERNEL32.DLL"] = 2;
+	mapNameToValue[L"ntdll.dll"] = 3;
+	EXPECT_EQ(mapNameToValue.size(), 2U);
+	EXPECT_EQ(mapNameToValue[L"kernel32.dll"], 2);
+	EXPECT_NE(mapNameToValue.find(L"NTDLL.DLL"), mapNameToValue.end());
+}
+
+TEST(strings, CaseFold_Compare)
+{
+	EXPECT_EQ(win32::strings::Compare_CaseInsensitive<wchar_t>(L"", L""), 0);
+	EXPECT_EQ(win32::strings::Compare_CaseInsensitive<wchar_t>(L"Software", L"SOFTWARE"), 0);
+	EXPECT_LT(win32::strings::Compare_CaseInsensitive<wchar_t>(L"abc", L"ABD"), 0);
+	EXPECT_GT(win32::strings::Compare_CaseInsensitive<wchar_t>(L"ABD", L"abc"), 0);
+	EXPECT_LT(win32::strings::Compare_CaseInsensitive<wchar_t>(L"ab", L"ABC"), 0);
+	EXPECT_EQ(win32::strings::Compare_CaseInsensitive<wchar_t>(L"\x00E9t\x00E9", L"\x00C9T\x00C9"), 0);
+	EXPECT_EQ(win32::strings::Compare_CaseInsensitive<char>("Kernel32.DLL", "kernel32.dll"), 0);
+
+	// Note: The order is of the upper-case fold, so '_' (0x5F) sorts after letters
+	EXPECT_LT(win32::strings::Compare_CaseInsensitive<wchar_t>(L"ab", L"a_"), 0);
+
+	// Differences past the first full block
+	{
+		auto swValue_Lower = std::wstring(20, L'a') + L"b";
+		auto swValue_Upper = std::wstring(20, L'A') + L"C";
+		EXPECT_LT(win32::strings::Compare_CaseInsensitive<wchar_t>(swValue_Lower, swValue_Upper), 0);
+		EXPECT_GT(win32::strings::Compare_CaseInsensitive<wchar_t>(swValue_Upper, swValue_Lower), 0);
+	}
+
+	// Sorting with the comparator puts names which differ only by case next to each other
+	{
+		auto arrNames = std::vector<std::wstring>{ L"b", L"A_", L"ab", L"B", L"a" };
+		std::sort(arrNames.begin(), arrNames.end(), win32::strings::less_CaseInsensitive<wchar_t>{});
+		ASSERT_EQ(arrNames.size(), 5U);
+		EXPECT_EQ(arrNames[0], L"a");
+		EXPECT_EQ(arrNames[1], L"ab");
+		EXPECT_EQ(arrNames[2], L"A_");
+		EXPECT_TRUE(win32::strings::AreEqual_CaseInsensitive<wchar_t>(arrNames[3], arrNames[4]));
+	}
+}
+
+TEST(strings, CaseFold_MatchesReference)
+{
+	// Note: Compare against CompareStringOrdinal over random inputs, with a small alphabet so there are many
+	// near-equal pairs; equal strings must also hash equally
+	static constexpr wchar_t arrAlphabet[] = { L'a', L'A', L'b', L'@', L'`', L'\x00E9', L'\x00C9' };
+
+	std::mt19937 oRandom{ 42 };
+	std::uniform_int_distribution<size_t> oDistribution_Length{ 0, 40 };
+	std::uniform_int_distribution<size_t> oDistribution_Char{ 0, std::size(arrAlphabet) - 1 };
+
+	for (size_t nIteration = 0; nIteration < 2000; ++nIteration)
+	{
+		auto nLength = oDistribution_Length(oRandom);
+		std::wstring swLHS;
+		std::wstring swRHS;
+		for (size_t i = 0; i < nLength; ++i)
+		{
+			swLHS.push_back(arrAlphabet[oDistribution_Char(oRandom)]);
+			swRHS.push_back(arrAlphabet[oDistribution_Char(oRandom)]);
+		}
+		// Note: Mostly-equal pairs, so the equal case is well covered
+		if (nIteration % 2 == 0)
+		{
+			for (size_t i = 0; i < nLength; ++i)
+			{
+				if (oDistribution_Char(oRandom) != 0)
+				{
+					swRHS[i] = swLHS[i];
+				}
+			}
+		}
+
+		bool bEqual_Reference = (::CompareStringOrdinal(swLHS.data(), static_cast<int>(swLHS.size()), swRHS.data(), static_cast<int>(swRHS.size()), TRUE) == CSTR_EQUAL);
+		bool bEqual = win32::strings::AreEqual_CaseInsensitive<wchar_t>(swLHS, swRHS);
+		EXPECT_EQ(bEqual, bEqual_Reference) << "LHS: " << swLHS << " RHS: " << swRHS;
+		if (bEqual)
+		{
+			EXPECT_EQ(win32::strings::Hash_CaseInsensitive<wchar_t>(swLHS), win32::strings::Hash_CaseInsensitive<wchar_t>(swRHS));
+		}
+	}
+}
+
+TEST(strings, CaseFold_NonAsciiMatchesFindSubstring)
+{
+	// Note: Compare, hash and substring search share one ordinal fold, so they agree with each other (and with
+	// CompareStringOrdinal) on non-ASCII names. Pairs are the same length, so "equal" is "found at the start".
+	struct TestPair
+	{
+		std::wstring_view m_svLHS;
+		std::wstring_view m_svRHS;
+	};
+	static constexpr TestPair arrPairs[] = {
+		{ L"\x00E9t\x00E9", L"\x00C9T\x00C9" },
+		{ L"\x0434\x043E\x043C", L"\x0414\x041E\x041C" },
+		{ L"\x03C9\x03C3", L"\x03A9\x03A3" },
+		{ L"\x00FF", L"\x0178" },
+		{ L"\x00DF", L"\x1E9E" },
+		{ L"\x0131", L"I" },
+		{ L"\x212A", L"k" },
+		{ L"\x00E9", L"e" },
+	};
+
+	for (const auto& oPair : arrPairs)
+	{
+		bool bEqual_Reference = (::CompareStringOrdinal(oPair.m_svLHS.data(), static_cast<int>(oPair.m_svLHS.size()), oPair.m_svRHS.data(), static_cast<int>(oPair.m_svRHS.size()), TRUE) == CSTR_EQUAL);
+		bool bEqual = win32::strings::AreEqual_CaseInsensitive<wchar_t>(oPair.m_svLHS, oPair.m_svRHS);
+		EXPECT_EQ(bEqual, bEqual_Reference) << "LHS: " << std::wstring{ oPair.m_svLHS } << " RHS: " << std::wstring{ oPair.m_svRHS };
+		EXPECT_EQ(win32::strings::Compare_CaseInsensitive<wchar_t>(oPair.m_svLHS, oPair.m_svRHS) == 0, bEqual);
+		EXPECT_EQ(win32::strings::FindSubstring_CaseInsensitive<wchar_t>(oPair.m_svLHS, oPair.m_svRHS) == 0, bEqual);
+
+		// Note: Long enough for the vectorized paths; the padding has no letters, so cannot match the needle
+		auto swHaystack = std::wstring{ L"0123456789" } + std::wstring{ oPair.m_svLHS } + L"-0123456789";
+		auto swNeedle = std::wstring{ L"0123456789" } + std::wstring{ oPair.m_svRHS } + L"-0123456789";
+		EXPECT_EQ(win32::strings::FindSubstring_CaseInsensitive<wchar_t>(swHaystack, oPair.m_svRHS) == 10, bEqual);
+		EXPECT_EQ(win32::strings::AreEqual_CaseInsensitive<wchar_t>(swHaystack, swNeedle), bEqual);
+		if (bEqual)
+		{
+			EXPECT_EQ(win32::strings::Hash_CaseInsensitive<wchar_t>(oPair.m_svLHS), win32::strings::Hash_CaseInsensitive<wchar_t>(oPair.m_svRHS));
+			EXPECT_EQ(win32::strings::Hash_CaseInsensitive<wchar_t>(swHaystack), win32::strings::Hash_CaseInsensitive<wchar_t>(swNeedle));
+		}
+	}
+
+	// Note: Letters with a simple upper case mapping
+	for (size_t i = 0; i < 4; ++i)
+	{
+		EXPECT_TRUE(win32::strings::AreEqual_CaseInsensitive<wchar_t>(arrPairs[i].m_svLHS, arrPairs[i].m_svRHS));
+	}
+	EXPECT_FALSE(win32::strings::AreEqual_CaseInsensitive<wchar_t>(arrPairs[7].m_svLHS, arrPairs[7].m_svRHS));
+}
@@ -0,0 +1,88 @@
+#include "pch.h"
+
+#include <random>
+#include <string>
+
+#include "vlr-util-win32/strings.FindSubstring.h"
+
+using namespace vlr;
+using namespace vlr::win32;
+
+TEST(strings, FindSubstring)
+{
+	EXPECT_EQ(win32::strings::FindSubstring<wchar_t>(L"abcdef", L""), 0U);
+	EXPECT_EQ(win32::strings::FindSubstring<wchar_t>(L"", L"a"), std::wstring_view::npos);
+	EXPECT_EQ(win32::strings::FindSubstring<wchar_t>(L"abc", L"abcd"), std::wstring_view::npos);
+	EXPECT_EQ(win32::strings::FindSubstring<wchar_t>(L"abcdef", L"cd"), 2U);
+	EXPECT_EQ(win32::strings::FindSubstring<wchar_t>(L"abcdef", L"CD"), std::wstring_view::npos);
+	EXPECT_EQ(win32::strings::FindSubstring<char>("abcdef", "f"), 5U);
+
+	// Matches spanning block boundaries, and at the very end
+	{
+		auto swHaystack = std::wstring(40, L'x') + L"needle";
+		EXPECT_EQ(win32::strings::FindSubstring<wchar_t>(swHaystack, L"needle"), 40U);
+		EXPECT_EQ(win32::strings::FindSubstring<wchar_t>(swHaystack, L"xneedle"), 39U);
+		EXPECT_EQ(win32::strings::FindSubstring<wchar_t>(swHaystack, L"needles"), std::wstring_view::npos);
+	}
+	{
+		auto saHaystack = std::string(33, 'x') + "needle";
+		EXPECT_EQ(win32::strings::FindSubstring<char>(saHaystack, "needle"), 33U);
+	}
+}
+
+TEST(strings, FindSubstring_CaseInsensitive)
+{
+	EXPECT_EQ(win32::strings::FindSubstring_CaseInsensitive<wchar_t>(L"abcDEF", L"cdE"), 2U);
+	EXPECT_EQ(win32::strings::FindSubstring_CaseInsensitive<char>("abcDEF", "CDe"), 2U);
+	EXPECT_EQ(win32::strings::FindSubstring_CaseInsensitive<wchar_t>(L"abcdef", L"cdx"), std::wstring_view::npos);
+
+	// Non-ASCII chars use ordinal case folding
+	{
+		auto swHaystack = std::wstring(20, L'x') + L"\x00C9t\x00C9";
+		EXPECT_EQ(win32::strings::FindSubstring_CaseInsensitive<wchar_t>(swHaystack, L"\x00E9t\x00E9"), 20U);
+		EXPECT_EQ(win32::strings::FindSubstring_CaseInsensitive<wchar_t>(swHaystack, L"xx\x00E9T"), 18U);
+	}
+}
+
+TEST(strings, FindSubstring_MatchesReference)
+{
+	// Note: Compare against std::find / CompareStringOrdinal over random inputs, with a small alphabet so there are
+	// many partial matches
+	static constexpr wchar_t arrAlphabet[] = { L'a', L'b', L'A', L'B', L'x', L'\x00E9', L'\x00C9' };
+
+	auto fFindReference_CaseInsensitive = [](std::wstring_view svHaystack, std::wstring_view svNeedle)
+	{
+		if (svNeedle.size() > svHaystack.size())
+		{
+			return std::wstring_view::npos;
+		}
+		for (size_t i = 0; i + svNeedle.size() <= svHaystack.size(); ++i)
+		{
+			if (::CompareStringOrdinal(svHaystack.data() + i, static_cast<int>(svNeedle.size()), svNeedle.data(), static_cast<int>(svNeedle.size()), TRUE) == CSTR_EQUAL)
+			{
+				return i;
+			}
+		}
+		return std::wstring_view::npos;
+	};
+
+	std::mt19937 oRandom{ 1 };
+	for (size_t nIteration = 0; nIteration < 20000; ++nIteration)
+	{
+		std::wstring swHaystack;
+		std::wstring swNeedle;
+		swHaystack.resize(oRandom() % 70);
+		swNeedle.resize(1 + oRandom() % 5);
+		for (auto& wch : swHaystack)
+		{
+			wch = arrAlphabet[oRandom() % std::size(arrAlphabet)];
+		}
+		for (auto& wch : swNeedle)
+		{
+			wch = arrAlphabet[oRandom() % std::size(arrAlphabet)];
+		}
+
+		ASSERT_EQ(win32::strings::FindSubstring<wchar_t>(swHaystack, swNeedle), swHaystack.find(swNeedle));
+		ASSERT_EQ(win32::strings::FindSubstring_CaseInsensitive<wchar_t>(swHaystack, swNeedle), fFindReference_CaseInsensitive(swHaystack, swNeedle));
+	}
+}
@@ -0,0 +1,186 @@
+// vlr-util-win32.tracereplay.cpp : This file contains the 'main' function. Program execution begins and ends there.
+//
+
+#include "pch.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <tchar.h>
+
+#include <vlr-util/ActionOnDestruction.h>
+
+#include <vlr-util-win32/RegistryAccess.h>
+#include <vlr-util-win32/RegistryAccess_TraceReplay.h>
+#include <vlr-util-win32/registry.AppHive.h>
+
+using namespace vlr;
+using namespace vlr::win32;
+
+// Replays a registry trace file (see CRegistryAccessTraceRecorder), and reports the throughput and latency.
+// By default the trace is replayed against a private app hive (RegLoadAppKey) in a temp file, which is prepared with
+// the keys and values the trace read; with --root, it is replayed against that key of the live registry instead.
+
+namespace {
+
+static constexpr auto pszUsage = _T(
+	"Usage: vlr-util-win32.tracereplay <trace file> [options]\n"
+	"  --speed=original|maximum|<factor>  Replay timing (default: maximum); a factor replays that many times faster\n"
+	"  --threads=<count>                  Replay threads (default: one per recorded thread)\n"
+	"  --root=HKCU\\<path>|HKLM\\<path>     Replay against the live registry, relative to this key\n"
+	"  --replay-writes                    Replay key creates, deletes, and value writes (skipped by default)\n");
+
+bool HasPrefix(vlr::tstring_view svValue, vlr::tstring_view svPrefix)
+{
+	return (svValue.size() >= svPrefix.size()) && (svValue.substr(0, svPrefix.size()) == svPrefix);
+}
+
+void PrintLatencyStats(const char* pszName, const CRegistryAccessTraceReplay::LatencyStats& oLatencyStats)
+{
+	std::printf("%-16s %10zu %10llu %10llu %10llu %10llu %10llu\n",
+		pszName,
+		oLatencyStats.m_nCount,
+		static_cast<unsigned long long>(oLatencyStats.m_nMeanMicroseconds),
+		static_cast<unsigned long long>(oLatencyStats.m_nP50Microseconds),
+		static_cast<unsigned long long>(oLatencyStats.m_nP90Microseconds),
+		static_cast<unsigned long long>(oLatencyStats.m_nP99Microseconds),
+		static_cast<unsigned long long>(oLatencyStats.m_nMaxMicroseconds));
+}
+
+} // namespace
+
+int _tmain(int argc, TCHAR* argv[])
+{
+	SResult sr;
+
+	if (argc < 2)
+	{
+		_ftprintf(stderr, _T("%s"), pszUsage);
+		return 1;
+	}
+
+	auto sTraceFilePath = vlr::tstring{ argv[1] };
+	auto options = CRegistryAccessTraceReplay::Options_Replay{};
+	vlr::tstring sRootKeyPath;
+	for (int i = 2; i < argc; ++i)
+	{
+		auto svArg = vlr::tstring_view{ argv[i] };
+		if (svArg == _T("--speed=original"))
+		{
+			options.withReplaySpeed(CRegistryAccessTraceReplay::ReplaySpeed::Original);
+		}
+		else if (svArg == _T("--speed=maximum"))
+		{
+			options.withReplaySpeed(CRegistryAccessTraceReplay::ReplaySpeed::Maximum);
+		}
+		else if (HasPrefix(svArg, _T("--speed=")))
+		{
+			options.withSpeedFactor(_tcstod(argv[i] + _tcslen(_T("--speed=")), nullptr));
+		}
+		else if (HasPrefix(svArg, _T("--threads=")))
+		{
+			options.withThreadCount(_tcstoul(argv[i] + _tcslen(_T("--threads=")), nullptr, 10));
+		}
+		else if (HasPrefix(svArg, _T("--root=")))
+		{
+			sRootKeyPath = argv[i] + _tcslen(_T("--root="));
+		}
+		else if (svArg == _T("--replay-writes"))
+		{
+			options.withReplayWrites();
+		}
+		else
+		{
+			_ftprintf(stderr, _T("Unrecognized argument: %s\n%s"), argv[i], pszUsage);
+			return 1;
+		}
+	}
+
+	RegistryAccess::Trace::TraceData oTraceData;
+	sr = oTraceData.LoadFromFile(sTraceFilePath);
+	if (!sr.isSuccess())
+	{
+		_ftprintf(stderr, _T("Failed to load trace file %s (0x%08X)\n"), sTraceFilePath.c_str(), static_cast<unsigned>(sr.asHRESULT()));
+		return 2;
+	}
+
+	registry::CAppHive oAppHive;
+	HKEY hRootKey{};
+	auto onDestroy_CloseRootKey = MakeActionOnDestruction([&] {
+		if (hRootKey && !oAppHive.GetRootKey())
+		{
+			::RegCloseKey(hRootKey);
+		}
+	});
+	if (sRootKeyPath.empty())
+	{
+		sr = oAppHive.Create(_T("vrt"));
+		if (!sr.isSuccess())
+		{
+			_ftprintf(stderr, _T("Failed to create app hive (0x%08X)\n"), static_cast<unsigned>(sr.asHRESULT()));
+			return 2;
+		}
+		hRootKey = oAppHive.GetRootKey();
+
+		sr = CRegistryAccessTraceReplay{ CRegistryAccess{ hRootKey } }.PrepareTarget(oTraceData);
+		if (!sr.isSuccess())
+		{
+			_ftprintf(stderr, _T("Failed to prepare app hive (0x%08X)\n"), static_cast<unsigned>(sr.asHRESULT()));
+			return 2;
+		}
+	}
+	else
+	{
+		HKEY hBaseKey{};
+		auto svRootKeyPath = vlr::tstring_view{ sRootKeyPath };
+		if (HasPrefix(svRootKeyPath, _T("HKCU\\")))
+		{
+			hBaseKey = HKEY_CURRENT_USER;
+		}
+		else if (HasPrefix(svRootKeyPath, _T("HKLM\\")))
+		{
+			hBaseKey = HKEY_LOCAL_MACHINE;
+		}
+		else
+		{
+			_ftprintf(stderr, _T("Unsupported root key: %s\n"), sRootKeyPath.c_str());
+			return 1;
+		}
+		auto dwAccessMask = options.m_bReplayWrites ? DWORD{ KEY_READ | KEY_WRITE } : DWORD{ KEY_READ };
+		LONG lResult = ::RegOpenKeyEx(hBaseKey, sRootKeyPath.c_str() + _tcslen(_T("HKCU\\")), 0, dwAccessMask, &hRootKey);
+		if (lResult != ERROR_SUCCESS)
+		{
+			_ftprintf(stderr, _T("Failed to open root key %s (%ld)\n"), sRootKeyPath.c_str(), lResult);
+			return 2;
+		}
+	}
+
+	auto oResult = CRegistryAccessTraceReplay::Result_Replay{};
+	sr = CRegistryAccessTraceReplay{ CRegistryAccess{ hRootKey } }.Replay(oTraceData, options, &oResult);
+	if (!sr.isSuccess())
+	{
+		_ftprintf(stderr, _T("Replay failed (0x%08X)\n"), static_cast<unsigned>(sr.asHRESULT()));
+		return 2;
+	}
+
+	std::printf("Threads: %zu\n", oResult.m_nThreadCount);
+	std::printf("Operations: %zu (skipped: %zu, errors: %zu, result mismatches: %zu)\n",
+		oResult.m_nOperationCount,
+		oResult.m_nSkippedCount,
+		oResult.m_nErrorCount,
+		oResult.m_nResultMismatchCount);
+	std::printf("Elapsed: %.3f ms, throughput: %.0f ops/s\n",
+		static_cast<double>(oResult.m_nElapsedMicroseconds) / 1000.0,
+		oResult.m_dOperationsPerSecond);
+	std::printf("\n%-16s %10s %10s %10s %10s %10s %10s\n", "Latency (us)", "Count", "Mean", "P50", "P90", "P99", "Max");
+	for (size_t nOperationType = 0; nOperationType < RegistryAccess::Trace::OperationType_Count; ++nOperationType)
+	{
+		const auto& oLatencyStats = oResult.m_arrLatencyStatsByOperation[nOperationType];
+		if (oLatencyStats.m_nCount > 0)
+		{
+			PrintLatencyStats(RegistryAccess::Trace::GetOperationName(static_cast<RegistryAccess::Trace::OperationType>(nOperationType)), oLatencyStats);
+		}
+	}
+	PrintLatencyStats("All", oResult.m_oLatencyStats);
+
+	return 0;
+}
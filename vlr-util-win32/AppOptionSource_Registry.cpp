@@ -1,10 +1,49 @@
 #include "pch.h"
 #include "AppOptionSource_Registry.h"
 
+#include <future>
+
+#include "registry.ContentHash.h"
+
 namespace vlr {
 
 namespace win32 {
 
+SPCAppOptionSpecifiedValue CAppOptionSource_Registry::MakeSpecifiedValueFromValueMapEntry(
+	const CRegistryAccess::ValueMapEntry& oValueMapEntry,
+	vlr::tzstring_view svzPath)
+{
+	const auto& sNativeOptionName = oValueMapEntry.m_sValueName;
+
+	SPCAppOptionSpecifiedValue spSpecifiedValue;
+	auto fMakeAppOptionSpecifiedValue = [&](const auto& tValue)
+	{
+		spSpecifiedValue = std::make_shared<CAppOptionSpecifiedValue>(
+			CAppOptionSourceInfo{ AppOptionSource::SystemConfigRespository, svzPath },
+			sNativeOptionName,
+			tValue);
+	};
+
+	if (oValueMapEntry.m_spValue_SZ)
+	{
+		fMakeAppOptionSpecifiedValue(*oValueMapEntry.m_spValue_SZ);
+	}
+	else if (oValueMapEntry.m_spValue_DWORD)
+	{
+		fMakeAppOptionSpecifiedValue(static_cast<uint32_t>(*oValueMapEntry.m_spValue_DWORD));
+	}
+	else if (oValueMapEntry.m_spValue_QWORD)
+	{
+		fMakeAppOptionSpecifiedValue(static_cast<uint64_t>(*oValueMapEntry.m_spValue_QWORD));
+	}
+	else
+	{
+		// Not supported atm; skip
+	}
+
+	return spSpecifiedValue;
+}
+
 SResult CAppOptionSource_Registry::ReadAllValuesFromPathAsOptions(
 	const CRegistryAccess& oReg,
 	vlr::tzstring_view svzPath)
@@ -25,34 +64,246 @@ SResult CAppOptionSource_Registry::ReadAllValuesFromPathAsOptions(
 	for (const auto& oMapPair : mapNameToValue)
 	{
 		const auto& oValueMapEntry = oMapPair.second;
-		const auto& sNativeOptionName = oValueMapEntry.m_sValueName;
 
-		SPCAppOptionSpecifiedValue spSpecifiedValue;
-		auto fMakeAppOptionSpecifiedValue = [&](const auto& tValue)
+		auto spSpecifiedValue = MakeSpecifiedValueFromValueMapEntry(oValueMapEntry, svzPath);
+		if (!spSpecifiedValue)
+		{
+			continue;
+		}
+
+		sr = oAppOptions.AddSpecifiedValue(spSpecifiedValue);
+		VLR_ASSERT_SR_SUCCEEDED_OR_CONTINUE(sr);
+	}
+
+	return S_OK;
+}
+
+SResult CAppOptionSource_Registry::ReloadChangedValuesFromPathAsOptions(
+	const CRegistryAccess& oReg,
+	vlr::tzstring_view svzPath,
+	Result_IncrementalReload* pResult /*= nullptr*/)
+{
+	SResult sr;
+
+	auto& oAppOptions = GetAppOptions();
+
+	Result_IncrementalReload oResult_Local;
+	auto& oResult = pResult ? *pResult : oResult_Local;
+	oResult = {};
+
+	auto iterPathReloadState = m_mapPathToReloadState.find(vlr::tstring{ svzPath });
+
+	// Note: The write time is read before the enumeration. If the key is written in between, the stored time
+	// is older than the content we read, so the next reload will enumerate again (and not miss the change).
+	CRegistryAccess::KeyInfo oKeyInfo{};
+	sr = oReg.ReadKeyInfo(svzPath, oKeyInfo);
+	if (sr == HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND))
+	{
+		// The key doesn't exist (or no longer exists); anything previously applied from it is removed
+		if (iterPathReloadState != m_mapPathToReloadState.end())
+		{
+			for (const auto& oMapPair : iterPathReloadState->second.m_mapValueNameToState)
+			{
+				if (oMapPair.second.m_bApplied)
+				{
+					oResult.m_arrRemovedOptionNames.push_back(oMapPair.first);
+				}
+			}
+			m_mapPathToReloadState.erase(iterPathReloadState);
+		}
+		return S_FALSE;
+	}
+	VLR_ASSERT_SR_SUCCEEDED_OR_RETURN_SRESULT(sr);
+
+	if (iterPathReloadState != m_mapPathToReloadState.end())
+	{
+		if (::CompareFileTime(&iterPathReloadState->second.m_ftLastWriteTime, &oKeyInfo.m_ftLastWriteTime) == 0)
+		{
+			oResult.m_bSkippedUnchangedKey = true;
+			return SResult::Success_NoWorkDone;
+		}
+	}
+
+	PathReloadState oPathReloadState_New;
+	oPathReloadState_New.m_ftLastWriteTime = oKeyInfo.m_ftLastWriteTime;
+	{
+		// Note: The write time has coarse granularity, so a write landing in the same tick as a very recent write
+		// would not change it. If the key was written very recently, do not trust the time for the next skip
+		// check; the next reload enumerates again, and the content hashes filter out unchanged values.
+		static constexpr ULONGLONG nRecentWriteWindow_100ns = 2ULL * 10 * 1000 * 1000;
+		FILETIME ftNow{};
+		::GetSystemTimeAsFileTime(&ftNow);
+		auto fToULL = [](const FILETIME& ft) { return (static_cast<ULONGLONG>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime; };
+		if (fToULL(ftNow) < fToULL(oKeyInfo.m_ftLastWriteTime) + nRecentWriteWindow_100ns)
+		{
+			oPathReloadState_New.m_ftLastWriteTime = {};
+		}
+	}
+	oPathReloadState_New.m_mapValueNameToState.reserve(oKeyInfo.m_dwValueCount);
+
+	const auto* pmapValueNameToState_Previous = (iterPathReloadState != m_mapPathToReloadState.end())
+		? &iterPathReloadState->second.m_mapValueNameToState
+		: nullptr;
+
+	auto fOnEnumValueData = [&](const CRegistryAccess::EnumValueData& oEnumValueData) -> SResult
+	{
+		auto sValueName = vlr::tstring{ oEnumValueData.m_svName };
+		auto oValueReloadState = ValueReloadState{};
+		oValueReloadState.m_nContentHash = registry::GetValueContentHash(oEnumValueData.m_dwType, oEnumValueData.m_spanData);
+
+		bool bWasApplied = false;
+		if (pmapValueNameToState_Previous)
+		{
+			auto iterPrevious = pmapValueNameToState_Previous->find(sValueName);
+			if (iterPrevious != pmapValueNameToState_Previous->end())
+			{
+				if (iterPrevious->second.m_nContentHash == oValueReloadState.m_nContentHash)
+				{
+					oPathReloadState_New.m_mapValueNameToState.emplace(std::move(sValueName), iterPrevious->second);
+					return SResult::Success;
+				}
+				bWasApplied = iterPrevious->second.m_bApplied;
+			}
+		}
+
+		// Note: Only new/changed values pay for conversion and option creation
+		CRegistryAccess::ValueMapEntry oValueMapEntry;
+		auto srPopulate = oReg.populateValueMapEntryFromEnumValueData(oEnumValueData, oValueMapEntry);
+		VLR_ASSERT_SR_SUCCEEDED_OR_RETURN_SRESULT(srPopulate);
+
+		auto spSpecifiedValue = MakeSpecifiedValueFromValueMapEntry(oValueMapEntry, svzPath);
+		if (spSpecifiedValue)
 		{
-			spSpecifiedValue = std::make_shared<CAppOptionSpecifiedValue>(
-				CAppOptionSourceInfo{ AppOptionSource::SystemConfigRespository, svzPath },
-				sNativeOptionName,
-				tValue);
-		};
+			auto srAdd = oAppOptions.AddSpecifiedValue(spSpecifiedValue);
+			VLR_ASSERT_SR_SUCCEEDED_OR_RETURN_SRESULT(srAdd);
+			oValueReloadState.m_bApplied = true;
 
-		if (oValueMapEntry.m_spValue_SZ)
+			if (bWasApplied)
+			{
+				++oResult.m_nChangedCount;
+			}
+			else
+			{
+				++oResult.m_nAddedCount;
+			}
+		}
+		else if (bWasApplied)
 		{
-			fMakeAppOptionSpecifiedValue(*oValueMapEntry.m_spValue_SZ);
+			// Note: The option it populated no longer has a value from this path
+			oResult.m_arrRemovedOptionNames.push_back(sValueName);
 		}
-		else if (oValueMapEntry.m_spValue_DWORD)
+
+		// Note: Unsupported types are tracked too, so they are not reconverted on every reload
+		oPathReloadState_New.m_mapValueNameToState.emplace(std::move(sValueName), oValueReloadState);
+
+		return SResult::Success;
+	};
+
+	sr = oReg.EnumAllValues(svzPath, fOnEnumValueData);
+	if (sr == HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND))
+	{
+		// Key was deleted after the info query; handle on the next reload
+		return S_FALSE;
+	}
+	VLR_ASSERT_SR_SUCCEEDED_OR_RETURN_SRESULT(sr);
+
+	if (pmapValueNameToState_Previous)
+	{
+		for (const auto& oMapPair : *pmapValueNameToState_Previous)
+		{
+			if (!oMapPair.second.m_bApplied)
+			{
+				continue;
+			}
+			if (oPathReloadState_New.m_mapValueNameToState.find(oMapPair.first) == oPathReloadState_New.m_mapValueNameToState.end())
+			{
+				oResult.m_arrRemovedOptionNames.push_back(oMapPair.first);
+			}
+		}
+	}
+
+	m_mapPathToReloadState[vlr::tstring{ svzPath }] = std::move(oPathReloadState_New);
+
+	return S_OK;
+}
+
+SResult CAppOptionSource_Registry::ReadLayeredValuesAsOptions(
+	const std::vector<Layer>& arrLayers,
+	Result_LayeredRead* pResult /*= nullptr*/)
+{
+	SResult sr;
+
+	auto& oAppOptions = GetAppOptions();
+
+	Result_LayeredRead oResult_Local;
+	auto& oResult = pResult ? *pResult : oResult_Local;
+	oResult = {};
+	oResult.m_arrLayerResults.resize(arrLayers.size());
+
+	using ValueMap = std::unordered_map<vlr::tstring, CRegistryAccess::ValueMapEntry>;
+	std::vector<ValueMap> arrLayerValueMaps(arrLayers.size());
+
+	auto fReadLayer = [&](size_t nLayerIndex) -> SResult
+	{
+		const auto& oLayer = arrLayers[nLayerIndex];
+		auto srRead = oLayer.m_oReg.RealAllValuesIntoMap(oLayer.m_sPath, arrLayerValueMaps[nLayerIndex]);
+		if (srRead == HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND))
 		{
-			fMakeAppOptionSpecifiedValue(static_cast<uint32_t>(*oValueMapEntry.m_spValue_DWORD));
+			return S_FALSE;
 		}
-		else if (oValueMapEntry.m_spValue_QWORD)
+		return srRead;
+	};
+
+	// Note: Each layer is typically a different hive/key, so the reads overlap; the first layer is read on the
+	// calling thread.
+	std::vector<std::future<SResult>> arrLayerReads;
+	for (size_t i = 1; i < arrLayers.size(); ++i)
+	{
+		arrLayerReads.push_back(std::async(std::launch::async, fReadLayer, i));
+	}
+	if (!arrLayers.empty())
+	{
+		oResult.m_arrLayerResults[0] = fReadLayer(0);
+	}
+	for (size_t i = 1; i < arrLayers.size(); ++i)
+	{
+		oResult.m_arrLayerResults[i] = arrLayerReads[i - 1].get();
+	}
+
+	// Note: Value names are case-insensitive, so the same option in different layers may differ in case
+	struct MergedEntry
+	{
+		size_t m_nLayerIndex{};
+		const CRegistryAccess::ValueMapEntry* m_pValueMapEntry{};
+	};
+	std::map<vlr::tstring, MergedEntry, vlr::StringCompare::asCaseInsensitive> mapNameToMergedEntry;
+
+	bool bAnyLayerFailed = false;
+	for (size_t i = 0; i < arrLayers.size(); ++i)
+	{
+		if (!oResult.m_arrLayerResults[i].isSuccess())
 		{
-			fMakeAppOptionSpecifiedValue(static_cast<uint64_t>(*oValueMapEntry.m_spValue_QWORD));
+			bAnyLayerFailed = true;
+			continue;
 		}
-		else
+		for (const auto& oMapPair : arrLayerValueMaps[i])
 		{
-			// Not supported atm; skip
+			const auto& oValueMapEntry = oMapPair.second;
+			// Note: Types which cannot be options do not override a lower layer (same as sequential reads)
+			bool bIsSupportedType = oValueMapEntry.m_spValue_SZ || oValueMapEntry.m_spValue_DWORD || oValueMapEntry.m_spValue_QWORD;
+			if (!bIsSupportedType)
+			{
+				continue;
+			}
+			mapNameToMergedEntry[oMapPair.first] = MergedEntry{ i, &oValueMapEntry };
 		}
+	}
+
+	for (const auto& oMapPair : mapNameToMergedEntry)
+	{
+		const auto& oMergedEntry = oMapPair.second;
 
+		auto spSpecifiedValue = MakeSpecifiedValueFromValueMapEntry(*oMergedEntry.m_pValueMapEntry, arrLayers[oMergedEntry.m_nLayerIndex].m_sPath);
 		if (!spSpecifiedValue)
 		{
 			continue;
@@ -60,6 +311,12 @@ SResult CAppOptionSource_Registry::ReadAllValuesFromPathAsOptions(
 
 		sr = oAppOptions.AddSpecifiedValue(spSpecifiedValue);
 		VLR_ASSERT_SR_SUCCEEDED_OR_CONTINUE(sr);
+		++oResult.m_nAppliedCount;
+	}
+
+	if (bAnyLayerFailed)
+	{
+		return SResult::Success_WithNuance;
 	}
 
 	return S_OK;
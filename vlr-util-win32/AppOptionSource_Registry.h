@@ -4,7 +4,12 @@
 #include "vlr-util/util.Result.h"
 #include "vlr-util/AppOptions.h"
 
+#include <map>
+
+#include "vlr-util/StringCompare.h"
+
 #include "RegistryAccess.h"
+#include "strings.CaseFold.h"
 
 namespace vlr {
 
@@ -17,6 +22,21 @@ class CAppOptionSource_Registry
 protected:
 	CAppOptions* m_pAppOptions_Override = nullptr;
 
+	// Note: State for incremental reload, per path
+	struct ValueReloadState
+	{
+		// Note: Hash of type + data, as last seen
+		uint64_t m_nContentHash{};
+		// Note: Set if the value was applied as an option (ie: its type is supported)
+		bool m_bApplied = false;
+	};
+	struct PathReloadState
+	{
+		FILETIME m_ftLastWriteTime{};
+		std::unordered_map<vlr::tstring, ValueReloadState> m_mapValueNameToState;
+	};
+	strings::unordered_map_CaseInsensitive<PathReloadState> m_mapPathToReloadState;
+
 	inline auto& GetAppOptions()
 	{
 		if (m_pAppOptions_Override)
@@ -36,11 +56,62 @@ public:
 		return *this;
 	}
 
+protected:
+	// Returns nullptr for value types which are not supported as options
+	static SPCAppOptionSpecifiedValue MakeSpecifiedValueFromValueMapEntry(
+		const CRegistryAccess::ValueMapEntry& oValueMapEntry,
+		vlr::tzstring_view svzPath);
+
 public:
 	SResult ReadAllValuesFromPathAsOptions(
 		const CRegistryAccess& oReg,
 		vlr::tzstring_view svzPath);
 
+	struct Result_IncrementalReload
+	{
+		// Note: Set if the key write time had not changed, and the key was not enumerated
+		bool m_bSkippedUnchangedKey = false;
+		size_t m_nAddedCount = 0;
+		size_t m_nChangedCount = 0;
+		// Note: Options which were applied by a previous reload of this path, and either no longer exist or changed
+		// to a type which is not supported as an option. CAppOptions holds the last specified value for these;
+		// callers decide how to handle removal.
+		std::vector<vlr::tstring> m_arrRemovedOptionNames;
+	};
+
+	// Incremental variant of the above, intended to be called repeatedly for the same path(s). The first call
+	// for a path applies all values. Later calls skip the key entirely if its last write time is unchanged, and
+	// otherwise only add options whose type/data changed (per-value content hash).
+	SResult ReloadChangedValuesFromPathAsOptions(
+		const CRegistryAccess& oReg,
+		vlr::tzstring_view svzPath,
+		Result_IncrementalReload* pResult = nullptr);
+	inline void ResetIncrementalReloadState()
+	{
+		m_mapPathToReloadState.clear();
+	}
+
+	struct Layer
+	{
+		CRegistryAccess m_oReg;
+		vlr::tstring m_sPath;
+	};
+
+	struct Result_LayeredRead
+	{
+		// Note: Same order as the layers; S_FALSE for a layer whose key does not exist
+		std::vector<SResult> m_arrLayerResults;
+		size_t m_nAppliedCount = 0;
+	};
+
+	// Reads several layers concurrently, and merges them in one pass: layers are in increasing order of
+	// precedence (the last layer wins, matching calling ReadAllValuesFromPathAsOptions for each in order).
+	// Each option is added once, attributed to the path of the layer it came from. A layer which fails to read
+	// does not prevent the others from being applied; in that case the result is Success_WithNuance.
+	SResult ReadLayeredValuesAsOptions(
+		const std::vector<Layer>& arrLayers,
+		Result_LayeredRead* pResult = nullptr);
+
 };
 
 } // namespace win32
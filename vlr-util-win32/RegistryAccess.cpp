@@ -1,12 +1,19 @@
 #include "pch.h"
 #include "RegistryAccess.h"
 
+#include <algorithm>
+#include <deque>
+#include <future>
+
+#include "vlr-util/ActionOnDestruction.h"
 #include "vlr-util/StringCompare.h"
 #include "vlr-util/util.range_checked_cast.h"
 #include "vlr-util/util.convert.StringConversion.h"
 
 #include "AutoCleanupTypedefs.h"
 #include "ModuleContext.Runtime.h"
+#include "RegistryAccess_Instrumentation.h"
+#include "strings.CaseFold.h"
 
 namespace vlr {
 
@@ -16,16 +23,18 @@ SResult CRegistryAccess::CheckKeyExists(tzstring_view svzKeyName) const
 {
 	SResult sr;
 
+	VLR_REGISTRY_TRACE_OPERATION(oTracedOperation, OpenKey, svzKeyName, tzstring_view{}, sr);
+
 	HKEY hKey{};
 	sr = openKey(svzKeyName, KEY_READ, hKey);
 	if (!sr.isSuccess())
 	{
-		return SResult::Success_WithNuance;
+		return oTracedOperation.Return(SResult::Success_WithNuance);
 	}
 	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hKey);
 	auto onDestroy_CloseRegKey = AutoCloseRegKey{ hKey };
 
-	return SResult::Success;
+	return oTracedOperation.Return(SResult::Success);
 }
 
 SResult CRegistryAccess::EnsureKeyExists(
@@ -33,40 +42,27 @@ SResult CRegistryAccess::EnsureKeyExists(
 	const Options_EnsureKeyExists& /*options*/ /*= {}*/) const
 {
 	SResult sr;
-	LONG lResult{};
+
+	VLR_REGISTRY_TRACE_OPERATION(oTracedOperation, CreateKey, svzKeyName, tzstring_view{}, sr);
 
 	// Note: The create (below) checks for existing already, so this is unnecessary
 	//sr = CheckKeyExists(svzKeyName);
 	//VLR_ON_SR_SUCCESS_RETURN_VALUE(sr);
 
-	// TODO? Add security attributes handling
-
 	HKEY hKey{};
 	DWORD dwDisposition{};
-	lResult = RegCreateKeyEx(
-		getBaseKey(),
-		svzKeyName,
-		0,
-		NULL,
-		0,
-		KEY_ALL_ACCESS | getWow64RedirectionKeyAccessMask(),
-		NULL,
-		&hKey,
-		&dwDisposition);
-	if (lResult != ERROR_SUCCESS)
-	{
-		return __HRESULT_FROM_WIN32(lResult);
-	}
+	sr = CreateOrOpenKey(svzKeyName, KEY_ALL_ACCESS, hKey, &dwDisposition);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
 	auto onDestroy_CloseRegKey = AutoCloseRegKey{ hKey };
 
 	switch (dwDisposition)
 	{
 	case REG_CREATED_NEW_KEY:
 	case REG_OPENED_EXISTING_KEY:
-		return SResult::Success;
+		return oTracedOperation.Return(SResult::Success);
 
 	default:
-		VLR_HANDLE_ASSERTION_FAILURE__AND_RETURN_EXPRESSION(SResult::Failure);
+		VLR_HANDLE_ASSERTION_FAILURE__AND_RETURN_EXPRESSION(oTracedOperation.Return(SResult::Failure));
 	}
 }
 
@@ -77,12 +73,14 @@ SResult CRegistryAccess::DeleteKey(
 	SResult sr;
 	LONG lResult{};
 
+	VLR_REGISTRY_TRACE_OPERATION(oTracedOperation, DeleteKey, svzKeyName, tzstring_view{}, sr);
+
 	if (options.m_bEnsureSafeDelete)
 	{
 		bool bKeyUnderSafeDeletePath = false;
 		for (const auto& sPath : options.m_arrSafeDeletePaths)
 		{
-			if (StringCompare::CI().StringHasPrefix(svzKeyName, sPath))
+			if (strings::HasPrefix_CaseInsensitive<TCHAR>(svzKeyName, sPath))
 			{
 				bKeyUnderSafeDeletePath = true;
 				break;
@@ -90,19 +88,22 @@ SResult CRegistryAccess::DeleteKey(
 		}
 		if (!bKeyUnderSafeDeletePath)
 		{
-			return SResult::Failure;
+			return oTracedOperation.Return(SResult::Failure);
 		}
 	}
 
+	VLR_REGISTRY_INSTRUMENT_OPERATION(oInstrumentedOperation, Write);
+
 	lResult = ::RegDeleteKey(
 		getBaseKey(),
 		svzKeyName);
+	VLR_REGISTRY_INSTRUMENT_ON_RESULT(oInstrumentedOperation, lResult);
 	if (lResult != ERROR_SUCCESS)
 	{
-		return __HRESULT_FROM_WIN32(lResult);
+		return oTracedOperation.Return(__HRESULT_FROM_WIN32(lResult));
 	}
 
-	return SResult::Success;
+	return oTracedOperation.Return(SResult::Success);
 }
 
 SResult CRegistryAccess::ReadValueInfo(
@@ -112,7 +113,8 @@ SResult CRegistryAccess::ReadValueInfo(
 	DWORD& dwSize_Result) const
 {
 	SResult sr;
-	LONG lResult{};
+
+	VLR_REGISTRY_TRACE_OPERATION(oTracedOperation, QueryValueInfo, svzKeyName, svzValueName, sr);
 
 	HKEY hKey{};
 	sr = openKey(svzKeyName, KEY_READ, hKey);
@@ -120,6 +122,30 @@ SResult CRegistryAccess::ReadValueInfo(
 	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hKey);
 	auto onDestroy_CloseRegKey = AutoCloseRegKey{ hKey };
 
+	sr = ReadValueInfoFromOpenKey(
+		hKey,
+		svzValueName,
+		dwType_Result,
+		dwSize_Result);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	oTracedOperation.OnValue(dwType_Result, dwSize_Result);
+
+	return sr;
+}
+
+SResult CRegistryAccess::ReadValueInfoFromOpenKey(
+	HKEY hKey,
+	tzstring_view svzValueName,
+	DWORD& dwType_Result,
+	DWORD& dwSize_Result) const
+{
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hKey);
+
+	LONG lResult{};
+
+	VLR_REGISTRY_INSTRUMENT_OPERATION(oInstrumentedOperation, Query);
+
 	lResult = RegQueryValueEx(
 		hKey,
 		svzValueName,
@@ -127,6 +153,7 @@ SResult CRegistryAccess::ReadValueInfo(
 		&dwType_Result,
 		NULL,
 		&dwSize_Result);
+	VLR_REGISTRY_INSTRUMENT_ON_RESULT(oInstrumentedOperation, lResult);
 	// Note: This appears to always return ERROR_SUCCESS
 	if (lResult == ERROR_SUCCESS)
 	{
@@ -148,7 +175,8 @@ SResult CRegistryAccess::ReadValueBase(
 	std::vector<BYTE>& arrData) const
 {
 	SResult sr;
-	LONG lResult{};
+
+	VLR_REGISTRY_TRACE_OPERATION(oTracedOperation, ReadValue, svzKeyName, svzValueName, sr);
 
 	HKEY hKey{};
 	sr = openKey(svzKeyName, KEY_READ, hKey);
@@ -156,6 +184,28 @@ SResult CRegistryAccess::ReadValueBase(
 	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hKey);
 	auto onDestroy_CloseRegKey = AutoCloseRegKey{ hKey };
 
+	sr = ReadValueBaseFromOpenKey(
+		hKey,
+		svzValueName,
+		dwType_Result,
+		arrData);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	oTracedOperation.OnValue(dwType_Result, arrData.size());
+
+	return sr;
+}
+
+SResult CRegistryAccess::ReadValueBaseFromOpenKey(
+	HKEY hKey,
+	tzstring_view svzValueName,
+	DWORD& dwType_Result,
+	std::vector<BYTE>& arrData) const
+{
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hKey);
+
+	LONG lResult{};
+
 	// Note: For the query, a data size 0 indicates that the data is not required. This is not 
 	// what we want here. So we need to set a default if not provided.
 	if (arrData.size() == 0)
@@ -163,6 +213,8 @@ SResult CRegistryAccess::ReadValueBase(
 		arrData.resize(m_OnReadValue_nDefaultBufferSize);
 	}
 
+	VLR_REGISTRY_INSTRUMENT_OPERATION(oInstrumentedOperation, Query);
+
 	size_t nIterationCount = 0;
 	while (true)
 	{
@@ -176,16 +228,21 @@ SResult CRegistryAccess::ReadValueBase(
 			&dwType_Result,
 			arrData.data(),
 			&dwBufferSize);
+		VLR_REGISTRY_INSTRUMENT_ON_RESULT(oInstrumentedOperation, lResult);
 		if (lResult == ERROR_SUCCESS)
 		{
 			// Truncate buffer to data size
 			arrData.resize(dwBufferSize);
+			VLR_REGISTRY_INSTRUMENT_ADD_BYTES(oInstrumentedOperation, dwBufferSize);
 			break;
 		}
 		if (lResult == ERROR_MORE_DATA)
 		{
+			VLR_REGISTRY_INSTRUMENT_ADD_RETRY(oInstrumentedOperation);
+
 			if (nIterationCount >= m_nMaxIterationCountForRead)
 			{
+				VLR_REGISTRY_INSTRUMENT_ON_ERROR(oInstrumentedOperation);
 				// TODO: Add context for error
 				return E_FAIL;
 			}
@@ -201,6 +258,150 @@ SResult CRegistryAccess::ReadValueBase(
 	return S_OK;
 }
 
+SResult CRegistryAccess::readValueIntoBufferFromOpenKey(
+	HKEY hKey,
+	tzstring_view svzValueName,
+	DWORD& dwType_Result,
+	cpp::span<BYTE> spanBuffer,
+	DWORD& dwDataSize_Result) const
+{
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hKey);
+
+	VLR_REGISTRY_INSTRUMENT_OPERATION(oInstrumentedOperation, Query);
+
+	dwDataSize_Result = util::range_checked_cast<DWORD>(spanBuffer.size());
+	LONG lResult = RegQueryValueEx(
+		hKey,
+		svzValueName,
+		NULL,
+		&dwType_Result,
+		spanBuffer.data(),
+		&dwDataSize_Result);
+	VLR_REGISTRY_INSTRUMENT_ON_RESULT(oInstrumentedOperation, lResult);
+	// Note: An empty span may have no data pointer, in which case the query only returns the size
+	if ((lResult == ERROR_SUCCESS) && (dwDataSize_Result > spanBuffer.size()))
+	{
+		return __HRESULT_FROM_WIN32(ERROR_MORE_DATA);
+	}
+	if (lResult != ERROR_SUCCESS)
+	{
+		return __HRESULT_FROM_WIN32(lResult);
+	}
+
+	VLR_REGISTRY_INSTRUMENT_ADD_BYTES(oInstrumentedOperation, dwDataSize_Result);
+	return SResult::Success;
+}
+
+SResult CRegistryAccess::readValueBinaryFromOpenKey(
+	HKEY hKey,
+	tzstring_view svzValueName,
+	std::vector<BYTE>& arrData) const
+{
+	SResult sr;
+
+	// Note: Query the data directly, into the vector's existing allocation (eg: a reused buffer) or the default size;
+	// only a value larger than that needs a second query, with the size returned along with ERROR_MORE_DATA.
+	arrData.resize((std::max)(arrData.capacity(), m_OnReadValue_nDefaultBufferSize));
+
+	DWORD dwType{};
+	DWORD dwDataSize{};
+	size_t nIterationCount = 0;
+	while (true)
+	{
+		nIterationCount++;
+
+		sr = readValueIntoBufferFromOpenKey(
+			hKey,
+			svzValueName,
+			dwType,
+			arrData,
+			dwDataSize);
+		if (sr.asHRESULT() == __HRESULT_FROM_WIN32(ERROR_MORE_DATA))
+		{
+			// Note: The type is returned along with ERROR_MORE_DATA, so other types are not read in full
+			if (dwType != REG_BINARY)
+			{
+				return E_UNEXPECTED;
+			}
+			// Note: The value may also grow between the queries; dwDataSize is the new size
+			if (nIterationCount >= m_nMaxIterationCountForRead)
+			{
+				return E_FAIL;
+			}
+			arrData.resize(dwDataSize);
+			continue;
+		}
+		VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+		break;
+	}
+
+	if (dwType != REG_BINARY)
+	{
+		return E_UNEXPECTED;
+	}
+	arrData.resize(dwDataSize);
+
+	return SResult::Success;
+}
+
+SResult CRegistryAccess::readValueBaseWithBuffer(
+	tzstring_view svzKeyName,
+	tzstring_view svzValueName,
+	DWORD& dwType_Result,
+	cpp::span<BYTE> spanBuffer,
+	std::vector<BYTE>& arrOverflowData,
+	cpp::span<const BYTE>& spanData_Result) const
+{
+	SResult sr;
+
+	VLR_REGISTRY_TRACE_OPERATION(oTracedOperation, ReadValue, svzKeyName, svzValueName, sr);
+
+	HKEY hKey{};
+	sr = openKey(svzKeyName, KEY_READ, hKey);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hKey);
+	auto onDestroy_CloseRegKey = AutoCloseRegKey{ hKey };
+
+	{
+		VLR_REGISTRY_INSTRUMENT_OPERATION(oInstrumentedOperation, Query);
+
+		DWORD dwDataSize = util::range_checked_cast<DWORD>(spanBuffer.size());
+		LONG lResult = RegQueryValueEx(
+			hKey,
+			svzValueName,
+			NULL,
+			&dwType_Result,
+			spanBuffer.data(),
+			&dwDataSize);
+		VLR_REGISTRY_INSTRUMENT_ON_RESULT(oInstrumentedOperation, lResult);
+		if (lResult == ERROR_SUCCESS)
+		{
+			VLR_REGISTRY_INSTRUMENT_ADD_BYTES(oInstrumentedOperation, dwDataSize);
+			spanData_Result = spanBuffer.first(dwDataSize);
+			oTracedOperation.OnValue(dwType_Result, dwDataSize);
+			return oTracedOperation.Return(SResult::Success);
+		}
+		if (lResult != ERROR_MORE_DATA)
+		{
+			return oTracedOperation.Return(__HRESULT_FROM_WIN32(lResult));
+		}
+
+		// Note: The query returned the required size; the value may still grow before the re-read, which handles that
+		arrOverflowData.resize(dwDataSize);
+	}
+
+	sr = ReadValueBaseFromOpenKey(
+		hKey,
+		svzValueName,
+		dwType_Result,
+		arrOverflowData);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	spanData_Result = arrOverflowData;
+	oTracedOperation.OnValue(dwType_Result, arrOverflowData.size());
+	return oTracedOperation.Return(SResult::Success);
+}
+
 SResult CRegistryAccess::WriteValueBase(
 	tzstring_view svzKeyName,
 	tzstring_view svzValueName,
@@ -208,7 +409,8 @@ SResult CRegistryAccess::WriteValueBase(
 	cpp::span<const BYTE> spanData) const
 {
 	SResult sr;
-	LONG lResult{};
+
+	VLR_REGISTRY_TRACE_OPERATION(oTracedOperation, WriteValue, svzKeyName, svzValueName, sr);
 
 	HKEY hKey{};
 	sr = openKey(svzKeyName, KEY_WRITE, hKey);
@@ -216,6 +418,27 @@ SResult CRegistryAccess::WriteValueBase(
 	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hKey);
 	auto onDestroy_CloseRegKey = AutoCloseRegKey{ hKey };
 
+	oTracedOperation.OnValue(dwType, spanData.size());
+
+	return oTracedOperation.Return(WriteValueBaseToOpenKey(
+		hKey,
+		svzValueName,
+		dwType,
+		spanData));
+}
+
+SResult CRegistryAccess::WriteValueBaseToOpenKey(
+	HKEY hKey,
+	tzstring_view svzValueName,
+	const DWORD& dwType,
+	cpp::span<const BYTE> spanData) const
+{
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hKey);
+
+	LONG lResult{};
+
+	VLR_REGISTRY_INSTRUMENT_OPERATION(oInstrumentedOperation, Write);
+
 	size_t nIterationCount = 0;
 	while (true)
 	{
@@ -229,6 +452,8 @@ SResult CRegistryAccess::WriteValueBase(
 			dwType,
 			spanData.data(),
 			dwBufferSize);
+		VLR_REGISTRY_INSTRUMENT_ON_RESULT(oInstrumentedOperation, lResult);
+		VLR_REGISTRY_INSTRUMENT_ADD_BYTES(oInstrumentedOperation, dwBufferSize);
 		if (lResult == ERROR_SUCCESS)
 		{
 			break;
@@ -651,9 +876,6 @@ SResult CRegistryAccess::WriteValue_MultiSz(
 	return SResult::Success;
 }
 
-// Note: Binary can be made faster by optimizing to not copy data.
-// Not doing this initially for consistency; update if speed for this type becomes desired.
-
 SResult CRegistryAccess::ReadValue_Binary(
 	tzstring_view svzKeyName,
 	tzstring_view svzValueName,
@@ -661,22 +883,26 @@ SResult CRegistryAccess::ReadValue_Binary(
 {
 	SResult sr;
 
-	DWORD dwType{};
+	VLR_REGISTRY_TRACE_OPERATION(oTracedOperation, ReadValue, svzKeyName, svzValueName, sr);
+
+	HKEY hKey{};
+	sr = openKey(svzKeyName, KEY_READ, hKey);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hKey);
+	auto onDestroy_CloseRegKey = AutoCloseRegKey{ hKey };
+
+	// Note: Read into a local buffer (moved into the result), so the result is unchanged on failure
 	std::vector<BYTE> arrData{};
-	sr = ReadValueBase(
-		svzKeyName,
+	sr = readValueBinaryFromOpenKey(
+		hKey,
 		svzValueName,
-		dwType,
 		arrData);
 	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
 
-	sr = convertRegDataToValue_Binary(
-		dwType,
-		arrData,
-		arrBinaryData);
-	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	oTracedOperation.OnValue(REG_BINARY, arrData.size());
+	arrBinaryData = std::move(arrData);
 
-	return SResult::Success;
+	return oTracedOperation.Return(SResult::Success);
 }
 
 SResult CRegistryAccess::ReadValue_Binary(
@@ -701,26 +927,101 @@ SResult CRegistryAccess::ReadValue_Binary(
 	return SResult::Success;
 }
 
-SResult CRegistryAccess::WriteValue_Binary(
+SResult CRegistryAccess::ReadValue_Binary(
 	tzstring_view svzKeyName,
 	tzstring_view svzValueName,
-	cpp::span<const BYTE> spanData) const
+	cpp::span<BYTE> spanBuffer,
+	size_t& nDataSize_Result) const
 {
 	SResult sr;
 
+	VLR_REGISTRY_TRACE_OPERATION(oTracedOperation, ReadValue, svzKeyName, svzValueName, sr);
+
+	HKEY hKey{};
+	sr = openKey(svzKeyName, KEY_READ, hKey);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hKey);
+	auto onDestroy_CloseRegKey = AutoCloseRegKey{ hKey };
+
 	DWORD dwType{};
-	std::vector<BYTE> arrData{};
-	sr = convertValueToRegData_Binary(
-		spanData,
+	DWORD dwDataSize{};
+	sr = readValueIntoBufferFromOpenKey(
+		hKey,
+		svzValueName,
 		dwType,
-		arrData);
+		spanBuffer,
+		dwDataSize);
+	// Note: The type is returned along with ERROR_MORE_DATA, so a mismatch is reported before the caller retries
+	if (sr.isSuccess() || (sr.asHRESULT() == __HRESULT_FROM_WIN32(ERROR_MORE_DATA)))
+	{
+		if (dwType != REG_BINARY)
+		{
+			return oTracedOperation.Return(E_UNEXPECTED);
+		}
+		nDataSize_Result = dwDataSize;
+		oTracedOperation.OnValue(dwType, dwDataSize);
+	}
 	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
 
+	return oTracedOperation.Return(SResult::Success);
+}
+
+SResult CRegistryAccess::ReadValue_Binary(
+	tzstring_view svzKeyName,
+	tzstring_view svzValueName,
+	const OnBinaryChunk& fOnBinaryChunk,
+	size_t nChunkSize /*= m_OnReadValue_nDefaultChunkSize*/) const
+{
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(fOnBinaryChunk);
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(nChunkSize);
+
+	SResult sr;
+
+	std::vector<BYTE> arrData{};
+	// Note: Scoped (and traced) separately, so the key is not held open, and the trace does not include the time,
+	// while the caller consumes the data
+	{
+		VLR_REGISTRY_TRACE_OPERATION(oTracedOperation, ReadValue, svzKeyName, svzValueName, sr);
+
+		HKEY hKey{};
+		sr = openKey(svzKeyName, KEY_READ, hKey);
+		VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+		VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hKey);
+		auto onDestroy_CloseRegKey = AutoCloseRegKey{ hKey };
+
+		sr = readValueBinaryFromOpenKey(
+			hKey,
+			svzValueName,
+			arrData);
+		VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+		oTracedOperation.OnValue(REG_BINARY, arrData.size());
+	}
+
+	auto spanData = cpp::span<const BYTE>{ arrData };
+	for (size_t nOffset = 0; nOffset < spanData.size(); nOffset += nChunkSize)
+	{
+		auto spanChunk = spanData.subspan(nOffset, (std::min)(nChunkSize, spanData.size() - nOffset));
+		sr = fOnBinaryChunk(spanChunk, nOffset, spanData.size());
+		VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	}
+
+	return SResult::Success;
+}
+
+SResult CRegistryAccess::WriteValue_Binary(
+	tzstring_view svzKeyName,
+	tzstring_view svzValueName,
+	cpp::span<const BYTE> spanData) const
+{
+	SResult sr;
+
+	// Note: The data is already in the registry format, so it is written directly
 	sr = WriteValueBase(
 		svzKeyName,
 		svzValueName,
-		dwType,
-		arrData);
+		REG_BINARY,
+		spanData);
 	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
 
 	return SResult::Success;
@@ -732,14 +1033,15 @@ SResult CRegistryAccess::DeleteValue(
 	const Options_DeleteKeysOrValues& options /*= {}*/)
 {
 	SResult sr;
-	LONG lResult{};
+
+	VLR_REGISTRY_TRACE_OPERATION(oTracedOperation, DeleteValue, svzKeyName, svzValueName, sr);
 
 	if (options.m_bEnsureSafeDelete)
 	{
 		bool bKeyUnderSafeDeletePath = false;
 		for (const auto& sPath : options.m_arrSafeDeletePaths)
 		{
-			if (StringCompare::CI().StringHasPrefix(svzKeyName, sPath))
+			if (strings::HasPrefix_CaseInsensitive<TCHAR>(svzKeyName, sPath))
 			{
 				bKeyUnderSafeDeletePath = true;
 				break;
@@ -747,7 +1049,7 @@ SResult CRegistryAccess::DeleteValue(
 		}
 		if (!bKeyUnderSafeDeletePath)
 		{
-			return SResult::Failure;
+			return oTracedOperation.Return(SResult::Failure);
 		}
 	}
 
@@ -755,14 +1057,26 @@ SResult CRegistryAccess::DeleteValue(
 	sr = openKey(svzKeyName, KEY_WRITE, hKey);
 	if (!sr.isSuccess())
 	{
-		return SResult::Success_WithNuance;
+		return oTracedOperation.Return(SResult::Success_WithNuance);
 	}
 	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hKey);
 	auto onDestroy_CloseRegKey = AutoCloseRegKey{ hKey };
 
-	lResult = ::RegDeleteValue(
+	return oTracedOperation.Return(DeleteValueFromOpenKey(hKey, svzValueName));
+}
+
+SResult CRegistryAccess::DeleteValueFromOpenKey(
+	HKEY hKey,
+	tzstring_view svzValueName) const
+{
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hKey);
+
+	VLR_REGISTRY_INSTRUMENT_OPERATION(oInstrumentedOperation, Write);
+
+	LONG lResult = ::RegDeleteValue(
 		hKey,
 		svzValueName);
+	VLR_REGISTRY_INSTRUMENT_ON_RESULT(oInstrumentedOperation, lResult);
 	if (lResult != ERROR_SUCCESS)
 	{
 		return __HRESULT_FROM_WIN32(lResult);
@@ -1247,7 +1561,8 @@ SResult CRegistryAccess::EnumAllValues(
 	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(fOnEnumValueData);
 
 	SResult sr;
-	LONG lResult{};
+
+	VLR_REGISTRY_TRACE_OPERATION(oTracedOperation, EnumValues, svzKeyName, tzstring_view{}, sr);
 
 	HKEY hKey{};
 	sr = openKey(svzKeyName, KEY_READ, hKey);
@@ -1255,11 +1570,112 @@ SResult CRegistryAccess::EnumAllValues(
 	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hKey);
 	auto onDestroy_CloseRegKey = AutoCloseRegKey{ hKey };
 
-	DWORD dwNumValues{};
-	DWORD dwMaxValueNameChars{};
-	DWORD dwMaxValueDataBytes{};
-	lResult = RegQueryInfoKey(
-		hKey,
+	// Note: When tracing, the entries are counted, and the time in the callback is not recorded as part of the operation
+	auto fOnEnumValueData_Traced = OnEnumValueData{};
+	if (oTracedOperation.IsRecording())
+	{
+		fOnEnumValueData_Traced = [&](const EnumValueData& oEnumValueData)
+		{
+			return oTracedOperation.CallForEntry([&] { return fOnEnumValueData(oEnumValueData); });
+		};
+	}
+
+	return oTracedOperation.Return(EnumAllValuesFromOpenKey(
+		hKey,
+		fOnEnumValueData_Traced ? fOnEnumValueData_Traced : fOnEnumValueData));
+}
+
+SResult CRegistryAccess::EnumAllValuesFromOpenKey(
+	HKEY hKey,
+	const OnEnumValueData& fOnEnumValueData) const
+{
+	return enumValuesFromOpenKey(
+		hKey,
+		0,
+		MAXDWORD,
+		fOnEnumValueData,
+		nullptr,
+		nullptr);
+}
+
+SResult CRegistryAccess::EnumValuesPage(
+	tzstring_view svzKeyName,
+	DWORD dwStartIndex,
+	DWORD dwMaxCount,
+	const OnEnumValueData& fOnEnumValueData,
+	Result_EnumPage* pResult /*= nullptr*/) const
+{
+	SResult sr;
+
+	HKEY hKey{};
+	sr = openKey(svzKeyName, KEY_READ, hKey);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hKey);
+	auto onDestroy_CloseRegKey = AutoCloseRegKey{ hKey };
+
+	return enumValuesFromOpenKey(
+		hKey,
+		dwStartIndex,
+		dwMaxCount,
+		fOnEnumValueData,
+		nullptr,
+		pResult);
+}
+
+SResult CRegistryAccess::EnumValuesPage(
+	tzstring_view svzKeyName,
+	const EnumPageToken& oPageToken,
+	DWORD dwMaxCount,
+	const OnEnumValueData& fOnEnumValueData,
+	Result_EnumPage* pResult /*= nullptr*/) const
+{
+	SResult sr;
+
+	HKEY hKey{};
+	sr = openKey(svzKeyName, KEY_READ, hKey);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hKey);
+	auto onDestroy_CloseRegKey = AutoCloseRegKey{ hKey };
+
+	return enumValuesFromOpenKey(
+		hKey,
+		oPageToken.m_dwNextIndex,
+		dwMaxCount,
+		fOnEnumValueData,
+		&oPageToken.m_ftLastWriteTime,
+		pResult);
+}
+
+SResult CRegistryAccess::enumValuesFromOpenKey(
+	HKEY hKey,
+	DWORD dwStartIndex,
+	DWORD dwMaxCount,
+	const OnEnumValueData& fOnEnumValueData,
+	const FILETIME* pftExpectedLastWriteTime,
+	Result_EnumPage* pResult) const
+{
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hKey);
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(fOnEnumValueData);
+
+	SResult sr;
+	LONG lResult{};
+
+	VLR_REGISTRY_INSTRUMENT_OPERATION(oInstrumentedOperation, Enumerate);
+
+	auto oResult = Result_EnumPage{};
+	auto oOnDestroy_SetResult = MakeActionOnDestruction([&] {
+		if (pResult)
+		{
+			*pResult = oResult;
+		}
+	});
+
+	DWORD dwNumValues{};
+	DWORD dwMaxValueNameChars{};
+	DWORD dwMaxValueDataBytes{};
+	FILETIME ftLastWriteTime{};
+	lResult = RegQueryInfoKey(
+		hKey,
 		NULL,
 		NULL,
 		NULL,
@@ -1270,9 +1686,16 @@ SResult CRegistryAccess::EnumAllValues(
 		&dwMaxValueNameChars,
 		&dwMaxValueDataBytes,
 		NULL,
-		NULL);
+		&ftLastWriteTime);
+	VLR_REGISTRY_INSTRUMENT_ON_RESULT(oInstrumentedOperation, lResult);
 	VLR_ASSERT_COMPARE_OR_RETURN_HRESULT_LAST_ERROR(lResult, == , ERROR_SUCCESS);
-	if (dwNumValues == 0)
+	if (pftExpectedLastWriteTime && (::CompareFileTime(pftExpectedLastWriteTime, &ftLastWriteTime) != 0))
+	{
+		return E_CHANGED_STATE;
+	}
+	oResult.m_dwTotalCount = dwNumValues;
+	oResult.m_oNextPageToken.m_ftLastWriteTime = ftLastWriteTime;
+	if (dwStartIndex >= dwNumValues)
 	{
 		return S_OK;
 	}
@@ -1283,7 +1706,8 @@ SResult CRegistryAccess::EnumAllValues(
 	std::vector<BYTE> arrValueData;
 	arrValueData.resize(dwMaxValueDataBytes);
 
-	for (DWORD i = 0; i < dwNumValues; ++i)
+	// Note: Count from the start index (rather than compare against start + max), so a max of MAXDWORD cannot overflow
+	for (DWORD i = dwStartIndex; (i < dwNumValues) && (oResult.m_dwEntryCount < dwMaxCount); ++i)
 	{
 		DWORD dwValueNameSizeChars = util::range_checked_cast<DWORD>(arrNameData.size());
 		DWORD dwValueType{};
@@ -1302,6 +1726,8 @@ SResult CRegistryAccess::EnumAllValues(
 		{
 			return S_OK;
 		}
+		VLR_REGISTRY_INSTRUMENT_ON_RESULT(oInstrumentedOperation, lResult);
+		VLR_REGISTRY_INSTRUMENT_ADD_BYTES(oInstrumentedOperation, dwValueDataSizeBytes);
 		// Note: There's a possible race condition here, where a value might be written while we're enumerating,
 		// and it exceeds the max buffer size. Ignoring this case for now.
 		if (lResult != ERROR_SUCCESS)
@@ -1316,25 +1742,41 @@ SResult CRegistryAccess::EnumAllValues(
 			.withType(dwValueType)
 			.withData(cpp::span<BYTE>{arrValueData.data(), dwValueDataSizeBytes})
 			;
-		sr = fOnEnumValueData(oEnumValueData);
+		{
+			VLR_REGISTRY_INSTRUMENT_EXCLUDE_SCOPE(oInstrumentedOperation);
+			sr = fOnEnumValueData(oEnumValueData);
+		}
 		// Note: If we fail the callback, we early-abort and return the error code
 		if (!sr.isSuccess())
 		{
 			return sr;
 		}
+		++oResult.m_dwEntryCount;
 	}
 
+	auto dwNextIndex = dwStartIndex + oResult.m_dwEntryCount;
+	oResult.m_bHasMore = (dwNextIndex < dwNumValues);
+	oResult.m_oNextPageToken.m_dwNextIndex = dwNextIndex;
+
 	return SResult::Success;
 }
 
 SResult CRegistryAccess::populateValueMapEntryFromEnumValueData(
 	const EnumValueData& oEnumValueData,
 	ValueMapEntry& oValueMapEntry) const
+{
+	oValueMapEntry.m_sValueName = cpp::tstring{ oEnumValueData.m_svName };
+
+	return populateValueMapEntryDataFromEnumValueData(oEnumValueData, oValueMapEntry);
+}
+
+SResult CRegistryAccess::populateValueMapEntryDataFromEnumValueData(
+	const EnumValueData& oEnumValueData,
+	ValueMapEntry& oValueMapEntry) const
 {
 	SResult sr;
 
 	oValueMapEntry.m_dwType = oEnumValueData.m_dwType;
-	oValueMapEntry.m_sValueName = cpp::tstring{ oEnumValueData.m_svName };
 
 	switch (oEnumValueData.m_dwType)
 	{
@@ -1396,6 +1838,29 @@ SResult CRegistryAccess::RealAllValuesIntoMap(
 	return SResult::Success;
 }
 
+SResult CRegistryAccess::RealAllValuesIntoMap(
+	tzstring_view svzKeyName,
+	std::unordered_map<vlr::tstring_view, ValueMapEntry>& mapNameToValue,
+	registry::CNameInternPool& oNameInternPool) const
+{
+	SResult sr;
+
+	auto fOnEnumValueData_AddToMap = [&](const CRegistryAccess::EnumValueData& oEnumValueData) -> SResult
+	{
+		auto svzValueName = oNameInternPool.Intern(oEnumValueData.m_svName);
+		auto& oValueMapEntry = mapNameToValue[vlr::tstring_view{ svzValueName.data(), svzValueName.size() }];
+		sr = populateValueMapEntryDataFromEnumValueData(oEnumValueData, oValueMapEntry);
+		VLR_ASSERT_SR_SUCCEEDED_OR_RETURN_SRESULT(sr);
+
+		return SResult::Success;
+	};
+
+	sr = EnumAllValues(svzKeyName, fOnEnumValueData_AddToMap);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	return SResult::Success;
+}
+
 SResult CRegistryAccess::ReadValueObfuscated(
 	tzstring_view svzKeyName,
 	tzstring_view svzValueName,
@@ -1490,7 +1955,8 @@ SResult CRegistryAccess::EnumAllSubkeys(
 	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(fOnEnumSubkeyData);
 
 	SResult sr;
-	LONG lResult{};
+
+	VLR_REGISTRY_TRACE_OPERATION(oTracedOperation, EnumSubkeys, svzKeyName, tzstring_view{}, sr);
 
 	HKEY hKey{};
 	sr = openKey(svzKeyName, KEY_READ, hKey);
@@ -1498,9 +1964,110 @@ SResult CRegistryAccess::EnumAllSubkeys(
 	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hKey);
 	auto onDestroy_CloseRegKey = AutoCloseRegKey{ hKey };
 
+	// Note: When tracing, the entries are counted, and the time in the callback is not recorded as part of the operation
+	auto fOnEnumSubkeyData_Traced = OnEnumSubkeyData{};
+	if (oTracedOperation.IsRecording())
+	{
+		fOnEnumSubkeyData_Traced = [&](const EnumSubkeyData& oEnumSubkeyData)
+		{
+			return oTracedOperation.CallForEntry([&] { return fOnEnumSubkeyData(oEnumSubkeyData); });
+		};
+	}
+
+	return oTracedOperation.Return(EnumAllSubkeysFromOpenKey(
+		hKey,
+		fOnEnumSubkeyData_Traced ? fOnEnumSubkeyData_Traced : fOnEnumSubkeyData));
+}
+
+SResult CRegistryAccess::EnumAllSubkeysFromOpenKey(
+	HKEY hKey,
+	const OnEnumSubkeyData& fOnEnumSubkeyData) const
+{
+	return enumSubkeysFromOpenKey(
+		hKey,
+		0,
+		MAXDWORD,
+		fOnEnumSubkeyData,
+		nullptr,
+		nullptr);
+}
+
+SResult CRegistryAccess::EnumSubkeysPage(
+	tzstring_view svzKeyName,
+	DWORD dwStartIndex,
+	DWORD dwMaxCount,
+	const OnEnumSubkeyData& fOnEnumSubkeyData,
+	Result_EnumPage* pResult /*= nullptr*/) const
+{
+	SResult sr;
+
+	HKEY hKey{};
+	sr = openKey(svzKeyName, KEY_READ, hKey);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hKey);
+	auto onDestroy_CloseRegKey = AutoCloseRegKey{ hKey };
+
+	return enumSubkeysFromOpenKey(
+		hKey,
+		dwStartIndex,
+		dwMaxCount,
+		fOnEnumSubkeyData,
+		nullptr,
+		pResult);
+}
+
+SResult CRegistryAccess::EnumSubkeysPage(
+	tzstring_view svzKeyName,
+	const EnumPageToken& oPageToken,
+	DWORD dwMaxCount,
+	const OnEnumSubkeyData& fOnEnumSubkeyData,
+	Result_EnumPage* pResult /*= nullptr*/) const
+{
+	SResult sr;
+
+	HKEY hKey{};
+	sr = openKey(svzKeyName, KEY_READ, hKey);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hKey);
+	auto onDestroy_CloseRegKey = AutoCloseRegKey{ hKey };
+
+	return enumSubkeysFromOpenKey(
+		hKey,
+		oPageToken.m_dwNextIndex,
+		dwMaxCount,
+		fOnEnumSubkeyData,
+		&oPageToken.m_ftLastWriteTime,
+		pResult);
+}
+
+SResult CRegistryAccess::enumSubkeysFromOpenKey(
+	HKEY hKey,
+	DWORD dwStartIndex,
+	DWORD dwMaxCount,
+	const OnEnumSubkeyData& fOnEnumSubkeyData,
+	const FILETIME* pftExpectedLastWriteTime,
+	Result_EnumPage* pResult) const
+{
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hKey);
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(fOnEnumSubkeyData);
+
+	SResult sr;
+	LONG lResult{};
+
+	VLR_REGISTRY_INSTRUMENT_OPERATION(oInstrumentedOperation, Enumerate);
+
+	auto oResult = Result_EnumPage{};
+	auto oOnDestroy_SetResult = MakeActionOnDestruction([&] {
+		if (pResult)
+		{
+			*pResult = oResult;
+		}
+	});
+
 	DWORD dwSubkeyCount{};
 	DWORD dwMaxSubkeyNameChars{};
 	DWORD dwMaxSubkeyClassChars{};
+	FILETIME ftLastWriteTime{};
 	lResult = RegQueryInfoKey(
 		hKey,
 		NULL,
@@ -1513,9 +2080,16 @@ SResult CRegistryAccess::EnumAllSubkeys(
 		NULL,
 		NULL,
 		NULL,
-		NULL);
+		&ftLastWriteTime);
+	VLR_REGISTRY_INSTRUMENT_ON_RESULT(oInstrumentedOperation, lResult);
 	VLR_ASSERT_COMPARE_OR_RETURN_HRESULT_LAST_ERROR(lResult, == , ERROR_SUCCESS);
-	if (dwSubkeyCount == 0)
+	if (pftExpectedLastWriteTime && (::CompareFileTime(pftExpectedLastWriteTime, &ftLastWriteTime) != 0))
+	{
+		return E_CHANGED_STATE;
+	}
+	oResult.m_dwTotalCount = dwSubkeyCount;
+	oResult.m_oNextPageToken.m_ftLastWriteTime = ftLastWriteTime;
+	if (dwStartIndex >= dwSubkeyCount)
 	{
 		return S_OK;
 	}
@@ -1526,7 +2100,7 @@ SResult CRegistryAccess::EnumAllSubkeys(
 	std::vector<TCHAR> arrSubkeyClassData;
 	arrSubkeyClassData.resize(dwMaxSubkeyClassChars + 1);
 
-	for (DWORD i = 0; i < dwSubkeyCount; ++i)
+	for (DWORD i = dwStartIndex; (i < dwSubkeyCount) && (oResult.m_dwEntryCount < dwMaxCount); ++i)
 	{
 		EnumSubkeyData oEnumSubkeyData{};
 		oEnumSubkeyData.withIndex(i);
@@ -1547,6 +2121,7 @@ SResult CRegistryAccess::EnumAllSubkeys(
 		{
 			return S_OK;
 		}
+		VLR_REGISTRY_INSTRUMENT_ON_RESULT(oInstrumentedOperation, lResult);
 		// Note: There's a possible race condition here, where a value might be written while we're enumerating,
 		// and it exceeds the max buffer size. Ignoring this case for now.
 		if (lResult != ERROR_SUCCESS)
@@ -1557,14 +2132,22 @@ SResult CRegistryAccess::EnumAllSubkeys(
 		oEnumSubkeyData.withName(vlr::tstring_view{arrSubkeyNameData.data(), dwSubkeyNameSizeChars});
 		oEnumSubkeyData.withClass(vlr::tstring_view{arrSubkeyClassData.data(), dwSubkeyClassSizeChars});
 
-		sr = fOnEnumSubkeyData(oEnumSubkeyData);
+		{
+			VLR_REGISTRY_INSTRUMENT_EXCLUDE_SCOPE(oInstrumentedOperation);
+			sr = fOnEnumSubkeyData(oEnumSubkeyData);
+		}
 		// Note: If we fail the callback, we early-abort and return the error code
 		if (!sr.isSuccess())
 		{
 			return sr;
 		}
+		++oResult.m_dwEntryCount;
 	}
 
+	auto dwNextIndex = dwStartIndex + oResult.m_dwEntryCount;
+	oResult.m_bHasMore = (dwNextIndex < dwSubkeyCount);
+	oResult.m_oNextPageToken.m_dwNextIndex = dwNextIndex;
+
 	return SResult::Success;
 }
 
@@ -1587,6 +2170,230 @@ SResult CRegistryAccess::ReadAllSubkeysIntoVector(
 	return SResult::Success;
 }
 
+SResult CRegistryAccess::ReadAllSubkeysIntoVector(
+	tzstring_view svzKeyName,
+	std::vector<vlr::tzstring_view>& arrSubkeyNames,
+	registry::CNameInternPool& oNameInternPool) const
+{
+	SResult sr;
+
+	auto fOnEnumSubkeyData_AddToResult = [&](const EnumSubkeyData& oEnumSubkeyData) -> SResult
+	{
+		arrSubkeyNames.push_back(oNameInternPool.Intern(oEnumSubkeyData.m_svName));
+
+		return SResult::Success;
+	};
+
+	sr = EnumAllSubkeys(svzKeyName, fOnEnumSubkeyData_AddToResult);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	return SResult::Success;
+}
+
+SResult CRegistryAccess::ReadKeyInfo(
+	tzstring_view svzKeyName,
+	KeyInfo& oKeyInfo) const
+{
+	SResult sr;
+
+	VLR_REGISTRY_TRACE_OPERATION(oTracedOperation, QueryKeyInfo, svzKeyName, tzstring_view{}, sr);
+
+	HKEY hKey{};
+	sr = openKey(svzKeyName, KEY_READ, hKey);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hKey);
+	auto onDestroy_CloseRegKey = AutoCloseRegKey{ hKey };
+
+	sr = queryKeyInfo(hKey, oKeyInfo);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	return oTracedOperation.Return(SResult::Success);
+}
+
+SResult CRegistryAccess::EnumAllSubkeysWithInfo(
+	tzstring_view svzKeyName,
+	const OnEnumSubkeyWithInfoData& fOnEnumSubkeyWithInfoData,
+	const Options_EnumSubkeysWithInfo& options /*= {}*/) const
+{
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(fOnEnumSubkeyWithInfoData);
+
+	SResult sr;
+	LONG lResult{};
+
+	HKEY hKey{};
+	sr = openKey(svzKeyName, KEY_READ, hKey);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hKey);
+	auto onDestroy_CloseRegKey = AutoCloseRegKey{ hKey };
+
+	KeyInfo oParentKeyInfo{};
+	sr = queryKeyInfo(hKey, oParentKeyInfo);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	if (oParentKeyInfo.m_dwSubkeyCount == 0)
+	{
+		return S_OK;
+	}
+
+	const DWORD dwChildAccessMask = KEY_READ | getWow64RedirectionKeyAccessMask();
+	auto fOpenChildAndQueryInfo = [hKey, dwChildAccessMask](const vlr::tstring& sChildName) -> std::pair<SResult, KeyInfo>
+	{
+		std::pair<SResult, KeyInfo> oResult{};
+
+		VLR_REGISTRY_INSTRUMENT_OPERATION(oInstrumentedOperation, Open);
+
+		HKEY hChildKey{};
+		LONG lResult = ::RegOpenKeyEx(
+			hKey,
+			sChildName.c_str(),
+			0,
+			dwChildAccessMask,
+			&hChildKey);
+		VLR_REGISTRY_INSTRUMENT_ON_RESULT(oInstrumentedOperation, lResult);
+		if (lResult != ERROR_SUCCESS)
+		{
+			oResult.first = SResult::For_win32_ErrorCode(lResult);
+			return oResult;
+		}
+		auto onDestroy_CloseChildKey = AutoCloseRegKey{ hChildKey };
+
+		oResult.first = queryKeyInfo(hChildKey, oResult.second);
+
+		return oResult;
+	};
+
+	// Note: With no prefetch, the deferred launch runs the child query inline on delivery.
+	const auto eLaunchPolicy = (options.m_nMaxPrefetchInFlight > 0) ? std::launch::async : std::launch::deferred;
+	const size_t nMaxInFlight = (std::max)(options.m_nMaxPrefetchInFlight, size_t{ 1 });
+
+	struct PendingSubkey
+	{
+		DWORD m_dwIndex{};
+		vlr::tstring m_sName;
+		vlr::tstring m_sClass;
+		FILETIME m_ftLastWriteTime{};
+		std::future<std::pair<SResult, KeyInfo>> m_futureKeyInfo;
+	};
+	// Note: This is declared after the parent key auto-close, so on any early return the outstanding requests
+	// (which open relative to the parent key) are waited on before the parent key is closed.
+	std::deque<PendingSubkey> dequePendingSubkeys;
+
+	auto fDeliverOldestPending = [&]() -> SResult
+	{
+		auto& oPendingSubkey = dequePendingSubkeys.front();
+
+		EnumSubkeyWithInfoData oEnumSubkeyWithInfoData{};
+		oEnumSubkeyWithInfoData.withIndex(oPendingSubkey.m_dwIndex);
+		oEnumSubkeyWithInfoData.withName(oPendingSubkey.m_sName);
+		oEnumSubkeyWithInfoData.withClass(oPendingSubkey.m_sClass);
+		oEnumSubkeyWithInfoData.withLastWriteTime(oPendingSubkey.m_ftLastWriteTime);
+		std::tie(oEnumSubkeyWithInfoData.m_srKeyInfo, oEnumSubkeyWithInfoData.m_oKeyInfo) = oPendingSubkey.m_futureKeyInfo.get();
+
+		auto srCallback = fOnEnumSubkeyWithInfoData(oEnumSubkeyWithInfoData);
+		dequePendingSubkeys.pop_front();
+
+		return srCallback;
+	};
+
+	VLR_REGISTRY_INSTRUMENT_OPERATION(oInstrumentedOperation, Enumerate);
+
+	std::vector<TCHAR> arrSubkeyNameData;
+	// Note: We need to add one char to buffer size for NULL-terminator
+	arrSubkeyNameData.resize(oParentKeyInfo.m_dwMaxSubkeyNameChars + 1);
+	std::vector<TCHAR> arrSubkeyClassData;
+	arrSubkeyClassData.resize(oParentKeyInfo.m_dwMaxSubkeyClassChars + 1);
+
+	for (DWORD i = 0; i < oParentKeyInfo.m_dwSubkeyCount; ++i)
+	{
+		DWORD dwSubkeyNameSizeChars = util::range_checked_cast<DWORD>(arrSubkeyNameData.size());
+		DWORD dwSubkeyClassSizeChars = util::range_checked_cast<DWORD>(arrSubkeyClassData.size());
+		FILETIME ftLastWriteTime{};
+
+		lResult = RegEnumKeyEx(
+			hKey,
+			i,
+			arrSubkeyNameData.data(),
+			&dwSubkeyNameSizeChars,
+			NULL,
+			arrSubkeyClassData.data(),
+			&dwSubkeyClassSizeChars,
+			&ftLastWriteTime);
+		if (lResult == ERROR_NO_MORE_ITEMS)
+		{
+			break;
+		}
+		VLR_REGISTRY_INSTRUMENT_ON_RESULT(oInstrumentedOperation, lResult);
+		// Note: Same race condition as noted in EnumAllSubkeys; ignoring this case for now.
+		if (lResult != ERROR_SUCCESS)
+		{
+			return SResult::For_win32_ErrorCode(lResult);
+		}
+
+		auto& oPendingSubkey = dequePendingSubkeys.emplace_back();
+		oPendingSubkey.m_dwIndex = i;
+		oPendingSubkey.m_sName.assign(arrSubkeyNameData.data(), dwSubkeyNameSizeChars);
+		oPendingSubkey.m_sClass.assign(arrSubkeyClassData.data(), dwSubkeyClassSizeChars);
+		oPendingSubkey.m_ftLastWriteTime = ftLastWriteTime;
+		oPendingSubkey.m_futureKeyInfo = std::async(eLaunchPolicy, fOpenChildAndQueryInfo, oPendingSubkey.m_sName);
+
+		if (dequePendingSubkeys.size() < nMaxInFlight)
+		{
+			continue;
+		}
+
+		{
+			// Note: Delivery waits for the child key queries (which are counted as their own operations), and runs the
+			// callback
+			VLR_REGISTRY_INSTRUMENT_EXCLUDE_SCOPE(oInstrumentedOperation);
+			sr = fDeliverOldestPending();
+		}
+		// Note: If we fail the callback, we early-abort and return the error code
+		if (!sr.isSuccess())
+		{
+			return sr;
+		}
+	}
+
+	while (!dequePendingSubkeys.empty())
+	{
+		VLR_REGISTRY_INSTRUMENT_EXCLUDE_SCOPE(oInstrumentedOperation);
+		sr = fDeliverOldestPending();
+		if (!sr.isSuccess())
+		{
+			return sr;
+		}
+	}
+
+	return SResult::Success;
+}
+
+SResult CRegistryAccess::queryKeyInfo(
+	HKEY hKey,
+	KeyInfo& oKeyInfo)
+{
+	VLR_REGISTRY_INSTRUMENT_OPERATION(oInstrumentedOperation, Query);
+
+	LONG lResult = RegQueryInfoKey(
+		hKey,
+		NULL,
+		NULL,
+		NULL,
+		&oKeyInfo.m_dwSubkeyCount,
+		&oKeyInfo.m_dwMaxSubkeyNameChars,
+		&oKeyInfo.m_dwMaxSubkeyClassChars,
+		&oKeyInfo.m_dwValueCount,
+		&oKeyInfo.m_dwMaxValueNameChars,
+		&oKeyInfo.m_dwMaxValueDataBytes,
+		NULL,
+		&oKeyInfo.m_ftLastWriteTime);
+	VLR_REGISTRY_INSTRUMENT_ON_RESULT(oInstrumentedOperation, lResult);
+	if (lResult != ERROR_SUCCESS)
+	{
+		return SResult::For_win32_ErrorCode(lResult);
+	}
+
+	return SResult::Success;
+}
+
 SResult CRegistryAccess::openKey(
 	tzstring_view svzKeyName,
 	DWORD dwAccessMask,
@@ -1594,12 +2401,77 @@ SResult CRegistryAccess::openKey(
 {
 	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(m_hBaseKey);
 
+	VLR_REGISTRY_INSTRUMENT_OPERATION(oInstrumentedOperation, Open);
+
 	LONG lResult = ::RegOpenKeyEx(
 		getBaseKey(),
 		svzKeyName,
 		0,
 		dwAccessMask | getWow64RedirectionKeyAccessMask(),
 		&hKey_Result);
+	VLR_REGISTRY_INSTRUMENT_ON_RESULT(oInstrumentedOperation, lResult);
+	if (lResult == ERROR_SUCCESS)
+	{
+		return SResult::Success;
+	}
+
+	return __HRESULT_FROM_WIN32(lResult);
+}
+
+SResult CRegistryAccess::CreateOrOpenKey(
+	tzstring_view svzKeyName,
+	DWORD dwAccessMask,
+	HKEY& hKey_Result,
+	DWORD* pdwDisposition /*= nullptr*/) const
+{
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(m_hBaseKey);
+
+	// TODO? Add security attributes handling
+
+	VLR_REGISTRY_INSTRUMENT_OPERATION(oInstrumentedOperation, Open);
+
+	DWORD dwDisposition{};
+	LONG lResult = ::RegCreateKeyEx(
+		getBaseKey(),
+		svzKeyName,
+		0,
+		NULL,
+		0,
+		dwAccessMask | getWow64RedirectionKeyAccessMask(),
+		NULL,
+		&hKey_Result,
+		&dwDisposition);
+	VLR_REGISTRY_INSTRUMENT_ON_RESULT(oInstrumentedOperation, lResult);
+	if (lResult != ERROR_SUCCESS)
+	{
+		return __HRESULT_FROM_WIN32(lResult);
+	}
+
+	if (pdwDisposition)
+	{
+		*pdwDisposition = dwDisposition;
+	}
+
+	return SResult::Success;
+}
+
+SResult CRegistryAccess::OpenSubkeyFromOpenKey(
+	HKEY hKey,
+	tzstring_view svzSubkeyName,
+	DWORD dwAccessMask,
+	HKEY& hKey_Result) const
+{
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hKey);
+
+	VLR_REGISTRY_INSTRUMENT_OPERATION(oInstrumentedOperation, Open);
+
+	LONG lResult = ::RegOpenKeyEx(
+		hKey,
+		svzSubkeyName,
+		0,
+		dwAccessMask | getWow64RedirectionKeyAccessMask(),
+		&hKey_Result);
+	VLR_REGISTRY_INSTRUMENT_ON_RESULT(oInstrumentedOperation, lResult);
 	if (lResult == ERROR_SUCCESS)
 	{
 		return SResult::Success;
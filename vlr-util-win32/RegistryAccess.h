@@ -1,5 +1,10 @@
 #pragma once
 
+#include <array>
+#include <cstring>
+#include <iterator>
+#include <optional>
+
 #include <vlr-util/cpp_namespace.h>
 #include <vlr-util/strings.split.h>
 #include <vlr-util/util.includes.h>
@@ -9,7 +14,10 @@
 #include <vlr-util/util.Result.h>
 #include <vlr-util/ModuleContext.Compilation.h>
 
+#include "RegistryAccess_TraceRecorder.h"
 #include "RegistryAccess_Wow64KeyAccessOption.h"
+#include "registry.Coercion.h"
+#include "registry.NameInternPool.h"
 
 namespace vlr {
 
@@ -32,11 +40,11 @@ auto MakeRegistryPath(std::basic_string_view<TChar> svPathPrefix, std::basic_str
 			return "{}\\{}";
 		}
 	};
-	constexpr auto svzChars_PathSeparators = strings::DelimitersSpec<TChar>::GetChars_PathSeparators();
+	constexpr auto svzChars_PathSeparators = ::vlr::strings::DelimitersSpec<TChar>::GetChars_PathSeparators();
 
 	auto sPath = fmt::format(fGetFormatString(),
-		strings::GetTrimmedStringView(svPathPrefix, svzChars_PathSeparators),
-		strings::GetTrimmedStringView(svPathComponent, svzChars_PathSeparators));
+		::vlr::strings::GetTrimmedStringView(svPathPrefix, svzChars_PathSeparators),
+		::vlr::strings::GetTrimmedStringView(svPathComponent, svzChars_PathSeparators));
 	if constexpr (sizeof...(args) == 0)
 	{
 		return sPath;
@@ -58,20 +66,46 @@ protected:
 	static constexpr size_t m_nMaxIterationCountForRead_Default = 2;
 	size_t m_nMaxIterationCountForRead = m_nMaxIterationCountForRead_Default;
 	static constexpr size_t m_OnReadValue_nDefaultBufferSize = 1024;
+	// Note: Values up to this size are read into a stack buffer, without allocation (eg: for coerced reads)
+	static constexpr size_t m_OnReadValue_nStackBufferSize = 256;
+	static constexpr size_t m_OnReadValue_nDefaultChunkSize = 64 * 1024;
 
 	RegistryAccess::SEWow64KeyAccessOption m_eWow64KeyAccessOption;
 
+	cpp::shared_ptr<CRegistryAccessTraceRecorder> m_spTraceRecorder;
+
 	virtual HKEY getBaseKey() const
 	{
 		return m_hBaseKey;
 	}
 
 public:
+	inline HKEY GetBaseKey() const
+	{
+		return getBaseKey();
+	}
+	inline RegistryAccess::SEWow64KeyAccessOption GetWow64KeyAccessOption() const
+	{
+		return m_eWow64KeyAccessOption;
+	}
 	inline SResult SetWow64KeyAccessOption(RegistryAccess::SEWow64KeyAccessOption eWow64KeyAccessOption)
 	{
 		m_eWow64KeyAccessOption = eWow64KeyAccessOption;
 		return SResult::Success;
 	}
+	// Opt-in recording of the operations made through this instance (and copies made after it is set); null stops
+	// recording. Recorded are the named-key operations: key existence checks and creates, key and value deletes,
+	// key and value info queries, value reads and writes (including typed and coerced reads), and full value or
+	// subkey enumerations (whose duration excludes the time spent in the caller's callbacks).
+	// Note: Operations on caller-opened keys (the FromOpenKey variants) and paged enumerations are not recorded.
+	inline void SetTraceRecorder(cpp::shared_ptr<CRegistryAccessTraceRecorder> spTraceRecorder)
+	{
+		m_spTraceRecorder = std::move(spTraceRecorder);
+	}
+	inline const cpp::shared_ptr<CRegistryAccessTraceRecorder>& GetTraceRecorder() const
+	{
+		return m_spTraceRecorder;
+	}
 	// Set the instance to access the system-native portion of the registry, based on system config
 	//inline SResult SetWow64Value_ForSystemNativeReg()
 	//{
@@ -104,6 +138,45 @@ public:
 			return *this;
 		}
 	};
+	// Opens the key relative to the base key, with the configured WOW64 view. The caller owns the returned
+	// handle, and is responsible for closing it (eg: via AutoCloseRegKey).
+	inline SResult OpenKey(
+		tzstring_view svzKeyName,
+		DWORD dwAccessMask,
+		HKEY& hKey_Result) const
+	{
+		return openKey(svzKeyName, dwAccessMask, hKey_Result);
+	}
+	// Note: As OpenKey, but creates the key (and any missing parent keys) if it does not exist. The disposition
+	// (REG_CREATED_NEW_KEY or REG_OPENED_EXISTING_KEY) is optionally returned.
+	SResult CreateOrOpenKey(
+		tzstring_view svzKeyName,
+		DWORD dwAccessMask,
+		HKEY& hKey_Result,
+		DWORD* pdwDisposition = nullptr) const;
+	// Opens a subkey relative to a key which the caller has already opened (eg: when walking a subtree), with the
+	// configured WOW64 view. The caller owns the returned handle.
+	SResult OpenSubkeyFromOpenKey(
+		HKEY hKey,
+		tzstring_view svzSubkeyName,
+		DWORD dwAccessMask,
+		HKEY& hKey_Result) const;
+	// Note: Results from a key changing or being protected while a subtree is walked (eg: deleted, or access
+	// denied), for which a walk should skip the key rather than fail.
+	static inline bool IsSkippableResultForWalk(const SResult& sr)
+	{
+		switch (sr.asHRESULT())
+		{
+		case __HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND):
+		case __HRESULT_FROM_WIN32(ERROR_ACCESS_DENIED):
+		case __HRESULT_FROM_WIN32(ERROR_KEY_DELETED):
+		case __HRESULT_FROM_WIN32(ERROR_MORE_DATA):
+			return true;
+		default:
+			return false;
+		}
+	}
+
 	SResult DeleteKey(
 		tzstring_view svzKeyName,
 		const Options_DeleteKeysOrValues& options = {}) const;
@@ -113,17 +186,38 @@ public:
 		tzstring_view svzValueName,
 		DWORD& dwType_Result,
 		DWORD& dwSize_Result) const;
+	// Note: Variant of the above for a key which the caller has already opened. The key must have been opened with
+	// at least KEY_QUERY_VALUE access.
+	SResult ReadValueInfoFromOpenKey(
+		HKEY hKey,
+		tzstring_view svzValueName,
+		DWORD& dwType_Result,
+		DWORD& dwSize_Result) const;
 
 	SResult ReadValueBase(
 		tzstring_view svzKeyName,
 		tzstring_view svzValueName,
 		DWORD& dwType_Result, 
 		std::vector<BYTE>& arrData) const;
+	// Note: Variant of the above for a key which the caller has already opened (eg: to share one open across
+	// several reads). The key must have been opened with at least KEY_QUERY_VALUE access.
+	SResult ReadValueBaseFromOpenKey(
+		HKEY hKey,
+		tzstring_view svzValueName,
+		DWORD& dwType_Result,
+		std::vector<BYTE>& arrData) const;
 	SResult WriteValueBase(
 		tzstring_view svzKeyName,
 		tzstring_view svzValueName,
 		const DWORD& dwType,
 		cpp::span<const BYTE> spanData) const;
+	// Note: Variant of the above for a key which the caller has already opened (eg: to write several values with
+	// one open). The key must have been opened with at least KEY_SET_VALUE access.
+	SResult WriteValueBaseToOpenKey(
+		HKEY hKey,
+		tzstring_view svzValueName,
+		const DWORD& dwType,
+		cpp::span<const BYTE> spanData) const;
 
 	SResult ReadValue_String(
 		tzstring_view svzKeyName,
@@ -212,6 +306,22 @@ public:
 		tzstring_view svzValueName,
 		std::vector<BYTE>& arrData,
 		const std::vector<BYTE>& arrDefaultResultOnNoValue) const;
+	// Note: Reads directly into the caller's buffer, with one query. If the buffer is too small, this fails with
+	// ERROR_MORE_DATA, and nDataSize_Result is the required size.
+	SResult ReadValue_Binary(
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName,
+		cpp::span<BYTE> spanBuffer,
+		size_t& nDataSize_Result) const;
+	// Note: The registry only reads values whole, so chunks are views into one read buffer, sized from the value
+	// info; this avoids copying the data into a result vector. Returning failure from the callback stops the read.
+	using OnBinaryChunk = std::function<SResult(cpp::span<const BYTE> spanChunk, size_t nOffset, size_t nTotalSize)>;
+	SResult ReadValue_Binary(
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName,
+		const OnBinaryChunk& fOnBinaryChunk,
+		size_t nChunkSize = m_OnReadValue_nDefaultChunkSize) const;
+	// Note: Writes directly from the caller's data, without a copy
 	SResult WriteValue_Binary(
 		tzstring_view svzKeyName,
 		tzstring_view svzValueName,
@@ -221,6 +331,11 @@ public:
 		tzstring_view svzKeyName,
 		tzstring_view svzValueName,
 		const Options_DeleteKeysOrValues& options = {});
+	// Note: Variant of the above for a key which the caller has already opened. The key must have been opened with
+	// at least KEY_SET_VALUE access. The safe delete path check does not apply (there is no path to check).
+	SResult DeleteValueFromOpenKey(
+		HKEY hKey,
+		tzstring_view svzValueName) const;
 
 	// Note: This is the "high-level" interface.
 	// These methods have template specializations for default supported data types.
@@ -511,7 +626,57 @@ public:
 			tValue);
 	}
 
-	// TODO? Support data coercion
+	// Reads the value, coercing the stored type to the requested type as allowed by the mode (see registry.Coercion.h).
+	// Supported types are DWORD, QWORD, bool, std::string and std::wstring. Values which fit in the stack buffer
+	// are read without allocation, so numeric reads (coerced or not) do not allocate.
+	template< typename TValue >
+	SResult ReadValue_Coerced(
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName,
+		TValue& tValue,
+		registry::CoercionMode eCoercionMode = registry::CoercionMode::Lenient) const
+	{
+		SResult sr;
+
+		std::array<BYTE, m_OnReadValue_nStackBufferSize> arrBuffer;
+		std::vector<BYTE> arrOverflowData;
+		DWORD dwType{};
+		cpp::span<const BYTE> spanData;
+		sr = readValueBaseWithBuffer(
+			svzKeyName,
+			svzValueName,
+			dwType,
+			arrBuffer,
+			arrOverflowData,
+			spanData);
+		VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+		return registry::CoerceRegData(dwType, spanData, tValue, eCoercionMode);
+	}
+	template< typename TValue >
+	SResult ReadValue_Coerced(
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName,
+		TValue& tValue,
+		const TValue& tDefaultResultOnNoValue,
+		registry::CoercionMode eCoercionMode = registry::CoercionMode::Lenient) const
+	{
+		SResult sr;
+
+		sr = ReadValue_Coerced(
+			svzKeyName,
+			svzValueName,
+			tValue,
+			eCoercionMode);
+		if (sr.asHRESULT() == __HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND))
+		{
+			tValue = tDefaultResultOnNoValue;
+			return SResult::Success;
+		}
+		VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+		return SResult::Success;
+	}
 
 	SResult convertRegDataToValue_String(
 		const DWORD& dwType,
@@ -606,6 +771,96 @@ public:
 		DWORD& dwType,
 		std::vector<BYTE>& arrData) const;
 
+	// View of the strings in REG_MULTI_SZ data, without copies. Iteration stops at the first empty string (the
+	// list terminator), or at the end of the data if the terminator is missing.
+	class MultiSzRange
+	{
+	protected:
+		vlr::tstring_view m_svData;
+
+	public:
+		class const_iterator
+		{
+		protected:
+			vlr::tstring_view m_svRemaining;
+			vlr::tstring_view m_svCurrent;
+
+			inline void readCurrent()
+			{
+				auto nSeparatorIndex = m_svRemaining.find(_T('\0'));
+				m_svCurrent = m_svRemaining.substr(0, nSeparatorIndex);
+				if (m_svCurrent.empty())
+				{
+					m_svRemaining = {};
+				}
+			}
+
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = vlr::tstring_view;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const vlr::tstring_view*;
+			using reference = const vlr::tstring_view&;
+
+			inline reference operator*() const
+			{
+				return m_svCurrent;
+			}
+			inline pointer operator->() const
+			{
+				return &m_svCurrent;
+			}
+			inline const_iterator& operator++()
+			{
+				m_svRemaining.remove_prefix((std::min)(m_svCurrent.size() + 1, m_svRemaining.size()));
+				readCurrent();
+				return *this;
+			}
+			inline const_iterator operator++(int)
+			{
+				auto iterPrevious = *this;
+				++(*this);
+				return iterPrevious;
+			}
+			// Note: All end iterators (no remaining data) compare equal
+			inline bool operator==(const const_iterator& oOther) const
+			{
+				return (m_svRemaining.data() == oOther.m_svRemaining.data()) && (m_svRemaining.size() == oOther.m_svRemaining.size());
+			}
+			inline bool operator!=(const const_iterator& oOther) const
+			{
+				return !(*this == oOther);
+			}
+
+		public:
+			const_iterator() = default;
+			explicit const_iterator(vlr::tstring_view svRemaining)
+				: m_svRemaining{ svRemaining }
+			{
+				readCurrent();
+			}
+		};
+
+		inline const_iterator begin() const
+		{
+			return const_iterator{ m_svData };
+		}
+		inline const_iterator end() const
+		{
+			return const_iterator{};
+		}
+		inline bool empty() const
+		{
+			return (begin() == end());
+		}
+
+	public:
+		MultiSzRange() = default;
+		explicit MultiSzRange(vlr::tstring_view svData)
+			: m_svData{ svData }
+		{}
+	};
+
 	struct EnumValueData
 	{
 		DWORD m_dwIndex{};
@@ -613,6 +868,64 @@ public:
 		DWORD m_dwType{};
 		cpp::span<const BYTE> m_spanData;
 
+		// Typed views of the data. Each returns nullopt if the value has a different type, or if the data size is
+		// not valid for the type. The returned views point into the enumeration buffer, so are only valid for the
+		// duration of the callback.
+		inline std::optional<DWORD> AsDWORD() const
+		{
+			if ((m_dwType != REG_DWORD) || (m_spanData.size() != sizeof(DWORD)))
+			{
+				return {};
+			}
+			DWORD dwValue{};
+			std::memcpy(&dwValue, m_spanData.data(), sizeof(dwValue));
+			return dwValue;
+		}
+		inline std::optional<QWORD> AsQWORD() const
+		{
+			if ((m_dwType != REG_QWORD) || (m_spanData.size() != sizeof(QWORD)))
+			{
+				return {};
+			}
+			QWORD qwValue{};
+			std::memcpy(&qwValue, m_spanData.data(), sizeof(qwValue));
+			return qwValue;
+		}
+		// Note: For REG_SZ and REG_EXPAND_SZ (not expanded); the null terminator is not included, if present.
+		inline std::optional<vlr::tstring_view> AsStringView() const
+		{
+			if ((m_dwType != REG_SZ) && (m_dwType != REG_EXPAND_SZ))
+			{
+				return {};
+			}
+			if ((m_spanData.size() % sizeof(TCHAR)) != 0)
+			{
+				return {};
+			}
+			auto svValue = vlr::tstring_view{ reinterpret_cast<const TCHAR*>(m_spanData.data()), m_spanData.size() / sizeof(TCHAR) };
+			if (!svValue.empty() && (svValue.back() == _T('\0')))
+			{
+				svValue.remove_suffix(1);
+			}
+			return svValue;
+		}
+		inline std::optional<MultiSzRange> AsMultiSzRange() const
+		{
+			if ((m_dwType != REG_MULTI_SZ) || ((m_spanData.size() % sizeof(TCHAR)) != 0))
+			{
+				return {};
+			}
+			return MultiSzRange{ vlr::tstring_view{ reinterpret_cast<const TCHAR*>(m_spanData.data()), m_spanData.size() / sizeof(TCHAR) } };
+		}
+		inline std::optional<cpp::span<const BYTE>> AsBinary() const
+		{
+			if (m_dwType != REG_BINARY)
+			{
+				return {};
+			}
+			return m_spanData;
+		}
+
 		decltype(auto) withIndex(DWORD dwIndex)
 		{
 			m_dwIndex = dwIndex;
@@ -639,6 +952,44 @@ public:
 	SResult EnumAllValues(
 		tzstring_view svzKeyName,
 		const OnEnumValueData& fOnEnumValueData) const;
+	SResult EnumAllValuesFromOpenKey(
+		HKEY hKey,
+		const OnEnumValueData& fOnEnumValueData) const;
+
+	// Paged enumeration: returns up to dwMaxCount entries from a start index, opening the key once per page, so a
+	// caller can page through a key with many entries at constant cost per page. The result includes a token for the
+	// next page, which records the key's last write time; a page requested with the token fails with
+	// E_CHANGED_STATE (before returning any entries) if the key was written since, because indexes are then no
+	// longer stable.
+	// Note: The token fields are plain data, so a UI or RPC layer can hold / pass the token as-is. The last write time
+	// has system clock tick resolution, so a write in the same tick as the previous page was read is not detected.
+	struct EnumPageToken
+	{
+		DWORD m_dwNextIndex{};
+		FILETIME m_ftLastWriteTime{};
+	};
+	struct Result_EnumPage
+	{
+		DWORD m_dwEntryCount{};
+		// Note: Total entries in the key, when the page was read
+		DWORD m_dwTotalCount{};
+		bool m_bHasMore = false;
+		// Note: Only valid if m_bHasMore
+		EnumPageToken m_oNextPageToken;
+	};
+
+	SResult EnumValuesPage(
+		tzstring_view svzKeyName,
+		DWORD dwStartIndex,
+		DWORD dwMaxCount,
+		const OnEnumValueData& fOnEnumValueData,
+		Result_EnumPage* pResult = nullptr) const;
+	SResult EnumValuesPage(
+		tzstring_view svzKeyName,
+		const EnumPageToken& oPageToken,
+		DWORD dwMaxCount,
+		const OnEnumValueData& fOnEnumValueData,
+		Result_EnumPage* pResult = nullptr) const;
 
 	// Note: This does data copies and allocations, so prefer enum for search/speed
 	struct ValueMapEntry
@@ -656,10 +1007,22 @@ public:
 	SResult populateValueMapEntryFromEnumValueData(
 		const EnumValueData& oEnumValueData,
 		ValueMapEntry& oValueMapEntry) const;
+	// Note: As above, without the name
+	SResult populateValueMapEntryDataFromEnumValueData(
+		const EnumValueData& oEnumValueData,
+		ValueMapEntry& oValueMapEntry) const;
 
 	SResult RealAllValuesIntoMap(
 		tzstring_view svzKeyName,
 		std::unordered_map<vlr::tstring, ValueMapEntry>& mapNameToValue) const;
+	// Note: Variant of the above with names from an intern pool, which can be shared across calls (and keys), so
+	// repeated names are not allocated again. The map keys refer to the pool, so are valid for the lifetime of the
+	// pool (and are null-terminated); the entry names (ValueMapEntry::m_sValueName) are left empty, since the key is
+	// the name.
+	SResult RealAllValuesIntoMap(
+		tzstring_view svzKeyName,
+		std::unordered_map<vlr::tstring_view, ValueMapEntry>& mapNameToValue,
+		registry::CNameInternPool& oNameInternPool) const;
 
 	// This is a method which can be used to read a value without exposing the name of the value which is being read.
 	// Since registry access calls can be audited, reading a value by name exposes the name. Instead of this, we can 
@@ -707,10 +1070,125 @@ public:
 	SResult EnumAllSubkeys(
 		tzstring_view svzKeyName,
 		const OnEnumSubkeyData& fOnEnumSubkeyData) const;
+	SResult EnumAllSubkeysFromOpenKey(
+		HKEY hKey,
+		const OnEnumSubkeyData& fOnEnumSubkeyData) const;
+
+	// Note: Paged variants; see EnumValuesPage
+	SResult EnumSubkeysPage(
+		tzstring_view svzKeyName,
+		DWORD dwStartIndex,
+		DWORD dwMaxCount,
+		const OnEnumSubkeyData& fOnEnumSubkeyData,
+		Result_EnumPage* pResult = nullptr) const;
+	SResult EnumSubkeysPage(
+		tzstring_view svzKeyName,
+		const EnumPageToken& oPageToken,
+		DWORD dwMaxCount,
+		const OnEnumSubkeyData& fOnEnumSubkeyData,
+		Result_EnumPage* pResult = nullptr) const;
 
 	SResult ReadAllSubkeysIntoVector(
 		tzstring_view svzKeyName,
 		std::vector<cpp::tstring>& arrSubkeyNames);
+	// Note: Variant of the above with names from an intern pool; see RealAllValuesIntoMap
+	SResult ReadAllSubkeysIntoVector(
+		tzstring_view svzKeyName,
+		std::vector<vlr::tzstring_view>& arrSubkeyNames,
+		registry::CNameInternPool& oNameInternPool) const;
+
+	// Note: This is the data returned from RegQueryInfoKey, for a single key
+
+	struct KeyInfo
+	{
+		DWORD m_dwSubkeyCount{};
+		DWORD m_dwMaxSubkeyNameChars{};
+		DWORD m_dwMaxSubkeyClassChars{};
+		DWORD m_dwValueCount{};
+		DWORD m_dwMaxValueNameChars{};
+		DWORD m_dwMaxValueDataBytes{};
+		FILETIME m_ftLastWriteTime{};
+	};
+
+	SResult ReadKeyInfo(
+		tzstring_view svzKeyName,
+		KeyInfo& oKeyInfo) const;
+
+	// This is a variant of subkey enumeration which also opens each child key, and reads the key info.
+	// The child open/query is handed off to a bounded set of in-flight requests while the parent enumeration
+	// continues, so the round-trips for the children overlap. Results are returned in enumeration order.
+
+	struct EnumSubkeyWithInfoData
+		: public EnumSubkeyData
+	{
+		// Note: Result of the child open/query; m_oKeyInfo is only valid if this is success
+		SResult m_srKeyInfo;
+		KeyInfo m_oKeyInfo;
+	};
+	using OnEnumSubkeyWithInfoData = std::function<SResult(const EnumSubkeyWithInfoData& oEnumSubkeyWithInfoData)>;
+
+	struct Options_EnumSubkeysWithInfo
+	{
+		// Note: A value of 0 disables the prefetch, and each child is queried inline
+		size_t m_nMaxPrefetchInFlight = 8;
+
+		decltype(auto) withMaxPrefetchInFlight(size_t nMaxPrefetchInFlight)
+		{
+			m_nMaxPrefetchInFlight = nMaxPrefetchInFlight;
+			return *this;
+		}
+	};
+
+	SResult EnumAllSubkeysWithInfo(
+		tzstring_view svzKeyName,
+		const OnEnumSubkeyWithInfoData& fOnEnumSubkeyWithInfoData,
+		const Options_EnumSubkeysWithInfo& options = {}) const;
+
+protected:
+	static SResult queryKeyInfo(
+		HKEY hKey,
+		KeyInfo& oKeyInfo);
+	// Note: Shared implementation of the full and paged enumerations. If the expected last write time is given and
+	// does not match the key, fails with E_CHANGED_STATE before any entries are returned.
+	SResult enumValuesFromOpenKey(
+		HKEY hKey,
+		DWORD dwStartIndex,
+		DWORD dwMaxCount,
+		const OnEnumValueData& fOnEnumValueData,
+		const FILETIME* pftExpectedLastWriteTime,
+		Result_EnumPage* pResult) const;
+	SResult enumSubkeysFromOpenKey(
+		HKEY hKey,
+		DWORD dwStartIndex,
+		DWORD dwMaxCount,
+		const OnEnumSubkeyData& fOnEnumSubkeyData,
+		const FILETIME* pftExpectedLastWriteTime,
+		Result_EnumPage* pResult) const;
+
+	// Note: One query into the buffer, for a value whose size is (probably) known; on ERROR_MORE_DATA,
+	// dwDataSize_Result is the required size.
+	SResult readValueIntoBufferFromOpenKey(
+		HKEY hKey,
+		tzstring_view svzValueName,
+		DWORD& dwType_Result,
+		cpp::span<BYTE> spanBuffer,
+		DWORD& dwDataSize_Result) const;
+	// Note: Reads a REG_BINARY value into the vector; the first data query uses the vector's existing allocation (or the
+	// default buffer size), so the size is only queried for values larger than that
+	SResult readValueBinaryFromOpenKey(
+		HKEY hKey,
+		tzstring_view svzValueName,
+		std::vector<BYTE>& arrData) const;
+
+	// Note: Reads into the buffer if the value fits, else into the overflow vector; the result span refers to
+	// whichever was used.
+	SResult readValueBaseWithBuffer(
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName,
+		DWORD& dwType_Result,
+		cpp::span<BYTE> spanBuffer,
+		std::vector<BYTE>& arrOverflowData,
+		cpp::span<const BYTE>& spanData_Result) const;
 
 protected:
 	SResult openKey(
@@ -0,0 +1,427 @@
+#include "pch.h"
+#include "RegistryAccess_Async.h"
+
+#include <algorithm>
+
+#include "vlr-util/StringCompare.h"
+
+#include "AutoCleanupTypedefs.h"
+
+namespace vlr {
+
+namespace win32 {
+
+namespace {
+
+template <typename TValue, typename FConvert>
+auto MakeOnReadValueComplete(
+	std::shared_ptr<std::promise<CRegistryAccessAsync::AsyncResult<TValue>>> spPromise,
+	FConvert fConvert)
+{
+	return [spPromise, fConvert](const SResult& srResult, DWORD dwType, cpp::span<const BYTE> spanData)
+	{
+		auto oResult = CRegistryAccessAsync::AsyncResult<TValue>{};
+		oResult.m_sr = srResult;
+		if (srResult.isSuccess())
+		{
+			oResult.m_sr = fConvert(dwType, spanData, oResult.m_tValue);
+		}
+		spPromise->set_value(std::move(oResult));
+	};
+}
+
+} // namespace
+
+SResult CRegistryAccessAsync::Options_Request::CheckCanProceed() const
+{
+	if (m_oCancellationToken.has_value() && m_oCancellationToken->IsCancelled())
+	{
+		return SResult::For_win32_ErrorCode(ERROR_CANCELLED);
+	}
+	if (m_tpDeadline.has_value() && (std::chrono::steady_clock::now() >= m_tpDeadline.value()))
+	{
+		return SResult::For_win32_ErrorCode(ERROR_TIMEOUT);
+	}
+
+	return SResult::Success;
+}
+
+CRegistryAccessAsync::KeyBatch& CRegistryAccessAsync::getPendingBatchForKey(tzstring_view svzKeyName)
+{
+	// Note: Caller holds m_mutexDataAccess. The pending list only holds batches which no I/O thread has picked
+	// up yet, so this is typically short.
+	for (auto& oKeyBatch : m_dequePendingBatches)
+	{
+		if (StringCompare::CI().AreEqual(oKeyBatch.m_sKeyName, svzKeyName))
+		{
+			return oKeyBatch;
+		}
+	}
+
+	m_nBatchesQueued.fetch_add(1, std::memory_order_relaxed);
+	auto& oKeyBatch = m_dequePendingBatches.emplace_back();
+	oKeyBatch.m_sKeyName = vlr::tstring{ svzKeyName };
+	return oKeyBatch;
+}
+
+void CRegistryAccessAsync::queueReadValue(
+	tzstring_view svzKeyName,
+	tzstring_view svzValueName,
+	const Options_Request& options,
+	OnReadValueComplete fOnComplete)
+{
+	{
+		auto slDataAccess = std::scoped_lock{ m_mutexDataAccess };
+
+		m_nRequestsQueued.fetch_add(1, std::memory_order_relaxed);
+		auto& oKeyBatch = getPendingBatchForKey(svzKeyName);
+		oKeyBatch.m_arrReadValueRequests.push_back(PendingReadValue{ vlr::tstring{ svzValueName }, options, std::move(fOnComplete) });
+	}
+	m_cvPendingWork.notify_one();
+}
+
+void CRegistryAccessAsync::queueEnumAllValues(
+	tzstring_view svzKeyName,
+	const Options_Request& options,
+	OnEnumAllValuesComplete fOnComplete)
+{
+	{
+		auto slDataAccess = std::scoped_lock{ m_mutexDataAccess };
+
+		m_nRequestsQueued.fetch_add(1, std::memory_order_relaxed);
+		auto& oKeyBatch = getPendingBatchForKey(svzKeyName);
+		oKeyBatch.m_arrEnumAllValuesRequests.push_back(PendingEnumAllValues{ options, std::move(fOnComplete) });
+	}
+	m_cvPendingWork.notify_one();
+}
+
+void CRegistryAccessAsync::threadProc()
+{
+	while (true)
+	{
+		KeyBatch oKeyBatch;
+		{
+			auto ulDataAccess = std::unique_lock{ m_mutexDataAccess };
+			m_cvPendingWork.wait(ulDataAccess, [&] { return m_bShutdown || !m_dequePendingBatches.empty(); });
+			if (m_bShutdown)
+			{
+				return;
+			}
+
+			oKeyBatch = std::move(m_dequePendingBatches.front());
+			m_dequePendingBatches.pop_front();
+		}
+
+		processBatch(oKeyBatch);
+	}
+}
+
+void CRegistryAccessAsync::completeAllInBatch(
+	KeyBatch& oKeyBatch,
+	const SResult& srResult)
+{
+	for (auto& oRequest : oKeyBatch.m_arrReadValueRequests)
+	{
+		oRequest.m_fOnComplete(srResult, REG_NONE, {});
+	}
+	oKeyBatch.m_arrReadValueRequests.clear();
+	for (auto& oRequest : oKeyBatch.m_arrEnumAllValuesRequests)
+	{
+		oRequest.m_fOnComplete(srResult, {});
+	}
+	oKeyBatch.m_arrEnumAllValuesRequests.clear();
+}
+
+void CRegistryAccessAsync::processBatch(KeyBatch& oKeyBatch) const
+{
+	SResult sr;
+
+	// Note: Requests which have been cancelled or timed out while queued are completed first, so they do not
+	// keep the key open or force an enumeration.
+
+	auto fCompleteIfCannotProceed = [](auto& oRequest)
+	{
+		auto srCanProceed = oRequest.m_options.CheckCanProceed();
+		if (srCanProceed.isSuccess())
+		{
+			return false;
+		}
+		if constexpr (std::is_same_v<std::decay_t<decltype(oRequest)>, PendingReadValue>)
+		{
+			oRequest.m_fOnComplete(srCanProceed, REG_NONE, {});
+		}
+		else
+		{
+			oRequest.m_fOnComplete(srCanProceed, {});
+		}
+		return true;
+	};
+	auto& arrReadValueRequests = oKeyBatch.m_arrReadValueRequests;
+	arrReadValueRequests.erase(
+		std::remove_if(arrReadValueRequests.begin(), arrReadValueRequests.end(), fCompleteIfCannotProceed),
+		arrReadValueRequests.end());
+	auto& arrEnumAllValuesRequests = oKeyBatch.m_arrEnumAllValuesRequests;
+	arrEnumAllValuesRequests.erase(
+		std::remove_if(arrEnumAllValuesRequests.begin(), arrEnumAllValuesRequests.end(), fCompleteIfCannotProceed),
+		arrEnumAllValuesRequests.end());
+	if (arrReadValueRequests.empty() && arrEnumAllValuesRequests.empty())
+	{
+		return;
+	}
+
+	HKEY hKey{};
+	m_nKeyOpens.fetch_add(1, std::memory_order_relaxed);
+	sr = m_oRegistryAccess.OpenKey(oKeyBatch.m_sKeyName, KEY_READ, hKey);
+	if (!sr.isSuccess())
+	{
+		completeAllInBatch(oKeyBatch, sr);
+		return;
+	}
+	auto onDestroy_CloseRegKey = AutoCloseRegKey{ hKey };
+
+	if (arrEnumAllValuesRequests.empty())
+	{
+		// Note: No enumeration was requested, so each value is read directly from the shared open key
+		DWORD dwType{};
+		std::vector<BYTE> arrData;
+		for (auto& oRequest : arrReadValueRequests)
+		{
+			if (fCompleteIfCannotProceed(oRequest))
+			{
+				continue;
+			}
+
+			arrData.clear();
+			m_nValueQueries.fetch_add(1, std::memory_order_relaxed);
+			sr = m_oRegistryAccess.ReadValueBaseFromOpenKey(hKey, oRequest.m_sValueName, dwType, arrData);
+			oRequest.m_fOnComplete(sr, dwType, arrData);
+		}
+		return;
+	}
+
+	// Note: One enumeration serves all enumeration requests, and all value reads in the batch. Registry value
+	// names are case-insensitive, so reads are matched accordingly.
+
+	std::vector<bool> arrReadValueServed(arrReadValueRequests.size(), false);
+	std::unordered_map<vlr::tstring, ValueMapEntry> mapNameToValue;
+	auto fOnEnumValueData = [&](const CRegistryAccess::EnumValueData& oEnumValueData) -> SResult
+	{
+		for (size_t i = 0; i < arrReadValueRequests.size(); ++i)
+		{
+			if (arrReadValueServed[i])
+			{
+				continue;
+			}
+			if (!StringCompare::CI().AreEqual(arrReadValueRequests[i].m_sValueName, oEnumValueData.m_svName))
+			{
+				continue;
+			}
+			arrReadValueRequests[i].m_fOnComplete(SResult::Success, oEnumValueData.m_dwType, oEnumValueData.m_spanData);
+			arrReadValueServed[i] = true;
+		}
+
+		auto& oValueMapEntry = mapNameToValue[vlr::tstring{ oEnumValueData.m_svName }];
+		auto srPopulate = m_oRegistryAccess.populateValueMapEntryFromEnumValueData(oEnumValueData, oValueMapEntry);
+		VLR_ASSERT_SR_SUCCEEDED_OR_RETURN_SRESULT(srPopulate);
+
+		return SResult::Success;
+	};
+	m_nEnumerations.fetch_add(1, std::memory_order_relaxed);
+	sr = m_oRegistryAccess.EnumAllValuesFromOpenKey(hKey, fOnEnumValueData);
+
+	for (size_t i = 0; i < arrReadValueRequests.size(); ++i)
+	{
+		if (arrReadValueServed[i])
+		{
+			continue;
+		}
+		// Note: Same result as a direct query for a value which does not exist
+		auto srResult = sr.isSuccess() ? SResult::For_win32_ErrorCode(ERROR_FILE_NOT_FOUND) : sr;
+		arrReadValueRequests[i].m_fOnComplete(srResult, REG_NONE, {});
+	}
+
+	for (size_t i = 0; i < arrEnumAllValuesRequests.size(); ++i)
+	{
+		if (!sr.isSuccess())
+		{
+			arrEnumAllValuesRequests[i].m_fOnComplete(sr, {});
+			continue;
+		}
+		// Note: The last request takes ownership of the map, the others get a copy
+		bool bIsLastRequest = (i + 1 == arrEnumAllValuesRequests.size());
+		arrEnumAllValuesRequests[i].m_fOnComplete(sr, bIsLastRequest
+			? std::move(mapNameToValue)
+			: std::unordered_map<vlr::tstring, ValueMapEntry>{ mapNameToValue });
+	}
+}
+
+std::future<CRegistryAccessAsync::AsyncResult<CRegistryAccessAsync::ValueData>> CRegistryAccessAsync::ReadValueBase(
+	tzstring_view svzKeyName,
+	tzstring_view svzValueName,
+	const Options_Request& options /*= {}*/)
+{
+	auto spPromise = std::make_shared<std::promise<AsyncResult<ValueData>>>();
+	auto oFuture = spPromise->get_future();
+
+	queueReadValue(svzKeyName, svzValueName, options, MakeOnReadValueComplete<ValueData>(spPromise,
+		[](DWORD dwType, cpp::span<const BYTE> spanData, ValueData& oValueData) -> SResult
+	{
+		oValueData.m_dwType = dwType;
+		oValueData.m_arrData.assign(spanData.begin(), spanData.end());
+		return SResult::Success;
+	}));
+
+	return oFuture;
+}
+
+std::future<CRegistryAccessAsync::AsyncResult<vlr::tstring>> CRegistryAccessAsync::ReadValue_String(
+	tzstring_view svzKeyName,
+	tzstring_view svzValueName,
+	const Options_Request& options /*= {}*/)
+{
+	auto spPromise = std::make_shared<std::promise<AsyncResult<vlr::tstring>>>();
+	auto oFuture = spPromise->get_future();
+
+	queueReadValue(svzKeyName, svzValueName, options, MakeOnReadValueComplete<vlr::tstring>(spPromise,
+		[this](DWORD dwType, cpp::span<const BYTE> spanData, vlr::tstring& sValue)
+	{
+		return m_oRegistryAccess.convertRegDataToValue_String(dwType, spanData, sValue);
+	}));
+
+	return oFuture;
+}
+
+std::future<CRegistryAccessAsync::AsyncResult<DWORD>> CRegistryAccessAsync::ReadValue_DWORD(
+	tzstring_view svzKeyName,
+	tzstring_view svzValueName,
+	const Options_Request& options /*= {}*/)
+{
+	auto spPromise = std::make_shared<std::promise<AsyncResult<DWORD>>>();
+	auto oFuture = spPromise->get_future();
+
+	queueReadValue(svzKeyName, svzValueName, options, MakeOnReadValueComplete<DWORD>(spPromise,
+		[this](DWORD dwType, cpp::span<const BYTE> spanData, DWORD& dwValue)
+	{
+		return m_oRegistryAccess.convertRegDataToValue_DWORD(dwType, spanData, dwValue);
+	}));
+
+	return oFuture;
+}
+
+std::future<CRegistryAccessAsync::AsyncResult<CRegistryAccessAsync::QWORD>> CRegistryAccessAsync::ReadValue_QWORD(
+	tzstring_view svzKeyName,
+	tzstring_view svzValueName,
+	const Options_Request& options /*= {}*/)
+{
+	auto spPromise = std::make_shared<std::promise<AsyncResult<QWORD>>>();
+	auto oFuture = spPromise->get_future();
+
+	queueReadValue(svzKeyName, svzValueName, options, MakeOnReadValueComplete<QWORD>(spPromise,
+		[this](DWORD dwType, cpp::span<const BYTE> spanData, QWORD& qwValue)
+	{
+		return m_oRegistryAccess.convertRegDataToValue_QWORD(dwType, spanData, qwValue);
+	}));
+
+	return oFuture;
+}
+
+std::future<CRegistryAccessAsync::AsyncResult<std::vector<vlr::tstring>>> CRegistryAccessAsync::ReadValue_MultiSz(
+	tzstring_view svzKeyName,
+	tzstring_view svzValueName,
+	const Options_Request& options /*= {}*/)
+{
+	auto spPromise = std::make_shared<std::promise<AsyncResult<std::vector<vlr::tstring>>>>();
+	auto oFuture = spPromise->get_future();
+
+	queueReadValue(svzKeyName, svzValueName, options, MakeOnReadValueComplete<std::vector<vlr::tstring>>(spPromise,
+		[this](DWORD dwType, cpp::span<const BYTE> spanData, std::vector<vlr::tstring>& arrValueCollection)
+	{
+		return m_oRegistryAccess.convertRegDataToValue_MultiSz(dwType, spanData, arrValueCollection);
+	}));
+
+	return oFuture;
+}
+
+std::future<CRegistryAccessAsync::AsyncResult<std::vector<BYTE>>> CRegistryAccessAsync::ReadValue_Binary(
+	tzstring_view svzKeyName,
+	tzstring_view svzValueName,
+	const Options_Request& options /*= {}*/)
+{
+	auto spPromise = std::make_shared<std::promise<AsyncResult<std::vector<BYTE>>>>();
+	auto oFuture = spPromise->get_future();
+
+	queueReadValue(svzKeyName, svzValueName, options, MakeOnReadValueComplete<std::vector<BYTE>>(spPromise,
+		[this](DWORD dwType, cpp::span<const BYTE> spanData, std::vector<BYTE>& arrData)
+	{
+		return m_oRegistryAccess.convertRegDataToValue_Binary(dwType, spanData, arrData);
+	}));
+
+	return oFuture;
+}
+
+std::future<CRegistryAccessAsync::AsyncResult<std::unordered_map<vlr::tstring, CRegistryAccessAsync::ValueMapEntry>>> CRegistryAccessAsync::ReadAllValuesIntoMap(
+	tzstring_view svzKeyName,
+	const Options_Request& options /*= {}*/)
+{
+	using ResultType = AsyncResult<std::unordered_map<vlr::tstring, ValueMapEntry>>;
+
+	auto spPromise = std::make_shared<std::promise<ResultType>>();
+	auto oFuture = spPromise->get_future();
+
+	queueEnumAllValues(svzKeyName, options,
+		[spPromise](const SResult& srResult, std::unordered_map<vlr::tstring, ValueMapEntry>&& mapNameToValue)
+	{
+		auto oResult = ResultType{};
+		oResult.m_sr = srResult;
+		oResult.m_tValue = std::move(mapNameToValue);
+		spPromise->set_value(std::move(oResult));
+	});
+
+	return oFuture;
+}
+
+CRegistryAccessAsync::Stats CRegistryAccessAsync::GetStats() const
+{
+	auto oStats = Stats{};
+	oStats.m_nRequestsQueued = m_nRequestsQueued.load(std::memory_order_relaxed);
+	oStats.m_nBatchesQueued = m_nBatchesQueued.load(std::memory_order_relaxed);
+	oStats.m_nKeyOpens = m_nKeyOpens.load(std::memory_order_relaxed);
+	oStats.m_nValueQueries = m_nValueQueries.load(std::memory_order_relaxed);
+	oStats.m_nEnumerations = m_nEnumerations.load(std::memory_order_relaxed);
+	return oStats;
+}
+
+CRegistryAccessAsync::CRegistryAccessAsync(const CRegistryAccess& oRegistryAccess, const Options_Async& options /*= {}*/)
+	: m_oRegistryAccess{ oRegistryAccess }
+{
+	auto nThreadCount = (std::max)(options.m_nThreadCount, size_t{ 1 });
+	m_arrThreads.reserve(nThreadCount);
+	for (size_t i = 0; i < nThreadCount; ++i)
+	{
+		m_arrThreads.emplace_back([this] { threadProc(); });
+	}
+}
+
+CRegistryAccessAsync::~CRegistryAccessAsync()
+{
+	{
+		auto slDataAccess = std::scoped_lock{ m_mutexDataAccess };
+		m_bShutdown = true;
+	}
+	m_cvPendingWork.notify_all();
+
+	for (auto& oThread : m_arrThreads)
+	{
+		oThread.join();
+	}
+
+	for (auto& oKeyBatch : m_dequePendingBatches)
+	{
+		completeAllInBatch(oKeyBatch, SResult::For_win32_ErrorCode(ERROR_OPERATION_ABORTED));
+	}
+	m_dequePendingBatches.clear();
+}
+
+} // namespace win32
+
+} // namespace vlr
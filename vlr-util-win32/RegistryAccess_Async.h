@@ -0,0 +1,216 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <vlr-util/util.includes.h>
+#include <vlr-util/util.Result.h>
+#include <vlr-util/zstring_view.h>
+
+#include "RegistryAccess.h"
+
+namespace vlr {
+
+namespace win32 {
+
+// Asynchronous (future-returning) reads on top of CRegistryAccess. Requests are executed on a dedicated pool of
+// I/O threads owned by the instance, so callers can overlap registry reads with other work.
+// Concurrent requests for the same key which are pending at the same time are grouped into one batch: the key is
+// opened once for the batch, and if the batch includes an enumeration, all value reads in the batch are served
+// from that single enumeration.
+// Results are delivered as SResult in the result structure (not as exceptions). A request which is cancelled,
+// or whose deadline passes before it is served, completes with ERROR_CANCELLED / ERROR_TIMEOUT respectively.
+
+class CRegistryAccessAsync
+{
+public:
+	using QWORD = CRegistryAccess::QWORD;
+	using ValueMapEntry = CRegistryAccess::ValueMapEntry;
+
+	// Note: Copies share state; cancelling any copy cancels all requests which were given the token.
+	class CCancellationToken
+	{
+	protected:
+		std::shared_ptr<std::atomic<bool>> m_spCancelled = std::make_shared<std::atomic<bool>>(false);
+
+	public:
+		inline void Cancel()
+		{
+			m_spCancelled->store(true, std::memory_order_relaxed);
+		}
+		inline bool IsCancelled() const
+		{
+			return m_spCancelled->load(std::memory_order_relaxed);
+		}
+	};
+
+	struct Options_Request
+	{
+		std::optional<CCancellationToken> m_oCancellationToken;
+		std::optional<std::chrono::steady_clock::time_point> m_tpDeadline;
+
+		decltype(auto) withCancellationToken(const CCancellationToken& oCancellationToken)
+		{
+			m_oCancellationToken = oCancellationToken;
+			return *this;
+		}
+		decltype(auto) withDeadline(std::chrono::steady_clock::time_point tpDeadline)
+		{
+			m_tpDeadline = tpDeadline;
+			return *this;
+		}
+		template <typename TRep, typename TPeriod>
+		decltype(auto) withTimeout(std::chrono::duration<TRep, TPeriod> durationTimeout)
+		{
+			m_tpDeadline = std::chrono::steady_clock::now() + durationTimeout;
+			return *this;
+		}
+
+		// Returns success if the request should still be served, else the cancellation/timeout result
+		SResult CheckCanProceed() const;
+	};
+
+	template <typename TValue>
+	struct AsyncResult
+	{
+		SResult m_sr;
+		TValue m_tValue{};
+	};
+
+	struct ValueData
+	{
+		DWORD m_dwType{};
+		std::vector<BYTE> m_arrData;
+	};
+
+	struct Stats
+	{
+		size_t m_nRequestsQueued{};
+		// Note: Each request either starts a batch or joins the batch pending for its key
+		size_t m_nBatchesQueued{};
+		// Note: Underlying registry operations; batching makes these fewer than the requests served
+		size_t m_nKeyOpens{};
+		size_t m_nValueQueries{};
+		size_t m_nEnumerations{};
+	};
+
+	struct Options_Async
+	{
+		size_t m_nThreadCount = 2;
+
+		decltype(auto) withThreadCount(size_t nThreadCount)
+		{
+			m_nThreadCount = nThreadCount;
+			return *this;
+		}
+	};
+
+protected:
+	// Note: Called exactly once per request, on an I/O thread
+	using OnReadValueComplete = std::function<void(const SResult& srResult, DWORD dwType, cpp::span<const BYTE> spanData)>;
+	using OnEnumAllValuesComplete = std::function<void(const SResult& srResult, std::unordered_map<vlr::tstring, ValueMapEntry>&& mapNameToValue)>;
+
+	struct PendingReadValue
+	{
+		vlr::tstring m_sValueName;
+		Options_Request m_options;
+		OnReadValueComplete m_fOnComplete;
+	};
+	struct PendingEnumAllValues
+	{
+		Options_Request m_options;
+		OnEnumAllValuesComplete m_fOnComplete;
+	};
+	struct KeyBatch
+	{
+		vlr::tstring m_sKeyName;
+		std::vector<PendingReadValue> m_arrReadValueRequests;
+		std::vector<PendingEnumAllValues> m_arrEnumAllValuesRequests;
+	};
+
+	const CRegistryAccess& m_oRegistryAccess;
+
+	std::mutex m_mutexDataAccess;
+	std::condition_variable m_cvPendingWork;
+	std::deque<KeyBatch> m_dequePendingBatches;
+	bool m_bShutdown = false;
+
+	std::vector<std::thread> m_arrThreads;
+
+	std::atomic<size_t> m_nRequestsQueued{};
+	std::atomic<size_t> m_nBatchesQueued{};
+	mutable std::atomic<size_t> m_nKeyOpens{};
+	mutable std::atomic<size_t> m_nValueQueries{};
+	mutable std::atomic<size_t> m_nEnumerations{};
+
+protected:
+	void queueReadValue(
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName,
+		const Options_Request& options,
+		OnReadValueComplete fOnComplete);
+	void queueEnumAllValues(
+		tzstring_view svzKeyName,
+		const Options_Request& options,
+		OnEnumAllValuesComplete fOnComplete);
+	KeyBatch& getPendingBatchForKey(tzstring_view svzKeyName);
+
+	void threadProc();
+	void processBatch(KeyBatch& oKeyBatch) const;
+	static void completeAllInBatch(
+		KeyBatch& oKeyBatch,
+		const SResult& srResult);
+
+public:
+	std::future<AsyncResult<ValueData>> ReadValueBase(
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName,
+		const Options_Request& options = {});
+	std::future<AsyncResult<vlr::tstring>> ReadValue_String(
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName,
+		const Options_Request& options = {});
+	std::future<AsyncResult<DWORD>> ReadValue_DWORD(
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName,
+		const Options_Request& options = {});
+	std::future<AsyncResult<QWORD>> ReadValue_QWORD(
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName,
+		const Options_Request& options = {});
+	std::future<AsyncResult<std::vector<vlr::tstring>>> ReadValue_MultiSz(
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName,
+		const Options_Request& options = {});
+	std::future<AsyncResult<std::vector<BYTE>>> ReadValue_Binary(
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName,
+		const Options_Request& options = {});
+
+	// Note: Equivalent of CRegistryAccess::RealAllValuesIntoMap
+	std::future<AsyncResult<std::unordered_map<vlr::tstring, ValueMapEntry>>> ReadAllValuesIntoMap(
+		tzstring_view svzKeyName,
+		const Options_Request& options = {});
+
+	Stats GetStats() const;
+
+public:
+	// Note: The registry access instance is referenced (not copied, so a derived instance is used as-is); it must
+	// outlive this instance, and not be modified while requests may be in progress.
+	CRegistryAccessAsync(const CRegistryAccess& oRegistryAccess, const Options_Async& options = {});
+	CRegistryAccessAsync(const CRegistryAccessAsync&) = delete;
+	// Note: Waits for in-progress batches; requests still pending complete with ERROR_OPERATION_ABORTED.
+	~CRegistryAccessAsync();
+};
+
+} // namespace win32
+
+} // namespace vlr
@@ -0,0 +1,301 @@
+#include "pch.h"
+#include "RegistryAccess_Atomic.h"
+
+#include <array>
+#include <mutex>
+
+#include <vlr-util/ActionOnDestruction.h>
+
+#include "AutoCleanupTypedefs.h"
+#include "strings.CaseFold.h"
+
+namespace vlr {
+
+namespace win32 {
+
+namespace {
+
+// Note: Shared by all instances, so that instances for the same value are serialized with each other
+constexpr size_t nLockStripeCount = 64;
+std::array<std::mutex, nLockStripeCount> g_arrLockStripes;
+
+// Note: 64-bit in all processes, so that 32-bit and 64-bit processes derive the same cross-process lock name
+uint64_t GetHashForValue(vlr::tstring_view svKeyName, vlr::tstring_view svValueName)
+{
+	auto nHash = strings::Hash64_CaseInsensitive(svKeyName);
+	nHash ^= strings::Hash64_CaseInsensitive(svValueName) + 0x9E3779B97F4A7C15ULL + (nHash << 6) + (nHash >> 2);
+	return nHash;
+}
+
+vlr::tstring FormatCrossProcessLockName(vlr::tstring_view svLockNamePrefix, uint64_t nHash)
+{
+	return fmt::format(_T("{}.{:016X}"), svLockNamePrefix, nHash);
+}
+
+} // namespace
+
+template <typename TValue, typename FUpdate>
+SResult CRegistryAccessAtomic::updateValue(
+	tzstring_view svzKeyName,
+	tzstring_view svzValueName,
+	const FUpdate& fUpdate,
+	TValue* ptValue_Result)
+{
+	static_assert(std::is_same_v<TValue, DWORD> || std::is_same_v<TValue, QWORD>);
+
+	SResult sr;
+
+	m_nOperations.fetch_add(1, std::memory_order_relaxed);
+
+	auto nHash = GetHashForValue(svzKeyName, svzValueName);
+
+	auto& oLockStripe = g_arrLockStripes[nHash % nLockStripeCount];
+	auto ulLockStripe = std::unique_lock{ oLockStripe, std::try_to_lock };
+	if (!ulLockStripe.owns_lock())
+	{
+		m_nContendedOperations.fetch_add(1, std::memory_order_relaxed);
+		ulLockStripe.lock();
+	}
+
+	HANDLE hCrossProcessLock{};
+	bool bOwnsCrossProcessLock = false;
+	auto oOnDestroy_ReleaseCrossProcessLock = MakeActionOnDestruction([&] {
+		if (bOwnsCrossProcessLock)
+		{
+			::ReleaseMutex(hCrossProcessLock);
+		}
+		if (hCrossProcessLock)
+		{
+			::CloseHandle(hCrossProcessLock);
+		}
+	});
+	if (m_options.m_bUseCrossProcessLock)
+	{
+		auto sLockName = FormatCrossProcessLockName(m_options.m_sCrossProcessLockNamePrefix, nHash);
+
+		hCrossProcessLock = ::CreateMutex(NULL, FALSE, sLockName.c_str());
+		if (!hCrossProcessLock)
+		{
+			return SResult::For_win32_ErrorCode(::GetLastError());
+		}
+
+		auto dwWaitResult = ::WaitForSingleObject(hCrossProcessLock, 0);
+		if (dwWaitResult == WAIT_TIMEOUT)
+		{
+			m_nCrossProcessWaits.fetch_add(1, std::memory_order_relaxed);
+			dwWaitResult = ::WaitForSingleObject(hCrossProcessLock, m_options.m_dwCrossProcessLockTimeoutMs);
+		}
+		switch (dwWaitResult)
+		{
+		case WAIT_OBJECT_0:
+		// Note: The previous owner exited without releasing; each registry write is atomic, so the value is
+		// still consistent.
+		case WAIT_ABANDONED:
+			bOwnsCrossProcessLock = true;
+			break;
+		case WAIT_TIMEOUT:
+			return SResult::For_win32_ErrorCode(ERROR_TIMEOUT);
+		default:
+			return SResult::For_win32_ErrorCode(::GetLastError());
+		}
+	}
+
+	HKEY hKey{};
+	sr = m_oRegistryAccess.OpenKey(svzKeyName, KEY_QUERY_VALUE | KEY_SET_VALUE, hKey);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hKey);
+	auto onDestroy_CloseRegKey = AutoCloseRegKey{ hKey };
+
+	std::optional<TValue> oCurrentValue;
+	{
+		DWORD dwType{};
+		std::vector<BYTE> arrData;
+		sr = m_oRegistryAccess.ReadValueBaseFromOpenKey(hKey, svzValueName, dwType, arrData);
+		if (sr.isSuccess())
+		{
+			TValue tValue{};
+			if constexpr (std::is_same_v<TValue, DWORD>)
+			{
+				sr = m_oRegistryAccess.convertRegDataToValue_DWORD(dwType, arrData, tValue);
+			}
+			else
+			{
+				sr = m_oRegistryAccess.convertRegDataToValue_QWORD(dwType, arrData, tValue);
+			}
+			VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+			oCurrentValue = tValue;
+		}
+		else if (sr.asHRESULT() == __HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND))
+		{
+			if (!m_options.m_bTreatMissingValueAsZero)
+			{
+				return sr;
+			}
+		}
+		else
+		{
+			return sr;
+		}
+	}
+
+	TValue tNewValue{};
+	bool bWriteValue = fUpdate(oCurrentValue, tNewValue);
+	if (!bWriteValue)
+	{
+		if (ptValue_Result)
+		{
+			*ptValue_Result = oCurrentValue.value_or(TValue{});
+		}
+		return SResult::Success_NoWorkDone;
+	}
+
+	{
+		DWORD dwType{};
+		std::vector<BYTE> arrData;
+		if constexpr (std::is_same_v<TValue, DWORD>)
+		{
+			sr = m_oRegistryAccess.convertValueToRegData_DWORD(tNewValue, dwType, arrData);
+		}
+		else
+		{
+			sr = m_oRegistryAccess.convertValueToRegData_QWORD(tNewValue, dwType, arrData);
+		}
+		VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+		sr = m_oRegistryAccess.WriteValueBaseToOpenKey(hKey, svzValueName, dwType, arrData);
+		VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	}
+
+	if (ptValue_Result)
+	{
+		*ptValue_Result = tNewValue;
+	}
+
+	return SResult::Success;
+}
+
+SResult CRegistryAccessAtomic::Update_DWORD(
+	tzstring_view svzKeyName,
+	tzstring_view svzValueName,
+	const OnUpdate_DWORD& fOnUpdate,
+	DWORD* pdwValue_Result /*= nullptr*/)
+{
+	return updateValue<DWORD>(svzKeyName, svzValueName, fOnUpdate, pdwValue_Result);
+}
+
+SResult CRegistryAccessAtomic::Update_QWORD(
+	tzstring_view svzKeyName,
+	tzstring_view svzValueName,
+	const OnUpdate_QWORD& fOnUpdate,
+	QWORD* pqwValue_Result /*= nullptr*/)
+{
+	return updateValue<QWORD>(svzKeyName, svzValueName, fOnUpdate, pqwValue_Result);
+}
+
+SResult CRegistryAccessAtomic::CompareExchange_DWORD(
+	tzstring_view svzKeyName,
+	tzstring_view svzValueName,
+	DWORD dwExpectedValue,
+	DWORD dwDesiredValue,
+	DWORD& dwOriginalValue)
+{
+	auto fUpdate = [&](std::optional<DWORD> oCurrentValue, DWORD& dwNewValue)
+	{
+		dwOriginalValue = oCurrentValue.value_or(0);
+		dwNewValue = dwDesiredValue;
+		return (dwOriginalValue == dwExpectedValue);
+	};
+	return updateValue<DWORD>(svzKeyName, svzValueName, fUpdate, nullptr);
+}
+
+SResult CRegistryAccessAtomic::CompareExchange_QWORD(
+	tzstring_view svzKeyName,
+	tzstring_view svzValueName,
+	QWORD qwExpectedValue,
+	QWORD qwDesiredValue,
+	QWORD& qwOriginalValue)
+{
+	auto fUpdate = [&](std::optional<QWORD> oCurrentValue, QWORD& qwNewValue)
+	{
+		qwOriginalValue = oCurrentValue.value_or(0);
+		qwNewValue = qwDesiredValue;
+		return (qwOriginalValue == qwExpectedValue);
+	};
+	return updateValue<QWORD>(svzKeyName, svzValueName, fUpdate, nullptr);
+}
+
+SResult CRegistryAccessAtomic::Add_DWORD(
+	tzstring_view svzKeyName,
+	tzstring_view svzValueName,
+	DWORD dwDelta,
+	DWORD* pdwNewValue /*= nullptr*/)
+{
+	auto fUpdate = [&](std::optional<DWORD> oCurrentValue, DWORD& dwNewValue)
+	{
+		dwNewValue = oCurrentValue.value_or(0) + dwDelta;
+		return true;
+	};
+	return updateValue<DWORD>(svzKeyName, svzValueName, fUpdate, pdwNewValue);
+}
+
+SResult CRegistryAccessAtomic::Add_QWORD(
+	tzstring_view svzKeyName,
+	tzstring_view svzValueName,
+	QWORD qwDelta,
+	QWORD* pqwNewValue /*= nullptr*/)
+{
+	auto fUpdate = [&](std::optional<QWORD> oCurrentValue, QWORD& qwNewValue)
+	{
+		qwNewValue = oCurrentValue.value_or(0) + qwDelta;
+		return true;
+	};
+	return updateValue<QWORD>(svzKeyName, svzValueName, fUpdate, pqwNewValue);
+}
+
+SResult CRegistryAccessAtomic::Max_DWORD(
+	tzstring_view svzKeyName,
+	tzstring_view svzValueName,
+	DWORD dwCandidateValue,
+	DWORD* pdwNewValue /*= nullptr*/)
+{
+	auto fUpdate = [&](std::optional<DWORD> oCurrentValue, DWORD& dwNewValue)
+	{
+		dwNewValue = dwCandidateValue;
+		return !oCurrentValue.has_value() || (oCurrentValue.value() < dwCandidateValue);
+	};
+	return updateValue<DWORD>(svzKeyName, svzValueName, fUpdate, pdwNewValue);
+}
+
+SResult CRegistryAccessAtomic::Max_QWORD(
+	tzstring_view svzKeyName,
+	tzstring_view svzValueName,
+	QWORD qwCandidateValue,
+	QWORD* pqwNewValue /*= nullptr*/)
+{
+	auto fUpdate = [&](std::optional<QWORD> oCurrentValue, QWORD& qwNewValue)
+	{
+		qwNewValue = qwCandidateValue;
+		return !oCurrentValue.has_value() || (oCurrentValue.value() < qwCandidateValue);
+	};
+	return updateValue<QWORD>(svzKeyName, svzValueName, fUpdate, pqwNewValue);
+}
+
+vlr::tstring CRegistryAccessAtomic::GetCrossProcessLockName(
+	vlr::tstring_view svKeyName,
+	vlr::tstring_view svValueName) const
+{
+	return FormatCrossProcessLockName(m_options.m_sCrossProcessLockNamePrefix, GetHashForValue(svKeyName, svValueName));
+}
+
+CRegistryAccessAtomic::Stats CRegistryAccessAtomic::GetStats() const
+{
+	auto oStats = Stats{};
+	oStats.m_nOperations = m_nOperations.load(std::memory_order_relaxed);
+	oStats.m_nContendedOperations = m_nContendedOperations.load(std::memory_order_relaxed);
+	oStats.m_nCrossProcessWaits = m_nCrossProcessWaits.load(std::memory_order_relaxed);
+	return oStats;
+}
+
+} // namespace win32
+
+} // namespace vlr
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <optional>
+
+#include <vlr-util/util.includes.h>
+#include <vlr-util/util.Result.h>
+#include <vlr-util/zstring_view.h>
+
+#include "RegistryAccess.h"
+
+namespace vlr {
+
+namespace win32 {
+
+// Read-modify-write operations on DWORD/QWORD registry values (eg: persisted counters), which do not lose updates
+// when called concurrently.
+// Within the process, each operation holds one of a fixed set of locks, selected by a (case-insensitive) hash of
+// the key path and value name; the lock set is shared by all instances, so unrelated values rarely contend, and
+// the same value is always serialized. Optionally, each operation also holds a named mutex (derived from the same
+// hash), so that processes which use the same lock name prefix are serialized as well. The base key is not part of
+// the hash; a shared lock for values under different base keys only costs some extra serialization.
+// Note: Only writers which use this class are coordinated; plain writes through CRegistryAccess are not.
+
+class CRegistryAccessAtomic
+{
+public:
+	using QWORD = CRegistryAccess::QWORD;
+
+	struct Options_Atomic
+	{
+		// Note: A value which does not exist is treated as 0 (and created by the operation); otherwise the
+		// operation fails with ERROR_FILE_NOT_FOUND
+		bool m_bTreatMissingValueAsZero = true;
+		bool m_bUseCrossProcessLock = false;
+		vlr::tstring m_sCrossProcessLockNamePrefix = _T("Local\\vlr-registry-atomic");
+		// Note: Fails with ERROR_TIMEOUT if the cross-process lock is not acquired within the timeout
+		DWORD m_dwCrossProcessLockTimeoutMs = INFINITE;
+
+		decltype(auto) withTreatMissingValueAsZero(bool bTreatMissingValueAsZero)
+		{
+			m_bTreatMissingValueAsZero = bTreatMissingValueAsZero;
+			return *this;
+		}
+		decltype(auto) withCrossProcessLock(vlr::tstring_view svLockNamePrefix, DWORD dwTimeoutMs = INFINITE)
+		{
+			m_bUseCrossProcessLock = true;
+			m_sCrossProcessLockNamePrefix = vlr::tstring{ svLockNamePrefix };
+			m_dwCrossProcessLockTimeoutMs = dwTimeoutMs;
+			return *this;
+		}
+	};
+
+	struct Stats
+	{
+		size_t m_nOperations{};
+		// Note: Operations which found their in-process lock held by another thread, and had to wait
+		size_t m_nContendedOperations{};
+		// Note: Operations which found the cross-process lock held (by any thread or process), and had to wait
+		size_t m_nCrossProcessWaits{};
+	};
+
+	// Called with the current value (if it exists); return true and set the new value to write it, or false to
+	// leave the value unchanged.
+	using OnUpdate_DWORD = std::function<bool(std::optional<DWORD> oCurrentValue, DWORD& dwNewValue)>;
+	using OnUpdate_QWORD = std::function<bool(std::optional<QWORD> oCurrentValue, QWORD& qwNewValue)>;
+
+protected:
+	CRegistryAccess m_oRegistryAccess;
+	Options_Atomic m_options;
+
+	std::atomic<size_t> m_nOperations{};
+	std::atomic<size_t> m_nContendedOperations{};
+	std::atomic<size_t> m_nCrossProcessWaits{};
+
+protected:
+	template <typename TValue, typename FUpdate>
+	SResult updateValue(
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName,
+		const FUpdate& fUpdate,
+		TValue* ptValue_Result);
+
+public:
+	// Note: Returns Success_NoWorkDone if the callback left the value unchanged. The result value is the value
+	// in the registry after the operation.
+	SResult Update_DWORD(
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName,
+		const OnUpdate_DWORD& fOnUpdate,
+		DWORD* pdwValue_Result = nullptr);
+	SResult Update_QWORD(
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName,
+		const OnUpdate_QWORD& fOnUpdate,
+		QWORD* pqwValue_Result = nullptr);
+
+	// Writes the desired value only if the current value equals the expected value. Returns Success if the value
+	// was written, or Success_NoWorkDone if not; either way, the original value is returned.
+	SResult CompareExchange_DWORD(
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName,
+		DWORD dwExpectedValue,
+		DWORD dwDesiredValue,
+		DWORD& dwOriginalValue);
+	SResult CompareExchange_QWORD(
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName,
+		QWORD qwExpectedValue,
+		QWORD qwDesiredValue,
+		QWORD& qwOriginalValue);
+
+	// Note: Wraps on overflow, like an unsigned integer
+	SResult Add_DWORD(
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName,
+		DWORD dwDelta,
+		DWORD* pdwNewValue = nullptr);
+	SResult Add_QWORD(
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName,
+		QWORD qwDelta,
+		QWORD* pqwNewValue = nullptr);
+
+	// Note: Returns Success_NoWorkDone if the current value was already at least the candidate value
+	SResult Max_DWORD(
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName,
+		DWORD dwCandidateValue,
+		DWORD* pdwNewValue = nullptr);
+	SResult Max_QWORD(
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName,
+		QWORD qwCandidateValue,
+		QWORD* pqwNewValue = nullptr);
+
+	// Note: The name of the named mutex used for the value in cross-process lock mode; the same in 32-bit and 64-bit
+	// processes.
+	vlr::tstring GetCrossProcessLockName(
+		vlr::tstring_view svKeyName,
+		vlr::tstring_view svValueName) const;
+
+	Stats GetStats() const;
+
+public:
+	CRegistryAccessAtomic(const CRegistryAccess& oRegistryAccess, const Options_Atomic& options = {})
+		: m_oRegistryAccess{ oRegistryAccess }
+		, m_options{ options }
+	{}
+};
+
+} // namespace win32
+
+} // namespace vlr
@@ -0,0 +1,390 @@
+#include "pch.h"
+#include "RegistryAccess_CopyTree.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+
+#include <vlr-util/ActionOnDestruction.h>
+#include <vlr-util/util.convert.StringConversion.h>
+
+#include "AutoCleanupTypedefs.h"
+#include "RegistryAccess_DualView.h"
+#include "strings.CaseFold.h"
+
+namespace vlr {
+
+namespace win32 {
+
+namespace {
+
+using unordered_set_CaseInsensitive = std::unordered_set<vlr::tstring, strings::hash_CaseInsensitive<TCHAR>, strings::equal_to_CaseInsensitive<TCHAR>>;
+
+inline vlr::tstring MakeSubkeyPath(vlr::tstring_view svKeyPath, vlr::tstring_view svSubkeyName)
+{
+	auto sSubkeyPath = vlr::tstring{ svKeyPath };
+	if (!sSubkeyPath.empty())
+	{
+		sSubkeyPath += _T('\\');
+	}
+	sSubkeyPath += svSubkeyName;
+	return sSubkeyPath;
+}
+
+// Note: True if svKeyPath is svRootPath, or is under it
+template <typename TChar>
+inline bool IsKeyPathUnderRoot(std::basic_string_view<TChar> svKeyPath, std::basic_string_view<TChar> svRootPath)
+{
+	if (svRootPath.empty())
+	{
+		return true;
+	}
+	if (!strings::HasPrefix_CaseInsensitive(svKeyPath, svRootPath))
+	{
+		return false;
+	}
+	return (svKeyPath.size() == svRootPath.size()) || (svKeyPath[svRootPath.size()] == TChar{ '\\' });
+}
+
+// Returns the kernel name of the key the path resolves to, in the access instance's base key and view. If the key
+// does not exist, this is the name of its nearest existing ancestor with the rest of the path appended (ie: where
+// the key would be created).
+SResult GetResolvedKeyName(
+	const CRegistryAccess& oRegistryAccess,
+	vlr::tstring_view svKeyPath,
+	std::wstring& swResolvedKeyName)
+{
+	SResult sr;
+
+	auto svExistingPath = svKeyPath;
+	while (true)
+	{
+		HKEY hKey{};
+		sr = oRegistryAccess.OpenKey(vlr::tstring{ svExistingPath }, KEY_QUERY_VALUE, hKey);
+		if (sr.isSuccess())
+		{
+			VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hKey);
+			auto onDestroy_CloseRegKey = AutoCloseRegKey{ hKey };
+			sr = CRegistryAccessDualView::GetKernelKeyName(hKey, swResolvedKeyName);
+			VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+			break;
+		}
+		if ((sr.asHRESULT() != __HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND)) || svExistingPath.empty())
+		{
+			return sr;
+		}
+		auto nSeparatorIndex = svExistingPath.find_last_of(_T('\\'));
+		svExistingPath = (nSeparatorIndex == vlr::tstring_view::npos)
+			? vlr::tstring_view{}
+			: svExistingPath.substr(0, nSeparatorIndex);
+	}
+
+	auto svMissingPath = svKeyPath.substr(svExistingPath.size());
+	if (!svMissingPath.empty())
+	{
+		if (svMissingPath.front() != _T('\\'))
+		{
+			swResolvedKeyName += L'\\';
+		}
+		swResolvedKeyName += util::Convert::ToStdStringW(svMissingPath);
+	}
+
+	return SResult::Success;
+}
+
+} // namespace
+
+struct CRegistryAccessCopyTree::Pipeline
+{
+	std::mutex m_mutexDataAccess;
+	std::condition_variable m_cvBatchQueued;
+	std::condition_variable m_cvBatchTaken;
+	std::deque<KeyBatch> m_dequeBatches;
+	size_t m_nQueuedBytes{};
+	size_t m_nKeysSkipped{};
+	bool m_bReaderDone = false;
+	bool m_bStop = false;
+	// Note: Set if the reader stopped on a failure
+	SResult m_srReader;
+};
+
+SResult CRegistryAccessCopyTree::readKeyBatch(
+	const vlr::tstring& sSourceRootPath,
+	KeyBatch& oKeyBatch,
+	std::vector<vlr::tstring>& arrSubkeyPaths) const
+{
+	SResult sr;
+
+	HKEY hKey{};
+	sr = m_oRegistryAccess_Source.OpenKey(MakeSubkeyPath(sSourceRootPath, oKeyBatch.m_sKeyPath), KEY_READ, hKey);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hKey);
+	auto onDestroy_CloseRegKey = AutoCloseRegKey{ hKey };
+
+	sr = m_oRegistryAccess_Source.EnumAllValuesFromOpenKey(hKey, [&](const CRegistryAccess::EnumValueData& oEnumValueData)
+	{
+		auto& oValueCopy = oKeyBatch.m_arrValues.emplace_back();
+		oValueCopy.m_sName = vlr::tstring{ oEnumValueData.m_svName };
+		oValueCopy.m_dwType = oEnumValueData.m_dwType;
+		oValueCopy.m_arrData.assign(oEnumValueData.m_spanData.begin(), oEnumValueData.m_spanData.end());
+		oKeyBatch.m_nDataSize += oValueCopy.m_arrData.size();
+		return SResult::Success;
+	});
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	sr = m_oRegistryAccess_Source.EnumAllSubkeysFromOpenKey(hKey, [&](const CRegistryAccess::EnumSubkeyData& oEnumSubkeyData)
+	{
+		arrSubkeyPaths.push_back(MakeSubkeyPath(oKeyBatch.m_sKeyPath, oEnumSubkeyData.m_svName));
+		return SResult::Success;
+	});
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	return SResult::Success;
+}
+
+void CRegistryAccessCopyTree::readerThreadProc(
+	Pipeline& oPipeline,
+	const vlr::tstring& sSourceRootPath,
+	const Options_CopyTree& options) const
+{
+	SResult sr;
+
+	auto oOnDestroy_SignalDone = MakeActionOnDestruction([&] {
+		{
+			auto slDataAccess = std::scoped_lock{ oPipeline.m_mutexDataAccess };
+			oPipeline.m_bReaderDone = true;
+		}
+		oPipeline.m_cvBatchQueued.notify_all();
+	});
+
+	// Note: Depth-first, so each key is queued before its subkeys (and the destination parent exists first)
+	std::vector<vlr::tstring> arrPendingKeyPaths;
+	arrPendingKeyPaths.emplace_back();
+	std::vector<vlr::tstring> arrSubkeyPaths;
+
+	while (!arrPendingKeyPaths.empty())
+	{
+		auto oKeyBatch = KeyBatch{};
+		oKeyBatch.m_sKeyPath = std::move(arrPendingKeyPaths.back());
+		arrPendingKeyPaths.pop_back();
+		bool bIsRoot = oKeyBatch.m_sKeyPath.empty();
+
+		arrSubkeyPaths.clear();
+		sr = readKeyBatch(sSourceRootPath, oKeyBatch, arrSubkeyPaths);
+		if (!sr.isSuccess())
+		{
+			auto slDataAccess = std::scoped_lock{ oPipeline.m_mutexDataAccess };
+			if (bIsRoot || !CRegistryAccess::IsSkippableResultForWalk(sr))
+			{
+				oPipeline.m_srReader = sr;
+				return;
+			}
+			++oPipeline.m_nKeysSkipped;
+			continue;
+		}
+		// Note: Pushed in reverse, so that subkeys are copied in enumeration order
+		for (auto iterSubkeyPath = arrSubkeyPaths.rbegin(); iterSubkeyPath != arrSubkeyPaths.rend(); ++iterSubkeyPath)
+		{
+			arrPendingKeyPaths.push_back(std::move(*iterSubkeyPath));
+		}
+
+		{
+			auto ulDataAccess = std::unique_lock{ oPipeline.m_mutexDataAccess };
+			oPipeline.m_cvBatchTaken.wait(ulDataAccess, [&] {
+				return false
+					|| oPipeline.m_bStop
+					|| oPipeline.m_dequeBatches.empty()
+					|| ((oPipeline.m_dequeBatches.size() < options.m_nMaxQueuedKeys) && (oPipeline.m_nQueuedBytes < options.m_nMaxQueuedBytes));
+			});
+			if (oPipeline.m_bStop)
+			{
+				return;
+			}
+			oPipeline.m_nQueuedBytes += oKeyBatch.m_nDataSize;
+			oPipeline.m_dequeBatches.push_back(std::move(oKeyBatch));
+		}
+		oPipeline.m_cvBatchQueued.notify_one();
+	}
+}
+
+SResult CRegistryAccessCopyTree::writeKeyBatch(
+	const vlr::tstring& sDestRootPath,
+	const KeyBatch& oKeyBatch,
+	const Options_CopyTree& options,
+	Result_CopyTree& oResult) const
+{
+	SResult sr;
+
+	HKEY hKey{};
+	DWORD dwDisposition{};
+	sr = m_oRegistryAccess_Dest.CreateOrOpenKey(MakeSubkeyPath(sDestRootPath, oKeyBatch.m_sKeyPath), KEY_QUERY_VALUE | KEY_SET_VALUE, hKey, &dwDisposition);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hKey);
+	auto onDestroy_CloseRegKey = AutoCloseRegKey{ hKey };
+
+	bool bKeyCreated = (dwDisposition == REG_CREATED_NEW_KEY);
+	if (bKeyCreated)
+	{
+		++oResult.m_nKeysCreated;
+	}
+
+	// Note: A new key has no values, so the existing value names are only needed for an existing key
+	unordered_set_CaseInsensitive setExistingValueNames;
+	if (!bKeyCreated && (options.m_ePolicy != RegistryAccess::CopyTreePolicy::Merge))
+	{
+		sr = m_oRegistryAccess_Dest.EnumAllValuesFromOpenKey(hKey, [&](const CRegistryAccess::EnumValueData& oEnumValueData)
+		{
+			setExistingValueNames.emplace(oEnumValueData.m_svName);
+			return SResult::Success;
+		});
+		VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	}
+
+	for (const auto& oValueCopy : oKeyBatch.m_arrValues)
+	{
+		if (options.m_ePolicy == RegistryAccess::CopyTreePolicy::SkipExisting)
+		{
+			if (setExistingValueNames.find(oValueCopy.m_sName) != setExistingValueNames.end())
+			{
+				++oResult.m_nValuesSkipped;
+				continue;
+			}
+		}
+		else if (options.m_ePolicy == RegistryAccess::CopyTreePolicy::Overwrite)
+		{
+			// Note: What remains after the writes is the set of destination values to delete
+			setExistingValueNames.erase(oValueCopy.m_sName);
+		}
+
+		sr = m_oRegistryAccess_Dest.WriteValueBaseToOpenKey(hKey, oValueCopy.m_sName, oValueCopy.m_dwType, oValueCopy.m_arrData);
+		VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+		++oResult.m_nValuesWritten;
+		oResult.m_nBytesWritten += oValueCopy.m_arrData.size();
+	}
+
+	if (options.m_ePolicy == RegistryAccess::CopyTreePolicy::Overwrite)
+	{
+		for (const auto& sValueName : setExistingValueNames)
+		{
+			sr = m_oRegistryAccess_Dest.DeleteValueFromOpenKey(hKey, sValueName);
+			if (sr.asHRESULT() == __HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND))
+			{
+				continue;
+			}
+			VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+			++oResult.m_nValuesDeleted;
+		}
+	}
+
+	++oResult.m_nKeysCopied;
+
+	return SResult::Success;
+}
+
+SResult CRegistryAccessCopyTree::CopyTree(
+	tzstring_view svzSourceKeyPath,
+	tzstring_view svzDestKeyPath,
+	const Options_CopyTree& options /*= {}*/,
+	Result_CopyTree* pResult /*= nullptr*/) const
+{
+	SResult sr;
+
+	// Note: The source and destination may be the same key under different paths, base keys or views (eg: a key
+	// which is shared between the 32-bit and 64-bit views), so the keys the paths resolve to are compared.
+	std::wstring swResolvedSourceKeyName;
+	std::wstring swResolvedDestKeyName;
+	sr = GetResolvedKeyName(m_oRegistryAccess_Source, svzSourceKeyPath, swResolvedSourceKeyName);
+	if (sr.isSuccess())
+	{
+		sr = GetResolvedKeyName(m_oRegistryAccess_Dest, svzDestKeyPath, swResolvedDestKeyName);
+	}
+	if (sr.isSuccess())
+	{
+		if (IsKeyPathUnderRoot<wchar_t>(swResolvedDestKeyName, swResolvedSourceKeyName))
+		{
+			return E_INVALIDARG;
+		}
+	}
+	else
+	{
+		// Note: The keys could not be resolved (eg: access denied on an ancestor); compare the paths, if in the
+		// same base key and view
+		bool bSameRegistryView = true
+			&& (m_oRegistryAccess_Source.GetBaseKey() == m_oRegistryAccess_Dest.GetBaseKey())
+			&& (static_cast<RegistryAccess::Wow64KeyAccessOption>(m_oRegistryAccess_Source.GetWow64KeyAccessOption())
+				== static_cast<RegistryAccess::Wow64KeyAccessOption>(m_oRegistryAccess_Dest.GetWow64KeyAccessOption()));
+		if (bSameRegistryView && IsKeyPathUnderRoot<TCHAR>(svzDestKeyPath, svzSourceKeyPath))
+		{
+			return E_INVALIDARG;
+		}
+	}
+
+	auto oOptions = options;
+	oOptions.m_nMaxQueuedKeys = (std::max)(oOptions.m_nMaxQueuedKeys, size_t{ 1 });
+
+	auto sSourceRootPath = vlr::tstring{ svzSourceKeyPath };
+	auto sDestRootPath = vlr::tstring{ svzDestKeyPath };
+
+	auto oResult = Result_CopyTree{};
+	auto oPipeline = Pipeline{};
+
+	auto threadReader = std::thread{ [&] { readerThreadProc(oPipeline, sSourceRootPath, oOptions); } };
+	auto oOnDestroy_StopReader = MakeActionOnDestruction([&] {
+		{
+			auto slDataAccess = std::scoped_lock{ oPipeline.m_mutexDataAccess };
+			oPipeline.m_bStop = true;
+		}
+		oPipeline.m_cvBatchTaken.notify_all();
+		threadReader.join();
+	});
+
+	while (true)
+	{
+		auto oKeyBatch = KeyBatch{};
+		{
+			auto ulDataAccess = std::unique_lock{ oPipeline.m_mutexDataAccess };
+			oPipeline.m_cvBatchQueued.wait(ulDataAccess, [&] {
+				return oPipeline.m_bReaderDone || !oPipeline.m_dequeBatches.empty();
+			});
+			oResult.m_nKeysSkipped = oPipeline.m_nKeysSkipped;
+			if (oPipeline.m_dequeBatches.empty())
+			{
+				// Note: The reader is done, and everything it read has been written
+				sr = oPipeline.m_srReader;
+				break;
+			}
+			oKeyBatch = std::move(oPipeline.m_dequeBatches.front());
+			oPipeline.m_dequeBatches.pop_front();
+			oPipeline.m_nQueuedBytes -= oKeyBatch.m_nDataSize;
+		}
+		oPipeline.m_cvBatchTaken.notify_one();
+
+		sr = writeKeyBatch(sDestRootPath, oKeyBatch, oOptions, oResult);
+		if (!sr.isSuccess())
+		{
+			break;
+		}
+
+		if (oOptions.m_fOnProgress)
+		{
+			sr = oOptions.m_fOnProgress(oKeyBatch.m_sKeyPath, oResult);
+			if (!sr.isSuccess())
+			{
+				break;
+			}
+		}
+	}
+
+	if (pResult)
+	{
+		*pResult = oResult;
+	}
+
+	return sr.isSet() ? sr : SResult::Success;
+}
+
+} // namespace win32
+
+} // namespace vlr
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include <vlr-util/util.includes.h>
+#include <vlr-util/util.Result.h>
+#include <vlr-util/zstring_view.h>
+
+#include "RegistryAccess.h"
+
+namespace vlr {
+
+namespace win32 {
+
+namespace RegistryAccess {
+
+enum class CopyTreePolicy
+{
+	// Source values replace destination values of the same name, and destination values which are not in the
+	// source key are deleted, so each copied key ends up with exactly the source key's values.
+	Overwrite,
+	// Source values replace destination values of the same name; other destination values are kept.
+	Merge,
+	// Destination values which already exist are left unchanged; only missing values are written.
+	SkipExisting,
+};
+
+} // namespace RegistryAccess
+
+// Copies a registry subtree (keys and values) from one CRegistryAccess to another; the two may differ in base key
+// and in WOW64 view (eg: to migrate settings from the 32-bit view to the 64-bit view).
+// Each source key is opened and enumerated once, and all of its values are written through one open destination
+// key handle. Reading and writing are pipelined: source keys are read on a background thread into a bounded
+// queue, while the calling thread writes the keys already read.
+// Note: Destination keys which are not in the source are never deleted (under any policy). Source keys which
+// cannot be read (eg: access denied, or deleted during the copy) are skipped, along with their subtree.
+
+class CRegistryAccessCopyTree
+{
+public:
+	struct Result_CopyTree
+	{
+		size_t m_nKeysCopied{};
+		size_t m_nKeysCreated{};
+		size_t m_nKeysSkipped{};
+		size_t m_nValuesWritten{};
+		size_t m_nValuesSkipped{};
+		size_t m_nValuesDeleted{};
+		size_t m_nBytesWritten{};
+	};
+	// Called after each key is copied, with the key path (relative to the source root) and the totals so far.
+	// Note: Returning failure stops the copy, and the failure is returned from CopyTree.
+	using OnProgress = std::function<SResult(vlr::tstring_view svKeyPath, const Result_CopyTree& oResultSoFar)>;
+
+	struct Options_CopyTree
+	{
+		RegistryAccess::CopyTreePolicy m_ePolicy = RegistryAccess::CopyTreePolicy::Merge;
+		OnProgress m_fOnProgress;
+		// Note: Bounds for keys read but not yet written; a single key larger than the byte limit is still queued
+		size_t m_nMaxQueuedKeys = 64;
+		size_t m_nMaxQueuedBytes = 4 * 1024 * 1024;
+
+		decltype(auto) withPolicy(RegistryAccess::CopyTreePolicy ePolicy)
+		{
+			m_ePolicy = ePolicy;
+			return *this;
+		}
+		decltype(auto) withProgress(OnProgress fOnProgress)
+		{
+			m_fOnProgress = std::move(fOnProgress);
+			return *this;
+		}
+		decltype(auto) withQueueLimits(size_t nMaxQueuedKeys, size_t nMaxQueuedBytes)
+		{
+			m_nMaxQueuedKeys = nMaxQueuedKeys;
+			m_nMaxQueuedBytes = nMaxQueuedBytes;
+			return *this;
+		}
+	};
+
+protected:
+	struct ValueCopy
+	{
+		vlr::tstring m_sName;
+		DWORD m_dwType{};
+		std::vector<BYTE> m_arrData;
+	};
+	struct KeyBatch
+	{
+		// Note: Relative to the source / destination root; empty for the root itself
+		vlr::tstring m_sKeyPath;
+		std::vector<ValueCopy> m_arrValues;
+		size_t m_nDataSize{};
+	};
+	struct Pipeline;
+
+	CRegistryAccess m_oRegistryAccess_Source;
+	CRegistryAccess m_oRegistryAccess_Dest;
+
+protected:
+	void readerThreadProc(
+		Pipeline& oPipeline,
+		const vlr::tstring& sSourceRootPath,
+		const Options_CopyTree& options) const;
+	SResult readKeyBatch(
+		const vlr::tstring& sSourceRootPath,
+		KeyBatch& oKeyBatch,
+		std::vector<vlr::tstring>& arrSubkeyPaths) const;
+	SResult writeKeyBatch(
+		const vlr::tstring& sDestRootPath,
+		const KeyBatch& oKeyBatch,
+		const Options_CopyTree& options,
+		Result_CopyTree& oResult) const;
+
+public:
+	// Note: Fails with E_INVALIDARG if the destination is the source key or is under it, since the copy would then
+	// read its own output. This compares the underlying keys, so also covers a key reached through different base
+	// keys or views (eg: a key shared between the 32-bit and 64-bit views). Returns the reader's failure if the
+	// source root cannot be read.
+	SResult CopyTree(
+		tzstring_view svzSourceKeyPath,
+		tzstring_view svzDestKeyPath,
+		const Options_CopyTree& options = {},
+		Result_CopyTree* pResult = nullptr) const;
+
+public:
+	// Note: The registry access instances are copied; the base keys must remain open for the life of this instance.
+	CRegistryAccessCopyTree(const CRegistryAccess& oRegistryAccess_Source, const CRegistryAccess& oRegistryAccess_Dest)
+		: m_oRegistryAccess_Source{ oRegistryAccess_Source }
+		, m_oRegistryAccess_Dest{ oRegistryAccess_Dest }
+	{}
+};
+
+} // namespace win32
+
+} // namespace vlr
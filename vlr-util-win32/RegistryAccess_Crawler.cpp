@@ -0,0 +1,473 @@
+#include "pch.h"
+#include "RegistryAccess_Crawler.h"
+
+#include <vlr-util/util.range_checked_cast.h>
+
+#include "AutoCleanupTypedefs.h"
+#include "filesystem.Functions.h"
+#include "registry.ContentHash.h"
+#include "registry.KeyHandle.h"
+#include "serialization.BinaryStream.h"
+
+namespace vlr {
+
+namespace win32 {
+
+namespace {
+
+static constexpr uint32_t CheckpointFile_Signature = 0x4B434C56; // "VLCK"
+static constexpr uint32_t CheckpointFile_Version = 1;
+// Note: Deeper than the registry allows; guards against recursion on a malformed file
+static constexpr size_t CheckpointFile_MaxKeyDepth = 1024;
+
+inline ULONGLONG ToULL(const FILETIME& ft)
+{
+	return (static_cast<ULONGLONG>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+}
+
+inline vlr::tstring MakeSubkeyPath(vlr::tstring_view svKeyPath, vlr::tstring_view svSubkeyName)
+{
+	auto sSubkeyPath = vlr::tstring{ svKeyPath };
+	if (!sSubkeyPath.empty())
+	{
+		sSubkeyPath += _T('\\');
+	}
+	sSubkeyPath += svSubkeyName;
+	return sSubkeyPath;
+}
+
+} // namespace
+
+void CRegistryAccessCrawler::collectSubtreeKeyPaths(
+	const vlr::tstring& sKeyPath,
+	std::vector<vlr::tstring>& arrKeyPaths) const
+{
+	arrKeyPaths.push_back(sKeyPath);
+
+	auto iterState = m_mapKeyPathToState.find(sKeyPath);
+	if (iterState == m_mapKeyPathToState.end())
+	{
+		return;
+	}
+	for (const auto& sSubkeyName : iterState->second.m_arrSubkeyNames)
+	{
+		collectSubtreeKeyPaths(MakeSubkeyPath(sKeyPath, sSubkeyName), arrKeyPaths);
+	}
+}
+
+SResult CRegistryAccessCrawler::visitKey(
+	const PendingKey& oPendingKey,
+	const OnCrawlChange& fOnCrawlChange,
+	const Options_Crawl& options,
+	ULONGLONG nRecentWriteThreshold,
+	Result_Crawl& oResult)
+{
+	SResult sr;
+
+	++oResult.m_nKeysVisited;
+
+	const auto& sKeyPath = oPendingKey.m_sKeyPath;
+	auto iterState_Previous = m_mapKeyPathToState.find(sKeyPath);
+	const KeyState* pKeyState_Previous = (iterState_Previous != m_mapKeyPathToState.end()) ? &iterState_Previous->second : nullptr;
+	bool bKeyChanged = false
+		|| !pKeyState_Previous
+		|| (ToULL(pKeyState_Previous->m_ftLastWriteTime) == 0)
+		|| (::CompareFileTime(&pKeyState_Previous->m_ftLastWriteTime, &oPendingKey.m_ftLastWriteTime) != 0);
+
+	HKEY hKey{};
+	sr = m_oRegistryAccess.OpenKey(sKeyPath, KEY_READ, hKey);
+	if (!sr.isSuccess())
+	{
+		if (!CRegistryAccess::IsSkippableResultForWalk(sr))
+		{
+			return sr;
+		}
+		// Note: A key deleted since its parent was enumerated is reported as removed when the parent is next visited
+		++oResult.m_nKeysSkipped;
+		return SResult::Success;
+	}
+	auto onDestroy_CloseRegKey = AutoCloseRegKey{ hKey };
+
+	struct ChangeToReport
+	{
+		RegistryAccess::CrawlChangeKind m_eChangeKind{};
+		vlr::tstring m_sKeyPath;
+	};
+	std::vector<ChangeToReport> arrChangesToReport;
+
+	KeyState oKeyState;
+	oKeyState.m_ftLastWriteTime = oPendingKey.m_ftLastWriteTime;
+	oKeyState.m_nContentHash = pKeyState_Previous ? pKeyState_Previous->m_nContentHash : 0;
+
+	if (bKeyChanged)
+	{
+		++oResult.m_nKeysValuesRead;
+
+		auto nContentHash = registry::ContentHash_OffsetBasis;
+		sr = m_oRegistryAccess.EnumAllValuesFromOpenKey(hKey, [&](const CRegistryAccess::EnumValueData& oEnumValueData) -> SResult
+		{
+			auto nDataSize = static_cast<uint64_t>(oEnumValueData.m_spanData.size());
+			nContentHash = registry::UpdateContentHash(nContentHash, reinterpret_cast<const BYTE*>(oEnumValueData.m_svName.data()), oEnumValueData.m_svName.size() * sizeof(TCHAR));
+			nContentHash = registry::UpdateContentHash(nContentHash, reinterpret_cast<const BYTE*>(&oEnumValueData.m_dwType), sizeof(oEnumValueData.m_dwType));
+			nContentHash = registry::UpdateContentHash(nContentHash, reinterpret_cast<const BYTE*>(&nDataSize), sizeof(nDataSize));
+			nContentHash = registry::UpdateContentHash(nContentHash, oEnumValueData.m_spanData.data(), oEnumValueData.m_spanData.size());
+			return SResult::Success;
+		});
+		if (sr.isSuccess())
+		{
+			if (!pKeyState_Previous)
+			{
+				arrChangesToReport.push_back(ChangeToReport{ RegistryAccess::CrawlChangeKind::KeyAdded, sKeyPath });
+			}
+			else if (nContentHash != pKeyState_Previous->m_nContentHash)
+			{
+				arrChangesToReport.push_back(ChangeToReport{ RegistryAccess::CrawlChangeKind::ValuesChanged, sKeyPath });
+			}
+			oKeyState.m_nContentHash = nContentHash;
+		}
+		else
+		{
+			if (!CRegistryAccess::IsSkippableResultForWalk(sr))
+			{
+				return sr;
+			}
+			// Note: Keep the previous hash, and re-read on the next crawl
+			++oResult.m_nKeysSkipped;
+			oKeyState.m_ftLastWriteTime = {};
+		}
+	}
+
+	// Note: The write time has coarse granularity, so a write landing in the same tick as a very recent write
+	// would not change it; do not trust very recent times for the next crawl (same as the index refresh).
+	if (ToULL(oKeyState.m_ftLastWriteTime) >= nRecentWriteThreshold)
+	{
+		oKeyState.m_ftLastWriteTime = {};
+	}
+
+	// Note: Subkeys are always enumerated, since their write times are how changes below this key are found; in
+	// pruning mode, only the subkeys whose write time changed are visited (see below).
+	struct SubkeyInfo
+	{
+		vlr::tstring m_sName;
+		FILETIME m_ftLastWriteTime{};
+	};
+	std::vector<SubkeyInfo> arrSubkeys;
+	bool bSubkeysEnumerated = true;
+	sr = m_oRegistryAccess.EnumAllSubkeysFromOpenKey(hKey, [&](const CRegistryAccess::EnumSubkeyData& oEnumSubkeyData) -> SResult
+	{
+		arrSubkeys.push_back(SubkeyInfo{ vlr::tstring{ oEnumSubkeyData.m_svName }, oEnumSubkeyData.m_ftLastWriteTime });
+		return SResult::Success;
+	});
+	if (!sr.isSuccess())
+	{
+		if (!CRegistryAccess::IsSkippableResultForWalk(sr))
+		{
+			return sr;
+		}
+		++oResult.m_nKeysSkipped;
+		bSubkeysEnumerated = false;
+		oKeyState.m_ftLastWriteTime = {};
+	}
+
+	std::vector<vlr::tstring> arrKeyPaths_Removed;
+	if (bSubkeysEnumerated)
+	{
+		oKeyState.m_arrSubkeyNames.reserve(arrSubkeys.size());
+		for (const auto& oSubkeyInfo : arrSubkeys)
+		{
+			oKeyState.m_arrSubkeyNames.push_back(oSubkeyInfo.m_sName);
+		}
+
+		if (pKeyState_Previous)
+		{
+			auto mapSubkeyNames = strings::unordered_map_CaseInsensitive<bool>{};
+			for (const auto& sSubkeyName : oKeyState.m_arrSubkeyNames)
+			{
+				mapSubkeyNames.emplace(sSubkeyName, true);
+			}
+			for (const auto& sSubkeyName_Previous : pKeyState_Previous->m_arrSubkeyNames)
+			{
+				if (mapSubkeyNames.find(sSubkeyName_Previous) == mapSubkeyNames.end())
+				{
+					collectSubtreeKeyPaths(MakeSubkeyPath(sKeyPath, sSubkeyName_Previous), arrKeyPaths_Removed);
+				}
+			}
+			for (const auto& sKeyPath_Removed : arrKeyPaths_Removed)
+			{
+				arrChangesToReport.push_back(ChangeToReport{ RegistryAccess::CrawlChangeKind::KeyRemoved, sKeyPath_Removed });
+			}
+		}
+	}
+	else if (pKeyState_Previous)
+	{
+		oKeyState.m_arrSubkeyNames = pKeyState_Previous->m_arrSubkeyNames;
+	}
+
+	// Note: Changes are reported before any state is updated, so if the callback stops the crawl, this key is
+	// visited (and its changes reported) again when the crawl resumes.
+	for (const auto& oChangeToReport : arrChangesToReport)
+	{
+		auto oCrawlChange = CrawlChange{};
+		oCrawlChange.m_eChangeKind = oChangeToReport.m_eChangeKind;
+		oCrawlChange.m_svKeyPath = oChangeToReport.m_sKeyPath;
+		sr = fOnCrawlChange(oCrawlChange);
+		VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+		++oResult.m_nChangesReported;
+	}
+
+	for (const auto& sKeyPath_Removed : arrKeyPaths_Removed)
+	{
+		m_mapKeyPathToState.erase(sKeyPath_Removed);
+	}
+
+	// Note: Pushed in reverse, so subkeys are visited in enumeration order
+	for (auto iterSubkey = arrSubkeys.rbegin(); bSubkeysEnumerated && (iterSubkey != arrSubkeys.rend()); ++iterSubkey)
+	{
+		auto sSubkeyPath = MakeSubkeyPath(sKeyPath, iterSubkey->m_sName);
+		if (options.m_eCrawlMode == RegistryAccess::CrawlMode::PruneUnchangedSubtrees)
+		{
+			auto iterState_Subkey = m_mapKeyPathToState.find(sSubkeyPath);
+			if ((iterState_Subkey != m_mapKeyPathToState.end())
+				&& (ToULL(iterState_Subkey->second.m_ftLastWriteTime) != 0)
+				&& (::CompareFileTime(&iterState_Subkey->second.m_ftLastWriteTime, &iterSubkey->m_ftLastWriteTime) == 0))
+			{
+				++oResult.m_nKeysPruned;
+				continue;
+			}
+		}
+		m_arrPendingKeys.push_back(PendingKey{ std::move(sSubkeyPath), iterSubkey->m_ftLastWriteTime });
+	}
+
+	m_mapKeyPathToState[sKeyPath] = std::move(oKeyState);
+
+	return SResult::Success;
+}
+
+SResult CRegistryAccessCrawler::Crawl(
+	const OnCrawlChange& fOnCrawlChange,
+	const Options_Crawl& options /*= {}*/,
+	Result_Crawl* pResult /*= nullptr*/)
+{
+	SResult sr;
+
+	Result_Crawl oResult_Local;
+	auto& oResult = pResult ? *pResult : oResult_Local;
+	oResult = {};
+
+	auto fSaveCheckpoint = [&]() -> SResult
+	{
+		if (options.m_sCheckpointFilePath.empty())
+		{
+			return SResult::Success_NoWorkDone;
+		}
+		return SaveCheckpoint(options.m_sCheckpointFilePath);
+	};
+
+	if (m_arrPendingKeys.empty())
+	{
+		CRegistryAccess::KeyInfo oKeyInfo;
+		sr = m_oRegistryAccess.ReadKeyInfo(m_sRootKeyPath, oKeyInfo);
+		VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+		m_arrPendingKeys.push_back(PendingKey{ m_sRootKeyPath, oKeyInfo.m_ftLastWriteTime });
+	}
+
+	static constexpr ULONGLONG nRecentWriteWindow_100ns = 2ULL * 10 * 1000 * 1000;
+	FILETIME ftNow{};
+	::GetSystemTimeAsFileTime(&ftNow);
+	auto nRecentWriteThreshold = ToULL(ftNow) - nRecentWriteWindow_100ns;
+
+	size_t nKeysSinceCheckpoint = 0;
+	while (!m_arrPendingKeys.empty())
+	{
+		if (oResult.m_nKeysVisited >= options.m_nMaxKeysToVisit)
+		{
+			sr = fSaveCheckpoint();
+			VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+			return SResult::Success_WithNuance;
+		}
+
+		auto oPendingKey = std::move(m_arrPendingKeys.back());
+		m_arrPendingKeys.pop_back();
+
+		sr = visitKey(oPendingKey, fOnCrawlChange, options, nRecentWriteThreshold, oResult);
+		if (!sr.isSuccess())
+		{
+			m_arrPendingKeys.push_back(std::move(oPendingKey));
+			// Note: The visit failure is the more useful result; the checkpoint save is best-effort here
+			fSaveCheckpoint();
+			return sr;
+		}
+
+		if ((options.m_nCheckpointIntervalKeys > 0) && (++nKeysSinceCheckpoint >= options.m_nCheckpointIntervalKeys))
+		{
+			sr = fSaveCheckpoint();
+			VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+			nKeysSinceCheckpoint = 0;
+		}
+	}
+
+	oResult.m_bCompleted = true;
+
+	sr = fSaveCheckpoint();
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	return SResult::Success;
+}
+
+SResult CRegistryAccessCrawler::SaveCheckpoint(
+	tzstring_view svzFilePath) const
+{
+	serialization::CBinaryWriter oWriter;
+
+	oWriter.Write(CheckpointFile_Signature);
+	oWriter.Write(CheckpointFile_Version);
+	oWriter.Write(static_cast<uint32_t>(sizeof(TCHAR)));
+	oWriter.Write(registry::GetPersistentBaseKeyId(m_oRegistryAccess.GetBaseKey()));
+	oWriter.WriteString<TCHAR>(m_sRootKeyPath);
+
+	// Note: Keys are written as a tree (name only, followed by subkeys), so paths are not repeated for each key.
+	// A key which has not been visited yet (eg: a new subkey still pending) is written without state.
+	std::function<void(const vlr::tstring&, vlr::tstring_view)> fWriteKey;
+	fWriteKey = [&](const vlr::tstring& sKeyPath, vlr::tstring_view svKeyName)
+	{
+		oWriter.WriteString<TCHAR>(svKeyName);
+
+		auto iterState = m_mapKeyPathToState.find(sKeyPath);
+		bool bHasState = (iterState != m_mapKeyPathToState.end());
+		oWriter.Write(static_cast<uint8_t>(bHasState ? 1 : 0));
+		if (!bHasState)
+		{
+			return;
+		}
+
+		const auto& oKeyState = iterState->second;
+		oWriter.Write(oKeyState.m_ftLastWriteTime);
+		oWriter.Write(oKeyState.m_nContentHash);
+		oWriter.Write(util::range_checked_cast<uint32_t>(oKeyState.m_arrSubkeyNames.size()));
+		for (const auto& sSubkeyName : oKeyState.m_arrSubkeyNames)
+		{
+			fWriteKey(MakeSubkeyPath(sKeyPath, sSubkeyName), sSubkeyName);
+		}
+	};
+	fWriteKey(m_sRootKeyPath, {});
+
+	oWriter.Write(util::range_checked_cast<uint32_t>(m_arrPendingKeys.size()));
+	for (const auto& oPendingKey : m_arrPendingKeys)
+	{
+		oWriter.WriteString<TCHAR>(oPendingKey.m_sKeyPath);
+		oWriter.Write(oPendingKey.m_ftLastWriteTime);
+	}
+
+	const auto& arrData = oWriter.GetData();
+	return filesystem::WriteFileContents(svzFilePath, arrData.data(), arrData.size());
+}
+
+SResult CRegistryAccessCrawler::LoadCheckpoint(
+	tzstring_view svzFilePath)
+{
+	SResult sr;
+
+	std::vector<BYTE> arrData;
+	sr = filesystem::ReadFileContents(svzFilePath, arrData);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	static const auto srBadFormat = SResult::For_win32_ErrorCode(ERROR_BAD_FORMAT);
+	serialization::CBinaryReader oReader{ arrData };
+
+	uint32_t nSignature{};
+	uint32_t nVersion{};
+	uint32_t nCharSize{};
+	uint64_t nBaseKeyId{};
+	vlr::tstring sRootKeyPath;
+	if (false
+		|| !oReader.Read(nSignature).isSuccess()
+		|| !oReader.Read(nVersion).isSuccess()
+		|| !oReader.Read(nCharSize).isSuccess()
+		|| (nSignature != CheckpointFile_Signature)
+		|| (nVersion != CheckpointFile_Version)
+		|| (nCharSize != sizeof(TCHAR))
+		|| !oReader.Read(nBaseKeyId).isSuccess()
+		|| !oReader.ReadString(sRootKeyPath).isSuccess())
+	{
+		return srBadFormat;
+	}
+	auto nBaseKeyId_Current = registry::GetPersistentBaseKeyId(m_oRegistryAccess.GetBaseKey());
+	if (((nBaseKeyId != 0) && (nBaseKeyId_Current != 0) && (nBaseKeyId != nBaseKeyId_Current))
+		|| !strings::AreEqual_CaseInsensitive<TCHAR>(sRootKeyPath, m_sRootKeyPath))
+	{
+		return SResult::For_win32_ErrorCode(ERROR_INVALID_DATA);
+	}
+
+	strings::unordered_map_CaseInsensitive<KeyState> mapKeyPathToState;
+	std::function<bool(const vlr::tstring&, size_t)> fReadKey;
+	fReadKey = [&](const vlr::tstring& sKeyPath, size_t nDepth)
+	{
+		uint8_t nHasState{};
+		if ((nDepth > CheckpointFile_MaxKeyDepth) || !oReader.Read(nHasState).isSuccess())
+		{
+			return false;
+		}
+		if (nHasState == 0)
+		{
+			return true;
+		}
+
+		KeyState oKeyState;
+		uint32_t nSubkeyCount{};
+		if (false
+			|| !oReader.Read(oKeyState.m_ftLastWriteTime).isSuccess()
+			|| !oReader.Read(oKeyState.m_nContentHash).isSuccess()
+			|| !oReader.Read(nSubkeyCount).isSuccess()
+			|| (nSubkeyCount > oReader.GetRemainingSize()))
+		{
+			return false;
+		}
+		oKeyState.m_arrSubkeyNames.resize(nSubkeyCount);
+		for (auto& sSubkeyName : oKeyState.m_arrSubkeyNames)
+		{
+			if (!oReader.ReadString(sSubkeyName).isSuccess()
+				|| !fReadKey(MakeSubkeyPath(sKeyPath, sSubkeyName), nDepth + 1))
+			{
+				return false;
+			}
+		}
+		mapKeyPathToState[sKeyPath] = std::move(oKeyState);
+		return true;
+	};
+	vlr::tstring sRootKeyName;
+	if (!oReader.ReadString(sRootKeyName).isSuccess()
+		|| !fReadKey(m_sRootKeyPath, 0))
+	{
+		return srBadFormat;
+	}
+
+	uint32_t nPendingKeyCount{};
+	if (!oReader.Read(nPendingKeyCount).isSuccess()
+		|| (nPendingKeyCount > oReader.GetRemainingSize()))
+	{
+		return srBadFormat;
+	}
+	std::vector<PendingKey> arrPendingKeys(nPendingKeyCount);
+	for (auto& oPendingKey : arrPendingKeys)
+	{
+		if (!oReader.ReadString(oPendingKey.m_sKeyPath).isSuccess()
+			|| !oReader.Read(oPendingKey.m_ftLastWriteTime).isSuccess())
+		{
+			return srBadFormat;
+		}
+	}
+	if (!oReader.IsAtEnd())
+	{
+		return srBadFormat;
+	}
+
+	m_mapKeyPathToState = std::move(mapKeyPathToState);
+	m_arrPendingKeys = std::move(arrPendingKeys);
+
+	return SResult::Success;
+}
+
+} // namespace win32
+
+} // namespace vlr
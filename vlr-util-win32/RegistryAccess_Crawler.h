@@ -0,0 +1,163 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include <vlr-util/util.includes.h>
+#include <vlr-util/util.Result.h>
+#include <vlr-util/zstring_view.h>
+
+#include "RegistryAccess.h"
+#include "strings.CaseFold.h"
+
+namespace vlr {
+
+namespace win32 {
+
+namespace RegistryAccess {
+
+enum class CrawlMode
+{
+	// Every key is visited (subkeys are enumerated), but values are only re-read for keys whose last write time
+	// changed. Detects all changes.
+	ReadChangedKeysOnly,
+	// Subkeys are enumerated for each visited key, but only visited if their own last write time changed (or they
+	// are new); values of unchanged keys are not re-read. Cost is proportional to churn, but a key's last write time
+	// does not change when only its descendants change, so changes more than one level below an unchanged key are
+	// not detected until that key itself is written.
+	PruneUnchangedSubtrees,
+};
+
+enum class CrawlChangeKind
+{
+	KeyAdded,
+	ValuesChanged,
+	KeyRemoved,
+};
+
+} // namespace RegistryAccess
+
+// Incremental crawl of a registry subtree, which reports keys which were added, removed, or whose values changed
+// since the previous crawl.
+// State from the previous crawl (last write time and content hash of each key's values, and its subkey names) is
+// kept as a checkpoint, which can be saved to / loaded from a file. A crawl which is stopped (by the callback
+// failing, a key limit, or the process exiting) keeps its list of pending keys in the checkpoint, and the next
+// call to Crawl resumes from there rather than starting over. Changes are reported at least once: keys visited
+// after the last saved checkpoint may be reported again after a resume.
+// Note: The first crawl (with no checkpoint) reports every key as added.
+
+class CRegistryAccessCrawler
+{
+public:
+	struct CrawlChange
+	{
+		RegistryAccess::CrawlChangeKind m_eChangeKind = RegistryAccess::CrawlChangeKind::KeyAdded;
+		// Note: Relative to the base key
+		vlr::tstring_view m_svKeyPath;
+	};
+	// Note: Returning failure stops the crawl (resumably); the change is reported again when the crawl resumes.
+	using OnCrawlChange = std::function<SResult(const CrawlChange& oCrawlChange)>;
+
+	struct Options_Crawl
+	{
+		RegistryAccess::CrawlMode m_eCrawlMode = RegistryAccess::CrawlMode::ReadChangedKeysOnly;
+		// Note: If set, the checkpoint is saved to this file every m_nCheckpointIntervalKeys keys, and when the
+		// crawl completes or stops
+		vlr::tstring m_sCheckpointFilePath;
+		size_t m_nCheckpointIntervalKeys = 1000;
+		// Note: The crawl stops (resumably) after visiting this many keys
+		size_t m_nMaxKeysToVisit = SIZE_MAX;
+
+		decltype(auto) withCrawlMode(RegistryAccess::CrawlMode eCrawlMode)
+		{
+			m_eCrawlMode = eCrawlMode;
+			return *this;
+		}
+		decltype(auto) withCheckpointFile(vlr::tstring_view svCheckpointFilePath, size_t nCheckpointIntervalKeys = 1000)
+		{
+			m_sCheckpointFilePath = vlr::tstring{ svCheckpointFilePath };
+			m_nCheckpointIntervalKeys = nCheckpointIntervalKeys;
+			return *this;
+		}
+		decltype(auto) withMaxKeysToVisit(size_t nMaxKeysToVisit)
+		{
+			m_nMaxKeysToVisit = nMaxKeysToVisit;
+			return *this;
+		}
+	};
+
+	struct Result_Crawl
+	{
+		size_t m_nKeysVisited{};
+		size_t m_nKeysValuesRead{};
+		size_t m_nKeysPruned{};
+		size_t m_nKeysSkipped{};
+		size_t m_nChangesReported{};
+		bool m_bCompleted = false;
+	};
+
+protected:
+	struct KeyState
+	{
+		// Note: Zero if the key's values should be re-read on the next crawl
+		FILETIME m_ftLastWriteTime{};
+		uint64_t m_nContentHash{};
+		std::vector<vlr::tstring> m_arrSubkeyNames;
+	};
+	struct PendingKey
+	{
+		vlr::tstring m_sKeyPath;
+		FILETIME m_ftLastWriteTime{};
+	};
+
+	CRegistryAccess m_oRegistryAccess;
+	vlr::tstring m_sRootKeyPath;
+
+	strings::unordered_map_CaseInsensitive<KeyState> m_mapKeyPathToState;
+	// Note: Stack of keys still to be visited; non-empty while a crawl is in progress
+	std::vector<PendingKey> m_arrPendingKeys;
+
+protected:
+	SResult visitKey(
+		const PendingKey& oPendingKey,
+		const OnCrawlChange& fOnCrawlChange,
+		const Options_Crawl& options,
+		ULONGLONG nRecentWriteThreshold,
+		Result_Crawl& oResult);
+	void collectSubtreeKeyPaths(
+		const vlr::tstring& sKeyPath,
+		std::vector<vlr::tstring>& arrKeyPaths) const;
+
+public:
+	// Note: Returns Success_WithNuance if the crawl stopped at the key limit (call again to resume)
+	SResult Crawl(
+		const OnCrawlChange& fOnCrawlChange,
+		const Options_Crawl& options = {},
+		Result_Crawl* pResult = nullptr);
+
+	// Note: Load fails with ERROR_BAD_FORMAT if the file is not a valid checkpoint, and ERROR_INVALID_DATA if it
+	// was saved for a different base key or root path.
+	SResult SaveCheckpoint(
+		tzstring_view svzFilePath) const;
+	SResult LoadCheckpoint(
+		tzstring_view svzFilePath);
+
+	inline bool IsCrawlInProgress() const
+	{
+		return !m_arrPendingKeys.empty();
+	}
+	inline size_t GetKeyCount() const
+	{
+		return m_mapKeyPathToState.size();
+	}
+
+public:
+	CRegistryAccessCrawler(const CRegistryAccess& oRegistryAccess, tzstring_view svzRootKeyPath)
+		: m_oRegistryAccess{ oRegistryAccess }
+		, m_sRootKeyPath{ svzRootKeyPath }
+	{}
+};
+
+} // namespace win32
+
+} // namespace vlr
@@ -0,0 +1,720 @@
+#include "pch.h"
+#include "RegistryAccess_Diff.h"
+
+#include <algorithm>
+#include <type_traits>
+
+#include <vlr-util/ActionOnDestruction.h>
+#include <vlr-util/util.convert.StringConversion.h>
+
+#include "strings.CaseFold.h"
+
+namespace vlr {
+
+namespace win32 {
+
+namespace RegistryAccess {
+
+const char* GetChangeTypeName(ChangeType eChangeType)
+{
+	switch (eChangeType)
+	{
+	case ChangeType::AddKey: return "AddKey";
+	case ChangeType::RemoveKey: return "RemoveKey";
+	case ChangeType::AddValue: return "AddValue";
+	case ChangeType::RemoveValue: return "RemoveValue";
+	case ChangeType::ModifyValue: return "ModifyValue";
+	default: return "Unknown";
+	}
+}
+
+} // namespace RegistryAccess
+
+namespace {
+
+inline vlr::tstring MakeSubkeyPath(vlr::tstring_view svKeyPath, vlr::tstring_view svSubkeyName)
+{
+	auto sSubkeyPath = vlr::tstring{ svKeyPath };
+	if (!sSubkeyPath.empty() && !svSubkeyName.empty())
+	{
+		sSubkeyPath += _T('\\');
+	}
+	sSubkeyPath += svSubkeyName;
+	return sSubkeyPath;
+}
+
+// Note: Results for a key which does not exist (or was deleted since its parent was read)
+inline bool IsKeyMissingResult(const SResult& sr)
+{
+	switch (sr.asHRESULT())
+	{
+	case __HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND):
+	case __HRESULT_FROM_WIN32(ERROR_KEY_DELETED):
+		return true;
+	default:
+		return false;
+	}
+}
+
+// Note: Views of names from the contents' own storage are null-terminated
+inline vlr::tzstring_view AsNullTerminated(vlr::tstring_view svName)
+{
+	return vlr::tzstring_view{ svName.data(), svName.size(), vlr::tzstring_view::StringIsNullTerminated{} };
+}
+
+// Note: Snapshot names are wide; they are only converted (into the contents' storage) for non-Unicode builds
+template <typename TChar>
+inline std::basic_string_view<TChar> GetSnapshotName(const std::wstring& sName, std::deque<std::basic_string<TChar>>& dequeNames)
+{
+	if constexpr (std::is_same_v<TChar, wchar_t>)
+	{
+		return sName;
+	}
+	else
+	{
+		return dequeNames.emplace_back(util::Convert::ToStdStringA(sName));
+	}
+}
+template <typename TChar>
+inline std::wstring MakeSnapshotName(std::basic_string_view<TChar> svName)
+{
+	if constexpr (std::is_same_v<TChar, wchar_t>)
+	{
+		return std::wstring{ svName };
+	}
+	else
+	{
+		return util::Convert::ToStdStringW(svName);
+	}
+}
+
+template <typename TEntry>
+inline void SortEntriesByName(std::vector<TEntry>& arrEntries)
+{
+	std::sort(arrEntries.begin(), arrEntries.end(), [](const TEntry& oLHS, const TEntry& oRHS)
+	{
+		return strings::less_CaseInsensitive<TCHAR>{}(oLHS.m_svName, oRHS.m_svName);
+	});
+}
+
+// Note: Position of the next entries of a sorted merge; < 0 if only the source has the next name, > 0 if only the
+// target has it, and 0 if both have it.
+template <typename TEntry>
+inline int CompareMergeEntries(const std::vector<TEntry>& arrEntries_Source, size_t nIndex_Source, const std::vector<TEntry>& arrEntries_Target, size_t nIndex_Target)
+{
+	if (nIndex_Source >= arrEntries_Source.size())
+	{
+		return 1;
+	}
+	if (nIndex_Target >= arrEntries_Target.size())
+	{
+		return -1;
+	}
+	return strings::Compare_CaseInsensitive(arrEntries_Source[nIndex_Source].m_svName, arrEntries_Target[nIndex_Target].m_svName);
+}
+
+} // namespace
+
+SResult CRegistryDiffSource::openRootKey(
+	KeyRef& oKeyRef_Result) const
+{
+	SResult sr;
+
+	oKeyRef_Result = {};
+	if (m_pSnapshotRootKey)
+	{
+		oKeyRef_Result.m_pHiveKey = m_pSnapshotRootKey;
+		return SResult::Success;
+	}
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(m_oRegistryAccess.has_value());
+
+	HKEY hKey{};
+	sr = m_oRegistryAccess->OpenKey(m_sRootKeyPath, KEY_READ, hKey);
+	if (IsKeyMissingResult(sr))
+	{
+		return SResult::Success;
+	}
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hKey);
+	oKeyRef_Result.m_hKey = hKey;
+
+	return SResult::Success;
+}
+
+SResult CRegistryDiffSource::openSubkey(
+	const KeyRef& oKeyRef_Parent,
+	const SubkeyEntry& oSubkeyEntry,
+	KeyRef& oKeyRef_Result) const
+{
+	SResult sr;
+
+	oKeyRef_Result = {};
+	if (oKeyRef_Parent.m_pHiveKey)
+	{
+		oKeyRef_Result.m_pHiveKey = oSubkeyEntry.m_pHiveKey;
+		return SResult::Success;
+	}
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(oKeyRef_Parent.m_hKey);
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(m_oRegistryAccess.has_value());
+
+	HKEY hKey{};
+	sr = m_oRegistryAccess->OpenSubkeyFromOpenKey(oKeyRef_Parent.m_hKey, AsNullTerminated(oSubkeyEntry.m_svName), KEY_READ, hKey);
+	if (IsKeyMissingResult(sr))
+	{
+		return SResult::Success;
+	}
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hKey);
+	oKeyRef_Result.m_hKey = hKey;
+
+	return SResult::Success;
+}
+
+void CRegistryDiffSource::closeKey(
+	KeyRef& oKeyRef)
+{
+	if (oKeyRef.m_hKey)
+	{
+		::RegCloseKey(oKeyRef.m_hKey);
+	}
+	oKeyRef = {};
+}
+
+SResult CRegistryDiffSource::readKey(
+	const KeyRef& oKeyRef,
+	KeyContents& oKeyContents) const
+{
+	SResult sr;
+
+	oKeyContents = {};
+	if (oKeyRef.m_pHiveKey)
+	{
+		const auto& oHiveKey = *oKeyRef.m_pHiveKey;
+		oKeyContents.m_arrValues.reserve(oHiveKey.m_arrValues.size());
+		for (const auto& oHiveValue : oHiveKey.m_arrValues)
+		{
+			auto& oValueEntry = oKeyContents.m_arrValues.emplace_back();
+			oValueEntry.m_svName = GetSnapshotName(oHiveValue.m_sName, oKeyContents.m_dequeNames);
+			oValueEntry.m_dwType = oHiveValue.m_dwType;
+			oValueEntry.m_spanData = cpp::span<const BYTE>{ oHiveValue.m_arrData.data(), oHiveValue.m_arrData.size() };
+		}
+		oKeyContents.m_arrSubkeys.reserve(oHiveKey.m_arrSubkeys.size());
+		for (const auto& oHiveSubkey : oHiveKey.m_arrSubkeys)
+		{
+			auto& oSubkeyEntry = oKeyContents.m_arrSubkeys.emplace_back();
+			oSubkeyEntry.m_svName = GetSnapshotName(oHiveSubkey.m_sName, oKeyContents.m_dequeNames);
+			oSubkeyEntry.m_pHiveKey = &oHiveSubkey;
+		}
+	}
+	else
+	{
+		VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(oKeyRef.m_hKey);
+		VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(m_oRegistryAccess.has_value());
+
+		sr = m_oRegistryAccess->EnumAllValuesFromOpenKey(oKeyRef.m_hKey, [&](const CRegistryAccess::EnumValueData& oEnumValueData)
+		{
+			const auto& sName = oKeyContents.m_dequeNames.emplace_back(oEnumValueData.m_svName);
+			const auto& arrData = oKeyContents.m_dequeData.emplace_back(oEnumValueData.m_spanData.begin(), oEnumValueData.m_spanData.end());
+			auto& oValueEntry = oKeyContents.m_arrValues.emplace_back();
+			oValueEntry.m_svName = sName;
+			oValueEntry.m_dwType = oEnumValueData.m_dwType;
+			oValueEntry.m_spanData = cpp::span<const BYTE>{ arrData.data(), arrData.size() };
+			return SResult::Success;
+		});
+		VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+		sr = m_oRegistryAccess->EnumAllSubkeysFromOpenKey(oKeyRef.m_hKey, [&](const CRegistryAccess::EnumSubkeyData& oEnumSubkeyData)
+		{
+			const auto& sName = oKeyContents.m_dequeNames.emplace_back(oEnumSubkeyData.m_svName);
+			oKeyContents.m_arrSubkeys.emplace_back().m_svName = sName;
+			return SResult::Success;
+		});
+		VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	}
+
+	SortEntriesByName(oKeyContents.m_arrValues);
+	SortEntriesByName(oKeyContents.m_arrSubkeys);
+
+	return SResult::Success;
+}
+
+struct CRegistryAccessDiff::DiffContext
+{
+	const CRegistryDiffSource& m_oSource;
+	const CRegistryDiffSource& m_oTarget;
+	const Options_Diff& m_options;
+	// Note: Changes are moved into the change set if set; otherwise passed to the callback
+	RegistryAccess::ChangeSet* m_pChangeSet = nullptr;
+	const OnChange* m_pfOnChange = nullptr;
+	Result_Diff m_oResult;
+
+	SResult emit(RegistryAccess::RegistryChange&& oChange)
+	{
+		using ChangeType = RegistryAccess::ChangeType;
+
+		switch (oChange.m_eChangeType)
+		{
+		case ChangeType::AddKey: ++m_oResult.m_nKeysAdded; break;
+		case ChangeType::RemoveKey: ++m_oResult.m_nKeysRemoved; break;
+		case ChangeType::AddValue: ++m_oResult.m_nValuesAdded; break;
+		case ChangeType::RemoveValue: ++m_oResult.m_nValuesRemoved; break;
+		case ChangeType::ModifyValue: ++m_oResult.m_nValuesModified; break;
+		}
+
+		if (m_pChangeSet)
+		{
+			m_pChangeSet->push_back(std::move(oChange));
+			return SResult::Success;
+		}
+		VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(m_pfOnChange);
+		return (*m_pfOnChange)(oChange);
+	}
+	SResult emitKeyChange(RegistryAccess::ChangeType eChangeType, vlr::tstring sKeyPath)
+	{
+		auto oChange = RegistryAccess::RegistryChange{};
+		oChange.m_eChangeType = eChangeType;
+		oChange.m_sKeyPath = std::move(sKeyPath);
+		return emit(std::move(oChange));
+	}
+};
+
+SResult CRegistryAccessDiff::diffValues(
+	DiffContext& oContext,
+	const CRegistryDiffSource::KeyContents& oKeyContents_Source,
+	const CRegistryDiffSource::KeyContents& oKeyContents_Target,
+	const vlr::tstring& sKeyPath) const
+{
+	using ChangeType = RegistryAccess::ChangeType;
+
+	SResult sr;
+
+	const auto& arrValues_Source = oKeyContents_Source.m_arrValues;
+	const auto& arrValues_Target = oKeyContents_Target.m_arrValues;
+	size_t nIndex_Source = 0;
+	size_t nIndex_Target = 0;
+	while ((nIndex_Source < arrValues_Source.size()) || (nIndex_Target < arrValues_Target.size()))
+	{
+		auto nCompare = CompareMergeEntries(arrValues_Source, nIndex_Source, arrValues_Target, nIndex_Target);
+		const auto* pValueEntry_Source = (nCompare <= 0) ? &arrValues_Source[nIndex_Source++] : nullptr;
+		const auto* pValueEntry_Target = (nCompare >= 0) ? &arrValues_Target[nIndex_Target++] : nullptr;
+
+		auto oChange = RegistryAccess::RegistryChange{};
+		if (pValueEntry_Source && pValueEntry_Target)
+		{
+			++oContext.m_oResult.m_nValuesCompared;
+			const auto& spanData_Source = pValueEntry_Source->m_spanData;
+			const auto& spanData_Target = pValueEntry_Target->m_spanData;
+			if ((pValueEntry_Source->m_dwType == pValueEntry_Target->m_dwType) && (spanData_Source.size() == spanData_Target.size()))
+			{
+				auto iterMismatch_Source = std::mismatch(spanData_Source.begin(), spanData_Source.end(), spanData_Target.begin(), spanData_Target.end()).first;
+				bool bIsEqual = (iterMismatch_Source == spanData_Source.end());
+				// Note: Counts the bytes up to and including the first difference
+				auto nMatchingByteCount = static_cast<size_t>(iterMismatch_Source - spanData_Source.begin());
+				oContext.m_oResult.m_nBytesCompared += bIsEqual ? nMatchingByteCount : nMatchingByteCount + 1;
+				if (bIsEqual)
+				{
+					continue;
+				}
+			}
+			oChange.m_eChangeType = ChangeType::ModifyValue;
+		}
+		else
+		{
+			oChange.m_eChangeType = pValueEntry_Source ? ChangeType::RemoveValue : ChangeType::AddValue;
+		}
+
+		oChange.m_sKeyPath = sKeyPath;
+		if (pValueEntry_Target)
+		{
+			oChange.m_sValueName = pValueEntry_Target->m_svName;
+			oChange.m_dwType = pValueEntry_Target->m_dwType;
+			oChange.m_arrData.assign(pValueEntry_Target->m_spanData.begin(), pValueEntry_Target->m_spanData.end());
+		}
+		else
+		{
+			oChange.m_sValueName = pValueEntry_Source->m_svName;
+		}
+		if (pValueEntry_Source && oContext.m_options.m_bIncludeSourceData)
+		{
+			oChange.m_dwType_Source = pValueEntry_Source->m_dwType;
+			oChange.m_arrData_Source.assign(pValueEntry_Source->m_spanData.begin(), pValueEntry_Source->m_spanData.end());
+		}
+		sr = oContext.emit(std::move(oChange));
+		VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	}
+
+	return SResult::Success;
+}
+
+SResult CRegistryAccessDiff::diffKey(
+	DiffContext& oContext,
+	const CRegistryDiffSource::KeyRef& oKeyRef_Source,
+	const CRegistryDiffSource::KeyRef& oKeyRef_Target,
+	const vlr::tstring& sKeyPath) const
+{
+	using ChangeType = RegistryAccess::ChangeType;
+
+	SResult sr;
+
+	// Note: A key with no source is an added key; it is walked the same way, so its values and subkeys are reported
+	// as added.
+	CRegistryDiffSource::KeyContents oKeyContents_Source;
+	CRegistryDiffSource::KeyContents oKeyContents_Target;
+	if (oKeyRef_Source.Exists())
+	{
+		++oContext.m_oResult.m_nKeysCompared;
+		sr = oContext.m_oSource.readKey(oKeyRef_Source, oKeyContents_Source);
+		VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	}
+	sr = oContext.m_oTarget.readKey(oKeyRef_Target, oKeyContents_Target);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	sr = diffValues(oContext, oKeyContents_Source, oKeyContents_Target, sKeyPath);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	// Note: Only the subkey names are kept while the subkeys are walked
+	oKeyContents_Source.m_arrValues = {};
+	oKeyContents_Source.m_dequeData = {};
+	oKeyContents_Target.m_arrValues = {};
+	oKeyContents_Target.m_dequeData = {};
+
+	const auto& arrSubkeys_Source = oKeyContents_Source.m_arrSubkeys;
+	const auto& arrSubkeys_Target = oKeyContents_Target.m_arrSubkeys;
+	size_t nIndex_Source = 0;
+	size_t nIndex_Target = 0;
+	while ((nIndex_Source < arrSubkeys_Source.size()) || (nIndex_Target < arrSubkeys_Target.size()))
+	{
+		auto nCompare = CompareMergeEntries(arrSubkeys_Source, nIndex_Source, arrSubkeys_Target, nIndex_Target);
+		if (nCompare < 0)
+		{
+			sr = oContext.emitKeyChange(ChangeType::RemoveKey, MakeSubkeyPath(sKeyPath, arrSubkeys_Source[nIndex_Source].m_svName));
+			VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+			++nIndex_Source;
+			continue;
+		}
+
+		CRegistryDiffSource::KeyRef oKeyRef_SubkeySource;
+		CRegistryDiffSource::KeyRef oKeyRef_SubkeyTarget;
+		auto onDestroy_CloseSubkeys = MakeActionOnDestruction([&] {
+			CRegistryDiffSource::closeKey(oKeyRef_SubkeySource);
+			CRegistryDiffSource::closeKey(oKeyRef_SubkeyTarget);
+		});
+		const auto& oSubkeyEntry_Target = arrSubkeys_Target[nIndex_Target++];
+		auto sSubkeyPath = MakeSubkeyPath(sKeyPath, oSubkeyEntry_Target.m_svName);
+		if (nCompare == 0)
+		{
+			sr = oContext.m_oSource.openSubkey(oKeyRef_Source, arrSubkeys_Source[nIndex_Source++], oKeyRef_SubkeySource);
+			VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+		}
+		sr = oContext.m_oTarget.openSubkey(oKeyRef_Target, oSubkeyEntry_Target, oKeyRef_SubkeyTarget);
+		VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+		// Note: Either key may have been deleted since its parent was read
+		if (!oKeyRef_SubkeyTarget.Exists())
+		{
+			if (oKeyRef_SubkeySource.Exists())
+			{
+				sr = oContext.emitKeyChange(ChangeType::RemoveKey, std::move(sSubkeyPath));
+				VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+			}
+			continue;
+		}
+		if (!oKeyRef_SubkeySource.Exists())
+		{
+			sr = oContext.emitKeyChange(ChangeType::AddKey, sSubkeyPath);
+			VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+		}
+		sr = diffKey(oContext, oKeyRef_SubkeySource, oKeyRef_SubkeyTarget, sSubkeyPath);
+		VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	}
+
+	return SResult::Success;
+}
+
+SResult CRegistryAccessDiff::diffTree(
+	DiffContext& oContext) const
+{
+	SResult sr;
+
+	CRegistryDiffSource::KeyRef oKeyRef_Source;
+	CRegistryDiffSource::KeyRef oKeyRef_Target;
+	auto onDestroy_CloseRootKeys = MakeActionOnDestruction([&] {
+		CRegistryDiffSource::closeKey(oKeyRef_Source);
+		CRegistryDiffSource::closeKey(oKeyRef_Target);
+	});
+	sr = oContext.m_oSource.openRootKey(oKeyRef_Source);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	sr = oContext.m_oTarget.openRootKey(oKeyRef_Target);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	if (!oKeyRef_Target.Exists())
+	{
+		if (oKeyRef_Source.Exists())
+		{
+			sr = oContext.emitKeyChange(RegistryAccess::ChangeType::RemoveKey, vlr::tstring{});
+			VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+		}
+		return SResult::Success;
+	}
+	if (!oKeyRef_Source.Exists())
+	{
+		sr = oContext.emitKeyChange(RegistryAccess::ChangeType::AddKey, vlr::tstring{});
+		VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	}
+
+	return diffKey(oContext, oKeyRef_Source, oKeyRef_Target, vlr::tstring{});
+}
+
+SResult CRegistryAccessDiff::DiffToCallback(
+	const CRegistryDiffSource& oSource,
+	const CRegistryDiffSource& oTarget,
+	const OnChange& fOnChange,
+	const Options_Diff& options /*= {}*/,
+	Result_Diff* pResult /*= nullptr*/) const
+{
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(fOnChange);
+
+	auto oContext = DiffContext{ oSource, oTarget, options };
+	oContext.m_pfOnChange = &fOnChange;
+	auto oOnDestroy_SetResult = MakeActionOnDestruction([&] {
+		if (pResult)
+		{
+			*pResult = oContext.m_oResult;
+		}
+	});
+
+	return diffTree(oContext);
+}
+
+SResult CRegistryAccessDiff::Diff(
+	const CRegistryDiffSource& oSource,
+	const CRegistryDiffSource& oTarget,
+	RegistryAccess::ChangeSet& oChangeSet_Result,
+	const Options_Diff& options /*= {}*/,
+	Result_Diff* pResult /*= nullptr*/) const
+{
+	SResult sr;
+
+	// Note: Changes are moved into the change set directly, rather than copied from a callback
+	RegistryAccess::ChangeSet oChangeSet;
+	auto oContext = DiffContext{ oSource, oTarget, options };
+	oContext.m_pChangeSet = &oChangeSet;
+	auto oOnDestroy_SetResult = MakeActionOnDestruction([&] {
+		if (pResult)
+		{
+			*pResult = oContext.m_oResult;
+		}
+	});
+
+	sr = diffTree(oContext);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	oChangeSet_Result = std::move(oChangeSet);
+
+	return SResult::Success;
+}
+
+SResult CRegistryAccessDiff::removeKeyTree(
+	const CRegistryAccess& oRegistryAccess,
+	const vlr::tstring& sKeyPath) const
+{
+	SResult sr;
+
+	std::vector<vlr::tstring> arrSubkeyNames;
+	sr = oRegistryAccess.EnumAllSubkeys(sKeyPath, [&](const CRegistryAccess::EnumSubkeyData& oEnumSubkeyData)
+	{
+		arrSubkeyNames.emplace_back(oEnumSubkeyData.m_svName);
+		return SResult::Success;
+	});
+	if (IsKeyMissingResult(sr))
+	{
+		return SResult::Success;
+	}
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	for (const auto& sSubkeyName : arrSubkeyNames)
+	{
+		sr = removeKeyTree(oRegistryAccess, MakeSubkeyPath(sKeyPath, sSubkeyName));
+		VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	}
+
+	sr = oRegistryAccess.DeleteKey(sKeyPath);
+	if (IsKeyMissingResult(sr))
+	{
+		return SResult::Success;
+	}
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	return SResult::Success;
+}
+
+SResult CRegistryAccessDiff::ApplyChanges(
+	const CRegistryAccess& oRegistryAccess,
+	tzstring_view svzRootKeyPath,
+	const RegistryAccess::ChangeSet& oChangeSet,
+	Result_Apply* pResult /*= nullptr*/) const
+{
+	using ChangeType = RegistryAccess::ChangeType;
+
+	SResult sr;
+
+	auto oResult = Result_Apply{};
+	auto oOnDestroy_SetResult = MakeActionOnDestruction([&] {
+		if (pResult)
+		{
+			*pResult = oResult;
+		}
+	});
+
+	// Note: The key of the last value change, kept open for value changes to the same key
+	HKEY hKey_Values{};
+	vlr::tstring sKeyPath_Values;
+	auto fCloseValuesKey = [&] {
+		if (hKey_Values)
+		{
+			::RegCloseKey(hKey_Values);
+			hKey_Values = {};
+		}
+	};
+	auto onDestroy_CloseValuesKey = MakeActionOnDestruction(fCloseValuesKey);
+
+	auto sRootKeyPath = vlr::tstring{ svzRootKeyPath };
+	for (const auto& oChange : oChangeSet)
+	{
+		auto sKeyPath = MakeSubkeyPath(sRootKeyPath, oChange.m_sKeyPath);
+		switch (oChange.m_eChangeType)
+		{
+		case ChangeType::AddKey:
+		{
+			fCloseValuesKey();
+			sr = oRegistryAccess.EnsureKeyExists(sKeyPath);
+			VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+			++oResult.m_nKeysCreated;
+			break;
+		}
+		case ChangeType::RemoveKey:
+		{
+			fCloseValuesKey();
+			sr = removeKeyTree(oRegistryAccess, sKeyPath);
+			VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+			++oResult.m_nKeysRemoved;
+			break;
+		}
+		case ChangeType::AddValue:
+		case ChangeType::ModifyValue:
+		case ChangeType::RemoveValue:
+		{
+			bool bIsRemove = (oChange.m_eChangeType == ChangeType::RemoveValue);
+			if (!hKey_Values || (sKeyPath_Values != sKeyPath))
+			{
+				fCloseValuesKey();
+				// Note: Removing a value does not create its key
+				sr = bIsRemove
+					? oRegistryAccess.OpenKey(sKeyPath, KEY_SET_VALUE, hKey_Values)
+					: oRegistryAccess.CreateOrOpenKey(sKeyPath, KEY_SET_VALUE, hKey_Values);
+				if (bIsRemove && IsKeyMissingResult(sr))
+				{
+					++oResult.m_nValuesDeleted;
+					break;
+				}
+				VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+				VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hKey_Values);
+				sKeyPath_Values = sKeyPath;
+			}
+			if (bIsRemove)
+			{
+				sr = oRegistryAccess.DeleteValueFromOpenKey(hKey_Values, oChange.m_sValueName);
+				if (sr.asHRESULT() != __HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND))
+				{
+					VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+				}
+				++oResult.m_nValuesDeleted;
+			}
+			else
+			{
+				sr = oRegistryAccess.WriteValueBaseToOpenKey(hKey_Values, oChange.m_sValueName, oChange.m_dwType, oChange.m_arrData);
+				VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+				++oResult.m_nValuesWritten;
+			}
+			break;
+		}
+		default:
+			return SResult{ E_INVALIDARG };
+		}
+		++oResult.m_nChangesApplied;
+	}
+
+	return SResult::Success;
+}
+
+SResult CRegistryAccessDiff::captureKey(
+	const CRegistryDiffSource& oSource,
+	const CRegistryDiffSource::KeyRef& oKeyRef,
+	registry::HiveKey& oHiveKey) const
+{
+	SResult sr;
+
+	CRegistryDiffSource::KeyContents oKeyContents;
+	sr = oSource.readKey(oKeyRef, oKeyContents);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	oHiveKey.m_arrValues.reserve(oKeyContents.m_arrValues.size());
+	for (const auto& oValueEntry : oKeyContents.m_arrValues)
+	{
+		oHiveKey.AddValue(
+			MakeSnapshotName(oValueEntry.m_svName),
+			oValueEntry.m_dwType,
+			std::vector<uint8_t>{ oValueEntry.m_spanData.begin(), oValueEntry.m_spanData.end() });
+	}
+	oKeyContents.m_arrValues = {};
+	oKeyContents.m_dequeData = {};
+
+	oHiveKey.m_arrSubkeys.reserve(oKeyContents.m_arrSubkeys.size());
+	for (const auto& oSubkeyEntry : oKeyContents.m_arrSubkeys)
+	{
+		CRegistryDiffSource::KeyRef oKeyRef_Subkey;
+		auto onDestroy_CloseSubkey = MakeActionOnDestruction([&] {
+			CRegistryDiffSource::closeKey(oKeyRef_Subkey);
+		});
+		sr = oSource.openSubkey(oKeyRef, oSubkeyEntry, oKeyRef_Subkey);
+		VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+		if (!oKeyRef_Subkey.Exists())
+		{
+			continue;
+		}
+		sr = captureKey(oSource, oKeyRef_Subkey, oHiveKey.AddSubkey(MakeSnapshotName(oSubkeyEntry.m_svName)));
+		VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	}
+
+	return SResult::Success;
+}
+
+SResult CRegistryAccessDiff::CaptureSnapshot(
+	const CRegistryDiffSource& oSource,
+	registry::HiveKey& oHiveKey_Result) const
+{
+	SResult sr;
+
+	CRegistryDiffSource::KeyRef oKeyRef;
+	auto onDestroy_CloseRootKey = MakeActionOnDestruction([&] {
+		CRegistryDiffSource::closeKey(oKeyRef);
+	});
+	sr = oSource.openRootKey(oKeyRef);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	if (!oKeyRef.Exists())
+	{
+		return SResult::For_win32_ErrorCode(ERROR_FILE_NOT_FOUND);
+	}
+
+	auto oHiveKey = registry::HiveKey{};
+	sr = captureKey(oSource, oKeyRef, oHiveKey);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	oHiveKey_Result = std::move(oHiveKey);
+
+	return SResult::Success;
+}
+
+} // namespace win32
+
+} // namespace vlr
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <optional>
+#include <vector>
+
+#include <vlr-util/util.includes.h>
+#include <vlr-util/util.Result.h>
+#include <vlr-util/zstring_view.h>
+
+#include "RegistryAccess.h"
+#include "registry.HiveWriter.h"
+
+namespace vlr {
+
+namespace win32 {
+
+namespace RegistryAccess {
+
+enum class ChangeType
+{
+	AddKey,
+	// Note: Removes the key with its whole subtree; the subtree's keys and values are not listed separately
+	RemoveKey,
+	AddValue,
+	RemoveValue,
+	ModifyValue,
+};
+
+const char* GetChangeTypeName(ChangeType eChangeType);
+
+struct RegistryChange
+{
+	ChangeType m_eChangeType{};
+	// Note: Relative to the diff roots; empty for the root itself
+	vlr::tstring m_sKeyPath;
+	// Note: Empty for key changes, and for the key's default value
+	vlr::tstring m_sValueName;
+	// Note: The target value, for AddValue and ModifyValue
+	DWORD m_dwType{};
+	std::vector<BYTE> m_arrData;
+	// Note: The source value, for RemoveValue and ModifyValue (if included; see Options_Diff)
+	DWORD m_dwType_Source{};
+	std::vector<BYTE> m_arrData_Source;
+};
+
+// Note: In walk order; each key's value changes come before its subkeys' changes, and an added key comes before its
+// values and subkeys, so the change set can be applied in order.
+using ChangeSet = std::vector<RegistryChange>;
+
+} // namespace RegistryAccess
+
+// One side of a diff: either a live key (through a CRegistryAccess), or an in-memory snapshot (a registry::HiveKey
+// tree; eg: a golden configuration, or one captured earlier with CRegistryAccessDiff::CaptureSnapshot).
+// Note: The registry access instance is copied; the base key must remain open for the life of this instance. A
+// snapshot is referenced, not copied, so must outlive this instance.
+
+class CRegistryDiffSource
+{
+	friend class CRegistryAccessDiff;
+
+protected:
+	std::optional<CRegistryAccess> m_oRegistryAccess;
+	vlr::tstring m_sRootKeyPath;
+	const registry::HiveKey* m_pSnapshotRootKey = nullptr;
+
+	// Note: An open key of the walk; neither member is set for a key which does not exist
+	struct KeyRef
+	{
+		HKEY m_hKey{};
+		const registry::HiveKey* m_pHiveKey = nullptr;
+
+		inline bool Exists() const
+		{
+			return (m_hKey != nullptr) || (m_pHiveKey != nullptr);
+		}
+	};
+	struct ValueEntry
+	{
+		vlr::tstring_view m_svName;
+		DWORD m_dwType{};
+		cpp::span<const BYTE> m_spanData;
+	};
+	struct SubkeyEntry
+	{
+		vlr::tstring_view m_svName;
+		// Note: Set for snapshot sources, so subkeys are not looked up by name
+		const registry::HiveKey* m_pHiveKey = nullptr;
+	};
+	// Note: Values and subkeys sorted by name (strings::Compare_CaseInsensitive). The views are into the storage here
+	// (for live keys, or converted names) or into the snapshot.
+	struct KeyContents
+	{
+		std::vector<ValueEntry> m_arrValues;
+		std::vector<SubkeyEntry> m_arrSubkeys;
+		std::deque<vlr::tstring> m_dequeNames;
+		std::deque<std::vector<BYTE>> m_dequeData;
+	};
+
+	SResult openRootKey(
+		KeyRef& oKeyRef_Result) const;
+	SResult openSubkey(
+		const KeyRef& oKeyRef_Parent,
+		const SubkeyEntry& oSubkeyEntry,
+		KeyRef& oKeyRef_Result) const;
+	static void closeKey(
+		KeyRef& oKeyRef);
+	SResult readKey(
+		const KeyRef& oKeyRef,
+		KeyContents& oKeyContents) const;
+
+public:
+	// Note: The root may be the base key itself (empty path)
+	CRegistryDiffSource(const CRegistryAccess& oRegistryAccess, tzstring_view svzRootKeyPath)
+		: m_oRegistryAccess{ oRegistryAccess }
+		, m_sRootKeyPath{ svzRootKeyPath }
+	{}
+	// Note: The root key's own name is ignored
+	explicit CRegistryDiffSource(const registry::HiveKey& oSnapshotRootKey)
+		: m_pSnapshotRootKey{ &oSnapshotRootKey }
+	{}
+};
+
+// Compares two registry subtrees, and produces the changes which turn the source subtree into the target subtree.
+// Both trees are walked together in sorted merge order, one key at a time: each key's values are read, sorted and
+// merged by name (case-insensitive), and released before the walk moves on to the subkeys, so memory use is bounded
+// by the largest key (and the walk depth) rather than by the tree. Values of the same name are compared by type and
+// size first, and only then bytewise, which stops at the first difference.
+// A key which is only in the source is reported as one RemoveKey, without walking its subtree. A root key which
+// does not exist is treated as an empty (absent) tree, so diffing against a missing key reports it as added/removed;
+// a key which exists but cannot be read (eg: access denied) fails the diff, rather than being reported as equal.
+// Note: Stateless; one instance can be used for any number of diffs.
+
+class CRegistryAccessDiff
+{
+public:
+	struct Options_Diff
+	{
+		// Note: Include the source value in RemoveValue and ModifyValue changes (eg: for audit reports, or to reverse
+		// the change set); not needed to apply the change set.
+		bool m_bIncludeSourceData = true;
+
+		decltype(auto) withIncludeSourceData(bool bIncludeSourceData = true)
+		{
+			m_bIncludeSourceData = bIncludeSourceData;
+			return *this;
+		}
+	};
+
+	struct Result_Diff
+	{
+		size_t m_nKeysCompared{};
+		size_t m_nValuesCompared{};
+		// Note: Data of values whose type and size matched, so were compared bytewise (up to the first difference)
+		size_t m_nBytesCompared{};
+		size_t m_nKeysAdded{};
+		size_t m_nKeysRemoved{};
+		size_t m_nValuesAdded{};
+		size_t m_nValuesRemoved{};
+		size_t m_nValuesModified{};
+	};
+
+	struct Result_Apply
+	{
+		// Note: On failure, this is the index of the change which failed
+		size_t m_nChangesApplied{};
+		size_t m_nKeysCreated{};
+		size_t m_nKeysRemoved{};
+		size_t m_nValuesWritten{};
+		size_t m_nValuesDeleted{};
+	};
+
+	// Called for each change, in walk order.
+	// Note: Returning failure stops the diff, and the failure is returned from DiffToCallback.
+	using OnChange = std::function<SResult(const RegistryAccess::RegistryChange& oChange)>;
+
+protected:
+	struct DiffContext;
+
+	SResult diffTree(
+		DiffContext& oContext) const;
+	SResult diffKey(
+		DiffContext& oContext,
+		const CRegistryDiffSource::KeyRef& oKeyRef_Source,
+		const CRegistryDiffSource::KeyRef& oKeyRef_Target,
+		const vlr::tstring& sKeyPath) const;
+	SResult diffValues(
+		DiffContext& oContext,
+		const CRegistryDiffSource::KeyContents& oKeyContents_Source,
+		const CRegistryDiffSource::KeyContents& oKeyContents_Target,
+		const vlr::tstring& sKeyPath) const;
+	SResult captureKey(
+		const CRegistryDiffSource& oSource,
+		const CRegistryDiffSource::KeyRef& oKeyRef,
+		registry::HiveKey& oHiveKey) const;
+	SResult removeKeyTree(
+		const CRegistryAccess& oRegistryAccess,
+		const vlr::tstring& sKeyPath) const;
+
+public:
+	SResult DiffToCallback(
+		const CRegistryDiffSource& oSource,
+		const CRegistryDiffSource& oTarget,
+		const OnChange& fOnChange,
+		const Options_Diff& options = {},
+		Result_Diff* pResult = nullptr) const;
+	SResult Diff(
+		const CRegistryDiffSource& oSource,
+		const CRegistryDiffSource& oTarget,
+		RegistryAccess::ChangeSet& oChangeSet_Result,
+		const Options_Diff& options = {},
+		Result_Diff* pResult = nullptr) const;
+
+	// Applies a change set (from a diff) under the root key, through the registry access instance's writes; eg: to
+	// bring a drifted host back to the golden configuration, diff (live -> golden), then apply to the live root.
+	// Changes are applied in order, and the first failure stops the apply. Value changes to the same key are written
+	// through one open key handle. Removing a key or value which does not exist counts as done, so an interrupted
+	// apply can be run again.
+	SResult ApplyChanges(
+		const CRegistryAccess& oRegistryAccess,
+		tzstring_view svzRootKeyPath,
+		const RegistryAccess::ChangeSet& oChangeSet,
+		Result_Apply* pResult = nullptr) const;
+
+	// Copies a source's tree into a snapshot (eg: to save a golden configuration with registry::CHiveWriter, or to
+	// diff a key against its own earlier state).
+	// Note: Fails with ERROR_FILE_NOT_FOUND if the source root does not exist.
+	SResult CaptureSnapshot(
+		const CRegistryDiffSource& oSource,
+		registry::HiveKey& oHiveKey_Result) const;
+};
+
+} // namespace win32
+
+} // namespace vlr
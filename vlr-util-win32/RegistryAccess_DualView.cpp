@@ -0,0 +1,303 @@
+#include "pch.h"
+#include "RegistryAccess_DualView.h"
+
+#include <future>
+
+#include <vlr-util/ActionOnDestruction.h>
+#include "vlr-util/StringCompare.h"
+#include "vlr-util/util.range_checked_cast.h"
+
+#include "AutoCleanupTypedefs.h"
+#include "platform.API.Win32.h"
+#include "strings.CaseFold.h"
+
+namespace vlr {
+
+namespace win32 {
+
+namespace {
+
+SResult ReadAllValuesIntoMapFromOpenKey(
+	const CRegistryAccess& oReg,
+	HKEY hKey,
+	std::unordered_map<vlr::tstring, CRegistryAccess::ValueMapEntry>& mapNameToValue)
+{
+	auto fOnEnumValueData_AddToMap = [&](const CRegistryAccess::EnumValueData& oEnumValueData) -> SResult
+	{
+		auto& oValueMapEntry = mapNameToValue[vlr::tstring{ oEnumValueData.m_svName }];
+		auto sr = oReg.populateValueMapEntryFromEnumValueData(oEnumValueData, oValueMapEntry);
+		VLR_ASSERT_SR_SUCCEEDED_OR_RETURN_SRESULT(sr);
+
+		return SResult::Success;
+	};
+
+	return oReg.EnumAllValuesFromOpenKey(hKey, fOnEnumValueData_AddToMap);
+}
+
+} // namespace
+
+CRegistryAccessDualView::CRegistryAccessDualView(HKEY hBaseKey)
+	: m_oReg_32bit{ hBaseKey }
+	, m_oReg_64bit{ hBaseKey }
+{
+	m_oReg_32bit.SetWow64KeyAccessOption(RegistryAccess::Wow64KeyAccessOption::UseExplicit32bit);
+	m_oReg_64bit.SetWow64KeyAccessOption(RegistryAccess::Wow64KeyAccessOption::UseExplicit64bit);
+}
+
+SResult CRegistryAccessDualView::GetKernelKeyName(
+	HKEY hKey,
+	std::wstring& swKernelKeyName)
+{
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hKey);
+
+	static constexpr LONG STATUS_BUFFER_OVERFLOW_Value = static_cast<LONG>(0x80000005L);
+	static constexpr LONG STATUS_BUFFER_TOO_SMALL_Value = static_cast<LONG>(0xC0000023L);
+
+	const auto& oFunction_NtQueryKey = platform::API::CWin32::GetSharedInstance().GetFunction_NtQueryKey();
+	if (!oFunction_NtQueryKey.m_srLoadResult.isSuccess())
+	{
+		return oFunction_NtQueryKey.m_srLoadResult;
+	}
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(oFunction_NtQueryKey.m_fFunction);
+
+	// Note: Result is KEY_NAME_INFORMATION; a ULONG byte length, followed by the (non-terminated) name
+	std::vector<BYTE> arrBuffer;
+	arrBuffer.resize(sizeof(ULONG) + 256 * sizeof(WCHAR));
+
+	for (size_t nIterationCount = 0; nIterationCount < 2; ++nIterationCount)
+	{
+		ULONG nResultLength{};
+		LONG ntStatus = oFunction_NtQueryKey.m_fFunction(
+			hKey,
+			platform::API::Win32::KeyInformationClass_KeyNameInformation,
+			arrBuffer.data(),
+			util::range_checked_cast<ULONG>(arrBuffer.size()),
+			&nResultLength);
+		if ((ntStatus == STATUS_BUFFER_OVERFLOW_Value) || (ntStatus == STATUS_BUFFER_TOO_SMALL_Value))
+		{
+			arrBuffer.resize(nResultLength);
+			continue;
+		}
+		if (ntStatus < 0)
+		{
+			return HRESULT_FROM_NT(ntStatus);
+		}
+
+		VLR_ASSERT_COMPARE_OR_RETURN_EUNEXPECTED(nResultLength, >= , sizeof(ULONG));
+		auto nNameLengthBytes = *reinterpret_cast<const ULONG*>(arrBuffer.data());
+		VLR_ASSERT_COMPARE_OR_RETURN_EUNEXPECTED(sizeof(ULONG) + nNameLengthBytes, <= , arrBuffer.size());
+		swKernelKeyName.assign(
+			reinterpret_cast<const wchar_t*>(arrBuffer.data() + sizeof(ULONG)),
+			nNameLengthBytes / sizeof(wchar_t));
+
+		return SResult::Success;
+	}
+
+	return E_FAIL;
+}
+
+SResult CRegistryAccessDualView::openBothViews(
+	tzstring_view svzKeyName,
+	OpenedViews& oOpenedViews) const
+{
+	SResult sr_32bit = m_oReg_32bit.OpenKey(svzKeyName, KEY_READ, oOpenedViews.m_hKey_32bit);
+	SResult sr_64bit = m_oReg_64bit.OpenKey(svzKeyName, KEY_READ, oOpenedViews.m_hKey_64bit);
+
+	// Note: A key which only exists in one view is fine; any other failure is returned
+	auto fIsNotFound = [](const SResult& sr)
+	{
+		return (sr.asHRESULT() == __HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+	};
+	if (!sr_32bit.isSuccess() && !fIsNotFound(sr_32bit))
+	{
+		if (oOpenedViews.m_hKey_64bit)
+		{
+			::RegCloseKey(oOpenedViews.m_hKey_64bit);
+			oOpenedViews.m_hKey_64bit = {};
+		}
+		return sr_32bit;
+	}
+	if (!sr_64bit.isSuccess() && !fIsNotFound(sr_64bit))
+	{
+		if (oOpenedViews.m_hKey_32bit)
+		{
+			::RegCloseKey(oOpenedViews.m_hKey_32bit);
+			oOpenedViews.m_hKey_32bit = {};
+		}
+		return sr_64bit;
+	}
+	if (!oOpenedViews.m_hKey_32bit && !oOpenedViews.m_hKey_64bit)
+	{
+		return sr_64bit;
+	}
+
+	if (oOpenedViews.m_hKey_32bit && oOpenedViews.m_hKey_64bit)
+	{
+		// Note: If the name cannot be queried, the views are treated as distinct (no dedupe, but still correct)
+		std::wstring swKernelKeyName_32bit;
+		std::wstring swKernelKeyName_64bit;
+		auto srName_32bit = GetKernelKeyName(oOpenedViews.m_hKey_32bit, swKernelKeyName_32bit);
+		auto srName_64bit = GetKernelKeyName(oOpenedViews.m_hKey_64bit, swKernelKeyName_64bit);
+		oOpenedViews.m_bViewsResolveToSameKey = true
+			&& srName_32bit.isSuccess()
+			&& srName_64bit.isSuccess()
+			&& StringCompare::CI().AreEqual(swKernelKeyName_32bit, swKernelKeyName_64bit);
+	}
+
+	return SResult::Success;
+}
+
+SResult CRegistryAccessDualView::EnumAllSubkeys(
+	tzstring_view svzKeyName,
+	std::vector<DualViewSubkeyData>& arrSubkeys) const
+{
+	SResult sr;
+
+	OpenedViews oOpenedViews;
+	sr = openBothViews(svzKeyName, oOpenedViews);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	auto onDestroy_CloseRegKeys = MakeActionOnDestruction([&] {
+		if (oOpenedViews.m_hKey_32bit)
+		{
+			::RegCloseKey(oOpenedViews.m_hKey_32bit);
+		}
+		if (oOpenedViews.m_hKey_64bit)
+		{
+			::RegCloseKey(oOpenedViews.m_hKey_64bit);
+		}
+	});
+
+	auto fEnumView = [](const CRegistryAccess& oReg, HKEY hKey, DWORD dwViewFlags, std::vector<DualViewSubkeyData>& arrSubkeys_View) -> SResult
+	{
+		return oReg.EnumAllSubkeysFromOpenKey(hKey, [&](const CRegistryAccess::EnumSubkeyData& oEnumSubkeyData) -> SResult
+		{
+			arrSubkeys_View.push_back(DualViewSubkeyData{ vlr::tstring{ oEnumSubkeyData.m_svName }, oEnumSubkeyData.m_ftLastWriteTime, dwViewFlags });
+			return SResult::Success;
+		});
+	};
+
+	// Single enumeration if there is only one distinct key
+	if (oOpenedViews.m_bViewsResolveToSameKey)
+	{
+		return fEnumView(m_oReg_64bit, oOpenedViews.m_hKey_64bit, RegistryAccess::RegistryView_Both, arrSubkeys);
+	}
+	if (!oOpenedViews.m_hKey_32bit)
+	{
+		return fEnumView(m_oReg_64bit, oOpenedViews.m_hKey_64bit, RegistryAccess::RegistryView_64bit, arrSubkeys);
+	}
+	if (!oOpenedViews.m_hKey_64bit)
+	{
+		return fEnumView(m_oReg_32bit, oOpenedViews.m_hKey_32bit, RegistryAccess::RegistryView_32bit, arrSubkeys);
+	}
+
+	std::vector<DualViewSubkeyData> arrSubkeys_32bit;
+	std::vector<DualViewSubkeyData> arrSubkeys_64bit;
+	auto oFuture_64bit = std::async(std::launch::async, fEnumView,
+		std::cref(m_oReg_64bit), oOpenedViews.m_hKey_64bit, DWORD{ RegistryAccess::RegistryView_64bit }, std::ref(arrSubkeys_64bit));
+	auto sr_32bit = fEnumView(m_oReg_32bit, oOpenedViews.m_hKey_32bit, RegistryAccess::RegistryView_32bit, arrSubkeys_32bit);
+	auto sr_64bit = oFuture_64bit.get();
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr_32bit);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr_64bit);
+
+	// Note: The parents differ, but individual children may still be shared between the views. Only children
+	// with the same name in both views can be the same key, so only those are opened and compared.
+	strings::unordered_map_CaseInsensitive<size_t> mapNameToIndex_64bit;
+	for (size_t i = 0; i < arrSubkeys_64bit.size(); ++i)
+	{
+		mapNameToIndex_64bit.emplace(arrSubkeys_64bit[i].m_sName, i);
+	}
+
+	arrSubkeys = std::move(arrSubkeys_64bit);
+	for (auto& oSubkeyData_32bit : arrSubkeys_32bit)
+	{
+		auto iterMatch = mapNameToIndex_64bit.find(oSubkeyData_32bit.m_sName);
+		if (iterMatch != mapNameToIndex_64bit.end())
+		{
+			HKEY hChildKey_32bit{};
+			HKEY hChildKey_64bit{};
+			LONG lResult_32bit = ::RegOpenKeyEx(oOpenedViews.m_hKey_32bit, oSubkeyData_32bit.m_sName.c_str(), 0, KEY_READ | KEY_WOW64_32KEY, &hChildKey_32bit);
+			auto onDestroy_CloseRegKey_32bit = AutoCloseRegKey{ hChildKey_32bit };
+			LONG lResult_64bit = ::RegOpenKeyEx(oOpenedViews.m_hKey_64bit, oSubkeyData_32bit.m_sName.c_str(), 0, KEY_READ | KEY_WOW64_64KEY, &hChildKey_64bit);
+			auto onDestroy_CloseRegKey_64bit = AutoCloseRegKey{ hChildKey_64bit };
+
+			bool bIsSameKey = false;
+			if ((lResult_32bit == ERROR_SUCCESS) && (lResult_64bit == ERROR_SUCCESS))
+			{
+				std::wstring swKernelKeyName_32bit;
+				std::wstring swKernelKeyName_64bit;
+				bIsSameKey = true
+					&& GetKernelKeyName(hChildKey_32bit, swKernelKeyName_32bit).isSuccess()
+					&& GetKernelKeyName(hChildKey_64bit, swKernelKeyName_64bit).isSuccess()
+					&& StringCompare::CI().AreEqual(swKernelKeyName_32bit, swKernelKeyName_64bit);
+			}
+			if (bIsSameKey)
+			{
+				arrSubkeys[iterMatch->second].m_dwViewFlags |= RegistryAccess::RegistryView_32bit;
+				continue;
+			}
+		}
+		arrSubkeys.push_back(std::move(oSubkeyData_32bit));
+	}
+
+	return SResult::Success;
+}
+
+SResult CRegistryAccessDualView::ReadAllValuesIntoMaps(
+	tzstring_view svzKeyName,
+	std::vector<DualViewValueMap>& arrValueMaps) const
+{
+	SResult sr;
+
+	OpenedViews oOpenedViews;
+	sr = openBothViews(svzKeyName, oOpenedViews);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	auto onDestroy_CloseRegKeys = MakeActionOnDestruction([&] {
+		if (oOpenedViews.m_hKey_32bit)
+		{
+			::RegCloseKey(oOpenedViews.m_hKey_32bit);
+		}
+		if (oOpenedViews.m_hKey_64bit)
+		{
+			::RegCloseKey(oOpenedViews.m_hKey_64bit);
+		}
+	});
+
+	arrValueMaps.clear();
+
+	if (oOpenedViews.m_bViewsResolveToSameKey || !oOpenedViews.m_hKey_32bit || !oOpenedViews.m_hKey_64bit)
+	{
+		auto& oValueMap = arrValueMaps.emplace_back();
+		if (oOpenedViews.m_bViewsResolveToSameKey)
+		{
+			oValueMap.m_dwViewFlags = RegistryAccess::RegistryView_Both;
+			return ReadAllValuesIntoMapFromOpenKey(m_oReg_64bit, oOpenedViews.m_hKey_64bit, oValueMap.m_mapNameToValue);
+		}
+		if (oOpenedViews.m_hKey_64bit)
+		{
+			oValueMap.m_dwViewFlags = RegistryAccess::RegistryView_64bit;
+			return ReadAllValuesIntoMapFromOpenKey(m_oReg_64bit, oOpenedViews.m_hKey_64bit, oValueMap.m_mapNameToValue);
+		}
+		oValueMap.m_dwViewFlags = RegistryAccess::RegistryView_32bit;
+		return ReadAllValuesIntoMapFromOpenKey(m_oReg_32bit, oOpenedViews.m_hKey_32bit, oValueMap.m_mapNameToValue);
+	}
+
+	arrValueMaps.resize(2);
+	auto& oValueMap_64bit = arrValueMaps[0];
+	auto& oValueMap_32bit = arrValueMaps[1];
+	oValueMap_64bit.m_dwViewFlags = RegistryAccess::RegistryView_64bit;
+	oValueMap_32bit.m_dwViewFlags = RegistryAccess::RegistryView_32bit;
+
+	auto oFuture_64bit = std::async(std::launch::async, [&] {
+		return ReadAllValuesIntoMapFromOpenKey(m_oReg_64bit, oOpenedViews.m_hKey_64bit, oValueMap_64bit.m_mapNameToValue);
+	});
+	auto sr_32bit = ReadAllValuesIntoMapFromOpenKey(m_oReg_32bit, oOpenedViews.m_hKey_32bit, oValueMap_32bit.m_mapNameToValue);
+	auto sr_64bit = oFuture_64bit.get();
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr_32bit);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr_64bit);
+
+	return SResult::Success;
+}
+
+} // namespace win32
+
+} // namespace vlr
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include <vlr-util/util.includes.h>
+#include <vlr-util/util.Result.h>
+#include <vlr-util/zstring_view.h>
+
+#include "RegistryAccess.h"
+
+namespace vlr {
+
+namespace win32 {
+
+namespace RegistryAccess {
+
+// Note: Flags, since an entry can be present in (resolve to the same key in) both views
+enum RegistryViewFlags : DWORD
+{
+	RegistryView_None = 0,
+	RegistryView_32bit = 0x1,
+	RegistryView_64bit = 0x2,
+	RegistryView_Both = RegistryView_32bit | RegistryView_64bit,
+};
+
+} // namespace RegistryAccess
+
+// Access to both the 32-bit (KEY_WOW64_32KEY) and 64-bit (KEY_WOW64_64KEY) views of the registry in one call.
+// Both views are opened, and if they resolve to the same underlying key (shared/non-redirected keys), the key is
+// only read once and the results are tagged with both views. Otherwise the views are read concurrently, and the
+// results are merged, each tagged with the view it came from.
+
+class CRegistryAccessDualView
+{
+public:
+	using ValueMapEntry = CRegistryAccess::ValueMapEntry;
+
+protected:
+	CRegistryAccess m_oReg_32bit;
+	CRegistryAccess m_oReg_64bit;
+
+public:
+	struct DualViewSubkeyData
+	{
+		vlr::tstring m_sName;
+		FILETIME m_ftLastWriteTime{};
+		DWORD m_dwViewFlags = RegistryAccess::RegistryView_None;
+	};
+
+	// Note: Subkeys from a key which is shared between the views are returned once, tagged with both views.
+	// If the key exists in only one view, that view's subkeys are returned (not an error).
+	SResult EnumAllSubkeys(
+		tzstring_view svzKeyName,
+		std::vector<DualViewSubkeyData>& arrSubkeys) const;
+
+	struct DualViewValueMap
+	{
+		DWORD m_dwViewFlags = RegistryAccess::RegistryView_None;
+		std::unordered_map<vlr::tstring, ValueMapEntry> m_mapNameToValue;
+	};
+
+	// Note: One entry if the views resolve to the same key (or the key exists in only one view), else one per view
+	SResult ReadAllValuesIntoMaps(
+		tzstring_view svzKeyName,
+		std::vector<DualViewValueMap>& arrValueMaps) const;
+
+protected:
+	struct OpenedViews
+	{
+		HKEY m_hKey_32bit{};
+		HKEY m_hKey_64bit{};
+		bool m_bViewsResolveToSameKey = false;
+	};
+	// Note: On success, at least one of the keys is open; caller closes any which are non-null
+	SResult openBothViews(
+		tzstring_view svzKeyName,
+		OpenedViews& oOpenedViews) const;
+
+public:
+	// Returns the kernel object name of the key (eg: \REGISTRY\MACHINE\SOFTWARE\WOW6432Node\...), which is
+	// unique per underlying key, so can be used to detect when two handles refer to the same key.
+	static SResult GetKernelKeyName(
+		HKEY hKey,
+		std::wstring& swKernelKeyName);
+
+public:
+	CRegistryAccessDualView(HKEY hBaseKey);
+};
+
+} // namespace win32
+
+} // namespace vlr
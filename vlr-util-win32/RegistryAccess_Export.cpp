@@ -0,0 +1,415 @@
+#include "pch.h"
+#include "RegistryAccess_Export.h"
+
+#include <charconv>
+
+#include <vlr-util/util.range_checked_cast.h>
+
+#include "AutoCleanupTypedefs.h"
+#include "strings.Base64.h"
+
+namespace vlr {
+
+namespace win32 {
+
+namespace {
+
+inline vlr::tstring MakeSubkeyPath(vlr::tstring_view svKeyPath, vlr::tstring_view svSubkeyName)
+{
+	auto sSubkeyPath = vlr::tstring{ svKeyPath };
+	if (!sSubkeyPath.empty())
+	{
+		sSubkeyPath += _T('\\');
+	}
+	sSubkeyPath += svSubkeyName;
+	return sSubkeyPath;
+}
+
+inline const char* GetRegTypeName(DWORD dwType)
+{
+	switch (dwType)
+	{
+	case REG_NONE: return "REG_NONE";
+	case REG_SZ: return "REG_SZ";
+	case REG_EXPAND_SZ: return "REG_EXPAND_SZ";
+	case REG_BINARY: return "REG_BINARY";
+	case REG_DWORD: return "REG_DWORD";
+	case REG_DWORD_BIG_ENDIAN: return "REG_DWORD_BIG_ENDIAN";
+	case REG_LINK: return "REG_LINK";
+	case REG_MULTI_SZ: return "REG_MULTI_SZ";
+	case REG_RESOURCE_LIST: return "REG_RESOURCE_LIST";
+	case REG_FULL_RESOURCE_DESCRIPTOR: return "REG_FULL_RESOURCE_DESCRIPTOR";
+	case REG_RESOURCE_REQUIREMENTS_LIST: return "REG_RESOURCE_REQUIREMENTS_LIST";
+	case REG_QWORD: return "REG_QWORD";
+	default: return nullptr;
+	}
+}
+
+void ConvertToUtf8(std::wstring_view svValue, std::string& saResult)
+{
+	saResult.clear();
+	if (svValue.empty())
+	{
+		return;
+	}
+	// Note: Invalid UTF-16 (eg: unpaired surrogates, which the registry allows) is replaced with U+FFFD
+	auto nValueLength = util::range_checked_cast<int>(svValue.size());
+	auto nResultLength = ::WideCharToMultiByte(CP_UTF8, 0, svValue.data(), nValueLength, NULL, 0, NULL, NULL);
+	if (nResultLength <= 0)
+	{
+		return;
+	}
+	saResult.resize(static_cast<size_t>(nResultLength));
+	::WideCharToMultiByte(CP_UTF8, 0, svValue.data(), nValueLength, saResult.data(), nResultLength, NULL, NULL);
+}
+void ConvertToUtf8(std::string_view svValue, std::string& saResult)
+{
+	// Note: For multi-byte builds, names and string data are in the ANSI code page
+	auto nValueLength = util::range_checked_cast<int>(svValue.size());
+	auto nWideLength = (nValueLength > 0) ? ::MultiByteToWideChar(CP_ACP, 0, svValue.data(), nValueLength, NULL, 0) : 0;
+	auto swValue = std::wstring(static_cast<size_t>((std::max)(nWideLength, 0)), L'\0');
+	if (nWideLength > 0)
+	{
+		::MultiByteToWideChar(CP_ACP, 0, svValue.data(), nValueLength, swValue.data(), nWideLength);
+	}
+	ConvertToUtf8(std::wstring_view{ swValue }, saResult);
+}
+
+void AppendJsonString(std::string& saOutput, std::string_view svaUtf8)
+{
+	static constexpr char arrHexDigits[] = "0123456789ABCDEF";
+
+	saOutput += '"';
+	for (auto ch : svaUtf8)
+	{
+		switch (ch)
+		{
+		case '"': saOutput += "\\\""; break;
+		case '\\': saOutput += "\\\\"; break;
+		case '\b': saOutput += "\\b"; break;
+		case '\f': saOutput += "\\f"; break;
+		case '\n': saOutput += "\\n"; break;
+		case '\r': saOutput += "\\r"; break;
+		case '\t': saOutput += "\\t"; break;
+		default:
+			if (static_cast<unsigned char>(ch) < 0x20)
+			{
+				saOutput += "\\u00";
+				saOutput += arrHexDigits[(ch >> 4) & 0xF];
+				saOutput += arrHexDigits[ch & 0xF];
+			}
+			else
+			{
+				saOutput += ch;
+			}
+			break;
+		}
+	}
+	saOutput += '"';
+}
+
+template <typename TValue>
+void AppendJsonNumber(std::string& saOutput, TValue tValue)
+{
+	char arrDigits[24]{};
+	auto oResult = std::to_chars(std::begin(arrDigits), std::end(arrDigits), tValue);
+	saOutput.append(arrDigits, oResult.ptr);
+}
+
+} // namespace
+
+struct CRegistryAccessExport::ExportContext
+{
+	const OnOutput& m_fOnOutput;
+	const Options_Export& m_options;
+	Result_Export& m_oResult;
+
+	std::string m_saOutput;
+	std::string m_saScratch;
+	// Note: Offset in the output buffer where the current record starts; npos once part of the record was written
+	size_t m_nRecordStartOffset{};
+	// Note: Set if the sink failed; the export then fails, whatever the result code (it is not a key read failure)
+	bool m_bOutputFailed = false;
+
+	void appendString(vlr::tstring_view svValue)
+	{
+		ConvertToUtf8(svValue, m_saScratch);
+		AppendJsonString(m_saOutput, m_saScratch);
+	}
+
+	SResult flush()
+	{
+		if (m_saOutput.empty())
+		{
+			return SResult::Success_NoWorkDone;
+		}
+		auto sr = m_fOnOutput(m_saOutput);
+		if (!sr.isSuccess())
+		{
+			m_bOutputFailed = true;
+			return sr;
+		}
+		m_oResult.m_nBytesWritten += m_saOutput.size();
+		m_saOutput.clear();
+		m_nRecordStartOffset = std::string::npos;
+		return SResult::Success;
+	}
+	SResult flushIfFull()
+	{
+		if (m_saOutput.size() < m_options.m_nOutputBufferSize)
+		{
+			return SResult::Success_NoWorkDone;
+		}
+		return flush();
+	}
+
+	ExportContext(const OnOutput& fOnOutput, const Options_Export& options, Result_Export& oResult)
+		: m_fOnOutput{ fOnOutput }
+		, m_options{ options }
+		, m_oResult{ oResult }
+	{
+		m_saOutput.reserve(m_options.m_nOutputBufferSize);
+	}
+};
+
+SResult CRegistryAccessExport::exportKey(
+	ExportContext& oContext,
+	const vlr::tstring& sKeyPath,
+	std::vector<vlr::tstring>& arrSubkeyPaths) const
+{
+	SResult sr;
+
+	HKEY hKey{};
+	sr = m_oRegistryAccess.OpenKey(sKeyPath, KEY_READ, hKey);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hKey);
+	auto onDestroy_CloseRegKey = AutoCloseRegKey{ hKey };
+
+	auto& saOutput = oContext.m_saOutput;
+
+	saOutput += "{\"key\":";
+	oContext.appendString(sKeyPath);
+	saOutput += ",\"values\":[";
+
+	size_t nValueCount = 0;
+	sr = m_oRegistryAccess.EnumAllValuesFromOpenKey(hKey, [&](const CRegistryAccess::EnumValueData& oEnumValueData)
+	{
+		if (nValueCount > 0)
+		{
+			saOutput += ',';
+		}
+		++nValueCount;
+
+		saOutput += "{\"name\":";
+		oContext.appendString(oEnumValueData.m_svName);
+		saOutput += ",\"type\":";
+		if (auto pszTypeName = GetRegTypeName(oEnumValueData.m_dwType))
+		{
+			saOutput += '"';
+			saOutput += pszTypeName;
+			saOutput += '"';
+		}
+		else
+		{
+			AppendJsonNumber(saOutput, oEnumValueData.m_dwType);
+		}
+
+		if (auto oValue = oEnumValueData.AsDWORD())
+		{
+			saOutput += ",\"data\":";
+			AppendJsonNumber(saOutput, oValue.value());
+		}
+		else if (auto oValue = oEnumValueData.AsQWORD())
+		{
+			saOutput += ",\"data\":";
+			AppendJsonNumber(saOutput, oValue.value());
+		}
+		else if ((oEnumValueData.m_dwType == REG_DWORD_BIG_ENDIAN) && (oEnumValueData.m_spanData.size() == sizeof(DWORD)))
+		{
+			DWORD dwValue{};
+			std::memcpy(&dwValue, oEnumValueData.m_spanData.data(), sizeof(dwValue));
+			saOutput += ",\"data\":";
+			AppendJsonNumber(saOutput, _byteswap_ulong(dwValue));
+		}
+		else if (auto oValue = oEnumValueData.AsStringView())
+		{
+			saOutput += ",\"data\":";
+			oContext.appendString(oValue.value());
+		}
+		else if (auto oValue = oEnumValueData.AsMultiSzRange())
+		{
+			saOutput += ",\"data\":[";
+			bool bFirst = true;
+			for (auto svString : oValue.value())
+			{
+				if (!bFirst)
+				{
+					saOutput += ',';
+				}
+				bFirst = false;
+				oContext.appendString(svString);
+			}
+			saOutput += ']';
+		}
+		else
+		{
+			saOutput += ",\"base64\":\"";
+			strings::AppendBase64(oEnumValueData.m_spanData.data(), oEnumValueData.m_spanData.size(), saOutput);
+			saOutput += '"';
+		}
+		saOutput += '}';
+
+		return oContext.flushIfFull();
+	});
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	saOutput += "]}";
+
+	sr = m_oRegistryAccess.EnumAllSubkeysFromOpenKey(hKey, [&](const CRegistryAccess::EnumSubkeyData& oEnumSubkeyData)
+	{
+		arrSubkeyPaths.push_back(MakeSubkeyPath(sKeyPath, oEnumSubkeyData.m_svName));
+		return SResult::Success;
+	});
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	oContext.m_oResult.m_nValuesExported += nValueCount;
+
+	return SResult::Success;
+}
+
+SResult CRegistryAccessExport::ExportToCallback(
+	tzstring_view svzRootKeyPath,
+	const OnOutput& fOnOutput,
+	const Options_Export& options /*= {}*/,
+	Result_Export* pResult /*= nullptr*/) const
+{
+	SResult sr;
+
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(fOnOutput);
+
+	auto oResult = Result_Export{};
+	auto oContext = ExportContext{ fOnOutput, options, oResult };
+	auto& saOutput = oContext.m_saOutput;
+
+	bool bIsJsonArray = (options.m_eFormat == RegistryAccess::ExportFormat::Json);
+	if (bIsJsonArray)
+	{
+		saOutput += '[';
+	}
+
+	// Note: Depth-first; the stack holds only the subkey paths of keys on the current path
+	std::vector<vlr::tstring> arrPendingKeyPaths;
+	arrPendingKeyPaths.emplace_back(svzRootKeyPath);
+	std::vector<vlr::tstring> arrSubkeyPaths;
+
+	while (!arrPendingKeyPaths.empty())
+	{
+		auto sKeyPath = std::move(arrPendingKeyPaths.back());
+		arrPendingKeyPaths.pop_back();
+		bool bIsRoot = (oResult.m_nKeysExported == 0) && (oResult.m_nKeysSkipped == 0);
+
+		auto nRecordSeparatorOffset = saOutput.size();
+		if (bIsJsonArray)
+		{
+			saOutput += (oResult.m_nKeysExported > 0) ? ",\n" : "\n";
+		}
+		oContext.m_nRecordStartOffset = nRecordSeparatorOffset;
+
+		arrSubkeyPaths.clear();
+		sr = exportKey(oContext, sKeyPath, arrSubkeyPaths);
+		if (!sr.isSuccess() && oContext.m_bOutputFailed)
+		{
+			if (pResult)
+			{
+				*pResult = oResult;
+			}
+			return sr;
+		}
+		if (!sr.isSuccess())
+		{
+			bool bRecordPartiallyWritten = (oContext.m_nRecordStartOffset == std::string::npos);
+			if (bIsRoot || bRecordPartiallyWritten || !CRegistryAccess::IsSkippableResultForWalk(sr))
+			{
+				if (pResult)
+				{
+					*pResult = oResult;
+				}
+				return sr;
+			}
+			saOutput.resize(oContext.m_nRecordStartOffset);
+			++oResult.m_nKeysSkipped;
+			continue;
+		}
+		if (!bIsJsonArray)
+		{
+			saOutput += '\n';
+		}
+		++oResult.m_nKeysExported;
+
+		// Note: Pushed in reverse, so that subkeys are exported in enumeration order
+		for (auto iterSubkeyPath = arrSubkeyPaths.rbegin(); iterSubkeyPath != arrSubkeyPaths.rend(); ++iterSubkeyPath)
+		{
+			arrPendingKeyPaths.push_back(std::move(*iterSubkeyPath));
+		}
+
+		sr = oContext.flushIfFull();
+		if (!sr.isSuccess())
+		{
+			if (pResult)
+			{
+				*pResult = oResult;
+			}
+			return sr;
+		}
+	}
+
+	if (bIsJsonArray)
+	{
+		saOutput += "\n]\n";
+	}
+	sr = oContext.flush();
+
+	if (pResult)
+	{
+		*pResult = oResult;
+	}
+
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	return SResult::Success;
+}
+
+SResult CRegistryAccessExport::ExportToFileHandle(
+	tzstring_view svzRootKeyPath,
+	HANDLE hFile,
+	const Options_Export& options /*= {}*/,
+	Result_Export* pResult /*= nullptr*/) const
+{
+	VLR_ASSERT_COMPARE_OR_RETURN_EUNEXPECTED(hFile, !=, INVALID_HANDLE_VALUE);
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hFile);
+
+	auto fOnOutput = [&](std::string_view svOutput) -> SResult
+	{
+		while (!svOutput.empty())
+		{
+			auto dwBytesToWrite = static_cast<DWORD>((std::min)(svOutput.size(), size_t{ MAXDWORD }));
+			DWORD dwBytesWritten{};
+			if (!::WriteFile(hFile, svOutput.data(), dwBytesToWrite, &dwBytesWritten, NULL))
+			{
+				return SResult::For_win32_ErrorCode(::GetLastError());
+			}
+			if (dwBytesWritten == 0)
+			{
+				return SResult::For_win32_ErrorCode(ERROR_WRITE_FAULT);
+			}
+			svOutput.remove_prefix(dwBytesWritten);
+		}
+		return SResult::Success;
+	};
+
+	return ExportToCallback(svzRootKeyPath, fOnOutput, options, pResult);
+}
+
+} // namespace win32
+
+} // namespace vlr
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <vlr-util/util.includes.h>
+#include <vlr-util/util.Result.h>
+#include <vlr-util/zstring_view.h>
+
+#include "RegistryAccess.h"
+
+namespace vlr {
+
+namespace win32 {
+
+namespace RegistryAccess {
+
+enum class ExportFormat
+{
+	// One JSON array of key records
+	Json,
+	// One key record per line (newline-delimited JSON)
+	NDJson,
+};
+
+} // namespace RegistryAccess
+
+// Streaming export of a registry subtree as JSON or NDJSON (UTF-8), to an open file handle or a callback.
+// One record is written per key, in depth-first order, eg:
+//   {"key":"SOFTWARE\\vlr-test","values":[{"name":"testDWORD","type":"REG_DWORD","data":42},...]}
+// DWORD and QWORD values are written as numbers, SZ and EXPAND_SZ as strings, and MULTI_SZ as arrays of strings. Other
+// types (and data whose size is not valid for its type) are written base64 encoded, as "base64" instead of "data".
+// Values are encoded directly from the enumeration buffer into an output buffer, which is written to the sink
+// whenever it fills; memory use is bounded by the output buffer size plus the largest single value, and the subkey
+// names still to be visited, not by the size of the subtree.
+// Note: Keys which cannot be read (eg: access denied, or deleted during the export) are skipped, unless part of
+// the key's record was already written to the sink (the export then fails, rather than write a broken record).
+// A failure from the sink always fails the export, whatever its result code.
+
+class CRegistryAccessExport
+{
+public:
+	// Note: Called with each chunk of output; returning failure stops the export, and is returned from it.
+	using OnOutput = std::function<SResult(std::string_view svOutput)>;
+
+	struct Options_Export
+	{
+		RegistryAccess::ExportFormat m_eFormat = RegistryAccess::ExportFormat::NDJson;
+		size_t m_nOutputBufferSize = 64 * 1024;
+
+		decltype(auto) withFormat(RegistryAccess::ExportFormat eFormat)
+		{
+			m_eFormat = eFormat;
+			return *this;
+		}
+		decltype(auto) withOutputBufferSize(size_t nOutputBufferSize)
+		{
+			m_nOutputBufferSize = nOutputBufferSize;
+			return *this;
+		}
+	};
+
+	struct Result_Export
+	{
+		size_t m_nKeysExported{};
+		size_t m_nKeysSkipped{};
+		size_t m_nValuesExported{};
+		size_t m_nBytesWritten{};
+	};
+
+protected:
+	struct ExportContext;
+
+	CRegistryAccess m_oRegistryAccess;
+
+protected:
+	SResult exportKey(
+		ExportContext& oContext,
+		const vlr::tstring& sKeyPath,
+		std::vector<vlr::tstring>& arrSubkeyPaths) const;
+
+public:
+	// Note: The key paths in the output are full paths (relative to the base key)
+	SResult ExportToCallback(
+		tzstring_view svzRootKeyPath,
+		const OnOutput& fOnOutput,
+		const Options_Export& options = {},
+		Result_Export* pResult = nullptr) const;
+	// Note: Writes at the current position of the handle (file or pipe), which the caller owns
+	SResult ExportToFileHandle(
+		tzstring_view svzRootKeyPath,
+		HANDLE hFile,
+		const Options_Export& options = {},
+		Result_Export* pResult = nullptr) const;
+
+public:
+	// Note: The registry access instance is copied; the base key must remain open for the life of this instance.
+	CRegistryAccessExport(const CRegistryAccess& oRegistryAccess)
+		: m_oRegistryAccess{ oRegistryAccess }
+	{}
+};
+
+} // namespace win32
+
+} // namespace vlr
@@ -0,0 +1,581 @@
+#include "pch.h"
+#include "RegistryAccess_Index.h"
+
+#include <algorithm>
+
+#include <vlr-util/StringCompare.h>
+#include <vlr-util/util.range_checked_cast.h>
+
+#include "AutoCleanupTypedefs.h"
+#include "filesystem.Functions.h"
+#include "registry.KeyHandle.h"
+#include "serialization.BinaryStream.h"
+#include "strings.CaseFold.h"
+#include "strings.FindSubstring.h"
+
+namespace vlr {
+
+namespace win32 {
+
+namespace {
+
+static constexpr uint32_t IndexFile_Signature = 0x58494C56; // "VLIX"
+// Note: Version 2 folds tokens with the ordinal (locale-independent) fold; version 1 used the user's locale
+static constexpr uint32_t IndexFile_Version = 2;
+
+template <typename TOnString>
+void ForEachStringInValueData(const CRegistryAccess::EnumValueData& oEnumValueData, const TOnString& fOnString)
+{
+	if (auto oStringView = oEnumValueData.AsStringView())
+	{
+		fOnString(oStringView.value());
+		return;
+	}
+	if (auto oMultiSzRange = oEnumValueData.AsMultiSzRange())
+	{
+		for (const auto& svElement : oMultiSzRange.value())
+		{
+			fOnString(svElement);
+		}
+	}
+}
+
+inline ULONGLONG ToULL(const FILETIME& ft)
+{
+	return (static_cast<ULONGLONG>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+}
+
+inline vlr::tstring_view GetLastPathComponent(vlr::tstring_view svKeyPath)
+{
+	auto nSeparatorIndex = svKeyPath.find_last_of(_T('\\'));
+	return (nSeparatorIndex == vlr::tstring_view::npos) ? svKeyPath : svKeyPath.substr(nSeparatorIndex + 1);
+}
+
+} // namespace
+
+uint32_t CRegistryAccessIndex::IndexData::internToken(vlr::tstring_view svToken)
+{
+	auto sToken = vlr::tstring{ svToken };
+	auto iterToken = m_mapTokenToId.find(sToken);
+	if (iterToken != m_mapTokenToId.end())
+	{
+		return iterToken->second;
+	}
+
+	auto nTokenId = util::range_checked_cast<uint32_t>(m_arrTokens.size());
+	m_arrTokens.push_back(sToken);
+	m_mapTokenToId.emplace(std::move(sToken), nTokenId);
+	return nTokenId;
+}
+
+void CRegistryAccessIndex::IndexData::rebuildPostings()
+{
+	m_arrTokenIdToKeyIndexes.clear();
+	m_arrTokenIdToKeyIndexes.resize(m_arrTokens.size());
+	for (size_t nKeyIndex = 0; nKeyIndex < m_arrKeyEntries.size(); ++nKeyIndex)
+	{
+		for (auto nTokenId : m_arrKeyEntries[nKeyIndex].m_arrTokenIds)
+		{
+			// Note: Keys are visited in order, so each posting list is already sorted
+			m_arrTokenIdToKeyIndexes[nTokenId].push_back(static_cast<uint32_t>(nKeyIndex));
+		}
+	}
+}
+
+class CRegistryAccessIndex::CRefreshWalk
+{
+protected:
+	const CRegistryAccess& m_oRegistryAccess;
+	const IndexData& m_oIndexData_Previous;
+	std::unordered_map<vlr::tstring_view, size_t> m_mapKeyPathToIndex_Previous;
+	std::vector<bool> m_arrKeyVisited_Previous;
+	ULONGLONG m_nRecentWriteThreshold{};
+
+public:
+	IndexData m_oIndexData;
+	Result_Refresh m_oResult;
+
+protected:
+	void setSortedTokenIds(KeyEntry& oKeyEntry, const std::vector<vlr::tstring>& arrTokens)
+	{
+		oKeyEntry.m_arrTokenIds.reserve(arrTokens.size());
+		for (const auto& sToken : arrTokens)
+		{
+			oKeyEntry.m_arrTokenIds.push_back(m_oIndexData.internToken(sToken));
+		}
+		std::sort(oKeyEntry.m_arrTokenIds.begin(), oKeyEntry.m_arrTokenIds.end());
+		oKeyEntry.m_arrTokenIds.erase(std::unique(oKeyEntry.m_arrTokenIds.begin(), oKeyEntry.m_arrTokenIds.end()), oKeyEntry.m_arrTokenIds.end());
+	}
+
+	bool tryReusePreviousEntry(KeyEntry& oKeyEntry)
+	{
+		auto iterPrevious = m_mapKeyPathToIndex_Previous.find(oKeyEntry.m_sKeyPath);
+		if (iterPrevious == m_mapKeyPathToIndex_Previous.end())
+		{
+			return false;
+		}
+		m_arrKeyVisited_Previous[iterPrevious->second] = true;
+
+		const auto& oKeyEntry_Previous = m_oIndexData_Previous.m_arrKeyEntries[iterPrevious->second];
+		if ((ToULL(oKeyEntry_Previous.m_ftLastWriteTime) == 0)
+			|| (::CompareFileTime(&oKeyEntry_Previous.m_ftLastWriteTime, &oKeyEntry.m_ftLastWriteTime) != 0))
+		{
+			return false;
+		}
+
+		std::vector<vlr::tstring> arrTokens;
+		arrTokens.reserve(oKeyEntry_Previous.m_arrTokenIds.size());
+		for (auto nTokenId : oKeyEntry_Previous.m_arrTokenIds)
+		{
+			arrTokens.push_back(m_oIndexData_Previous.m_arrTokens[nTokenId]);
+		}
+		setSortedTokenIds(oKeyEntry, arrTokens);
+		return true;
+	}
+
+	SResult readKeyTokens(HKEY hKey, vlr::tstring_view svKeyName, KeyEntry& oKeyEntry)
+	{
+		std::vector<vlr::tstring> arrTokens;
+		TokenizeText(svKeyName, arrTokens);
+
+		auto sr = m_oRegistryAccess.EnumAllValuesFromOpenKey(hKey, [&](const CRegistryAccess::EnumValueData& oEnumValueData) -> SResult
+		{
+			TokenizeText(oEnumValueData.m_svName, arrTokens);
+			ForEachStringInValueData(oEnumValueData, [&](vlr::tstring_view svString)
+			{
+				TokenizeText(svString, arrTokens);
+			});
+			return SResult::Success;
+		});
+		if (!sr.isSuccess())
+		{
+			if (!CRegistryAccess::IsSkippableResultForWalk(sr))
+			{
+				return sr;
+			}
+			// Note: Keep what was read (at least the key name), and re-read on the next refresh
+			++m_oResult.m_nKeysSkipped;
+			oKeyEntry.m_ftLastWriteTime = {};
+		}
+
+		// Note: The write time has coarse granularity, so a write landing in the same tick as a very recent write
+		// would not change it; do not trust very recent times for the next refresh (same as incremental reload).
+		if (ToULL(oKeyEntry.m_ftLastWriteTime) >= m_nRecentWriteThreshold)
+		{
+			oKeyEntry.m_ftLastWriteTime = {};
+		}
+
+		setSortedTokenIds(oKeyEntry, arrTokens);
+		return SResult::Success;
+	}
+
+public:
+	SResult walkKey(HKEY hKey, vlr::tstring& sKeyPath, vlr::tstring_view svKeyName, const FILETIME& ftLastWriteTime)
+	{
+		SResult sr;
+
+		++m_oResult.m_nKeysVisited;
+
+		KeyEntry oKeyEntry;
+		oKeyEntry.m_sKeyPath = sKeyPath;
+		oKeyEntry.m_ftLastWriteTime = ftLastWriteTime;
+		if (tryReusePreviousEntry(oKeyEntry))
+		{
+			++m_oResult.m_nKeysReused;
+		}
+		else
+		{
+			sr = readKeyTokens(hKey, svKeyName, oKeyEntry);
+			VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+			++m_oResult.m_nKeysReindexed;
+		}
+		m_oIndexData.m_arrKeyEntries.push_back(std::move(oKeyEntry));
+
+		struct SubkeyInfo
+		{
+			vlr::tstring m_sName;
+			FILETIME m_ftLastWriteTime{};
+		};
+		std::vector<SubkeyInfo> arrSubkeys;
+		sr = m_oRegistryAccess.EnumAllSubkeysFromOpenKey(hKey, [&](const CRegistryAccess::EnumSubkeyData& oEnumSubkeyData) -> SResult
+		{
+			arrSubkeys.push_back(SubkeyInfo{ vlr::tstring{ oEnumSubkeyData.m_svName }, oEnumSubkeyData.m_ftLastWriteTime });
+			return SResult::Success;
+		});
+		if (!sr.isSuccess())
+		{
+			if (!CRegistryAccess::IsSkippableResultForWalk(sr))
+			{
+				return sr;
+			}
+			++m_oResult.m_nKeysSkipped;
+			return SResult::Success;
+		}
+
+		for (const auto& oSubkeyInfo : arrSubkeys)
+		{
+			HKEY hSubkey{};
+			sr = m_oRegistryAccess.OpenSubkeyFromOpenKey(hKey, oSubkeyInfo.m_sName, KEY_READ, hSubkey);
+			if (!sr.isSuccess())
+			{
+				if (!CRegistryAccess::IsSkippableResultForWalk(sr))
+				{
+					return sr;
+				}
+				++m_oResult.m_nKeysSkipped;
+				continue;
+			}
+			auto onDestroy_CloseRegKey = AutoCloseRegKey{ hSubkey };
+
+			auto nKeyPathLength = sKeyPath.size();
+			if (!sKeyPath.empty())
+			{
+				sKeyPath += _T('\\');
+			}
+			sKeyPath += oSubkeyInfo.m_sName;
+			sr = walkKey(hSubkey, sKeyPath, oSubkeyInfo.m_sName, oSubkeyInfo.m_ftLastWriteTime);
+			sKeyPath.resize(nKeyPathLength);
+			VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+		}
+
+		return SResult::Success;
+	}
+
+	void finalize()
+	{
+		for (bool bVisited : m_arrKeyVisited_Previous)
+		{
+			if (!bVisited)
+			{
+				++m_oResult.m_nKeysRemoved;
+			}
+		}
+		m_oIndexData.rebuildPostings();
+	}
+
+public:
+	CRefreshWalk(const CRegistryAccess& oRegistryAccess, const IndexData& oIndexData_Previous)
+		: m_oRegistryAccess{ oRegistryAccess }
+		, m_oIndexData_Previous{ oIndexData_Previous }
+	{
+		m_mapKeyPathToIndex_Previous.reserve(oIndexData_Previous.m_arrKeyEntries.size());
+		for (size_t nKeyIndex = 0; nKeyIndex < oIndexData_Previous.m_arrKeyEntries.size(); ++nKeyIndex)
+		{
+			m_mapKeyPathToIndex_Previous.emplace(oIndexData_Previous.m_arrKeyEntries[nKeyIndex].m_sKeyPath, nKeyIndex);
+		}
+		m_arrKeyVisited_Previous.resize(oIndexData_Previous.m_arrKeyEntries.size());
+
+		static constexpr ULONGLONG nRecentWriteWindow_100ns = 2ULL * 10 * 1000 * 1000;
+		FILETIME ftNow{};
+		::GetSystemTimeAsFileTime(&ftNow);
+		m_nRecentWriteThreshold = ToULL(ftNow) - nRecentWriteWindow_100ns;
+	}
+};
+
+void CRegistryAccessIndex::TokenizeText(
+	vlr::tstring_view svText,
+	std::vector<vlr::tstring>& arrTokens)
+{
+	static constexpr size_t nMinTokenLength = 2;
+
+	auto fIsTokenChar = [](TCHAR tChar)
+	{
+		return false
+			|| !strings::detail::IsAsciiChar(tChar)
+			|| ((tChar >= _T('0')) && (tChar <= _T('9')))
+			|| ((tChar >= _T('a')) && (tChar <= _T('z')))
+			|| ((tChar >= _T('A')) && (tChar <= _T('Z')));
+	};
+
+	size_t nTokenStartIndex = vlr::tstring_view::npos;
+	for (size_t i = 0; i <= svText.size(); ++i)
+	{
+		if ((i < svText.size()) && fIsTokenChar(svText[i]))
+		{
+			if (nTokenStartIndex == vlr::tstring_view::npos)
+			{
+				nTokenStartIndex = i;
+			}
+			continue;
+		}
+		if (nTokenStartIndex == vlr::tstring_view::npos)
+		{
+			continue;
+		}
+
+		auto nTokenLength = i - nTokenStartIndex;
+		if (nTokenLength >= nMinTokenLength)
+		{
+			auto sToken = vlr::tstring{ svText.substr(nTokenStartIndex, nTokenLength) };
+			// Note: Same fold as the case-insensitive name compare; not locale-dependent, since the index is persisted
+			strings::detail::FoldToUpper_Scalar(sToken.data(), sToken.size());
+			arrTokens.push_back(std::move(sToken));
+		}
+		nTokenStartIndex = vlr::tstring_view::npos;
+	}
+}
+
+SResult CRegistryAccessIndex::Refresh(
+	Result_Refresh* pResult /*= nullptr*/)
+{
+	SResult sr;
+
+	CRegistryAccess::KeyInfo oKeyInfo;
+	sr = m_oRegistryAccess.ReadKeyInfo(m_sRootKeyPath, oKeyInfo);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	HKEY hKey{};
+	sr = m_oRegistryAccess.OpenKey(m_sRootKeyPath, KEY_READ, hKey);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	auto onDestroy_CloseRegKey = AutoCloseRegKey{ hKey };
+
+	CRefreshWalk oRefreshWalk{ m_oRegistryAccess, m_oIndexData };
+	auto sKeyPath = m_sRootKeyPath;
+	sr = oRefreshWalk.walkKey(hKey, sKeyPath, GetLastPathComponent(m_sRootKeyPath), oKeyInfo.m_ftLastWriteTime);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	oRefreshWalk.finalize();
+
+	// Note: The previous index is only replaced once the walk has fully succeeded
+	m_oIndexData = std::move(oRefreshWalk.m_oIndexData);
+	if (pResult)
+	{
+		*pResult = oRefreshWalk.m_oResult;
+	}
+
+	return SResult::Success;
+}
+
+bool CRegistryAccessIndex::isPhrasePresentInKey(
+	const vlr::tstring& sKeyPath,
+	vlr::tstring_view svPhrase) const
+{
+	auto fContainsPhrase = [&](vlr::tstring_view svText)
+	{
+		return (strings::FindSubstring_CaseInsensitive<TCHAR>(svText, svPhrase) != vlr::tstring_view::npos);
+	};
+
+	if (fContainsPhrase(GetLastPathComponent(sKeyPath)))
+	{
+		return true;
+	}
+
+	HKEY hKey{};
+	auto sr = m_oRegistryAccess.OpenKey(sKeyPath, KEY_READ, hKey);
+	if (!sr.isSuccess())
+	{
+		return false;
+	}
+	auto onDestroy_CloseRegKey = AutoCloseRegKey{ hKey };
+
+	bool bFound = false;
+	m_oRegistryAccess.EnumAllValuesFromOpenKey(hKey, [&](const CRegistryAccess::EnumValueData& oEnumValueData) -> SResult
+	{
+		bFound = fContainsPhrase(oEnumValueData.m_svName);
+		ForEachStringInValueData(oEnumValueData, [&](vlr::tstring_view svString)
+		{
+			bFound = bFound || fContainsPhrase(svString);
+		});
+		// Note: Failure result stops the enumeration once found
+		return bFound ? SResult{ E_ABORT } : SResult::Success;
+	});
+
+	return bFound;
+}
+
+SResult CRegistryAccessIndex::Query(
+	vlr::tstring_view svQuery,
+	std::vector<vlr::tstring>& arrKeyPaths,
+	const Options_Query& options /*= {}*/) const
+{
+	arrKeyPaths.clear();
+
+	std::vector<vlr::tstring> arrQueryTokens;
+	TokenizeText(svQuery, arrQueryTokens);
+	if (arrQueryTokens.empty())
+	{
+		return E_INVALIDARG;
+	}
+
+	std::vector<const std::vector<uint32_t>*> arrPostingLists;
+	for (const auto& sQueryToken : arrQueryTokens)
+	{
+		auto iterToken = m_oIndexData.m_mapTokenToId.find(sQueryToken);
+		if (iterToken == m_oIndexData.m_mapTokenToId.end())
+		{
+			return SResult::Success;
+		}
+		arrPostingLists.push_back(&m_oIndexData.m_arrTokenIdToKeyIndexes[iterToken->second]);
+	}
+
+	// Note: Intersect starting from the shortest list, so the working set only shrinks
+	std::sort(arrPostingLists.begin(), arrPostingLists.end(), [](const auto* pLHS, const auto* pRHS)
+	{
+		return pLHS->size() < pRHS->size();
+	});
+	std::vector<uint32_t> arrKeyIndexes = *arrPostingLists.front();
+	std::vector<uint32_t> arrKeyIndexes_Intersection;
+	for (size_t i = 1; (i < arrPostingLists.size()) && !arrKeyIndexes.empty(); ++i)
+	{
+		arrKeyIndexes_Intersection.clear();
+		std::set_intersection(
+			arrKeyIndexes.begin(), arrKeyIndexes.end(),
+			arrPostingLists[i]->begin(), arrPostingLists[i]->end(),
+			std::back_inserter(arrKeyIndexes_Intersection));
+		arrKeyIndexes.swap(arrKeyIndexes_Intersection);
+	}
+
+	for (auto nKeyIndex : arrKeyIndexes)
+	{
+		if (arrKeyPaths.size() >= options.m_nMaxResults)
+		{
+			break;
+		}
+		const auto& sKeyPath = m_oIndexData.m_arrKeyEntries[nKeyIndex].m_sKeyPath;
+		if (options.m_bVerifyPhrase && !isPhrasePresentInKey(sKeyPath, svQuery))
+		{
+			continue;
+		}
+		arrKeyPaths.push_back(sKeyPath);
+	}
+
+	return SResult::Success;
+}
+
+SResult CRegistryAccessIndex::SaveToFile(
+	tzstring_view svzFilePath) const
+{
+	serialization::CBinaryWriter oWriter;
+
+	oWriter.Write(IndexFile_Signature);
+	oWriter.Write(IndexFile_Version);
+	oWriter.Write(static_cast<uint32_t>(sizeof(TCHAR)));
+	oWriter.Write(registry::GetPersistentBaseKeyId(m_oRegistryAccess.GetBaseKey()));
+	oWriter.WriteString<TCHAR>(m_sRootKeyPath);
+
+	oWriter.Write(util::range_checked_cast<uint32_t>(m_oIndexData.m_arrTokens.size()));
+	for (const auto& sToken : m_oIndexData.m_arrTokens)
+	{
+		oWriter.WriteString<TCHAR>(sToken);
+	}
+
+	oWriter.Write(util::range_checked_cast<uint32_t>(m_oIndexData.m_arrKeyEntries.size()));
+	for (const auto& oKeyEntry : m_oIndexData.m_arrKeyEntries)
+	{
+		oWriter.WriteString<TCHAR>(oKeyEntry.m_sKeyPath);
+		oWriter.Write(oKeyEntry.m_ftLastWriteTime);
+		oWriter.Write(util::range_checked_cast<uint32_t>(oKeyEntry.m_arrTokenIds.size()));
+		oWriter.WriteBytes(oKeyEntry.m_arrTokenIds.data(), oKeyEntry.m_arrTokenIds.size() * sizeof(uint32_t));
+	}
+
+	const auto& arrData = oWriter.GetData();
+	return filesystem::WriteFileContents(svzFilePath, arrData.data(), arrData.size());
+}
+
+SResult CRegistryAccessIndex::LoadFromFile(
+	tzstring_view svzFilePath)
+{
+	SResult sr;
+
+	std::vector<BYTE> arrData;
+	sr = filesystem::ReadFileContents(svzFilePath, arrData);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	static const auto srBadFormat = SResult::For_win32_ErrorCode(ERROR_BAD_FORMAT);
+	serialization::CBinaryReader oReader{ arrData };
+
+	uint32_t nSignature{};
+	uint32_t nVersion{};
+	uint32_t nCharSize{};
+	uint64_t nBaseKeyId{};
+	vlr::tstring sRootKeyPath;
+	if (false
+		|| !oReader.Read(nSignature).isSuccess()
+		|| !oReader.Read(nVersion).isSuccess()
+		|| !oReader.Read(nCharSize).isSuccess()
+		|| (nSignature != IndexFile_Signature)
+		|| (nVersion != IndexFile_Version)
+		|| (nCharSize != sizeof(TCHAR))
+		|| !oReader.Read(nBaseKeyId).isSuccess()
+		|| !oReader.ReadString(sRootKeyPath).isSuccess())
+	{
+		return srBadFormat;
+	}
+	auto nBaseKeyId_Current = registry::GetPersistentBaseKeyId(m_oRegistryAccess.GetBaseKey());
+	if (((nBaseKeyId != 0) && (nBaseKeyId_Current != 0) && (nBaseKeyId != nBaseKeyId_Current))
+		|| !StringCompare::CI().AreEqual(sRootKeyPath, m_sRootKeyPath))
+	{
+		return SResult::For_win32_ErrorCode(ERROR_INVALID_DATA);
+	}
+
+	IndexData oIndexData;
+
+	// Note: Counts are bounded by the remaining data (by each entry's minimum serialized size) before allocating, so a
+	// corrupt or truncated file fails the load instead of causing a huge allocation.
+	static constexpr size_t nMinTokenSize = sizeof(uint32_t);
+	static constexpr size_t nMinKeyEntrySize = sizeof(uint32_t) + sizeof(FILETIME) + sizeof(uint32_t);
+
+	uint32_t nTokenCount{};
+	if (false
+		|| !oReader.Read(nTokenCount).isSuccess()
+		|| (nTokenCount > oReader.GetRemainingSize() / nMinTokenSize))
+	{
+		return srBadFormat;
+	}
+	oIndexData.m_arrTokens.resize(nTokenCount);
+	oIndexData.m_mapTokenToId.reserve(nTokenCount);
+	for (uint32_t nTokenId = 0; nTokenId < nTokenCount; ++nTokenId)
+	{
+		auto& sToken = oIndexData.m_arrTokens[nTokenId];
+		if (!oReader.ReadString(sToken).isSuccess())
+		{
+			return srBadFormat;
+		}
+		oIndexData.m_mapTokenToId.emplace(sToken, nTokenId);
+	}
+
+	uint32_t nKeyCount{};
+	if (false
+		|| !oReader.Read(nKeyCount).isSuccess()
+		|| (nKeyCount > oReader.GetRemainingSize() / nMinKeyEntrySize))
+	{
+		return srBadFormat;
+	}
+	oIndexData.m_arrKeyEntries.resize(nKeyCount);
+	for (auto& oKeyEntry : oIndexData.m_arrKeyEntries)
+	{
+		uint32_t nKeyTokenCount{};
+		if (false
+			|| !oReader.ReadString(oKeyEntry.m_sKeyPath).isSuccess()
+			|| !oReader.Read(oKeyEntry.m_ftLastWriteTime).isSuccess()
+			|| !oReader.Read(nKeyTokenCount).isSuccess()
+			|| (nKeyTokenCount > oReader.GetRemainingSize() / sizeof(uint32_t)))
+		{
+			return srBadFormat;
+		}
+		oKeyEntry.m_arrTokenIds.resize(nKeyTokenCount);
+		if (!oReader.ReadBytes(oKeyEntry.m_arrTokenIds.data(), nKeyTokenCount * sizeof(uint32_t)).isSuccess())
+		{
+			return srBadFormat;
+		}
+		for (auto nTokenId : oKeyEntry.m_arrTokenIds)
+		{
+			if (nTokenId >= nTokenCount)
+			{
+				return srBadFormat;
+			}
+		}
+	}
+	if (!oReader.IsAtEnd())
+	{
+		return srBadFormat;
+	}
+
+	oIndexData.rebuildPostings();
+	m_oIndexData = std::move(oIndexData);
+
+	return SResult::Success;
+}
+
+} // namespace win32
+
+} // namespace vlr
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include <vlr-util/util.includes.h>
+#include <vlr-util/util.Result.h>
+#include <vlr-util/zstring_view.h>
+
+#include "RegistryAccess.h"
+
+namespace vlr {
+
+namespace win32 {
+
+// Inverted index of the contents of a registry subtree, for repeated lookups of "which keys mention X" without
+// re-crawling the subtree for each lookup.
+// Tokens are taken from key names, value names, and string value data (REG_SZ, REG_EXPAND_SZ, REG_MULTI_SZ); a token
+// is a run of letters/digits (non-ASCII chars are treated as letters), case-folded with the locale-independent fold
+// used for registry names, of at least 2 chars. A query is tokenized the same way, and matches keys which contain all
+// of the query tokens.
+// Refresh walks the subtree, but only re-reads the values of keys whose last write time has changed since the
+// previous refresh (or load); keys which no longer exist are dropped. Note that a key's last write time does not
+// change when its descendants change, so the walk itself (subkey enumeration) is still required on each refresh.
+// The index can be saved to / loaded from a file, so it can be reused across processes.
+// Query is const, and can be called concurrently; Refresh and LoadFromFile require exclusive access.
+
+class CRegistryAccessIndex
+{
+public:
+	struct Result_Refresh
+	{
+		size_t m_nKeysVisited{};
+		size_t m_nKeysReindexed{};
+		size_t m_nKeysReused{};
+		size_t m_nKeysRemoved{};
+		size_t m_nKeysSkipped{};
+	};
+
+	struct Options_Query
+	{
+		// Note: If set, each candidate key is re-read, and only kept if the query text appears verbatim
+		// (case-insensitive) in the key name, a value name, or string data; this removes keys which only contain the
+		// query tokens separately. Keys which can no longer be read are dropped.
+		bool m_bVerifyPhrase = false;
+		size_t m_nMaxResults = SIZE_MAX;
+
+		decltype(auto) withVerifyPhrase(bool bVerifyPhrase)
+		{
+			m_bVerifyPhrase = bVerifyPhrase;
+			return *this;
+		}
+		decltype(auto) withMaxResults(size_t nMaxResults)
+		{
+			m_nMaxResults = nMaxResults;
+			return *this;
+		}
+	};
+
+protected:
+	struct KeyEntry
+	{
+		vlr::tstring m_sKeyPath;
+		// Note: Zero if the key's values should be re-read on the next refresh
+		FILETIME m_ftLastWriteTime{};
+		// Note: Sorted, unique
+		std::vector<uint32_t> m_arrTokenIds;
+	};
+
+	struct IndexData
+	{
+		std::vector<KeyEntry> m_arrKeyEntries;
+		std::vector<vlr::tstring> m_arrTokens;
+		std::unordered_map<vlr::tstring, uint32_t> m_mapTokenToId;
+		// Note: Posting lists; sorted key indexes for each token id
+		std::vector<std::vector<uint32_t>> m_arrTokenIdToKeyIndexes;
+
+		uint32_t internToken(vlr::tstring_view svToken);
+		void rebuildPostings();
+	};
+
+	CRegistryAccess m_oRegistryAccess;
+	vlr::tstring m_sRootKeyPath;
+	IndexData m_oIndexData;
+
+protected:
+	class CRefreshWalk;
+
+	bool isPhrasePresentInKey(
+		const vlr::tstring& sKeyPath,
+		vlr::tstring_view svPhrase) const;
+
+public:
+	// Splits the text into normalized (case-folded) tokens, appending them to the collection
+	static void TokenizeText(
+		vlr::tstring_view svText,
+		std::vector<vlr::tstring>& arrTokens);
+
+	SResult Refresh(
+		Result_Refresh* pResult = nullptr);
+
+	SResult Query(
+		vlr::tstring_view svQuery,
+		std::vector<vlr::tstring>& arrKeyPaths,
+		const Options_Query& options = {}) const;
+
+	// Note: Load fails with ERROR_BAD_FORMAT if the file is not a valid index (or is from an incompatible version),
+	// and ERROR_INVALID_DATA if it was built for a different base key or root path.
+	SResult SaveToFile(
+		tzstring_view svzFilePath) const;
+	SResult LoadFromFile(
+		tzstring_view svzFilePath);
+
+	inline size_t GetKeyCount() const
+	{
+		return m_oIndexData.m_arrKeyEntries.size();
+	}
+	inline size_t GetTokenCount() const
+	{
+		return m_oIndexData.m_arrTokens.size();
+	}
+
+public:
+	CRegistryAccessIndex(const CRegistryAccess& oRegistryAccess, tzstring_view svzRootKeyPath)
+		: m_oRegistryAccess{ oRegistryAccess }
+		, m_sRootKeyPath{ svzRootKeyPath }
+	{}
+};
+
+} // namespace win32
+
+} // namespace vlr
@@ -0,0 +1,191 @@
+#include "pch.h"
+#include "RegistryAccess_Instrumentation.h"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace vlr {
+
+namespace win32 {
+
+namespace RegistryAccess {
+
+namespace Instrumentation {
+
+void OperationStats::Add(const OperationStats& oOther)
+{
+	m_nCount += oOther.m_nCount;
+	m_nErrorCount += oOther.m_nErrorCount;
+	m_nRetryCount += oOther.m_nRetryCount;
+	m_nByteCount += oOther.m_nByteCount;
+	m_nTotalLatencyMicroseconds += oOther.m_nTotalLatencyMicroseconds;
+	for (size_t i = 0; i < m_arrLatencyHistogram.size(); ++i)
+	{
+		m_arrLatencyHistogram[i] += oOther.m_arrLatencyHistogram[i];
+	}
+}
+
+uint64_t OperationStats::GetApproxLatencyPercentileMicroseconds(double dPercentile) const
+{
+	uint64_t nHistogramCount = 0;
+	for (const auto& nBucketCount : m_arrLatencyHistogram)
+	{
+		nHistogramCount += nBucketCount;
+	}
+	if (nHistogramCount == 0)
+	{
+		return 0;
+	}
+
+	auto nTargetCount = static_cast<uint64_t>((dPercentile / 100.0) * static_cast<double>(nHistogramCount));
+	nTargetCount = (std::max)(nTargetCount, uint64_t{ 1 });
+
+	uint64_t nCumulativeCount = 0;
+	for (size_t i = 0; i < m_arrLatencyHistogram.size(); ++i)
+	{
+		nCumulativeCount += m_arrLatencyHistogram[i];
+		if (nCumulativeCount >= nTargetCount)
+		{
+			return uint64_t{ 1 } << i;
+		}
+	}
+
+	return uint64_t{ 1 } << (m_arrLatencyHistogram.size() - 1);
+}
+
+void ThreadOperationCounters::ReadInto(OperationStats& oOperationStats) const
+{
+	oOperationStats.m_nCount += m_nCount.load(std::memory_order_relaxed);
+	oOperationStats.m_nErrorCount += m_nErrorCount.load(std::memory_order_relaxed);
+	oOperationStats.m_nRetryCount += m_nRetryCount.load(std::memory_order_relaxed);
+	oOperationStats.m_nByteCount += m_nByteCount.load(std::memory_order_relaxed);
+	oOperationStats.m_nTotalLatencyMicroseconds += m_nTotalLatencyMicroseconds.load(std::memory_order_relaxed);
+	for (size_t i = 0; i < m_arrLatencyHistogram.size(); ++i)
+	{
+		oOperationStats.m_arrLatencyHistogram[i] += m_arrLatencyHistogram[i].load(std::memory_order_relaxed);
+	}
+}
+
+namespace {
+
+// Note: Only the owning thread writes, so a plain load/store is sufficient (no locked increment).
+inline void AddToCounter(std::atomic<uint64_t>& nCounter, uint64_t nValue)
+{
+	nCounter.store(nCounter.load(std::memory_order_relaxed) + nValue, std::memory_order_relaxed);
+}
+
+class CThreadCountersRegistry
+{
+public:
+	static auto& GetSharedInstance()
+	{
+		static CThreadCountersRegistry theInstance;
+		return theInstance;
+	}
+
+protected:
+	std::mutex m_mutexDataAccess;
+	std::vector<const ThreadCounters*> m_arrLiveThreadCounters;
+	// Note: Totals from threads which have exited
+	Snapshot m_oRetiredTotals;
+
+public:
+	void Register(const ThreadCounters* pThreadCounters)
+	{
+		auto slDataAccess = std::scoped_lock{ m_mutexDataAccess };
+
+		m_arrLiveThreadCounters.push_back(pThreadCounters);
+	}
+	void Unregister(const ThreadCounters* pThreadCounters)
+	{
+		auto slDataAccess = std::scoped_lock{ m_mutexDataAccess };
+
+		for (size_t i = 0; i < OperationType_Count; ++i)
+		{
+			pThreadCounters->m_arrOperationCounters[i].ReadInto(m_oRetiredTotals.m_arrOperationStats[i]);
+		}
+		m_arrLiveThreadCounters.erase(
+			std::remove(m_arrLiveThreadCounters.begin(), m_arrLiveThreadCounters.end(), pThreadCounters),
+			m_arrLiveThreadCounters.end());
+	}
+	Snapshot GetSnapshot()
+	{
+		auto slDataAccess = std::scoped_lock{ m_mutexDataAccess };
+
+		Snapshot oSnapshot = m_oRetiredTotals;
+		for (const auto* pThreadCounters : m_arrLiveThreadCounters)
+		{
+			for (size_t i = 0; i < OperationType_Count; ++i)
+			{
+				pThreadCounters->m_arrOperationCounters[i].ReadInto(oSnapshot.m_arrOperationStats[i]);
+			}
+		}
+
+		return oSnapshot;
+	}
+};
+
+class CThreadCountersRegistration
+{
+protected:
+	std::unique_ptr<ThreadCounters> m_upThreadCounters = std::make_unique<ThreadCounters>();
+
+public:
+	inline ThreadCounters& GetThreadCounters()
+	{
+		return *m_upThreadCounters;
+	}
+
+public:
+	CThreadCountersRegistration()
+	{
+		CThreadCountersRegistry::GetSharedInstance().Register(m_upThreadCounters.get());
+	}
+	~CThreadCountersRegistration()
+	{
+		CThreadCountersRegistry::GetSharedInstance().Unregister(m_upThreadCounters.get());
+	}
+};
+
+} // namespace
+
+Snapshot GetSnapshot()
+{
+	return CThreadCountersRegistry::GetSharedInstance().GetSnapshot();
+}
+
+ThreadCounters& GetCountersForCurrentThread()
+{
+	// Note: Ensure the registry outlives any thread registration which references it
+	static auto& oRegistry = CThreadCountersRegistry::GetSharedInstance();
+	(void)oRegistry;
+
+	thread_local CThreadCountersRegistration tl_oThreadCountersRegistration;
+	return tl_oThreadCountersRegistration.GetThreadCounters();
+}
+
+CScopedOperation::~CScopedOperation()
+{
+	auto durLatency = (std::chrono::steady_clock::now() - m_tpStart) - m_durExcluded;
+	auto nLatencyMicroseconds = static_cast<uint64_t>((std::max)(
+		std::chrono::duration_cast<std::chrono::microseconds>(durLatency).count(),
+		std::chrono::microseconds::rep{ 0 }));
+
+	auto& oCounters = GetCountersForCurrentThread().m_arrOperationCounters[m_eOperationType];
+	AddToCounter(oCounters.m_nCount, 1);
+	AddToCounter(oCounters.m_nErrorCount, m_bError ? 1 : 0);
+	AddToCounter(oCounters.m_nRetryCount, m_nRetryCount);
+	AddToCounter(oCounters.m_nByteCount, m_nByteCount);
+	AddToCounter(oCounters.m_nTotalLatencyMicroseconds, nLatencyMicroseconds);
+	AddToCounter(oCounters.m_arrLatencyHistogram[GetLatencyHistogramBucket(nLatencyMicroseconds)], 1);
+}
+
+} // namespace Instrumentation
+
+} // namespace RegistryAccess
+
+} // namespace win32
+
+} // namespace vlr
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+
+#include <vlr-util/util.includes.h>
+
+// Note: Instrumentation is compiled out unless this is defined to non-zero (eg: in the project preprocessor
+// definitions; the DebugInstrumented configuration does this for the library and its tests). It must be the same for
+// the library and its users. When disabled, the instrumentation macros expand to nothing, and snapshots are always
+// empty.
+
+#ifndef VLR_WIN32_CONFIG_REGISTRY_INSTRUMENTATION
+#define VLR_WIN32_CONFIG_REGISTRY_INSTRUMENTATION 0
+#endif
+
+namespace vlr {
+
+namespace win32 {
+
+namespace RegistryAccess {
+
+namespace Instrumentation {
+
+enum OperationType : size_t
+{
+	Open,
+	Query,
+	Enumerate,
+	Write,
+	OperationType_Count,
+};
+
+// Note: Latency buckets are log2 of microseconds; bucket 0 is < 1us, bucket N is [2^(N-1), 2^N) us, and the
+// last bucket holds everything larger.
+static constexpr size_t LatencyHistogramBucketCount = 32;
+
+constexpr size_t GetLatencyHistogramBucket(uint64_t nLatencyMicroseconds)
+{
+	size_t nBucket = 0;
+	while (nLatencyMicroseconds > 0 && nBucket < LatencyHistogramBucketCount - 1)
+	{
+		nLatencyMicroseconds >>= 1;
+		++nBucket;
+	}
+	return nBucket;
+}
+
+struct OperationStats
+{
+	uint64_t m_nCount = 0;
+	uint64_t m_nErrorCount = 0;
+	// Note: Retries are additional calls on ERROR_MORE_DATA
+	uint64_t m_nRetryCount = 0;
+	uint64_t m_nByteCount = 0;
+	uint64_t m_nTotalLatencyMicroseconds = 0;
+	std::array<uint64_t, LatencyHistogramBucketCount> m_arrLatencyHistogram{};
+
+	void Add(const OperationStats& oOther);
+
+	// Returns the upper bound (in us) of the bucket containing the given percentile (0..100)
+	uint64_t GetApproxLatencyPercentileMicroseconds(double dPercentile) const;
+};
+
+struct Snapshot
+{
+	std::array<OperationStats, OperationType_Count> m_arrOperationStats{};
+
+	inline const OperationStats& ForOperation(OperationType eOperationType) const
+	{
+		return m_arrOperationStats[eOperationType];
+	}
+};
+
+// Merges the counters from all live threads, and from threads which have exited, into one snapshot.
+Snapshot GetSnapshot();
+
+// Note: The per-thread counters are single-writer (the owning thread), and are read by snapshot from other
+// threads. Relaxed atomics are used so the owning thread never takes a lock or a locked RMW.
+
+struct ThreadOperationCounters
+{
+	std::atomic<uint64_t> m_nCount{};
+	std::atomic<uint64_t> m_nErrorCount{};
+	std::atomic<uint64_t> m_nRetryCount{};
+	std::atomic<uint64_t> m_nByteCount{};
+	std::atomic<uint64_t> m_nTotalLatencyMicroseconds{};
+	std::array<std::atomic<uint64_t>, LatencyHistogramBucketCount> m_arrLatencyHistogram{};
+
+	void ReadInto(OperationStats& oOperationStats) const;
+};
+
+struct ThreadCounters
+{
+	std::array<ThreadOperationCounters, OperationType_Count> m_arrOperationCounters;
+};
+
+ThreadCounters& GetCountersForCurrentThread();
+
+class CScopedOperation
+{
+protected:
+	OperationType m_eOperationType;
+	std::chrono::steady_clock::time_point m_tpStart;
+	uint64_t m_nRetryCount = 0;
+	uint64_t m_nByteCount = 0;
+	bool m_bError = false;
+	// Note: Time spent outside the operation (eg: in a caller's enumeration callback), which is not latency
+	std::chrono::steady_clock::duration m_durExcluded{};
+
+public:
+	inline void AddRetry()
+	{
+		++m_nRetryCount;
+	}
+	inline void AddBytes(size_t nByteCount)
+	{
+		m_nByteCount += nByteCount;
+	}
+	inline void OnResult(LONG lResult)
+	{
+		m_bError = (lResult != ERROR_SUCCESS) && (lResult != ERROR_MORE_DATA);
+	}
+	inline void OnHRESULT(HRESULT hr)
+	{
+		m_bError = FAILED(hr) && (hr != HRESULT_FROM_WIN32(ERROR_MORE_DATA));
+	}
+	// Note: For failures which are not a single call's result (eg: running out of retries on ERROR_MORE_DATA)
+	inline void OnError()
+	{
+		m_bError = true;
+	}
+	inline void ExcludeFromLatency(std::chrono::steady_clock::duration durExcluded)
+	{
+		m_durExcluded += durExcluded;
+	}
+
+public:
+	CScopedOperation(OperationType eOperationType)
+		: m_eOperationType{ eOperationType }
+		, m_tpStart{ std::chrono::steady_clock::now() }
+	{}
+	~CScopedOperation();
+};
+
+// Excludes the time spent in its scope from the operation's latency; eg: around the caller's enumeration callback,
+// so enumerate latency is the registry's time only.
+class CScopedLatencyExclusion
+{
+protected:
+	CScopedOperation& m_oOperation;
+	std::chrono::steady_clock::time_point m_tpStart;
+
+public:
+	CScopedLatencyExclusion(CScopedOperation& oOperation)
+		: m_oOperation{ oOperation }
+		, m_tpStart{ std::chrono::steady_clock::now() }
+	{}
+	~CScopedLatencyExclusion()
+	{
+		m_oOperation.ExcludeFromLatency(std::chrono::steady_clock::now() - m_tpStart);
+	}
+};
+
+} // namespace Instrumentation
+
+} // namespace RegistryAccess
+
+} // namespace win32
+
+} // namespace vlr
+
+#if VLR_WIN32_CONFIG_REGISTRY_INSTRUMENTATION
+
+#define VLR_REGISTRY_INSTRUMENT_OPERATION(varName, eOperationType) \
+	auto varName = ::vlr::win32::RegistryAccess::Instrumentation::CScopedOperation{ ::vlr::win32::RegistryAccess::Instrumentation::eOperationType }
+#define VLR_REGISTRY_INSTRUMENT_ON_RESULT(varName, lResult) varName.OnResult(lResult)
+#define VLR_REGISTRY_INSTRUMENT_ON_HRESULT(varName, hr) varName.OnHRESULT(hr)
+#define VLR_REGISTRY_INSTRUMENT_ADD_RETRY(varName) varName.AddRetry()
+#define VLR_REGISTRY_INSTRUMENT_ADD_BYTES(varName, nByteCount) varName.AddBytes(nByteCount)
+#define VLR_REGISTRY_INSTRUMENT_ON_ERROR(varName) varName.OnError()
+#define VLR_REGISTRY_INSTRUMENT_EXCLUDE_SCOPE(varName) \
+	auto varName##_oLatencyExclusion = ::vlr::win32::RegistryAccess::Instrumentation::CScopedLatencyExclusion{ varName }
+
+#else
+
+#define VLR_REGISTRY_INSTRUMENT_OPERATION(varName, eOperationType)
+#define VLR_REGISTRY_INSTRUMENT_ON_RESULT(varName, lResult)
+#define VLR_REGISTRY_INSTRUMENT_ON_HRESULT(varName, hr)
+#define VLR_REGISTRY_INSTRUMENT_ADD_RETRY(varName)
+#define VLR_REGISTRY_INSTRUMENT_ADD_BYTES(varName, nByteCount)
+#define VLR_REGISTRY_INSTRUMENT_ON_ERROR(varName)
+#define VLR_REGISTRY_INSTRUMENT_EXCLUDE_SCOPE(varName)
+
+#endif
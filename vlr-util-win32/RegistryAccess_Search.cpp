@@ -0,0 +1,467 @@
+#include "pch.h"
+#include "RegistryAccess_Search.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <vlr-util/ActionOnDestruction.h>
+
+#include "AutoCleanupTypedefs.h"
+#include "strings.FindSubstring.h"
+
+namespace vlr {
+
+namespace win32 {
+
+namespace {
+
+inline bool AreEqualChars_Glob(TCHAR tLHS, TCHAR tRHS, bool bCaseInsensitive)
+{
+	if (tLHS == tRHS)
+	{
+		return true;
+	}
+	if (!bCaseInsensitive)
+	{
+		return false;
+	}
+	if (strings::detail::IsAsciiChar(tLHS) && strings::detail::IsAsciiChar(tRHS))
+	{
+		return (strings::detail::ToAsciiLower(tLHS) == strings::detail::ToAsciiLower(tRHS));
+	}
+	return strings::detail::AreEqualChars_CaseInsensitive(&tLHS, &tRHS, 1);
+}
+
+// Note: Iterative match with single-star backtracking; linear in practice, worst case O(n*m)
+bool IsGlobMatch(vlr::tstring_view svValue, vlr::tstring_view svPattern, bool bCaseInsensitive)
+{
+	size_t nValueIndex = 0;
+	size_t nPatternIndex = 0;
+	size_t nStarPatternIndex = vlr::tstring_view::npos;
+	size_t nStarValueIndex = 0;
+
+	while (nValueIndex < svValue.size())
+	{
+		if (nPatternIndex < svPattern.size())
+		{
+			auto tPatternChar = svPattern[nPatternIndex];
+			if (tPatternChar == _T('*'))
+			{
+				nStarPatternIndex = nPatternIndex++;
+				nStarValueIndex = nValueIndex;
+				continue;
+			}
+			if ((tPatternChar == _T('?')) || AreEqualChars_Glob(tPatternChar, svValue[nValueIndex], bCaseInsensitive))
+			{
+				++nPatternIndex;
+				++nValueIndex;
+				continue;
+			}
+		}
+		if (nStarPatternIndex == vlr::tstring_view::npos)
+		{
+			return false;
+		}
+		nPatternIndex = nStarPatternIndex + 1;
+		nValueIndex = ++nStarValueIndex;
+	}
+	while ((nPatternIndex < svPattern.size()) && (svPattern[nPatternIndex] == _T('*')))
+	{
+		++nPatternIndex;
+	}
+
+	return (nPatternIndex == svPattern.size());
+}
+
+class CSearchWalk
+{
+public:
+	using SearchMatch = CRegistryAccessSearch::SearchMatch;
+
+protected:
+	const CRegistryAccess& m_oRegistryAccess;
+	const CRegistryAccessSearch::CPattern& m_oPattern;
+	const CRegistryAccessSearch::OnSearchMatch& m_fOnSearchMatch;
+	const CRegistryAccessSearch::Options_Search& m_options;
+
+	std::mutex m_mutexCallback;
+	std::atomic<bool> m_bStop{ false };
+	SResult m_srFailure;
+
+public:
+	std::atomic<size_t> m_nKeysVisited{};
+	std::atomic<size_t> m_nValuesVisited{};
+	std::atomic<size_t> m_nMatchCount{};
+	std::atomic<size_t> m_nKeysSkipped{};
+
+protected:
+	inline bool hasTarget(RegistryAccess::SearchTargetFlags eTarget) const
+	{
+		return ((m_options.m_dwSearchTargets & eTarget) != 0);
+	}
+
+	void setFailure(const SResult& sr)
+	{
+		auto slCallback = std::scoped_lock{ m_mutexCallback };
+		if (!m_bStop.exchange(true))
+		{
+			m_srFailure = sr;
+		}
+	}
+
+	SResult reportMatch(const SearchMatch& oSearchMatch)
+	{
+		auto slCallback = std::scoped_lock{ m_mutexCallback };
+		if (m_bStop)
+		{
+			return E_ABORT;
+		}
+		++m_nMatchCount;
+		auto sr = m_fOnSearchMatch(oSearchMatch);
+		if (!sr.isSuccess())
+		{
+			m_bStop = true;
+			m_srFailure = sr;
+		}
+		return sr;
+	}
+
+	bool isValueDataMatch(const CRegistryAccess::EnumValueData& oEnumValueData) const
+	{
+		if (auto oStringView = oEnumValueData.AsStringView())
+		{
+			return m_oPattern.IsMatch(oStringView.value());
+		}
+		if (auto oMultiSzRange = oEnumValueData.AsMultiSzRange())
+		{
+			for (const auto& svElement : oMultiSzRange.value())
+			{
+				if (m_oPattern.IsMatch(svElement))
+				{
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	SResult searchValues(HKEY hKey, vlr::tstring_view svKeyPath)
+	{
+		auto fOnEnumValueData = [&](const CRegistryAccess::EnumValueData& oEnumValueData) -> SResult
+		{
+			if (m_bStop)
+			{
+				return E_ABORT;
+			}
+			++m_nValuesVisited;
+
+			auto oSearchMatch = SearchMatch{};
+			oSearchMatch.m_svKeyPath = svKeyPath;
+			oSearchMatch.m_svValueName = oEnumValueData.m_svName;
+			oSearchMatch.m_dwType = oEnumValueData.m_dwType;
+			oSearchMatch.m_spanData = oEnumValueData.m_spanData;
+
+			if (hasTarget(RegistryAccess::SearchTarget_ValueName) && m_oPattern.IsMatch(oEnumValueData.m_svName))
+			{
+				oSearchMatch.m_eMatchedTarget = RegistryAccess::SearchTarget_ValueName;
+				auto sr = reportMatch(oSearchMatch);
+				VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+			}
+			if (hasTarget(RegistryAccess::SearchTarget_ValueData) && isValueDataMatch(oEnumValueData))
+			{
+				oSearchMatch.m_eMatchedTarget = RegistryAccess::SearchTarget_ValueData;
+				auto sr = reportMatch(oSearchMatch);
+				VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+			}
+
+			return SResult::Success;
+		};
+
+		return m_oRegistryAccess.EnumAllValuesFromOpenKey(hKey, fOnEnumValueData);
+	}
+
+public:
+	// Note: Returns false if the walk should not continue into the key's subtree
+	bool searchKeyValues(HKEY hKey, vlr::tstring_view svKeyPath)
+	{
+		if (m_bStop)
+		{
+			return false;
+		}
+		++m_nKeysVisited;
+
+		if (!hasTarget(RegistryAccess::SearchTarget_ValueName) && !hasTarget(RegistryAccess::SearchTarget_ValueData))
+		{
+			return true;
+		}
+
+		auto sr = searchValues(hKey, svKeyPath);
+		if (sr.isSuccess())
+		{
+			return true;
+		}
+		if (m_bStop)
+		{
+			return false;
+		}
+		if (!CRegistryAccess::IsSkippableResultForWalk(sr))
+		{
+			setFailure(sr);
+			return false;
+		}
+		// Note: Values could not be read (eg: changed during the walk), but subkeys may still be searchable
+		++m_nKeysSkipped;
+		return true;
+	}
+
+	// Note: Searches the values of the key, and then (depth permitting) its subtree
+	void searchKey(HKEY hKey, vlr::tstring& sKeyPath, size_t nDepth)
+	{
+		if (!searchKeyValues(hKey, sKeyPath))
+		{
+			return;
+		}
+		if (nDepth >= m_options.m_nMaxDepth)
+		{
+			return;
+		}
+
+		std::vector<vlr::tstring> arrSubkeyNames;
+		auto sr = readSubkeyNames(hKey, arrSubkeyNames);
+		if (!sr.isSuccess())
+		{
+			if (!CRegistryAccess::IsSkippableResultForWalk(sr))
+			{
+				setFailure(sr);
+			}
+			return;
+		}
+
+		for (const auto& sSubkeyName : arrSubkeyNames)
+		{
+			if (m_bStop)
+			{
+				return;
+			}
+			searchSubkey(hKey, sKeyPath, sSubkeyName, nDepth + 1);
+		}
+	}
+
+	void searchSubkey(HKEY hParentKey, vlr::tstring& sParentKeyPath, const vlr::tstring& sSubkeyName, size_t nDepth)
+	{
+		auto nParentKeyPathLength = sParentKeyPath.size();
+		if (!sParentKeyPath.empty())
+		{
+			sParentKeyPath += _T('\\');
+		}
+		sParentKeyPath += sSubkeyName;
+		auto& sKeyPath = sParentKeyPath;
+
+		do
+		{
+			if (hasTarget(RegistryAccess::SearchTarget_KeyName) && m_oPattern.IsMatch(sSubkeyName))
+			{
+				auto oSearchMatch = SearchMatch{};
+				oSearchMatch.m_svKeyPath = sKeyPath;
+				oSearchMatch.m_eMatchedTarget = RegistryAccess::SearchTarget_KeyName;
+				auto sr = reportMatch(oSearchMatch);
+				if (!sr.isSuccess())
+				{
+					break;
+				}
+			}
+
+			HKEY hKey{};
+			auto sr = m_oRegistryAccess.OpenSubkeyFromOpenKey(hParentKey, sSubkeyName, KEY_READ, hKey);
+			if (!sr.isSuccess())
+			{
+				if (CRegistryAccess::IsSkippableResultForWalk(sr))
+				{
+					++m_nKeysSkipped;
+				}
+				else
+				{
+					setFailure(sr);
+				}
+				break;
+			}
+			auto onDestroy_CloseRegKey = AutoCloseRegKey{ hKey };
+
+			searchKey(hKey, sKeyPath, nDepth);
+		} while (false);
+
+		sParentKeyPath.resize(nParentKeyPathLength);
+	}
+
+	SResult readSubkeyNames(HKEY hKey, std::vector<vlr::tstring>& arrSubkeyNames) const
+	{
+		return m_oRegistryAccess.EnumAllSubkeysFromOpenKey(hKey, [&](const CRegistryAccess::EnumSubkeyData& oEnumSubkeyData) -> SResult
+		{
+			arrSubkeyNames.emplace_back(oEnumSubkeyData.m_svName);
+			return SResult::Success;
+		});
+	}
+
+	SResult getResult() const
+	{
+		return m_srFailure.isSet() ? m_srFailure : SResult::Success;
+	}
+
+public:
+	CSearchWalk(
+		const CRegistryAccess& oRegistryAccess,
+		const CRegistryAccessSearch::CPattern& oPattern,
+		const CRegistryAccessSearch::OnSearchMatch& fOnSearchMatch,
+		const CRegistryAccessSearch::Options_Search& options)
+		: m_oRegistryAccess{ oRegistryAccess }
+		, m_oPattern{ oPattern }
+		, m_fOnSearchMatch{ fOnSearchMatch }
+		, m_options{ options }
+	{}
+};
+
+} // namespace
+
+SResult CRegistryAccessSearch::CPattern::Initialize(
+	vlr::tstring_view svPattern,
+	RegistryAccess::SearchMatchMode eMatchMode,
+	bool bCaseInsensitive)
+{
+	m_eMatchMode = eMatchMode;
+	m_bCaseInsensitive = bCaseInsensitive;
+	m_sPattern = vlr::tstring{ svPattern };
+	m_spRegex.reset();
+
+	if (eMatchMode == RegistryAccess::SearchMatchMode::Regex)
+	{
+		auto eFlags = std::regex_constants::ECMAScript | std::regex_constants::optimize;
+		if (bCaseInsensitive)
+		{
+			eFlags |= std::regex_constants::icase;
+		}
+		try
+		{
+			m_spRegex = std::make_shared<const std::basic_regex<TCHAR>>(m_sPattern, eFlags);
+		}
+		catch (const std::regex_error&)
+		{
+			return E_INVALIDARG;
+		}
+	}
+
+	return SResult::Success;
+}
+
+bool CRegistryAccessSearch::CPattern::IsMatch(vlr::tstring_view svValue) const
+{
+	switch (m_eMatchMode)
+	{
+	case RegistryAccess::SearchMatchMode::Literal:
+		if (m_bCaseInsensitive)
+		{
+			return (strings::FindSubstring_CaseInsensitive<TCHAR>(svValue, m_sPattern) != vlr::tstring_view::npos);
+		}
+		return (strings::FindSubstring<TCHAR>(svValue, m_sPattern) != vlr::tstring_view::npos);
+
+	case RegistryAccess::SearchMatchMode::Glob:
+		return IsGlobMatch(svValue, m_sPattern, m_bCaseInsensitive);
+
+	case RegistryAccess::SearchMatchMode::Regex:
+		if (!m_spRegex)
+		{
+			return false;
+		}
+		try
+		{
+			return std::regex_search(svValue.begin(), svValue.end(), *m_spRegex);
+		}
+		catch (const std::regex_error&)
+		{
+			// Note: Can only happen on pathological pattern/input combinations (complexity/stack limits)
+			return false;
+		}
+
+	default:
+		VLR_ASSERT_ON_UNHANDLED_SWITCH_CASE;
+		return false;
+	}
+}
+
+SResult CRegistryAccessSearch::Search(
+	tzstring_view svzKeyName,
+	vlr::tstring_view svPattern,
+	const OnSearchMatch& fOnSearchMatch,
+	const Options_Search& options /*= {}*/,
+	Result_Search* pResult /*= nullptr*/) const
+{
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(fOnSearchMatch);
+
+	SResult sr;
+
+	CPattern oPattern;
+	sr = oPattern.Initialize(svPattern, options.m_eMatchMode, options.m_bCaseInsensitive);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	HKEY hKey{};
+	sr = m_oRegistryAccess.OpenKey(svzKeyName, KEY_READ, hKey);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	auto onDestroy_CloseRegKey = AutoCloseRegKey{ hKey };
+
+	CSearchWalk oSearchWalk{ m_oRegistryAccess, oPattern, fOnSearchMatch, options };
+	// Note: The counts are populated on every return (including failures), for what was searched
+	auto onDestroy_PopulateResult = MakeActionOnDestruction([&] {
+		if (pResult)
+		{
+			pResult->m_nKeysVisited = oSearchWalk.m_nKeysVisited;
+			pResult->m_nValuesVisited = oSearchWalk.m_nValuesVisited;
+			pResult->m_nMatchCount = oSearchWalk.m_nMatchCount;
+			pResult->m_nKeysSkipped = oSearchWalk.m_nKeysSkipped;
+		}
+	});
+
+	// The root's values are searched on the calling thread; its subtrees are then shared out between the workers
+	auto sRootKeyPath = vlr::tstring{ svzKeyName };
+	if (!oSearchWalk.searchKeyValues(hKey, sRootKeyPath) || (options.m_nMaxDepth == 0))
+	{
+		return oSearchWalk.getResult();
+	}
+
+	std::vector<vlr::tstring> arrSubkeyNames;
+	sr = oSearchWalk.readSubkeyNames(hKey, arrSubkeyNames);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	std::atomic<size_t> nNextSubkeyIndex{};
+	auto fWorker = [&]
+	{
+		auto sKeyPath = sRootKeyPath;
+		while (true)
+		{
+			auto nSubkeyIndex = nNextSubkeyIndex.fetch_add(1, std::memory_order_relaxed);
+			if (nSubkeyIndex >= arrSubkeyNames.size())
+			{
+				break;
+			}
+			oSearchWalk.searchSubkey(hKey, sKeyPath, arrSubkeyNames[nSubkeyIndex], 1);
+		}
+	};
+
+	auto nThreadCount = (std::min)((std::max)(options.m_nThreadCount, size_t{ 1 }), arrSubkeyNames.size());
+	std::vector<std::thread> arrWorkerThreads;
+	for (size_t i = 1; i < nThreadCount; ++i)
+	{
+		arrWorkerThreads.emplace_back(fWorker);
+	}
+	fWorker();
+	for (auto& oThread : arrWorkerThreads)
+	{
+		oThread.join();
+	}
+
+	return oSearchWalk.getResult();
+}
+
+} // namespace win32
+
+} // namespace vlr
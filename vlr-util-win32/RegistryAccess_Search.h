@@ -0,0 +1,149 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <regex>
+
+#include <vlr-util/util.includes.h>
+#include <vlr-util/util.Result.h>
+#include <vlr-util/zstring_view.h>
+
+#include "RegistryAccess.h"
+
+namespace vlr {
+
+namespace win32 {
+
+namespace RegistryAccess {
+
+enum class SearchMatchMode
+{
+	// Pattern is found anywhere in the string
+	Literal,
+	// Whole string matches the pattern; '*' matches any run of chars, '?' matches any single char
+	Glob,
+	// ECMAScript regex, found anywhere in the string (use ^...$ to anchor)
+	Regex,
+};
+
+enum SearchTargetFlags : DWORD
+{
+	SearchTarget_None = 0,
+	SearchTarget_KeyName = 0x1,
+	SearchTarget_ValueName = 0x2,
+	// Note: String data only (REG_SZ, REG_EXPAND_SZ, and each string in REG_MULTI_SZ)
+	SearchTarget_ValueData = 0x4,
+	SearchTarget_All = SearchTarget_KeyName | SearchTarget_ValueName | SearchTarget_ValueData,
+};
+
+} // namespace RegistryAccess
+
+// Search of a registry subtree for keys and values whose names or string data match a pattern.
+// The top-level subkeys of the search root are distributed across worker threads, and each worker walks its
+// subtrees depth-first. Matches are streamed to the caller's callback as they are found; the callback is invoked
+// under a lock (one call at a time), so it does not need to be thread-safe, but match order is not deterministic.
+// Subkeys which cannot be opened or read (eg: access denied, or deleted during the walk) are skipped and counted. The
+// name of the search root itself is not matched; key name matches are for subkeys below it.
+
+class CRegistryAccessSearch
+{
+public:
+	struct SearchMatch
+	{
+		// Note: Path of the matching key (or of the key containing the matching value), relative to the base key
+		vlr::tstring_view m_svKeyPath;
+		RegistryAccess::SearchTargetFlags m_eMatchedTarget = RegistryAccess::SearchTarget_None;
+		// Note: Value fields are only set for value name/data matches
+		vlr::tstring_view m_svValueName;
+		DWORD m_dwType{};
+		cpp::span<const BYTE> m_spanData;
+	};
+	// Note: The data in the match is only valid for the duration of the call. Returning failure stops the search,
+	// and the failure is returned from Search.
+	using OnSearchMatch = std::function<SResult(const SearchMatch& oSearchMatch)>;
+
+	struct Options_Search
+	{
+		RegistryAccess::SearchMatchMode m_eMatchMode = RegistryAccess::SearchMatchMode::Literal;
+		// Note: Registry names are case-insensitive, so this is the default
+		bool m_bCaseInsensitive = true;
+		DWORD m_dwSearchTargets = RegistryAccess::SearchTarget_All;
+		// Note: Depth 0 is the search root itself (values only); 1 includes its direct subkeys, etc
+		size_t m_nMaxDepth = SIZE_MAX;
+		// Note: Includes the calling thread; 1 walks the whole tree on the calling thread
+		size_t m_nThreadCount = 4;
+
+		decltype(auto) withMatchMode(RegistryAccess::SearchMatchMode eMatchMode)
+		{
+			m_eMatchMode = eMatchMode;
+			return *this;
+		}
+		decltype(auto) withCaseInsensitive(bool bCaseInsensitive)
+		{
+			m_bCaseInsensitive = bCaseInsensitive;
+			return *this;
+		}
+		decltype(auto) withSearchTargets(DWORD dwSearchTargets)
+		{
+			m_dwSearchTargets = dwSearchTargets;
+			return *this;
+		}
+		decltype(auto) withMaxDepth(size_t nMaxDepth)
+		{
+			m_nMaxDepth = nMaxDepth;
+			return *this;
+		}
+		decltype(auto) withThreadCount(size_t nThreadCount)
+		{
+			m_nThreadCount = nThreadCount;
+			return *this;
+		}
+	};
+
+	struct Result_Search
+	{
+		size_t m_nKeysVisited{};
+		size_t m_nValuesVisited{};
+		size_t m_nMatchCount{};
+		size_t m_nKeysSkipped{};
+	};
+
+	// Compiled form of the pattern; can be used directly to test individual strings.
+	class CPattern
+	{
+	protected:
+		RegistryAccess::SearchMatchMode m_eMatchMode = RegistryAccess::SearchMatchMode::Literal;
+		bool m_bCaseInsensitive = true;
+		vlr::tstring m_sPattern;
+		std::shared_ptr<const std::basic_regex<TCHAR>> m_spRegex;
+
+	public:
+		// Note: Returns E_INVALIDARG if the pattern is not a valid regex (for Regex mode)
+		SResult Initialize(
+			vlr::tstring_view svPattern,
+			RegistryAccess::SearchMatchMode eMatchMode,
+			bool bCaseInsensitive);
+
+		bool IsMatch(vlr::tstring_view svValue) const;
+	};
+
+protected:
+	CRegistryAccess m_oRegistryAccess;
+
+public:
+	SResult Search(
+		tzstring_view svzKeyName,
+		vlr::tstring_view svPattern,
+		const OnSearchMatch& fOnSearchMatch,
+		const Options_Search& options = {},
+		Result_Search* pResult = nullptr) const;
+
+public:
+	CRegistryAccessSearch(const CRegistryAccess& oRegistryAccess)
+		: m_oRegistryAccess{ oRegistryAccess }
+	{}
+};
+
+} // namespace win32
+
+} // namespace vlr
@@ -0,0 +1,416 @@
+#include "pch.h"
+#include "RegistryAccess_Shared.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+#include <vlr-util/ActionOnDestruction.h>
+
+namespace vlr {
+
+namespace win32 {
+
+namespace {
+
+std::atomic<uint64_t> g_nNextInstanceId{ 1 };
+
+} // namespace
+
+// A thread's caches, by instance id. The instances own the caches; the pointers are used for lookups (a thread only
+// looks up instances which are alive, and ids are never reused), and the weak references to tell which instances
+// were destroyed. Entries of destroyed instances are removed whenever the thread adds a cache, and when the thread
+// exits, its caches in instances which still exist are released (handles closed), for the instances to prune.
+class CRegistryAccessShared::CThreadCacheRegistry
+{
+protected:
+	struct Entry
+	{
+		ThreadCache* m_pThreadCache{};
+		std::weak_ptr<ThreadCache> m_wpThreadCache;
+	};
+	std::unordered_map<uint64_t, Entry> m_mapInstanceIdToEntry;
+
+public:
+	inline ThreadCache* Find(uint64_t nInstanceId) const
+	{
+		auto iterEntry = m_mapInstanceIdToEntry.find(nInstanceId);
+		return (iterEntry != m_mapInstanceIdToEntry.end()) ? iterEntry->second.m_pThreadCache : nullptr;
+	}
+	void Add(uint64_t nInstanceId, const std::shared_ptr<ThreadCache>& spThreadCache)
+	{
+		for (auto iterEntry = m_mapInstanceIdToEntry.begin(); iterEntry != m_mapInstanceIdToEntry.end(); )
+		{
+			iterEntry = iterEntry->second.m_wpThreadCache.expired() ? m_mapInstanceIdToEntry.erase(iterEntry) : std::next(iterEntry);
+		}
+		m_mapInstanceIdToEntry.emplace(nInstanceId, Entry{ spThreadCache.get(), spThreadCache });
+	}
+
+public:
+	~CThreadCacheRegistry()
+	{
+		for (auto& oInstanceIdAndEntry : m_mapInstanceIdToEntry)
+		{
+			auto spThreadCache = oInstanceIdAndEntry.second.m_wpThreadCache.lock();
+			if (!spThreadCache)
+			{
+				continue;
+			}
+			closeCachedHandles(*spThreadCache);
+			spThreadCache->m_bThreadExited.store(true, std::memory_order_release);
+		}
+	}
+};
+
+CRegistryAccessShared::ThreadCache& CRegistryAccessShared::getThreadCache() const
+{
+	thread_local CThreadCacheRegistry tl_oThreadCacheRegistry;
+
+	auto pThreadCache = tl_oThreadCacheRegistry.Find(m_nInstanceId);
+	if (pThreadCache)
+	{
+		return *pThreadCache;
+	}
+
+	auto spThreadCache = std::make_shared<ThreadCache>();
+	spThreadCache->m_nGeneration = m_nGeneration.load(std::memory_order_acquire);
+	{
+		auto slThreadCaches = std::scoped_lock{ m_mutexThreadCaches };
+		pruneExitedThreadCaches();
+		m_arrThreadCaches.push_back(spThreadCache);
+	}
+	tl_oThreadCacheRegistry.Add(m_nInstanceId, spThreadCache);
+	return *spThreadCache;
+}
+
+void CRegistryAccessShared::pruneExitedThreadCaches() const
+{
+	auto iterFirstExited = std::stable_partition(m_arrThreadCaches.begin(), m_arrThreadCaches.end(), [](const std::shared_ptr<ThreadCache>& spThreadCache)
+	{
+		return !spThreadCache->m_bThreadExited.load(std::memory_order_acquire);
+	});
+	for (auto iterThreadCache = iterFirstExited; iterThreadCache != m_arrThreadCaches.end(); ++iterThreadCache)
+	{
+		const auto& oThreadCache = **iterThreadCache;
+		++m_oStats_Pruned.m_nThreadCachesReleased;
+		m_oStats_Pruned.m_nHandleCacheHits += oThreadCache.m_nHandleCacheHits.load(std::memory_order_relaxed);
+		m_oStats_Pruned.m_nHandleCacheMisses += oThreadCache.m_nHandleCacheMisses.load(std::memory_order_relaxed);
+		m_oStats_Pruned.m_nHandlesEvicted += oThreadCache.m_nHandlesEvicted.load(std::memory_order_relaxed);
+	}
+	m_arrThreadCaches.erase(iterFirstExited, m_arrThreadCaches.end());
+}
+
+void CRegistryAccessShared::closeCachedHandles(ThreadCache& oThreadCache)
+{
+	auto nHandleCount = oThreadCache.m_mapKeyHandles_Read.size() + oThreadCache.m_mapKeyHandles_Write.size();
+	oThreadCache.m_nHandlesEvicted.fetch_add(nHandleCount, std::memory_order_relaxed);
+	oThreadCache.m_mapKeyHandles_Read.clear();
+	oThreadCache.m_mapKeyHandles_Write.clear();
+}
+
+SResult CRegistryAccessShared::getKey(
+	ThreadCache& oThreadCache,
+	tzstring_view svzKeyName,
+	bool bWriteAccess,
+	HKEY& hKey_Result,
+	registry::CKeyHandle& oUncachedKeyHandle,
+	bool& bFromCache) const
+{
+	SResult sr;
+
+	bFromCache = false;
+
+	// Note: Handles can only be closed (and so the cache can only be changed) if no operation on this thread is using one
+	bool bCanUpdateCache = (oThreadCache.m_nActiveOperations == 0);
+
+	auto nGeneration = m_nGeneration.load(std::memory_order_acquire);
+	bool bCacheIsCurrent = (oThreadCache.m_nGeneration == nGeneration);
+	if (!bCacheIsCurrent && bCanUpdateCache)
+	{
+		closeCachedHandles(oThreadCache);
+		oThreadCache.m_nGeneration = nGeneration;
+		bCacheIsCurrent = true;
+	}
+
+	auto& mapKeyHandles = bWriteAccess ? oThreadCache.m_mapKeyHandles_Write : oThreadCache.m_mapKeyHandles_Read;
+	if (bCacheIsCurrent)
+	{
+		auto iterKeyHandle = mapKeyHandles.find(svzKeyName);
+		if (iterKeyHandle != mapKeyHandles.end())
+		{
+			oThreadCache.m_nHandleCacheHits.fetch_add(1, std::memory_order_relaxed);
+			hKey_Result = iterKeyHandle->second->m_oKeyHandle.Get();
+			bFromCache = true;
+			return SResult::Success;
+		}
+	}
+	oThreadCache.m_nHandleCacheMisses.fetch_add(1, std::memory_order_relaxed);
+
+	HKEY hKey{};
+	sr = m_oRegistryAccess.OpenKey(svzKeyName, bWriteAccess ? KEY_WRITE | KEY_QUERY_VALUE : KEY_READ, hKey);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED(hKey);
+	auto oKeyHandle = registry::CKeyHandle{ hKey };
+
+	if (!bCacheIsCurrent || !bCanUpdateCache)
+	{
+		hKey_Result = oKeyHandle.Get();
+		oUncachedKeyHandle = std::move(oKeyHandle);
+		return SResult::Success;
+	}
+
+	if ((oThreadCache.m_mapKeyHandles_Read.size() + oThreadCache.m_mapKeyHandles_Write.size()) >= m_options.m_nMaxCachedHandlesPerThread)
+	{
+		closeCachedHandles(oThreadCache);
+	}
+	auto spCachedKeyHandle = std::make_unique<CachedKeyHandle>(CachedKeyHandle{ vlr::tstring{ svzKeyName }, std::move(oKeyHandle) });
+	hKey_Result = spCachedKeyHandle->m_oKeyHandle.Get();
+	auto svKeyName = vlr::tstring_view{ spCachedKeyHandle->m_sKeyName };
+	mapKeyHandles.emplace(svKeyName, std::move(spCachedKeyHandle));
+	bFromCache = true;
+
+	return SResult::Success;
+}
+
+template <typename FOperation>
+SResult CRegistryAccessShared::withKey(
+	tzstring_view svzKeyName,
+	bool bWriteAccess,
+	const FOperation& fOperation) const
+{
+	SResult sr;
+
+	auto& oThreadCache = getThreadCache();
+
+	for (bool bRetry = true; ; bRetry = false)
+	{
+		HKEY hKey{};
+		registry::CKeyHandle oUncachedKeyHandle;
+		bool bFromCache = false;
+		sr = getKey(oThreadCache, svzKeyName, bWriteAccess, hKey, oUncachedKeyHandle, bFromCache);
+		VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+		{
+			++oThreadCache.m_nActiveOperations;
+			auto oOnDestroy_EndOperation = MakeActionOnDestruction([&] {
+				--oThreadCache.m_nActiveOperations;
+			});
+			sr = fOperation(hKey);
+		}
+
+		// Note: The key was deleted (and maybe re-created) since the handle was cached; evict it and open it again
+		if (bRetry && bFromCache && (sr.asHRESULT() == __HRESULT_FROM_WIN32(ERROR_KEY_DELETED)) && (oThreadCache.m_nActiveOperations == 0))
+		{
+			auto& mapKeyHandles = bWriteAccess ? oThreadCache.m_mapKeyHandles_Write : oThreadCache.m_mapKeyHandles_Read;
+			auto nEvictedCount = mapKeyHandles.erase(svzKeyName);
+			oThreadCache.m_nHandlesEvicted.fetch_add(nEvictedCount, std::memory_order_relaxed);
+			continue;
+		}
+
+		return sr;
+	}
+}
+
+SResult CRegistryAccessShared::ReadValueBase(
+	tzstring_view svzKeyName,
+	tzstring_view svzValueName,
+	DWORD& dwType_Result,
+	std::vector<BYTE>& arrData) const
+{
+	return withKey(svzKeyName, false, [&](HKEY hKey)
+	{
+		return m_oRegistryAccess.ReadValueBaseFromOpenKey(hKey, svzValueName, dwType_Result, arrData);
+	});
+}
+
+SResult CRegistryAccessShared::ReadValue_DWORD(
+	tzstring_view svzKeyName,
+	tzstring_view svzValueName,
+	DWORD& dwValue) const
+{
+	SResult sr;
+
+	DWORD dwType{};
+	std::vector<BYTE> arrData;
+	sr = ReadValueBase(svzKeyName, svzValueName, dwType, arrData);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	return m_oRegistryAccess.convertRegDataToValue_DWORD(dwType, arrData, dwValue);
+}
+
+SResult CRegistryAccessShared::ReadValue_QWORD(
+	tzstring_view svzKeyName,
+	tzstring_view svzValueName,
+	QWORD& qwValue) const
+{
+	SResult sr;
+
+	DWORD dwType{};
+	std::vector<BYTE> arrData;
+	sr = ReadValueBase(svzKeyName, svzValueName, dwType, arrData);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	return m_oRegistryAccess.convertRegDataToValue_QWORD(dwType, arrData, qwValue);
+}
+
+SResult CRegistryAccessShared::ReadValue_String(
+	tzstring_view svzKeyName,
+	tzstring_view svzValueName,
+	vlr::tstring& sValue) const
+{
+	SResult sr;
+
+	DWORD dwType{};
+	std::vector<BYTE> arrData;
+	sr = ReadValueBase(svzKeyName, svzValueName, dwType, arrData);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	return m_oRegistryAccess.convertRegDataToValue_String(dwType, arrData, sValue);
+}
+
+SResult CRegistryAccessShared::WriteValueBase(
+	tzstring_view svzKeyName,
+	tzstring_view svzValueName,
+	const DWORD& dwType,
+	cpp::span<const BYTE> spanData) const
+{
+	return withKey(svzKeyName, true, [&](HKEY hKey)
+	{
+		return m_oRegistryAccess.WriteValueBaseToOpenKey(hKey, svzValueName, dwType, spanData);
+	});
+}
+
+SResult CRegistryAccessShared::WriteValue_DWORD(
+	tzstring_view svzKeyName,
+	tzstring_view svzValueName,
+	const DWORD& dwValue) const
+{
+	SResult sr;
+
+	DWORD dwType{};
+	std::vector<BYTE> arrData;
+	sr = m_oRegistryAccess.convertValueToRegData_DWORD(dwValue, dwType, arrData);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	return WriteValueBase(svzKeyName, svzValueName, dwType, arrData);
+}
+
+SResult CRegistryAccessShared::WriteValue_QWORD(
+	tzstring_view svzKeyName,
+	tzstring_view svzValueName,
+	const QWORD& qwValue) const
+{
+	SResult sr;
+
+	DWORD dwType{};
+	std::vector<BYTE> arrData;
+	sr = m_oRegistryAccess.convertValueToRegData_QWORD(qwValue, dwType, arrData);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	return WriteValueBase(svzKeyName, svzValueName, dwType, arrData);
+}
+
+SResult CRegistryAccessShared::WriteValue_String(
+	tzstring_view svzKeyName,
+	tzstring_view svzValueName,
+	vlr::tstring_view svValue) const
+{
+	SResult sr;
+
+	DWORD dwType{};
+	std::vector<BYTE> arrData;
+	sr = m_oRegistryAccess.convertValueToRegData_String(svValue, dwType, arrData);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	return WriteValueBase(svzKeyName, svzValueName, dwType, arrData);
+}
+
+SResult CRegistryAccessShared::DeleteValue(
+	tzstring_view svzKeyName,
+	tzstring_view svzValueName) const
+{
+	return withKey(svzKeyName, true, [&](HKEY hKey)
+	{
+		return m_oRegistryAccess.DeleteValueFromOpenKey(hKey, svzValueName);
+	});
+}
+
+SResult CRegistryAccessShared::EnumAllValues(
+	tzstring_view svzKeyName,
+	const CRegistryAccess::OnEnumValueData& fOnEnumValueData) const
+{
+	return withKey(svzKeyName, false, [&](HKEY hKey)
+	{
+		return m_oRegistryAccess.EnumAllValuesFromOpenKey(hKey, fOnEnumValueData);
+	});
+}
+
+SResult CRegistryAccessShared::EnumAllSubkeys(
+	tzstring_view svzKeyName,
+	const CRegistryAccess::OnEnumSubkeyData& fOnEnumSubkeyData) const
+{
+	return withKey(svzKeyName, false, [&](HKEY hKey)
+	{
+		return m_oRegistryAccess.EnumAllSubkeysFromOpenKey(hKey, fOnEnumSubkeyData);
+	});
+}
+
+SResult CRegistryAccessShared::EnsureKeyExists(
+	tzstring_view svzKeyName) const
+{
+	return m_oRegistryAccess.EnsureKeyExists(svzKeyName);
+}
+
+SResult CRegistryAccessShared::DeleteKey(
+	tzstring_view svzKeyName,
+	const CRegistryAccess::Options_DeleteKeysOrValues& options /*= {}*/) const
+{
+	auto sr = m_oRegistryAccess.DeleteKey(svzKeyName, options);
+	Invalidate();
+	return sr;
+}
+
+void CRegistryAccessShared::Invalidate() const
+{
+	m_nGeneration.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void CRegistryAccessShared::ReleaseThreadCache() const
+{
+	auto& oThreadCache = getThreadCache();
+	if (oThreadCache.m_nActiveOperations == 0)
+	{
+		closeCachedHandles(oThreadCache);
+	}
+}
+
+CRegistryAccessShared::Stats CRegistryAccessShared::GetStats() const
+{
+	auto slThreadCaches = std::scoped_lock{ m_mutexThreadCaches };
+
+	auto oStats = m_oStats_Pruned;
+	for (const auto& spThreadCache : m_arrThreadCaches)
+	{
+		if (spThreadCache->m_bThreadExited.load(std::memory_order_acquire))
+		{
+			++oStats.m_nThreadCachesReleased;
+		}
+		else
+		{
+			++oStats.m_nThreadCaches;
+		}
+		oStats.m_nHandleCacheHits += spThreadCache->m_nHandleCacheHits.load(std::memory_order_relaxed);
+		oStats.m_nHandleCacheMisses += spThreadCache->m_nHandleCacheMisses.load(std::memory_order_relaxed);
+		oStats.m_nHandlesEvicted += spThreadCache->m_nHandlesEvicted.load(std::memory_order_relaxed);
+	}
+	return oStats;
+}
+
+CRegistryAccessShared::CRegistryAccessShared(const CRegistryAccess& oRegistryAccess, const Options_Shared& options /*= {}*/)
+	: m_oRegistryAccess{ oRegistryAccess }
+	, m_options{ options }
+	, m_nInstanceId{ g_nNextInstanceId.fetch_add(1, std::memory_order_relaxed) }
+{}
+
+} // namespace win32
+
+} // namespace vlr
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <vlr-util/util.includes.h>
+#include <vlr-util/util.Result.h>
+#include <vlr-util/zstring_view.h>
+
+#include "RegistryAccess.h"
+#include "registry.KeyHandle.h"
+#include "strings.CaseFold.h"
+
+namespace vlr {
+
+namespace win32 {
+
+// Registry access object which can be shared by many threads (eg: one instance for a worker pool), and which caches
+// open key handles so repeated access to the same keys does not re-open them.
+// Each thread which uses the instance gets its own handle cache: lookups take no locks and touch no shared state
+// other than one atomic load (the cache generation), and handles are never shared between threads. A lock is only
+// taken the first time a thread uses the instance.
+// Thread-safety contract:
+// - All methods may be called concurrently from any number of threads, except the destructor; no calls may be in
+//   progress when the instance is destroyed.
+// - The configuration (base key, WOW64 view) is fixed at construction.
+// - Invalidate may be called from any thread; each thread closes its cached handles on its next call. DeleteKey
+//   invalidates automatically. A cached handle to a key which was deleted by someone else is evicted (and the
+//   operation retried with a fresh open) when it fails with ERROR_KEY_DELETED.
+// - Enumeration callbacks may call back into the instance (on the same thread); cached handles are not closed while
+//   an operation is in progress on the thread, so uncached handles are used in that case.
+// Note: When a thread exits, its caches' handles are closed, and the caches are pruned the next time a thread starts
+// using the instance; a thread can also call ReleaseThreadCache to close its handles sooner.
+
+class CRegistryAccessShared
+{
+public:
+	using QWORD = CRegistryAccess::QWORD;
+
+	struct Options_Shared
+	{
+		// Note: A thread's cache is cleared when it reaches this many handles
+		size_t m_nMaxCachedHandlesPerThread = 64;
+
+		decltype(auto) withMaxCachedHandlesPerThread(size_t nMaxCachedHandlesPerThread)
+		{
+			m_nMaxCachedHandlesPerThread = nMaxCachedHandlesPerThread;
+			return *this;
+		}
+	};
+
+	struct Stats
+	{
+		// Note: Caches of threads which have not exited; those of exited threads are counted as released
+		size_t m_nThreadCaches{};
+		size_t m_nThreadCachesReleased{};
+		size_t m_nHandleCacheHits{};
+		size_t m_nHandleCacheMisses{};
+		size_t m_nHandlesEvicted{};
+	};
+
+protected:
+	struct CachedKeyHandle
+	{
+		vlr::tstring m_sKeyName;
+		registry::CKeyHandle m_oKeyHandle;
+	};
+	// Note: Keyed by a view of each entry's own name (entries are not moved), so lookups do not allocate
+	using KeyHandleMap = std::unordered_map<
+		vlr::tstring_view,
+		std::unique_ptr<CachedKeyHandle>,
+		strings::hash_CaseInsensitive<TCHAR>,
+		strings::equal_to_CaseInsensitive<TCHAR>>;
+
+	struct ThreadCache
+	{
+		uint64_t m_nGeneration{};
+		// Note: Operations in progress on the owning thread (nested via callbacks); handles are only closed at zero
+		size_t m_nActiveOperations{};
+		KeyHandleMap m_mapKeyHandles_Read;
+		KeyHandleMap m_mapKeyHandles_Write;
+
+		// Note: Written only by the owning thread; atomic so GetStats can read them from any thread
+		std::atomic<size_t> m_nHandleCacheHits{};
+		std::atomic<size_t> m_nHandleCacheMisses{};
+		std::atomic<size_t> m_nHandlesEvicted{};
+		// Note: Set when the owning thread exits, after its handles are closed
+		std::atomic<bool> m_bThreadExited{};
+	};
+	class CThreadCacheRegistry;
+
+	const CRegistryAccess m_oRegistryAccess;
+	const Options_Shared m_options;
+	// Note: Unique per instance (never reused), so a thread's lookup of its cache cannot match a destroyed instance
+	const uint64_t m_nInstanceId;
+	mutable std::atomic<uint64_t> m_nGeneration{ 1 };
+
+	mutable std::mutex m_mutexThreadCaches;
+	// Note: Shared with the owning threads' registries (weakly), so an exiting thread can release its caches
+	mutable std::vector<std::shared_ptr<ThreadCache>> m_arrThreadCaches;
+	// Note: Counts from the caches which were pruned (after their threads exited)
+	mutable Stats m_oStats_Pruned;
+
+protected:
+	ThreadCache& getThreadCache() const;
+	// Note: Called with the thread caches lock held
+	void pruneExitedThreadCaches() const;
+	static void closeCachedHandles(ThreadCache& oThreadCache);
+	// Note: Returns a cached handle, or (if the cache cannot be updated) an uncached one, owned by the key handle
+	SResult getKey(
+		ThreadCache& oThreadCache,
+		tzstring_view svzKeyName,
+		bool bWriteAccess,
+		HKEY& hKey_Result,
+		registry::CKeyHandle& oUncachedKeyHandle,
+		bool& bFromCache) const;
+	template <typename FOperation>
+	SResult withKey(
+		tzstring_view svzKeyName,
+		bool bWriteAccess,
+		const FOperation& fOperation) const;
+
+public:
+	SResult ReadValueBase(
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName,
+		DWORD& dwType_Result,
+		std::vector<BYTE>& arrData) const;
+	SResult ReadValue_DWORD(
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName,
+		DWORD& dwValue) const;
+	SResult ReadValue_QWORD(
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName,
+		QWORD& qwValue) const;
+	SResult ReadValue_String(
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName,
+		vlr::tstring& sValue) const;
+
+	SResult WriteValueBase(
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName,
+		const DWORD& dwType,
+		cpp::span<const BYTE> spanData) const;
+	SResult WriteValue_DWORD(
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName,
+		const DWORD& dwValue) const;
+	SResult WriteValue_QWORD(
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName,
+		const QWORD& qwValue) const;
+	SResult WriteValue_String(
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName,
+		vlr::tstring_view svValue) const;
+
+	SResult DeleteValue(
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName) const;
+
+	SResult EnumAllValues(
+		tzstring_view svzKeyName,
+		const CRegistryAccess::OnEnumValueData& fOnEnumValueData) const;
+	SResult EnumAllSubkeys(
+		tzstring_view svzKeyName,
+		const CRegistryAccess::OnEnumSubkeyData& fOnEnumSubkeyData) const;
+
+	SResult EnsureKeyExists(
+		tzstring_view svzKeyName) const;
+	// Note: Invalidates all threads' cached handles
+	SResult DeleteKey(
+		tzstring_view svzKeyName,
+		const CRegistryAccess::Options_DeleteKeysOrValues& options = {}) const;
+
+	void Invalidate() const;
+	// Note: Closes the calling thread's cached handles now (eg: before the thread exits)
+	void ReleaseThreadCache() const;
+
+	Stats GetStats() const;
+
+	inline const CRegistryAccess& GetRegistryAccess() const
+	{
+		return m_oRegistryAccess;
+	}
+
+public:
+	// Note: The registry access instance is copied; the base key must remain open for the life of this instance.
+	CRegistryAccessShared(const CRegistryAccess& oRegistryAccess, const Options_Shared& options = {});
+	CRegistryAccessShared(const CRegistryAccessShared&) = delete;
+	CRegistryAccessShared& operator=(const CRegistryAccessShared&) = delete;
+};
+
+} // namespace win32
+
+} // namespace vlr
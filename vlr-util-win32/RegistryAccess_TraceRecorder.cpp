@@ -0,0 +1,268 @@
+#include "pch.h"
+#include "RegistryAccess_TraceRecorder.h"
+
+#include <algorithm>
+
+#include <vlr-util/util.range_checked_cast.h>
+
+#include "filesystem.Functions.h"
+#include "serialization.BinaryStream.h"
+
+namespace vlr {
+
+namespace win32 {
+
+namespace RegistryAccess {
+
+namespace Trace {
+
+namespace {
+
+static constexpr uint32_t TraceFile_Signature = 0x52544C56; // "VLTR"
+static constexpr uint32_t TraceFile_Version = 1;
+
+} // namespace
+
+const char* GetOperationName(OperationType eOperationType)
+{
+	switch (eOperationType)
+	{
+	case OpenKey: return "OpenKey";
+	case CreateKey: return "CreateKey";
+	case DeleteKey: return "DeleteKey";
+	case QueryKeyInfo: return "QueryKeyInfo";
+	case QueryValueInfo: return "QueryValueInfo";
+	case ReadValue: return "ReadValue";
+	case WriteValue: return "WriteValue";
+	case DeleteValue: return "DeleteValue";
+	case EnumValues: return "EnumValues";
+	case EnumSubkeys: return "EnumSubkeys";
+	default: return "Unknown";
+	}
+}
+
+SResult TraceData::SaveToFile(
+	tzstring_view svzFilePath) const
+{
+	serialization::CBinaryWriter oWriter;
+	oWriter.Reserve(m_arrRecords.size() * sizeof(TraceRecord) + 1024);
+
+	oWriter.Write(TraceFile_Signature);
+	oWriter.Write(TraceFile_Version);
+	oWriter.Write(static_cast<uint32_t>(sizeof(TCHAR)));
+	oWriter.Write(static_cast<uint32_t>(sizeof(TraceRecord)));
+	oWriter.Write(m_nThreadCount);
+
+	oWriter.Write(util::range_checked_cast<uint32_t>(m_arrNames.size()));
+	for (const auto& sName : m_arrNames)
+	{
+		oWriter.WriteString<TCHAR>(sName);
+	}
+
+	oWriter.Write(util::range_checked_cast<uint32_t>(m_arrRecords.size()));
+	oWriter.WriteBytes(m_arrRecords.data(), m_arrRecords.size() * sizeof(TraceRecord));
+
+	const auto& arrData = oWriter.GetData();
+	return filesystem::WriteFileContents(svzFilePath, arrData.data(), arrData.size());
+}
+
+SResult TraceData::LoadFromFile(
+	tzstring_view svzFilePath)
+{
+	SResult sr;
+
+	std::vector<BYTE> arrData;
+	sr = filesystem::ReadFileContents(svzFilePath, arrData);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	static const auto srBadFormat = SResult::For_win32_ErrorCode(ERROR_BAD_FORMAT);
+	serialization::CBinaryReader oReader{ arrData };
+
+	uint32_t nSignature{};
+	uint32_t nVersion{};
+	uint32_t nCharSize{};
+	uint32_t nRecordSize{};
+	TraceData oTraceData;
+	if (false
+		|| !oReader.Read(nSignature).isSuccess()
+		|| !oReader.Read(nVersion).isSuccess()
+		|| !oReader.Read(nCharSize).isSuccess()
+		|| !oReader.Read(nRecordSize).isSuccess()
+		|| (nSignature != TraceFile_Signature)
+		|| (nVersion != TraceFile_Version)
+		|| (nCharSize != sizeof(TCHAR))
+		|| (nRecordSize != sizeof(TraceRecord))
+		|| !oReader.Read(oTraceData.m_nThreadCount).isSuccess())
+	{
+		return srBadFormat;
+	}
+
+	uint32_t nNameCount{};
+	if (!oReader.Read(nNameCount).isSuccess()
+		|| (nNameCount == 0)
+		|| (nNameCount > oReader.GetRemainingSize()))
+	{
+		return srBadFormat;
+	}
+	oTraceData.m_arrNames.resize(nNameCount);
+	for (auto& sName : oTraceData.m_arrNames)
+	{
+		if (!oReader.ReadString(sName).isSuccess())
+		{
+			return srBadFormat;
+		}
+	}
+
+	uint32_t nRecordCount{};
+	if (!oReader.Read(nRecordCount).isSuccess()
+		|| (oReader.GetRemainingSize() != size_t{ nRecordCount } * sizeof(TraceRecord)))
+	{
+		return srBadFormat;
+	}
+	oTraceData.m_arrRecords.resize(nRecordCount);
+	if (!oReader.ReadBytes(oTraceData.m_arrRecords.data(), oTraceData.m_arrRecords.size() * sizeof(TraceRecord)).isSuccess())
+	{
+		return srBadFormat;
+	}
+	for (const auto& oRecord : oTraceData.m_arrRecords)
+	{
+		if ((oRecord.m_nKeyNameId >= nNameCount)
+			|| (oRecord.m_nValueNameId >= nNameCount)
+			|| (oRecord.m_eOperationType >= OperationType_Count)
+			|| (oRecord.m_nThreadIndex >= oTraceData.m_nThreadCount))
+		{
+			return srBadFormat;
+		}
+	}
+
+	*this = std::move(oTraceData);
+
+	return SResult::Success;
+}
+
+} // namespace Trace
+
+} // namespace RegistryAccess
+
+uint32_t CRegistryAccessTraceRecorder::getNameId(vlr::tstring_view svName)
+{
+	if (svName.empty())
+	{
+		return 0;
+	}
+
+	auto iter = m_mapNameToId.find(svName);
+	if (iter != m_mapNameToId.end())
+	{
+		return iter->second;
+	}
+
+	auto nNameId = util::range_checked_cast<uint32_t>(m_oTraceData.m_arrNames.size());
+	auto svzPooledName = m_oNamePool.Intern(svName);
+	m_oTraceData.m_arrNames.emplace_back(svzPooledName.data(), svzPooledName.size());
+	m_mapNameToId.emplace(vlr::tstring_view{ svzPooledName.data(), svzPooledName.size() }, nNameId);
+	return nNameId;
+}
+
+uint32_t CRegistryAccessTraceRecorder::getThreadIndex(std::thread::id idThread)
+{
+	auto iterInsert = m_mapThreadToIndex.emplace(idThread, m_oTraceData.m_nThreadCount);
+	if (iterInsert.second)
+	{
+		++m_oTraceData.m_nThreadCount;
+	}
+	return iterInsert.first->second;
+}
+
+uint64_t CRegistryAccessTraceRecorder::GetElapsedMicroseconds() const
+{
+	auto durElapsed = std::chrono::steady_clock::now() - m_tpStart;
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(durElapsed).count());
+}
+
+void CRegistryAccessTraceRecorder::Record(
+	RegistryAccess::Trace::OperationType eOperationType,
+	tzstring_view svzKeyName,
+	tzstring_view svzValueName,
+	const RegistryAccess::Trace::OperationInfo& oOperationInfo,
+	const SResult& srResult,
+	uint64_t nStartMicroseconds,
+	uint64_t nExcludedMicroseconds /*= 0*/)
+{
+	auto oRecord = RegistryAccess::Trace::TraceRecord{};
+	oRecord.m_nStartMicroseconds = nStartMicroseconds;
+	auto nEndMicroseconds = GetElapsedMicroseconds();
+	auto nDurationMicroseconds = nEndMicroseconds - (std::min)(nStartMicroseconds, nEndMicroseconds);
+	nDurationMicroseconds -= (std::min)(nExcludedMicroseconds, nDurationMicroseconds);
+	oRecord.m_nDurationMicroseconds = static_cast<uint32_t>((std::min)(
+		nDurationMicroseconds,
+		uint64_t{ UINT32_MAX }));
+	oRecord.m_dwType = oOperationInfo.m_dwType;
+	oRecord.m_nDataSize = static_cast<uint32_t>((std::min)(oOperationInfo.m_nDataSize, size_t{ UINT32_MAX }));
+	oRecord.m_hrResult = srResult.asHRESULT();
+	oRecord.m_eOperationType = eOperationType;
+
+	auto oLock = std::scoped_lock{ m_mutexDataAccess };
+	if (m_oTraceData.m_arrRecords.size() >= m_options.m_nMaxRecordCount)
+	{
+		++m_nDroppedCount;
+		return;
+	}
+	oRecord.m_nKeyNameId = getNameId(vlr::tstring_view{ svzKeyName.data(), svzKeyName.size() });
+	oRecord.m_nValueNameId = getNameId(vlr::tstring_view{ svzValueName.data(), svzValueName.size() });
+	oRecord.m_nThreadIndex = getThreadIndex(std::this_thread::get_id());
+	m_oTraceData.m_arrRecords.push_back(oRecord);
+}
+
+RegistryAccess::Trace::TraceData CRegistryAccessTraceRecorder::GetTraceData() const
+{
+	auto oLock = std::scoped_lock{ m_mutexDataAccess };
+	return m_oTraceData;
+}
+
+SResult CRegistryAccessTraceRecorder::SaveToFile(
+	tzstring_view svzFilePath) const
+{
+	return GetTraceData().SaveToFile(svzFilePath);
+}
+
+CRegistryAccessTraceRecorder::Stats CRegistryAccessTraceRecorder::GetStats() const
+{
+	auto oLock = std::scoped_lock{ m_mutexDataAccess };
+	auto oStats = Stats{};
+	oStats.m_nRecordCount = m_oTraceData.m_arrRecords.size();
+	oStats.m_nDroppedCount = m_nDroppedCount;
+	oStats.m_nNameCount = m_oTraceData.m_arrNames.size();
+	oStats.m_nThreadCount = m_oTraceData.m_nThreadCount;
+	return oStats;
+}
+
+namespace RegistryAccess {
+
+namespace Trace {
+
+CScopedOperation::~CScopedOperation()
+{
+	if (!m_pTraceRecorder)
+	{
+		return;
+	}
+
+	auto nExcludedMicroseconds = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(m_durExcluded).count());
+	m_pTraceRecorder->Record(
+		m_eOperationType,
+		m_svzKeyName,
+		m_svzValueName,
+		m_oOperationInfo,
+		m_bHasResult ? m_srResult : m_srResult_Bound,
+		m_nStartMicroseconds,
+		nExcludedMicroseconds);
+}
+
+} // namespace Trace
+
+} // namespace RegistryAccess
+
+} // namespace win32
+
+} // namespace vlr
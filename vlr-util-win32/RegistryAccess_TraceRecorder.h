@@ -0,0 +1,252 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <vlr-util/util.includes.h>
+#include <vlr-util/util.Result.h>
+#include <vlr-util/zstring_view.h>
+
+#include "registry.NameInternPool.h"
+
+namespace vlr {
+
+namespace win32 {
+
+namespace RegistryAccess {
+
+namespace Trace {
+
+enum OperationType : uint8_t
+{
+	OpenKey,
+	CreateKey,
+	DeleteKey,
+	QueryKeyInfo,
+	QueryValueInfo,
+	ReadValue,
+	WriteValue,
+	DeleteValue,
+	EnumValues,
+	EnumSubkeys,
+	OperationType_Count,
+};
+
+constexpr bool IsWriteOperation(OperationType eOperationType)
+{
+	return false
+		|| (eOperationType == CreateKey)
+		|| (eOperationType == DeleteKey)
+		|| (eOperationType == WriteValue)
+		|| (eOperationType == DeleteValue);
+}
+
+const char* GetOperationName(OperationType eOperationType);
+
+// Note: Filled in by the traced operation. For values, the type and size of the data read or written (the data itself
+// is not recorded); for enumerations, the size is the number of entries delivered to the callback.
+struct OperationInfo
+{
+	DWORD m_dwType{};
+	size_t m_nDataSize{};
+};
+
+// Note: Fixed size, with no implicit padding, so records are written to trace files as-is.
+struct TraceRecord
+{
+	// Note: Relative to the start of recording
+	uint64_t m_nStartMicroseconds{};
+	// Note: Excludes the time spent in the caller's enumeration callbacks
+	uint32_t m_nDurationMicroseconds{};
+	// Note: Indexes into the trace's name table; 0 is the empty name
+	uint32_t m_nKeyNameId{};
+	uint32_t m_nValueNameId{};
+	uint32_t m_dwType{};
+	uint32_t m_nDataSize{};
+	HRESULT m_hrResult{};
+	// Note: Threads are numbered in the order they first recorded an operation
+	uint32_t m_nThreadIndex{};
+	OperationType m_eOperationType{};
+	uint8_t m_arrReserved[3]{};
+};
+static_assert(sizeof(TraceRecord) == 40);
+
+struct TraceData
+{
+	std::vector<vlr::tstring> m_arrNames{ vlr::tstring{} };
+	// Note: In the order operations completed
+	std::vector<TraceRecord> m_arrRecords;
+	uint32_t m_nThreadCount{};
+
+	inline vlr::tstring_view GetName(uint32_t nNameId) const
+	{
+		return (nNameId < m_arrNames.size()) ? vlr::tstring_view{ m_arrNames[nNameId] } : vlr::tstring_view{};
+	}
+
+	SResult SaveToFile(
+		tzstring_view svzFilePath) const;
+	// Note: Fails with ERROR_BAD_FORMAT if the file is not a (compatible) trace file.
+	SResult LoadFromFile(
+		tzstring_view svzFilePath);
+};
+
+} // namespace Trace
+
+} // namespace RegistryAccess
+
+// Opt-in recorder for the operations made through CRegistryAccess (see CRegistryAccess::SetTraceRecorder), to capture
+// a production workload for offline replay (see CRegistryAccessTraceReplay).
+// Note: Thread-safe; one recorder can be shared by several CRegistryAccess instances and threads. Each record takes a
+// short lock, so recording is meant for capturing a workload, rather than for always-on use.
+
+class CRegistryAccessTraceRecorder
+{
+public:
+	struct Options
+	{
+		// Note: Records past this count are dropped (and counted), to bound memory use
+		size_t m_nMaxRecordCount = 1024 * 1024;
+
+		decltype(auto) withMaxRecordCount(size_t nMaxRecordCount)
+		{
+			m_nMaxRecordCount = nMaxRecordCount;
+			return *this;
+		}
+	};
+
+	struct Stats
+	{
+		size_t m_nRecordCount{};
+		size_t m_nDroppedCount{};
+		size_t m_nNameCount{};
+		size_t m_nThreadCount{};
+	};
+
+protected:
+	Options m_options;
+	std::chrono::steady_clock::time_point m_tpStart = std::chrono::steady_clock::now();
+
+	mutable std::mutex m_mutexDataAccess;
+	RegistryAccess::Trace::TraceData m_oTraceData;
+	// Note: Views are into the pool, which outlives the map
+	registry::CNameInternPool m_oNamePool;
+	std::unordered_map<vlr::tstring_view, uint32_t> m_mapNameToId;
+	std::unordered_map<std::thread::id, uint32_t> m_mapThreadToIndex;
+	size_t m_nDroppedCount{};
+
+	// Note: Caller holds the lock
+	uint32_t getNameId(vlr::tstring_view svName);
+	uint32_t getThreadIndex(std::thread::id idThread);
+
+public:
+	uint64_t GetElapsedMicroseconds() const;
+
+	void Record(
+		RegistryAccess::Trace::OperationType eOperationType,
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName,
+		const RegistryAccess::Trace::OperationInfo& oOperationInfo,
+		const SResult& srResult,
+		uint64_t nStartMicroseconds,
+		uint64_t nExcludedMicroseconds = 0);
+
+	// Note: Copy of the records so far; recording can continue
+	RegistryAccess::Trace::TraceData GetTraceData() const;
+	SResult SaveToFile(
+		tzstring_view svzFilePath) const;
+	Stats GetStats() const;
+
+public:
+	CRegistryAccessTraceRecorder() = default;
+	explicit CRegistryAccessTraceRecorder(const Options& options)
+		: m_options{ options }
+	{}
+	CRegistryAccessTraceRecorder(const CRegistryAccessTraceRecorder&) = delete;
+	CRegistryAccessTraceRecorder& operator=(const CRegistryAccessTraceRecorder&) = delete;
+};
+
+namespace RegistryAccess {
+
+namespace Trace {
+
+// Records one operation when it goes out of scope, if there is a recorder (see VLR_REGISTRY_TRACE_OPERATION). The
+// result recorded is the one passed to Return; exits which do not go through it (eg: VLR_ON_SR_ERROR_RETURN_VALUE)
+// record the current value of the bound result variable.
+class CScopedOperation
+{
+protected:
+	CRegistryAccessTraceRecorder* m_pTraceRecorder = nullptr;
+	OperationType m_eOperationType{};
+	tzstring_view m_svzKeyName;
+	tzstring_view m_svzValueName;
+	const SResult& m_srResult_Bound;
+	SResult m_srResult;
+	bool m_bHasResult = false;
+	OperationInfo m_oOperationInfo;
+	uint64_t m_nStartMicroseconds{};
+	std::chrono::steady_clock::duration m_durExcluded{};
+
+public:
+	inline bool IsRecording() const
+	{
+		return (m_pTraceRecorder != nullptr);
+	}
+	inline void OnValue(DWORD dwType, size_t nDataSize)
+	{
+		m_oOperationInfo.m_dwType = dwType;
+		m_oOperationInfo.m_nDataSize = nDataSize;
+	}
+	inline SResult Return(SResult srResult)
+	{
+		m_srResult = srResult;
+		m_bHasResult = true;
+		return srResult;
+	}
+	// Note: For the caller's enumeration callback; counts the entry, and excludes the callback's time from the
+	// recorded duration.
+	template <typename TCallback>
+	inline SResult CallForEntry(const TCallback& fCallback)
+	{
+		++m_oOperationInfo.m_nDataSize;
+		auto tpStart = std::chrono::steady_clock::now();
+		SResult sr = fCallback();
+		m_durExcluded += std::chrono::steady_clock::now() - tpStart;
+		return sr;
+	}
+
+public:
+	CScopedOperation(
+		CRegistryAccessTraceRecorder* pTraceRecorder,
+		OperationType eOperationType,
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName,
+		const SResult& srResult_Bound)
+		: m_pTraceRecorder{ pTraceRecorder }
+		, m_eOperationType{ eOperationType }
+		, m_svzKeyName{ svzKeyName }
+		, m_svzValueName{ svzValueName }
+		, m_srResult_Bound{ srResult_Bound }
+		, m_nStartMicroseconds{ pTraceRecorder ? pTraceRecorder->GetElapsedMicroseconds() : 0 }
+	{}
+	~CScopedOperation();
+	CScopedOperation(const CScopedOperation&) = delete;
+	CScopedOperation& operator=(const CScopedOperation&) = delete;
+};
+
+} // namespace Trace
+
+} // namespace RegistryAccess
+
+} // namespace win32
+
+} // namespace vlr
+
+// Note: For CRegistryAccess members; traces the rest of the enclosing scope, binding srResult (the function's result
+// variable, declared before this) as the result for early exits.
+#define VLR_REGISTRY_TRACE_OPERATION(varName, eOperationType, svzKeyName, svzValueName, srResult) \
+	auto varName = ::vlr::win32::RegistryAccess::Trace::CScopedOperation{ \
+		m_spTraceRecorder.get(), ::vlr::win32::RegistryAccess::Trace::eOperationType, svzKeyName, svzValueName, srResult }
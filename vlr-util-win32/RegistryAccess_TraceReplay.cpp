@@ -0,0 +1,315 @@
+#include "pch.h"
+#include "RegistryAccess_TraceReplay.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <set>
+#include <thread>
+#include <utility>
+
+namespace vlr {
+
+namespace win32 {
+
+namespace Trace = RegistryAccess::Trace;
+
+struct CRegistryAccessTraceReplay::ThreadContext
+{
+	// Note: A copy per thread, so non-const operations (eg: DeleteValue) can be replayed
+	CRegistryAccess m_oRegistryAccess;
+	std::vector<size_t> m_arrRecordIndexes;
+	std::vector<BYTE> m_arrData;
+	std::array<std::vector<uint32_t>, Trace::OperationType_Count> m_arrDurationsByOperation;
+	size_t m_nOperationCount{};
+	size_t m_nSkippedCount{};
+	size_t m_nErrorCount{};
+	size_t m_nResultMismatchCount{};
+};
+
+void CRegistryAccessTraceReplay::makeWriteData(
+	size_t nSeed,
+	size_t nDataSize,
+	std::vector<BYTE>& arrData)
+{
+	arrData.resize(nDataSize);
+	for (size_t nIndex = 0; nIndex < nDataSize; ++nIndex)
+	{
+		arrData[nIndex] = static_cast<BYTE>(nSeed * 31 + nIndex * 7);
+	}
+}
+
+CRegistryAccessTraceReplay::LatencyStats CRegistryAccessTraceReplay::getLatencyStats(std::vector<uint32_t>& arrDurationsMicroseconds)
+{
+	auto oLatencyStats = LatencyStats{};
+	if (arrDurationsMicroseconds.empty())
+	{
+		return oLatencyStats;
+	}
+
+	std::sort(arrDurationsMicroseconds.begin(), arrDurationsMicroseconds.end());
+	auto fGetPercentile = [&](size_t nPercentile)
+	{
+		// Note: Nearest-rank percentile
+		auto nRank = (nPercentile * arrDurationsMicroseconds.size() + 99) / 100;
+		return uint64_t{ arrDurationsMicroseconds[(std::max)(nRank, size_t{ 1 }) - 1] };
+	};
+
+	uint64_t nTotalMicroseconds = 0;
+	for (auto nDurationMicroseconds : arrDurationsMicroseconds)
+	{
+		nTotalMicroseconds += nDurationMicroseconds;
+	}
+	oLatencyStats.m_nCount = arrDurationsMicroseconds.size();
+	oLatencyStats.m_nMeanMicroseconds = nTotalMicroseconds / arrDurationsMicroseconds.size();
+	oLatencyStats.m_nP50Microseconds = fGetPercentile(50);
+	oLatencyStats.m_nP90Microseconds = fGetPercentile(90);
+	oLatencyStats.m_nP99Microseconds = fGetPercentile(99);
+	oLatencyStats.m_nMaxMicroseconds = arrDurationsMicroseconds.back();
+	return oLatencyStats;
+}
+
+SResult CRegistryAccessTraceReplay::replayRecord(
+	ThreadContext& oThreadContext,
+	const Trace::TraceData& oTraceData,
+	size_t nRecordIndex) const
+{
+	const auto& oRecord = oTraceData.m_arrRecords[nRecordIndex];
+	const auto& sKeyName = oTraceData.m_arrNames[oRecord.m_nKeyNameId];
+	const auto& sValueName = oTraceData.m_arrNames[oRecord.m_nValueNameId];
+	auto& oRegistryAccess = oThreadContext.m_oRegistryAccess;
+
+	switch (oRecord.m_eOperationType)
+	{
+	case Trace::OpenKey:
+		return oRegistryAccess.CheckKeyExists(sKeyName);
+
+	case Trace::CreateKey:
+		return oRegistryAccess.EnsureKeyExists(sKeyName);
+
+	case Trace::DeleteKey:
+		return oRegistryAccess.DeleteKey(sKeyName);
+
+	case Trace::QueryKeyInfo:
+	{
+		auto oKeyInfo = CRegistryAccess::KeyInfo{};
+		return oRegistryAccess.ReadKeyInfo(sKeyName, oKeyInfo);
+	}
+
+	case Trace::QueryValueInfo:
+	{
+		DWORD dwType{};
+		DWORD dwDataSize{};
+		return oRegistryAccess.ReadValueInfo(sKeyName, sValueName, dwType, dwDataSize);
+	}
+
+	case Trace::ReadValue:
+	{
+		DWORD dwType{};
+		return oRegistryAccess.ReadValueBase(sKeyName, sValueName, dwType, oThreadContext.m_arrData);
+	}
+
+	case Trace::WriteValue:
+		makeWriteData(nRecordIndex, oRecord.m_nDataSize, oThreadContext.m_arrData);
+		return oRegistryAccess.WriteValueBase(sKeyName, sValueName, oRecord.m_dwType, oThreadContext.m_arrData);
+
+	case Trace::DeleteValue:
+		return oRegistryAccess.DeleteValue(sKeyName, sValueName);
+
+	case Trace::EnumValues:
+		return oRegistryAccess.EnumAllValues(sKeyName, [](const CRegistryAccess::EnumValueData& /*oEnumValueData*/) -> SResult
+		{
+			return SResult::Success;
+		});
+
+	case Trace::EnumSubkeys:
+		return oRegistryAccess.EnumAllSubkeys(sKeyName, [](const CRegistryAccess::EnumSubkeyData& /*oEnumSubkeyData*/) -> SResult
+		{
+			return SResult::Success;
+		});
+
+	default:
+		VLR_HANDLE_ASSERTION_FAILURE__AND_RETURN_EXPRESSION(E_UNEXPECTED);
+	}
+}
+
+SResult CRegistryAccessTraceReplay::PrepareTarget(
+	const Trace::TraceData& oTraceData) const
+{
+	SResult sr;
+
+	std::set<uint32_t> setPreparedKeyNameIds;
+	std::set<std::pair<uint32_t, uint32_t>> setPreparedValueNameIds;
+	std::vector<BYTE> arrData;
+
+	for (size_t nRecordIndex = 0; nRecordIndex < oTraceData.m_arrRecords.size(); ++nRecordIndex)
+	{
+		const auto& oRecord = oTraceData.m_arrRecords[nRecordIndex];
+		// Note: Creates are expected to succeed against the target either way; keys which did not exist when
+		// checked in the trace (S_FALSE from CheckKeyExists) are left out.
+		if ((oRecord.m_hrResult != S_OK) || (oRecord.m_eOperationType == Trace::CreateKey))
+		{
+			continue;
+		}
+
+		const auto& sKeyName = oTraceData.m_arrNames[oRecord.m_nKeyNameId];
+		if (setPreparedKeyNameIds.insert(oRecord.m_nKeyNameId).second)
+		{
+			sr = m_oRegistryAccess.EnsureKeyExists(sKeyName);
+			VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+		}
+
+		switch (oRecord.m_eOperationType)
+		{
+		case Trace::QueryValueInfo:
+		case Trace::ReadValue:
+		case Trace::DeleteValue:
+			break;
+		default:
+			continue;
+		}
+		if (!setPreparedValueNameIds.emplace(oRecord.m_nKeyNameId, oRecord.m_nValueNameId).second)
+		{
+			continue;
+		}
+
+		// Note: Deletes do not record the type or size of the value
+		auto dwType = (oRecord.m_eOperationType == Trace::DeleteValue) ? DWORD{ REG_BINARY } : DWORD{ oRecord.m_dwType };
+		makeWriteData(nRecordIndex, oRecord.m_nDataSize, arrData);
+		sr = m_oRegistryAccess.WriteValueBase(sKeyName, oTraceData.m_arrNames[oRecord.m_nValueNameId], dwType, arrData);
+		VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+	}
+
+	return SResult::Success;
+}
+
+SResult CRegistryAccessTraceReplay::Replay(
+	const Trace::TraceData& oTraceData,
+	const Options_Replay& options /*= {}*/,
+	Result_Replay* pResult /*= nullptr*/) const
+{
+	if ((options.m_eReplaySpeed == ReplaySpeed::Accelerated) && !(options.m_dSpeedFactor > 0.0))
+	{
+		return E_INVALIDARG;
+	}
+	auto dSpeedFactor = (options.m_eReplaySpeed == ReplaySpeed::Accelerated) ? options.m_dSpeedFactor : 1.0;
+
+	auto nThreadCount = (options.m_nThreadCount != 0)
+		? options.m_nThreadCount
+		: (std::max)(size_t{ oTraceData.m_nThreadCount }, size_t{ 1 });
+
+	// Note: Records are stored in completion order; each thread replays its records in start order
+	std::vector<ThreadContext> arrThreadContexts(nThreadCount);
+	for (auto& oThreadContext : arrThreadContexts)
+	{
+		oThreadContext.m_oRegistryAccess = m_oRegistryAccess;
+	}
+	uint64_t nTraceStartMicroseconds = UINT64_MAX;
+	for (size_t nRecordIndex = 0; nRecordIndex < oTraceData.m_arrRecords.size(); ++nRecordIndex)
+	{
+		const auto& oRecord = oTraceData.m_arrRecords[nRecordIndex];
+		arrThreadContexts[oRecord.m_nThreadIndex % nThreadCount].m_arrRecordIndexes.push_back(nRecordIndex);
+		nTraceStartMicroseconds = (std::min)(nTraceStartMicroseconds, oRecord.m_nStartMicroseconds);
+	}
+	for (auto& oThreadContext : arrThreadContexts)
+	{
+		std::stable_sort(oThreadContext.m_arrRecordIndexes.begin(), oThreadContext.m_arrRecordIndexes.end(), [&](size_t nLhs, size_t nRhs)
+		{
+			return oTraceData.m_arrRecords[nLhs].m_nStartMicroseconds < oTraceData.m_arrRecords[nRhs].m_nStartMicroseconds;
+		});
+	}
+
+	auto tpReplayStart = std::chrono::steady_clock::now();
+
+	auto fReplayThread = [&](ThreadContext& oThreadContext)
+	{
+		for (auto nRecordIndex : oThreadContext.m_arrRecordIndexes)
+		{
+			const auto& oRecord = oTraceData.m_arrRecords[nRecordIndex];
+			if (Trace::IsWriteOperation(oRecord.m_eOperationType) && !options.m_bReplayWrites)
+			{
+				++oThreadContext.m_nSkippedCount;
+				continue;
+			}
+
+			if (options.m_eReplaySpeed != ReplaySpeed::Maximum)
+			{
+				auto dOffsetMicroseconds = static_cast<double>(oRecord.m_nStartMicroseconds - nTraceStartMicroseconds) / dSpeedFactor;
+				std::this_thread::sleep_until(tpReplayStart + std::chrono::microseconds{ static_cast<int64_t>(dOffsetMicroseconds) });
+			}
+
+			auto tpStart = std::chrono::steady_clock::now();
+			auto sr = replayRecord(oThreadContext, oTraceData, nRecordIndex);
+			auto nDurationMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - tpStart).count();
+
+			oThreadContext.m_arrDurationsByOperation[oRecord.m_eOperationType].push_back(static_cast<uint32_t>(
+				(std::min)(nDurationMicroseconds, static_cast<decltype(nDurationMicroseconds)>(UINT32_MAX))));
+			++oThreadContext.m_nOperationCount;
+			if (!sr.isSuccess())
+			{
+				++oThreadContext.m_nErrorCount;
+			}
+			if (sr.asHRESULT() != oRecord.m_hrResult)
+			{
+				++oThreadContext.m_nResultMismatchCount;
+			}
+		}
+	};
+
+	{
+		std::vector<std::thread> arrThreads;
+		arrThreads.reserve(nThreadCount);
+		for (auto& oThreadContext : arrThreadContexts)
+		{
+			arrThreads.emplace_back(fReplayThread, std::ref(oThreadContext));
+		}
+		for (auto& oThread : arrThreads)
+		{
+			oThread.join();
+		}
+	}
+
+	auto nElapsedMicroseconds = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - tpReplayStart).count());
+
+	if (!pResult)
+	{
+		return SResult::Success;
+	}
+
+	auto oResult = Result_Replay{};
+	oResult.m_nThreadCount = nThreadCount;
+	oResult.m_nElapsedMicroseconds = nElapsedMicroseconds;
+	std::vector<uint32_t> arrDurations_All;
+	for (size_t nOperationType = 0; nOperationType < Trace::OperationType_Count; ++nOperationType)
+	{
+		std::vector<uint32_t> arrDurations;
+		for (auto& oThreadContext : arrThreadContexts)
+		{
+			const auto& arrThreadDurations = oThreadContext.m_arrDurationsByOperation[nOperationType];
+			arrDurations.insert(arrDurations.end(), arrThreadDurations.begin(), arrThreadDurations.end());
+		}
+		arrDurations_All.insert(arrDurations_All.end(), arrDurations.begin(), arrDurations.end());
+		oResult.m_arrLatencyStatsByOperation[nOperationType] = getLatencyStats(arrDurations);
+	}
+	oResult.m_oLatencyStats = getLatencyStats(arrDurations_All);
+	for (const auto& oThreadContext : arrThreadContexts)
+	{
+		oResult.m_nOperationCount += oThreadContext.m_nOperationCount;
+		oResult.m_nSkippedCount += oThreadContext.m_nSkippedCount;
+		oResult.m_nErrorCount += oThreadContext.m_nErrorCount;
+		oResult.m_nResultMismatchCount += oThreadContext.m_nResultMismatchCount;
+	}
+	if (nElapsedMicroseconds > 0)
+	{
+		oResult.m_dOperationsPerSecond = static_cast<double>(oResult.m_nOperationCount) * 1000000.0 / static_cast<double>(nElapsedMicroseconds);
+	}
+
+	*pResult = std::move(oResult);
+
+	return SResult::Success;
+}
+
+} // namespace win32
+
+} // namespace vlr
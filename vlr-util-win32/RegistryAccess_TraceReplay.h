@@ -0,0 +1,134 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <vlr-util/util.includes.h>
+#include <vlr-util/util.Result.h>
+
+#include "RegistryAccess.h"
+#include "RegistryAccess_TraceRecorder.h"
+
+namespace vlr {
+
+namespace win32 {
+
+// Replays a recorded trace (see CRegistryAccessTraceRecorder) against a registry access instance; eg: against a
+// hermetic app hive (prepared with PrepareTarget), to benchmark a production workload without the production machine.
+// The schedule is deterministic: each recorded thread's operations run in their recorded order, on the replay thread
+// it is assigned to. Only the interleaving between replay threads (and the timing) varies between runs.
+// Note: Values are written with generated (deterministic) data of the recorded type and size, since trace files do not
+// contain the data itself.
+
+class CRegistryAccessTraceReplay
+{
+public:
+	enum class ReplaySpeed
+	{
+		// Each operation starts at its recorded offset from the start of the trace
+		Original,
+		// As Original, with the offsets divided by the speed factor
+		Accelerated,
+		// Each replay thread runs its operations back to back
+		Maximum,
+	};
+
+	struct Options_Replay
+	{
+		ReplaySpeed m_eReplaySpeed = ReplaySpeed::Maximum;
+		double m_dSpeedFactor = 10.0;
+		// Note: 0 replays each recorded thread on its own thread; otherwise, recorded threads are assigned to the
+		// replay threads round-robin.
+		size_t m_nThreadCount = 0;
+		// Note: Key creates, deletes, and value writes are skipped (and counted) unless enabled, so by default a replay
+		// against a real registry is read-only.
+		bool m_bReplayWrites = false;
+
+		decltype(auto) withReplaySpeed(ReplaySpeed eReplaySpeed)
+		{
+			m_eReplaySpeed = eReplaySpeed;
+			return *this;
+		}
+		decltype(auto) withSpeedFactor(double dSpeedFactor)
+		{
+			m_eReplaySpeed = ReplaySpeed::Accelerated;
+			m_dSpeedFactor = dSpeedFactor;
+			return *this;
+		}
+		decltype(auto) withThreadCount(size_t nThreadCount)
+		{
+			m_nThreadCount = nThreadCount;
+			return *this;
+		}
+		decltype(auto) withReplayWrites(bool bReplayWrites = true)
+		{
+			m_bReplayWrites = bReplayWrites;
+			return *this;
+		}
+	};
+
+	// Note: Exact (not bucketed) percentiles, in microseconds
+	struct LatencyStats
+	{
+		size_t m_nCount{};
+		uint64_t m_nMeanMicroseconds{};
+		uint64_t m_nP50Microseconds{};
+		uint64_t m_nP90Microseconds{};
+		uint64_t m_nP99Microseconds{};
+		uint64_t m_nMaxMicroseconds{};
+	};
+
+	struct Result_Replay
+	{
+		size_t m_nThreadCount{};
+		size_t m_nOperationCount{};
+		size_t m_nSkippedCount{};
+		size_t m_nErrorCount{};
+		// Note: Operations whose result differed from the recorded result
+		size_t m_nResultMismatchCount{};
+		uint64_t m_nElapsedMicroseconds{};
+		double m_dOperationsPerSecond{};
+		LatencyStats m_oLatencyStats;
+		std::array<LatencyStats, RegistryAccess::Trace::OperationType_Count> m_arrLatencyStatsByOperation{};
+	};
+
+protected:
+	CRegistryAccess m_oRegistryAccess;
+
+	struct ThreadContext;
+
+	SResult replayRecord(
+		ThreadContext& oThreadContext,
+		const RegistryAccess::Trace::TraceData& oTraceData,
+		size_t nRecordIndex) const;
+
+	static void makeWriteData(
+		size_t nSeed,
+		size_t nDataSize,
+		std::vector<BYTE>& arrData);
+	static LatencyStats getLatencyStats(std::vector<uint32_t>& arrDurationsMicroseconds);
+
+public:
+	// Creates the keys, and writes the values, which the trace found to exist (ie: which were read successfully), so
+	// a replay against an empty store sees the same keys and values as the recording.
+	SResult PrepareTarget(
+		const RegistryAccess::Trace::TraceData& oTraceData) const;
+	// Note: Failures of replayed operations are counted in the result, and do not fail the replay.
+	SResult Replay(
+		const RegistryAccess::Trace::TraceData& oTraceData,
+		const Options_Replay& options = {},
+		Result_Replay* pResult = nullptr) const;
+
+public:
+	// Note: Operations are replayed without recording, even if the instance has a trace recorder set
+	CRegistryAccessTraceReplay(const CRegistryAccess& oRegistryAccess)
+		: m_oRegistryAccess{ oRegistryAccess }
+	{
+		m_oRegistryAccess.SetTraceRecorder(nullptr);
+	}
+};
+
+} // namespace win32
+
+} // namespace vlr
@@ -0,0 +1,226 @@
+#include "pch.h"
+#include "RegistryAccess_WriteBehind.h"
+
+#include <algorithm>
+
+#include "AutoCleanupTypedefs.h"
+
+namespace vlr {
+
+namespace win32 {
+
+SResult CRegistryAccessWriteBehind::WriteValueBase(
+	tzstring_view svzKeyName,
+	tzstring_view svzValueName,
+	const DWORD& dwType,
+	cpp::span<const BYTE> spanData)
+{
+	bool bFlushThresholdReached = false;
+	{
+		auto slDataAccess = std::scoped_lock{ m_mutexDataAccess };
+
+		auto& mapPendingValues = m_mapPendingKeys[vlr::tstring{ svzKeyName }];
+		auto [iterPendingValue, bInserted] = mapPendingValues.try_emplace(vlr::tstring{ svzValueName });
+		iterPendingValue->second.m_dwType = dwType;
+		iterPendingValue->second.m_arrData.assign(spanData.begin(), spanData.end());
+
+		m_oStats.m_nWritesRequested++;
+		if (bInserted)
+		{
+			m_nPendingValueCount++;
+		}
+		else
+		{
+			m_oStats.m_nWritesCoalesced++;
+		}
+		bFlushThresholdReached = (m_nPendingValueCount >= m_options.m_nFlushThreshold);
+	}
+	if (bFlushThresholdReached)
+	{
+		m_cvFlushNeeded.notify_one();
+	}
+
+	return SResult::Success;
+}
+
+SResult CRegistryAccessWriteBehind::WriteValue_DWORD(
+	tzstring_view svzKeyName,
+	tzstring_view svzValueName,
+	const DWORD& dwValue)
+{
+	SResult sr;
+
+	DWORD dwType{};
+	std::vector<BYTE> arrData{};
+	sr = m_oRegistryAccess.convertValueToRegData_DWORD(
+		dwValue,
+		dwType,
+		arrData);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	return WriteValueBase(svzKeyName, svzValueName, dwType, arrData);
+}
+
+SResult CRegistryAccessWriteBehind::WriteValue_QWORD(
+	tzstring_view svzKeyName,
+	tzstring_view svzValueName,
+	const QWORD& qwValue)
+{
+	SResult sr;
+
+	DWORD dwType{};
+	std::vector<BYTE> arrData{};
+	sr = m_oRegistryAccess.convertValueToRegData_QWORD(
+		qwValue,
+		dwType,
+		arrData);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	return WriteValueBase(svzKeyName, svzValueName, dwType, arrData);
+}
+
+SResult CRegistryAccessWriteBehind::WriteValue_String(
+	tzstring_view svzKeyName,
+	tzstring_view svzValueName,
+	vlr::tstring_view svValue)
+{
+	SResult sr;
+
+	DWORD dwType{};
+	std::vector<BYTE> arrData{};
+	sr = m_oRegistryAccess.convertValueToRegData_String(
+		svValue,
+		dwType,
+		arrData);
+	VLR_ON_SR_ERROR_RETURN_VALUE(sr);
+
+	return WriteValueBase(svzKeyName, svzValueName, dwType, arrData);
+}
+
+SResult CRegistryAccessWriteBehind::flushPending()
+{
+	auto slFlush = std::scoped_lock{ m_mutexFlush };
+
+	// Note: Buffered values are taken as a whole, so writes made during the flush are buffered for the next one
+	PendingKeys mapPendingKeys;
+	{
+		auto slDataAccess = std::scoped_lock{ m_mutexDataAccess };
+		mapPendingKeys.swap(m_mapPendingKeys);
+		m_nPendingValueCount = 0;
+	}
+	if (mapPendingKeys.empty())
+	{
+		return SResult::Success_NoWorkDone;
+	}
+
+	SResult srFirstFailure;
+	size_t nKeysOpened = 0;
+	size_t nValuesWritten = 0;
+	size_t nValuesFailed = 0;
+	auto fOnFailure = [&](const SResult& srFailure, size_t nValueCount)
+	{
+		if (!srFirstFailure.isSet())
+		{
+			srFirstFailure = srFailure;
+		}
+		nValuesFailed += nValueCount;
+	};
+
+	for (const auto& [sKeyName, mapPendingValues] : mapPendingKeys)
+	{
+		HKEY hKey{};
+		auto sr = m_oRegistryAccess.OpenKey(sKeyName, KEY_SET_VALUE, hKey);
+		if (!sr.isSuccess())
+		{
+			fOnFailure(sr, mapPendingValues.size());
+			continue;
+		}
+		auto onDestroy_CloseRegKey = AutoCloseRegKey{ hKey };
+		nKeysOpened++;
+
+		for (const auto& [sValueName, oPendingValue] : mapPendingValues)
+		{
+			sr = m_oRegistryAccess.WriteValueBaseToOpenKey(hKey, sValueName, oPendingValue.m_dwType, oPendingValue.m_arrData);
+			if (!sr.isSuccess())
+			{
+				fOnFailure(sr, 1);
+				continue;
+			}
+			nValuesWritten++;
+		}
+	}
+
+	{
+		auto slDataAccess = std::scoped_lock{ m_mutexDataAccess };
+		m_oStats.m_nFlushCount++;
+		m_oStats.m_nKeysOpened += nKeysOpened;
+		m_oStats.m_nValuesWritten += nValuesWritten;
+		m_oStats.m_nValuesFailed += nValuesFailed;
+		if (srFirstFailure.isSet())
+		{
+			m_oStats.m_srLastFailure = srFirstFailure;
+		}
+	}
+
+	return srFirstFailure.isSet() ? srFirstFailure : SResult::Success;
+}
+
+SResult CRegistryAccessWriteBehind::Flush()
+{
+	return flushPending();
+}
+
+CRegistryAccessWriteBehind::Stats CRegistryAccessWriteBehind::GetStats()
+{
+	auto slDataAccess = std::scoped_lock{ m_mutexDataAccess };
+	return m_oStats;
+}
+
+void CRegistryAccessWriteBehind::threadProc()
+{
+	while (true)
+	{
+		{
+			auto ulDataAccess = std::unique_lock{ m_mutexDataAccess };
+			m_cvFlushNeeded.wait_for(ulDataAccess, m_options.m_durationFlushInterval, [&] {
+				return m_bShutdown || (m_nPendingValueCount >= m_options.m_nFlushThreshold);
+			});
+			if (m_bShutdown)
+			{
+				return;
+			}
+			if (m_nPendingValueCount == 0)
+			{
+				continue;
+			}
+		}
+
+		// Note: Failures are recorded in the stats; there is no caller to return them to here
+		flushPending();
+	}
+}
+
+CRegistryAccessWriteBehind::CRegistryAccessWriteBehind(const CRegistryAccess& oRegistryAccess, const Options_WriteBehind& options /*= {}*/)
+	: m_oRegistryAccess{ oRegistryAccess }
+	, m_options{ options }
+{
+	m_options.m_nFlushThreshold = (std::max)(m_options.m_nFlushThreshold, size_t{ 1 });
+	m_threadFlush = std::thread{ [this] { threadProc(); } };
+}
+
+CRegistryAccessWriteBehind::~CRegistryAccessWriteBehind()
+{
+	{
+		auto slDataAccess = std::scoped_lock{ m_mutexDataAccess };
+		m_bShutdown = true;
+	}
+	m_cvFlushNeeded.notify_all();
+
+	m_threadFlush.join();
+
+	flushPending();
+}
+
+} // namespace win32
+
+} // namespace vlr
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <vlr-util/util.includes.h>
+#include <vlr-util/util.Result.h>
+#include <vlr-util/zstring_view.h>
+
+#include "RegistryAccess.h"
+#include "strings.CaseFold.h"
+
+namespace vlr {
+
+namespace win32 {
+
+// Write-behind (buffered) writes on top of CRegistryAccess, for values which are updated frequently (eg: counters,
+// heartbeat timestamps) where only the latest value needs to be persisted.
+// Writes are buffered in memory, and only the latest value for each (key, value name) is kept. Buffered values are
+// flushed by a background thread on an interval, or earlier once the number of buffered values reaches a threshold;
+// each flush opens each key once, and writes all of its buffered values. Destruction flushes any remaining values.
+// Note that reads through CRegistryAccess do not see buffered values until they are flushed. A value which fails
+// to write (eg: the key does not exist) is dropped, and the failure is counted in the stats; it is not retried.
+
+class CRegistryAccessWriteBehind
+{
+public:
+	using QWORD = CRegistryAccess::QWORD;
+
+	struct Options_WriteBehind
+	{
+		std::chrono::milliseconds m_durationFlushInterval = std::chrono::seconds{ 1 };
+		// Note: Number of distinct buffered values which triggers a flush before the interval elapses
+		size_t m_nFlushThreshold = 256;
+
+		decltype(auto) withFlushInterval(std::chrono::milliseconds durationFlushInterval)
+		{
+			m_durationFlushInterval = durationFlushInterval;
+			return *this;
+		}
+		decltype(auto) withFlushThreshold(size_t nFlushThreshold)
+		{
+			m_nFlushThreshold = nFlushThreshold;
+			return *this;
+		}
+	};
+
+	struct Stats
+	{
+		// Note: Writes requested by the caller, and how many of those replaced a value which was still buffered
+		size_t m_nWritesRequested{};
+		size_t m_nWritesCoalesced{};
+		size_t m_nFlushCount{};
+		size_t m_nKeysOpened{};
+		size_t m_nValuesWritten{};
+		size_t m_nValuesFailed{};
+		SResult m_srLastFailure;
+	};
+
+protected:
+	struct PendingValue
+	{
+		DWORD m_dwType{};
+		std::vector<BYTE> m_arrData;
+	};
+	using PendingValuesForKey = strings::unordered_map_CaseInsensitive<PendingValue>;
+	using PendingKeys = strings::unordered_map_CaseInsensitive<PendingValuesForKey>;
+
+	CRegistryAccess m_oRegistryAccess;
+	Options_WriteBehind m_options;
+
+	std::mutex m_mutexDataAccess;
+	std::condition_variable m_cvFlushNeeded;
+	PendingKeys m_mapPendingKeys;
+	size_t m_nPendingValueCount{};
+	Stats m_oStats;
+	bool m_bShutdown = false;
+
+	// Note: Held for the duration of each flush, so flushes (background and explicit) write in order
+	std::mutex m_mutexFlush;
+
+	std::thread m_threadFlush;
+
+protected:
+	void threadProc();
+	SResult flushPending();
+
+public:
+	SResult WriteValueBase(
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName,
+		const DWORD& dwType,
+		cpp::span<const BYTE> spanData);
+	SResult WriteValue_DWORD(
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName,
+		const DWORD& dwValue);
+	SResult WriteValue_QWORD(
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName,
+		const QWORD& qwValue);
+	SResult WriteValue_String(
+		tzstring_view svzKeyName,
+		tzstring_view svzValueName,
+		vlr::tstring_view svValue);
+
+	// Writes all buffered values on the calling thread; returns the first write failure, if any.
+	// Note: Returns Success_NoWorkDone if nothing was buffered.
+	SResult Flush();
+
+	Stats GetStats();
+
+public:
+	// Note: The registry access instance is copied; the base key must remain open for the life of this instance.
+	CRegistryAccessWriteBehind(const CRegistryAccess& oRegistryAccess, const Options_WriteBehind& options = {});
+	CRegistryAccessWriteBehind(const CRegistryAccessWriteBehind&) = delete;
+	// Note: Stops the background thread, then flushes any remaining buffered values.
+	~CRegistryAccessWriteBehind();
+};
+
+} // namespace win32
+
+} // namespace vlr
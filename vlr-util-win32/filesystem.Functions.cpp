@@ -1,6 +1,7 @@
 #include "pch.h"
 #include "filesystem.Functions.h"
 
+#include <vlr-util/ActionOnDestruction.h>
 #include <vlr-util/util.data_adaptor.MultiSZ.h>
 
 namespace vlr {
@@ -24,6 +25,85 @@ HRESULT GetVolumePathNamesForVolumeName( const vlr::tstring& sVolumeName, std::v
 	return S_OK;
 }
 
+HRESULT ReadFileContents( vlr::tzstring_view svzFilePath, std::vector<BYTE>& arrData )
+{
+	HANDLE hFile = ::CreateFile( svzFilePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+	if (hFile == INVALID_HANDLE_VALUE)
+	{
+		return HRESULT_FROM_WIN32( GetLastError() );
+	}
+	auto oOnDestroy_CloseFile = vlr::MakeActionOnDestruction( [&] {
+		::CloseHandle( hFile );
+	} );
+
+	LARGE_INTEGER liFileSize{};
+	if (!::GetFileSizeEx( hFile, &liFileSize ))
+	{
+		return HRESULT_FROM_WIN32( GetLastError() );
+	}
+	if (static_cast<ULONGLONG>(liFileSize.QuadPart) > MAXDWORD)
+	{
+		return HRESULT_FROM_WIN32( ERROR_FILE_TOO_LARGE );
+	}
+
+	arrData.resize( static_cast<size_t>(liFileSize.QuadPart) );
+	DWORD dwBytesRead{};
+	if (!arrData.empty() && !::ReadFile( hFile, arrData.data(), static_cast<DWORD>(arrData.size()), &dwBytesRead, NULL ))
+	{
+		return HRESULT_FROM_WIN32( GetLastError() );
+	}
+	arrData.resize( dwBytesRead );
+
+	return S_OK;
+}
+
+HRESULT WriteFileContents( vlr::tzstring_view svzFilePath, const BYTE* pData, size_t nDataSize )
+{
+	if (nDataSize > MAXDWORD)
+	{
+		return HRESULT_FROM_WIN32( ERROR_FILE_TOO_LARGE );
+	}
+
+	auto sTempFilePath = vlr::tstring{ svzFilePath } + _T(".tmp");
+
+	HANDLE hFile = ::CreateFile( sTempFilePath.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL );
+	if (hFile == INVALID_HANDLE_VALUE)
+	{
+		return HRESULT_FROM_WIN32( GetLastError() );
+	}
+	bool bReplacedTarget = false;
+	auto oOnDestroy_CleanupTempFile = vlr::MakeActionOnDestruction( [&] {
+		if (hFile != INVALID_HANDLE_VALUE)
+		{
+			::CloseHandle( hFile );
+		}
+		if (!bReplacedTarget)
+		{
+			::DeleteFile( sTempFilePath.c_str() );
+		}
+	} );
+
+	DWORD dwBytesWritten{};
+	if ((nDataSize > 0) && !::WriteFile( hFile, pData, static_cast<DWORD>(nDataSize), &dwBytesWritten, NULL ))
+	{
+		return HRESULT_FROM_WIN32( GetLastError() );
+	}
+	if (!::FlushFileBuffers( hFile ))
+	{
+		return HRESULT_FROM_WIN32( GetLastError() );
+	}
+	::CloseHandle( hFile );
+	hFile = INVALID_HANDLE_VALUE;
+
+	if (!::MoveFileEx( sTempFilePath.c_str(), svzFilePath, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH ))
+	{
+		return HRESULT_FROM_WIN32( GetLastError() );
+	}
+	bReplacedTarget = true;
+
+	return S_OK;
+}
+
 } // namespace filesystem
 
 } // namespace win32
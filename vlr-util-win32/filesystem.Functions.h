@@ -1,8 +1,10 @@
 #pragma once
 
 #include <list>
+#include <vector>
 
 #include <vlr-util/util.includes.h>
+#include <vlr-util/zstring_view.h>
 
 namespace vlr {
 
@@ -12,6 +14,13 @@ namespace filesystem {
 
 HRESULT GetVolumePathNamesForVolumeName( const vlr::tstring& sVolumeName, std::list<vlr::tstring>& oPathNameList );
 
+// Reads the whole file into the buffer.
+HRESULT ReadFileContents( vlr::tzstring_view svzFilePath, std::vector<BYTE>& arrData );
+
+// Writes the file via a temporary file in the same directory, which then replaces the target; readers see either the
+// old or the new contents, never a partial write.
+HRESULT WriteFileContents( vlr::tzstring_view svzFilePath, const BYTE* pData, size_t nDataSize );
+
 } // namespace filesystem
 
 } // namespace win32
@@ -47,6 +47,42 @@ const Win32::F_IsWow64Process2& CWin32::GetFunction_IsWow64Process2()
 	return *m_spIsWow64Process2;
 }
 
+const Win32::F_NtQueryKey& CWin32::GetFunction_NtQueryKey()
+{
+	static const auto _tFailureValue = Win32::F_NtQueryKey{};
+
+	auto slDataAccess = std::scoped_lock{ m_mutexDataAccess };
+
+	static constexpr vlr::tzstring_view svzFunctionName = _T("NtQueryKey");
+	static constexpr vlr::tzstring_view svzLibraryName = _T("ntdll.dll");
+
+	if (m_spNtQueryKey)
+	{
+		return *m_spNtQueryKey;
+	}
+
+	SResult sr;
+
+	CDynamicLoadInfo_Function oLoadInfo;
+	oLoadInfo.m_vecLibraryLoadInfo.push_back(CDynamicLoadInfo_Library{ svzLibraryName });
+	oLoadInfo.m_sFunctionName = svzFunctionName.toStdString();
+
+	// We want the typed function version in the map, so we create and pass in
+	m_spNtQueryKey = std::make_shared<Win32::F_NtQueryKey>();
+
+	SPCDynamicLoadedFunctionBase spDynamicLoadFunction;
+	sr = GetDynamicLoadProc().TryPopulateFunction(oLoadInfo, spDynamicLoadFunction, m_spNtQueryKey);
+	if (sr != SResult::Success)
+	{
+		return _tFailureValue;
+	}
+	// Note: If we succeeded, we should have the non-null value in our variable now
+	VLR_ASSERT_NONZERO_OR_RETURN_FAILURE_VALUE(spDynamicLoadFunction);
+	VLR_ASSERT_COMPARE_OR_RETURN_FAILURE_VALUE(spDynamicLoadFunction.get(), == , m_spNtQueryKey.get());
+
+	return *m_spNtQueryKey;
+}
+
 } // namespace API
 
 } // namespace platform
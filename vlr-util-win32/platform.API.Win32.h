@@ -35,6 +35,19 @@ using F_IsWow64Process2 = vlr::CDynamicLoadedFunction<BOOL WINAPI(
 	/*[out, optional]*/ USHORT* /*pNativeMachine*/
 )>;
 
+// https://learn.microsoft.com/en-us/windows-hardware/drivers/ddi/wdm/nf-wdm-zwquerykey
+
+// Note: From KEY_INFORMATION_CLASS (wdm.h), which is not in the user-mode SDK headers
+static constexpr int KeyInformationClass_KeyNameInformation = 3;
+
+using F_NtQueryKey = vlr::CDynamicLoadedFunction<LONG NTAPI(
+	/*[in]*/            HANDLE /*KeyHandle*/,
+	/*[in]*/            int /*KeyInformationClass*/,
+	/*[out, optional]*/ PVOID /*KeyInformation*/,
+	/*[in]*/            ULONG /*Length*/,
+	/*[out]*/           PULONG /*ResultLength*/
+)>;
+
 } // namespace Win32
 
 class CWin32
@@ -56,9 +69,11 @@ protected:
 	std::recursive_mutex m_mutexDataAccess;
 
 	std::shared_ptr<Win32::F_IsWow64Process2> m_spIsWow64Process2;
+	std::shared_ptr<Win32::F_NtQueryKey> m_spNtQueryKey;
 
 public:
 	const Win32::F_IsWow64Process2& GetFunction_IsWow64Process2();
+	const Win32::F_NtQueryKey& GetFunction_NtQueryKey();
 
 public:
 	CWin32() = default;
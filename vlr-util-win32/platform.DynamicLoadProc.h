@@ -1,6 +1,5 @@
 #pragma once
 
-#include <map>
 #include <mutex>
 #include <wow64apiset.h>
 
@@ -10,6 +9,7 @@
 
 #include "DynamicLoadedLibrary.h"
 #include "DynamicLoadInfo_Function.h"
+#include "strings.CaseFold.h"
 
 namespace vlr {
 
@@ -30,9 +30,9 @@ protected:
 	std::recursive_mutex m_mutexDataAccess;
 	// Note: In Windows, libraries are looked up by the case-insensitive name to check if they are loaded, and if found,
 	// an existing library is always returned. So we emulate this here.
-	std::map<vlr::tstring, CDynamicLoadedLibrary, vlr::StringCompare::asCaseInsensitive> m_mapLoadNameToLibrary;
+	strings::unordered_map_CaseInsensitive<CDynamicLoadedLibrary> m_mapLoadNameToLibrary;
 
-	std::map<vlr::tstring, SPCDynamicLoadedFunctionBase, vlr::StringCompare::asCaseInsensitive> m_mapFunctionIdentifierToLoadedInstance;
+	strings::unordered_map_CaseInsensitive<SPCDynamicLoadedFunctionBase> m_mapFunctionIdentifierToLoadedInstance;
 
 	SResult ResolveDynamicLoadForLibrary(
 		CDynamicLoadedLibrary& oDynamicLoadLibrary);
@@ -0,0 +1,73 @@
+#include "pch.h"
+#include "registry.AppHive.h"
+
+namespace vlr {
+
+namespace win32 {
+
+namespace registry {
+
+SResult CAppHive::Create( tzstring_view svzTempFilePrefix /*= _T("vrh")*/ )
+{
+	LONG lResult{};
+
+	if (m_hRootKey)
+	{
+		return SResult::Success_NoWorkDone;
+	}
+
+	TCHAR szTempPath[MAX_PATH + 1]{};
+	auto nTempPathLength = ::GetTempPath( MAX_PATH, szTempPath );
+	if (nTempPathLength == 0)
+	{
+		return SResult::For_win32_LastError();
+	}
+	TCHAR szHiveFilePath[MAX_PATH + 1]{};
+	if (!::GetTempFileName( szTempPath, svzTempFilePrefix, 0, szHiveFilePath ))
+	{
+		return SResult::For_win32_LastError();
+	}
+	m_sHiveFilePath = szHiveFilePath;
+
+	// Note: GetTempFileName creates an empty file; the hive load will create a valid (empty) hive if the
+	// file does not exist, so remove the placeholder first.
+	::DeleteFile( m_sHiveFilePath.c_str() );
+
+	lResult = ::RegLoadAppKey(
+		m_sHiveFilePath.c_str(),
+		&m_hRootKey,
+		KEY_ALL_ACCESS,
+		0,
+		0 );
+	if (lResult != ERROR_SUCCESS)
+	{
+		m_hRootKey = {};
+		m_sHiveFilePath.clear();
+		return SResult::For_win32_ErrorCode( lResult );
+	}
+
+	return SResult::Success;
+}
+
+void CAppHive::Destroy()
+{
+	if (m_hRootKey)
+	{
+		::RegCloseKey( m_hRootKey );
+		m_hRootKey = {};
+	}
+	if (!m_sHiveFilePath.empty())
+	{
+		// Note: Best-effort cleanup; the hive and its transaction logs are removed once unloaded.
+		::DeleteFile( m_sHiveFilePath.c_str() );
+		::DeleteFile( (m_sHiveFilePath + _T(".LOG1")).c_str() );
+		::DeleteFile( (m_sHiveFilePath + _T(".LOG2")).c_str() );
+		m_sHiveFilePath.clear();
+	}
+}
+
+} // namespace registry
+
+} // namespace win32
+
+} // namespace vlr
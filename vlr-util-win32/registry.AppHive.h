@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vlr-util/util.includes.h>
+#include <vlr-util/util.Result.h>
+#include <vlr-util/zstring_view.h>
+
+namespace vlr {
+
+namespace win32 {
+
+namespace registry {
+
+// A private, in-process registry store, backed by an application hive (RegLoadAppKey) in a new temp file. It is not
+// visible to other processes, does not touch the user or machine registry, and is deleted when the instance is
+// destroyed; eg: for benchmarks, or to replay a trace hermetically.
+
+class CAppHive
+{
+protected:
+	vlr::tstring m_sHiveFilePath;
+	HKEY m_hRootKey = {};
+
+public:
+	// Note: The prefix is for the temp file name (see GetTempFileName; up to 3 chars are used). Returns
+	// Success_NoWorkDone if the hive was already created.
+	SResult Create( tzstring_view svzTempFilePrefix = _T("vrh") );
+	void Destroy();
+
+	inline HKEY GetRootKey() const
+	{
+		return m_hRootKey;
+	}
+	inline const vlr::tstring& GetHiveFilePath() const
+	{
+		return m_sHiveFilePath;
+	}
+
+public:
+	CAppHive() = default;
+	CAppHive( const CAppHive& ) = delete;
+	CAppHive& operator=( const CAppHive& ) = delete;
+	~CAppHive()
+	{
+		Destroy();
+	}
+};
+
+} // namespace registry
+
+} // namespace win32
+
+} // namespace vlr
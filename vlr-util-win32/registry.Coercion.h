@@ -0,0 +1,448 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <type_traits>
+
+#include <vlr-util/cpp_namespace.h>
+#include <vlr-util/util.includes.h>
+#include <vlr-util/util.Result.h>
+#include <vlr-util/util.std_aliases.h>
+#include <vlr-util/util.convert.StringConversion.h>
+
+#include "strings.CaseFold.h"
+
+namespace vlr {
+
+namespace win32 {
+
+namespace registry {
+
+// Coercion of registry data to a requested C++ type, when the stored type is not the native type for it (eg: a
+// DWORD stored as REG_SZ "42", or a bool stored as REG_DWORD).
+// The conversions are dispatched through a constexpr table per requested type, indexed by the stored REG_* type;
+// each entry has the least permissive mode which allows it. Modes are ordered; each allows what the previous does:
+// - Strict: the native type only (REG_DWORD for DWORD and bool, REG_QWORD for QWORD, REG_SZ/REG_EXPAND_SZ for strings)
+// - Lenient: lossless conversions between numeric types (including REG_DWORD_BIG_ENDIAN, and REG_BINARY of the
+//   exact size), and numbers to decimal strings; narrowing fails if the value does not fit
+// - NumericParse: also parses strings as numbers (decimal, or hex with "0x"), and bools ("true"/"false", or numbers)
+// Unsupported conversions return E_UNEXPECTED (as for the non-coercing conversions), unparsable strings
+// ERROR_INVALID_DATA, and values out of range ERROR_ARITHMETIC_OVERFLOW.
+// Note: Coercions (but not native type reads) are counted per requested and stored type, for all threads.
+
+enum class CoercionMode
+{
+	Strict,
+	Lenient,
+	NumericParse,
+};
+
+enum CoercionTarget : size_t
+{
+	Target_DWORD,
+	Target_QWORD,
+	Target_Bool,
+	Target_StringA,
+	Target_StringW,
+	CoercionTarget_Count,
+};
+
+// Note: REG_NONE (0) through REG_QWORD (11) are contiguous, so the stored type is the table index
+static constexpr size_t RegTypeCount = REG_QWORD + 1;
+
+template <typename TValue>
+struct CoercionEntry
+{
+	CoercionMode m_eMinimumMode = CoercionMode::Strict;
+	SResult( *m_pfCoerce )(cpp::span<const BYTE> spanData, TValue& tValue) = nullptr;
+	// Note: False for native type reads, which are not counted
+	bool m_bIsCoercion = false;
+};
+
+struct CoercionCounts
+{
+	std::array<std::array<uint64_t, RegTypeCount>, CoercionTarget_Count> m_arrCounts{};
+
+	inline uint64_t Get( CoercionTarget eTarget, DWORD dwStoredType ) const
+	{
+		return (dwStoredType < RegTypeCount) ? m_arrCounts[eTarget][dwStoredType] : 0;
+	}
+};
+
+namespace detail {
+
+inline auto& GetCoercionCounters()
+{
+	static std::array<std::array<std::atomic<uint64_t>, RegTypeCount>, CoercionTarget_Count> arrCounters{};
+	return arrCounters;
+}
+
+template <typename TInteger>
+inline SResult ReadInteger( cpp::span<const BYTE> spanData, TInteger& tValue )
+{
+	if (spanData.size() != sizeof( TInteger ))
+	{
+		return __HRESULT_FROM_WIN32( ERROR_INVALID_DATA );
+	}
+	std::memcpy( &tValue, spanData.data(), sizeof( TInteger ) );
+	return SResult::Success;
+}
+
+template <typename TInteger>
+inline SResult NarrowInteger( uint64_t nValue, TInteger& tValue )
+{
+	if (nValue > static_cast<uint64_t>((std::numeric_limits<TInteger>::max)()))
+	{
+		return __HRESULT_FROM_WIN32( ERROR_ARITHMETIC_OVERFLOW );
+	}
+	tValue = static_cast<TInteger>(nValue);
+	return SResult::Success;
+}
+
+// Note: The data may or may not include the terminator; the string ends at the first null char (as for REG_SZ reads)
+inline vlr::tstring_view GetStringView( cpp::span<const BYTE> spanData )
+{
+	auto svValue = vlr::tstring_view{ reinterpret_cast<const TCHAR*>(spanData.data()), spanData.size() / sizeof( TCHAR ) };
+	auto nNullIndex = svValue.find( _T( '\0' ) );
+	return (nNullIndex != vlr::tstring_view::npos) ? svValue.substr( 0, nNullIndex ) : svValue;
+}
+
+inline vlr::tstring_view TrimWhitespace( vlr::tstring_view svValue )
+{
+	static constexpr auto svWhitespace = vlr::tstring_view{ _T( " \t\r\n" ) };
+	auto nStart = svValue.find_first_not_of( svWhitespace );
+	if (nStart == vlr::tstring_view::npos)
+	{
+		return {};
+	}
+	auto nEnd = svValue.find_last_not_of( svWhitespace );
+	return svValue.substr( nStart, nEnd - nStart + 1 );
+}
+
+inline SResult ParseUnsigned( vlr::tstring_view svValue, uint64_t& nValue )
+{
+	svValue = TrimWhitespace( svValue );
+	if (!svValue.empty() && svValue.front() == _T( '+' ))
+	{
+		svValue.remove_prefix( 1 );
+	}
+
+	uint64_t nBase = 10;
+	if (svValue.size() > 2 && svValue[0] == _T( '0' ) && (svValue[1] == _T( 'x' ) || svValue[1] == _T( 'X' )))
+	{
+		nBase = 16;
+		svValue.remove_prefix( 2 );
+	}
+	if (svValue.empty())
+	{
+		return __HRESULT_FROM_WIN32( ERROR_INVALID_DATA );
+	}
+
+	uint64_t nResult = 0;
+	for (auto chDigit : svValue)
+	{
+		uint64_t nDigit{};
+		if (chDigit >= _T( '0' ) && chDigit <= _T( '9' ))
+		{
+			nDigit = static_cast<uint64_t>(chDigit - _T( '0' ));
+		}
+		else if (nBase == 16 && chDigit >= _T( 'a' ) && chDigit <= _T( 'f' ))
+		{
+			nDigit = static_cast<uint64_t>(chDigit - _T( 'a' )) + 10;
+		}
+		else if (nBase == 16 && chDigit >= _T( 'A' ) && chDigit <= _T( 'F' ))
+		{
+			nDigit = static_cast<uint64_t>(chDigit - _T( 'A' )) + 10;
+		}
+		else
+		{
+			return __HRESULT_FROM_WIN32( ERROR_INVALID_DATA );
+		}
+
+		if (nResult > ((std::numeric_limits<uint64_t>::max)() - nDigit) / nBase)
+		{
+			return __HRESULT_FROM_WIN32( ERROR_ARITHMETIC_OVERFLOW );
+		}
+		nResult = nResult * nBase + nDigit;
+	}
+
+	nValue = nResult;
+	return SResult::Success;
+}
+
+// Conversions from each stored type, to integers (DWORD, QWORD)
+
+template <typename TInteger>
+inline SResult CoerceFrom_DWORD( cpp::span<const BYTE> spanData, TInteger& tValue )
+{
+	DWORD dwValue{};
+	auto sr = ReadInteger( spanData, dwValue );
+	VLR_ON_SR_ERROR_RETURN_VALUE( sr );
+	tValue = static_cast<TInteger>(dwValue);
+	return SResult::Success;
+}
+
+template <typename TInteger>
+inline SResult CoerceFrom_DWORD_BigEndian( cpp::span<const BYTE> spanData, TInteger& tValue )
+{
+	DWORD dwValue{};
+	auto sr = ReadInteger( spanData, dwValue );
+	VLR_ON_SR_ERROR_RETURN_VALUE( sr );
+	tValue = static_cast<TInteger>(_byteswap_ulong( dwValue ));
+	return SResult::Success;
+}
+
+template <typename TInteger>
+inline SResult CoerceFrom_QWORD( cpp::span<const BYTE> spanData, TInteger& tValue )
+{
+	uint64_t qwValue{};
+	auto sr = ReadInteger( spanData, qwValue );
+	VLR_ON_SR_ERROR_RETURN_VALUE( sr );
+	return NarrowInteger( qwValue, tValue );
+}
+
+template <typename TInteger>
+inline SResult CoerceFrom_Binary( cpp::span<const BYTE> spanData, TInteger& tValue )
+{
+	return ReadInteger( spanData, tValue );
+}
+
+template <typename TInteger>
+inline SResult CoerceFrom_String( cpp::span<const BYTE> spanData, TInteger& tValue )
+{
+	uint64_t nValue{};
+	auto sr = ParseUnsigned( GetStringView( spanData ), nValue );
+	VLR_ON_SR_ERROR_RETURN_VALUE( sr );
+	return NarrowInteger( nValue, tValue );
+}
+
+// Conversions to bool; numbers are true if non-zero
+
+template <typename FCoerce>
+inline SResult CoerceToBool( cpp::span<const BYTE> spanData, bool& bValue, FCoerce fCoerce )
+{
+	uint64_t nValue{};
+	auto sr = fCoerce( spanData, nValue );
+	VLR_ON_SR_ERROR_RETURN_VALUE( sr );
+	bValue = (nValue != 0);
+	return SResult::Success;
+}
+
+inline SResult CoerceBoolFrom_DWORD( cpp::span<const BYTE> spanData, bool& bValue )
+{
+	return CoerceToBool( spanData, bValue, CoerceFrom_DWORD<uint64_t> );
+}
+
+inline SResult CoerceBoolFrom_DWORD_BigEndian( cpp::span<const BYTE> spanData, bool& bValue )
+{
+	return CoerceToBool( spanData, bValue, CoerceFrom_DWORD_BigEndian<uint64_t> );
+}
+
+inline SResult CoerceBoolFrom_QWORD( cpp::span<const BYTE> spanData, bool& bValue )
+{
+	return CoerceToBool( spanData, bValue, CoerceFrom_QWORD<uint64_t> );
+}
+
+inline SResult CoerceBoolFrom_String( cpp::span<const BYTE> spanData, bool& bValue )
+{
+	auto svValue = TrimWhitespace( GetStringView( spanData ) );
+	if (strings::AreEqual_CaseInsensitive<TCHAR>( svValue, _T( "true" ) ))
+	{
+		bValue = true;
+		return SResult::Success;
+	}
+	if (strings::AreEqual_CaseInsensitive<TCHAR>( svValue, _T( "false" ) ))
+	{
+		bValue = false;
+		return SResult::Success;
+	}
+	return CoerceToBool( spanData, bValue, CoerceFrom_String<uint64_t> );
+}
+
+// Conversions to strings; numbers are formatted as decimal
+
+template <typename TString>
+inline SResult CoerceStringFrom_String( cpp::span<const BYTE> spanData, TString& sValue )
+{
+	auto svValue = GetStringView( spanData );
+	if constexpr (std::is_same_v<typename TString::value_type, TCHAR>)
+	{
+		sValue.assign( svValue.data(), svValue.size() );
+	}
+	else if constexpr (std::is_same_v<typename TString::value_type, char>)
+	{
+		sValue = util::Convert::ToStdStringA( svValue );
+	}
+	else
+	{
+		sValue = util::Convert::ToStdStringW( svValue );
+	}
+	return SResult::Success;
+}
+
+template <typename TString, typename FCoerce>
+inline SResult CoerceToString( cpp::span<const BYTE> spanData, TString& sValue, FCoerce fCoerce )
+{
+	uint64_t nValue{};
+	auto sr = fCoerce( spanData, nValue );
+	VLR_ON_SR_ERROR_RETURN_VALUE( sr );
+	if constexpr (std::is_same_v<typename TString::value_type, char>)
+	{
+		sValue = std::to_string( nValue );
+	}
+	else
+	{
+		sValue = std::to_wstring( nValue );
+	}
+	return SResult::Success;
+}
+
+template <typename TString>
+inline SResult CoerceStringFrom_DWORD( cpp::span<const BYTE> spanData, TString& sValue )
+{
+	return CoerceToString( spanData, sValue, CoerceFrom_DWORD<uint64_t> );
+}
+
+template <typename TString>
+inline SResult CoerceStringFrom_DWORD_BigEndian( cpp::span<const BYTE> spanData, TString& sValue )
+{
+	return CoerceToString( spanData, sValue, CoerceFrom_DWORD_BigEndian<uint64_t> );
+}
+
+template <typename TString>
+inline SResult CoerceStringFrom_QWORD( cpp::span<const BYTE> spanData, TString& sValue )
+{
+	return CoerceToString( spanData, sValue, CoerceFrom_QWORD<uint64_t> );
+}
+
+// Tables
+
+template <typename TInteger>
+constexpr auto MakeIntegerCoercionTable( DWORD dwNativeType )
+{
+	std::array<CoercionEntry<TInteger>, RegTypeCount> arrEntries{};
+	arrEntries[REG_DWORD] = { CoercionMode::Lenient, &CoerceFrom_DWORD<TInteger>, true };
+	arrEntries[REG_DWORD_BIG_ENDIAN] = { CoercionMode::Lenient, &CoerceFrom_DWORD_BigEndian<TInteger>, true };
+	arrEntries[REG_QWORD] = { CoercionMode::Lenient, &CoerceFrom_QWORD<TInteger>, true };
+	arrEntries[REG_BINARY] = { CoercionMode::Lenient, &CoerceFrom_Binary<TInteger>, true };
+	arrEntries[REG_SZ] = { CoercionMode::NumericParse, &CoerceFrom_String<TInteger>, true };
+	arrEntries[REG_EXPAND_SZ] = { CoercionMode::NumericParse, &CoerceFrom_String<TInteger>, true };
+	arrEntries[dwNativeType].m_eMinimumMode = CoercionMode::Strict;
+	arrEntries[dwNativeType].m_bIsCoercion = false;
+	return arrEntries;
+}
+
+template <typename TString>
+constexpr auto MakeStringCoercionTable()
+{
+	std::array<CoercionEntry<TString>, RegTypeCount> arrEntries{};
+	arrEntries[REG_SZ] = { CoercionMode::Strict, &CoerceStringFrom_String<TString>, false };
+	arrEntries[REG_EXPAND_SZ] = { CoercionMode::Strict, &CoerceStringFrom_String<TString>, false };
+	arrEntries[REG_DWORD] = { CoercionMode::Lenient, &CoerceStringFrom_DWORD<TString>, true };
+	arrEntries[REG_DWORD_BIG_ENDIAN] = { CoercionMode::Lenient, &CoerceStringFrom_DWORD_BigEndian<TString>, true };
+	arrEntries[REG_QWORD] = { CoercionMode::Lenient, &CoerceStringFrom_QWORD<TString>, true };
+	return arrEntries;
+}
+
+} // namespace detail
+
+template <typename TValue>
+struct CoercionTable
+{
+	static_assert(sizeof( TValue ) == 0, "Unhandled type for registry data coercion");
+};
+
+template <>
+struct CoercionTable<DWORD>
+{
+	static constexpr auto m_eTarget = Target_DWORD;
+	static constexpr auto m_arrEntries = detail::MakeIntegerCoercionTable<DWORD>( REG_DWORD );
+};
+
+template <>
+struct CoercionTable<uint64_t>
+{
+	static constexpr auto m_eTarget = Target_QWORD;
+	static constexpr auto m_arrEntries = detail::MakeIntegerCoercionTable<uint64_t>( REG_QWORD );
+};
+
+template <>
+struct CoercionTable<bool>
+{
+	static constexpr auto m_eTarget = Target_Bool;
+	static constexpr auto m_arrEntries = [] {
+		std::array<CoercionEntry<bool>, RegTypeCount> arrEntries{};
+		// Note: REG_DWORD is the conventional (native) storage for flags, so non-zero is true even in strict mode, and
+		// is not counted as a coercion
+		arrEntries[REG_DWORD] = { CoercionMode::Strict, &detail::CoerceBoolFrom_DWORD, false };
+		arrEntries[REG_DWORD_BIG_ENDIAN] = { CoercionMode::Lenient, &detail::CoerceBoolFrom_DWORD_BigEndian, true };
+		arrEntries[REG_QWORD] = { CoercionMode::Lenient, &detail::CoerceBoolFrom_QWORD, true };
+		arrEntries[REG_SZ] = { CoercionMode::NumericParse, &detail::CoerceBoolFrom_String, true };
+		arrEntries[REG_EXPAND_SZ] = { CoercionMode::NumericParse, &detail::CoerceBoolFrom_String, true };
+		return arrEntries;
+	}();
+};
+
+template <>
+struct CoercionTable<std::string>
+{
+	static constexpr auto m_eTarget = Target_StringA;
+	static constexpr auto m_arrEntries = detail::MakeStringCoercionTable<std::string>();
+};
+
+template <>
+struct CoercionTable<std::wstring>
+{
+	static constexpr auto m_eTarget = Target_StringW;
+	static constexpr auto m_arrEntries = detail::MakeStringCoercionTable<std::wstring>();
+};
+
+template <typename TValue>
+constexpr bool IsCoercionSupported( DWORD dwStoredType, CoercionMode eMode )
+{
+	if (dwStoredType >= RegTypeCount)
+	{
+		return false;
+	}
+	const auto& oEntry = CoercionTable<TValue>::m_arrEntries[dwStoredType];
+	return (oEntry.m_pfCoerce != nullptr) && (eMode >= oEntry.m_eMinimumMode);
+}
+
+template <typename TValue>
+inline SResult CoerceRegData( DWORD dwStoredType, cpp::span<const BYTE> spanData, TValue& tValue, CoercionMode eMode )
+{
+	if (!IsCoercionSupported<TValue>( dwStoredType, eMode ))
+	{
+		return E_UNEXPECTED;
+	}
+
+	const auto& oEntry = CoercionTable<TValue>::m_arrEntries[dwStoredType];
+	if (oEntry.m_bIsCoercion)
+	{
+		detail::GetCoercionCounters()[CoercionTable<TValue>::m_eTarget][dwStoredType].fetch_add( 1, std::memory_order_relaxed );
+	}
+	return oEntry.m_pfCoerce( spanData, tValue );
+}
+
+inline CoercionCounts GetCoercionCounts()
+{
+	CoercionCounts oCounts;
+	const auto& arrCounters = detail::GetCoercionCounters();
+	for (size_t nTarget = 0; nTarget < CoercionTarget_Count; ++nTarget)
+	{
+		for (size_t nType = 0; nType < RegTypeCount; ++nType)
+		{
+			oCounts.m_arrCounts[nTarget][nType] = arrCounters[nTarget][nType].load( std::memory_order_relaxed );
+		}
+	}
+	return oCounts;
+}
+
+} // namespace registry
+
+} // namespace win32
+
+} // namespace vlr
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vlr-util/util.includes.h>
+#include <vlr-util/cpp_namespace.h>
+
+namespace vlr {
+
+namespace win32 {
+
+namespace registry {
+
+// Note: 64-bit FNV-1a; this is for change detection (eg: comparing value content between reads), not for
+// security purposes. Values of different types with identical bytes hash differently.
+
+static constexpr uint64_t ContentHash_OffsetBasis = 14695981039346656037ULL;
+static constexpr uint64_t ContentHash_Prime = 1099511628211ULL;
+
+constexpr uint64_t UpdateContentHash( uint64_t nHash, const BYTE* pData, size_t nByteCount )
+{
+	for (size_t i = 0; i < nByteCount; ++i)
+	{
+		nHash ^= pData[i];
+		nHash *= ContentHash_Prime;
+	}
+	return nHash;
+}
+
+inline uint64_t GetValueContentHash( DWORD dwType, cpp::span<const BYTE> spanData )
+{
+	auto nHash = ContentHash_OffsetBasis;
+	nHash = UpdateContentHash( nHash, reinterpret_cast<const BYTE*>(&dwType), sizeof( dwType ) );
+	nHash = UpdateContentHash( nHash, spanData.data(), spanData.size() );
+	return nHash;
+}
+
+} // namespace registry
+
+} // namespace win32
+
+} // namespace vlr
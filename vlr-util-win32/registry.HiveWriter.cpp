@@ -0,0 +1,948 @@
+#include "pch.h"
+#include "registry.HiveWriter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <initializer_list>
+#include <numeric>
+
+namespace vlr {
+
+namespace win32 {
+
+namespace registry {
+
+namespace {
+
+constexpr uint32_t nBaseBlockSize = 4096;
+constexpr uint32_t nHiveBinAlignment = 4096;
+constexpr uint32_t nHiveBinHeaderSize = 32;
+// Note: Keeps offsets (and the file size) within the signed 32-bit range used by cell sizes
+constexpr uint32_t nMaxHiveBinsDataSize = 0x7FFFF000;
+constexpr uint32_t nCellNil = 0xFFFFFFFF;
+
+// Note: Data larger than this is split into big data segments of this size
+constexpr uint32_t nMaxDataCellSize = 16344;
+constexpr uint32_t nMaxBigDataSegmentCount = 0xFFFF;
+constexpr uint32_t nResidentDataSize = 4;
+constexpr uint32_t nResidentDataFlag = 0x80000000;
+constexpr size_t nMaxIndexLeafCount = 512;
+
+constexpr size_t nMaxKeyNameLength = 255;
+constexpr size_t nMaxValueNameLength = 16383;
+constexpr size_t nMaxKeyDepth = 512;
+
+constexpr uint16_t nKeyFlag_HiveEntry = 0x0004;
+constexpr uint16_t nKeyFlag_NoDelete = 0x0008;
+constexpr uint16_t nKeyFlag_CompressedName = 0x0020;
+constexpr uint16_t nValueFlag_CompressedName = 0x0001;
+
+constexpr size_t nKeyNodeHeaderSize = 76;
+constexpr size_t nValueHeaderSize = 20;
+constexpr size_t nSecurityHeaderSize = 20;
+constexpr size_t nBigDataHeaderSize = 8;
+constexpr size_t nIndexHeaderSize = 4;
+
+constexpr uint32_t nRegType_SZ = 1;
+constexpr uint32_t nRegType_EXPAND_SZ = 2;
+constexpr uint32_t nRegType_DWORD = 4;
+constexpr uint32_t nRegType_MULTI_SZ = 7;
+constexpr uint32_t nRegType_QWORD = 11;
+
+constexpr auto svRootKeyName_Default = std::wstring_view{ L"ROOT" };
+
+inline uint32_t AlignUp( uint32_t nValue, uint32_t nAlignment )
+{
+	return (nValue + nAlignment - 1) / nAlignment * nAlignment;
+}
+
+// All values in the file are little-endian
+
+inline void Put16( uint8_t* pData, uint16_t nValue )
+{
+	pData[0] = static_cast<uint8_t>(nValue);
+	pData[1] = static_cast<uint8_t>(nValue >> 8);
+}
+
+inline void Put32( uint8_t* pData, uint32_t nValue )
+{
+	for (size_t i = 0; i < 4; ++i)
+	{
+		pData[i] = static_cast<uint8_t>(nValue >> (8 * i));
+	}
+}
+
+inline void Put64( uint8_t* pData, uint64_t nValue )
+{
+	Put32( pData, static_cast<uint32_t>(nValue) );
+	Put32( pData + 4, static_cast<uint32_t>(nValue >> 32) );
+}
+
+inline uint32_t Get32( const uint8_t* pData )
+{
+	return static_cast<uint32_t>(pData[0]) | (static_cast<uint32_t>(pData[1]) << 8) | (static_cast<uint32_t>(pData[2]) << 16) | (static_cast<uint32_t>(pData[3]) << 24);
+}
+
+inline void AppendUtf16( std::wstring_view svValue, std::vector<uint8_t>& arrData )
+{
+	auto fAppendUnit = [&]( uint32_t nUnit )
+	{
+		arrData.push_back( static_cast<uint8_t>(nUnit) );
+		arrData.push_back( static_cast<uint8_t>(nUnit >> 8) );
+	};
+	for (auto ch : svValue)
+	{
+		auto nCodePoint = static_cast<uint32_t>(ch);
+		if (nCodePoint > 0xFFFF)
+		{
+			// Note: Only where wchar_t is 32-bit
+			nCodePoint -= 0x10000;
+			fAppendUnit( 0xD800 + (nCodePoint >> 10) );
+			fAppendUnit( 0xDC00 + (nCodePoint & 0x3FF) );
+			continue;
+		}
+		fAppendUnit( nCodePoint );
+	}
+}
+
+std::u16string ToUtf16( std::wstring_view svValue )
+{
+	std::vector<uint8_t> arrData;
+	AppendUtf16( svValue, arrData );
+	std::u16string sResult( arrData.size() / 2, u'\0' );
+	for (size_t i = 0; i < sResult.size(); ++i)
+	{
+		sResult[i] = static_cast<char16_t>(arrData[2 * i] | (arrData[2 * i + 1] << 8));
+	}
+	return sResult;
+}
+
+inline char16_t UpcaseChar( char16_t ch )
+{
+	if ((ch >= u'a' && ch <= u'z') || (ch >= 0xE0 && ch <= 0xFE && ch != 0xF7))
+	{
+		return static_cast<char16_t>(ch - 0x20);
+	}
+	if (ch == 0xB5)
+	{
+		return 0x039C;
+	}
+	if (ch == 0xFF)
+	{
+		return 0x0178;
+	}
+	return ch;
+}
+
+inline std::u16string Upcase( std::u16string sValue )
+{
+	std::transform( sValue.begin(), sValue.end(), sValue.begin(), UpcaseChar );
+	return sValue;
+}
+
+// Note: The hash used by lh leaves, of the upcased name
+inline uint32_t GetNameHash( const std::u16string& sUpcasedName )
+{
+	uint32_t nHash = 0;
+	for (auto ch : sUpcasedName)
+	{
+		nHash = nHash * 37 + ch;
+	}
+	return nHash;
+}
+
+// Names are stored as Latin-1 ("compressed") if possible, else as UTF-16LE
+struct EncodedName
+{
+	std::u16string m_sName;
+	bool m_bCompressed = true;
+
+	explicit EncodedName( std::wstring_view svName )
+		: m_sName{ ToUtf16( svName ) }
+	{
+		m_bCompressed = std::all_of( m_sName.begin(), m_sName.end(), []( char16_t ch ) { return ch <= 0xFF; } );
+	}
+
+	inline size_t GetByteCount() const
+	{
+		return m_bCompressed ? m_sName.size() : m_sName.size() * 2;
+	}
+	// Note: Lengths in the parent's "largest name" fields are always in UTF-16 bytes
+	inline uint32_t GetUtf16ByteCount() const
+	{
+		return static_cast<uint32_t>(m_sName.size() * 2);
+	}
+	inline void WriteTo( uint8_t* pData ) const
+	{
+		for (auto ch : m_sName)
+		{
+			if (m_bCompressed)
+			{
+				*pData++ = static_cast<uint8_t>(ch);
+			}
+			else
+			{
+				Put16( pData, ch );
+				pData += 2;
+			}
+		}
+	}
+};
+
+inline bool IsValidKeyName( std::wstring_view svName )
+{
+	return !svName.empty() && svName.size() <= nMaxKeyNameLength && svName.find( L'\\' ) == std::wstring_view::npos;
+}
+
+// Note: Returns the indexes of the subkeys, ordered by upcased name (the order required for the subkey index)
+SResult GetSortedSubkeyOrder( const HiveKey& oKey, std::vector<size_t>& arrOrder, std::vector<std::u16string>& arrUpcasedNames )
+{
+	arrUpcasedNames.clear();
+	arrUpcasedNames.reserve( oKey.m_arrSubkeys.size() );
+	for (const auto& oSubkey : oKey.m_arrSubkeys)
+	{
+		arrUpcasedNames.push_back( Upcase( ToUtf16( oSubkey.m_sName ) ) );
+	}
+
+	arrOrder.resize( oKey.m_arrSubkeys.size() );
+	std::iota( arrOrder.begin(), arrOrder.end(), size_t{ 0 } );
+	std::sort( arrOrder.begin(), arrOrder.end(), [&]( size_t nLHS, size_t nRHS )
+	{
+		return arrUpcasedNames[nLHS] < arrUpcasedNames[nRHS];
+	} );
+
+	auto iterDuplicate = std::adjacent_find( arrOrder.begin(), arrOrder.end(), [&]( size_t nLHS, size_t nRHS )
+	{
+		return arrUpcasedNames[nLHS] == arrUpcasedNames[nRHS];
+	} );
+	if (iterDuplicate != arrOrder.end())
+	{
+		return E_INVALIDARG;
+	}
+
+	return SResult::Success;
+}
+
+SResult CheckValueNames( const HiveKey& oKey )
+{
+	std::vector<std::u16string> arrUpcasedNames;
+	arrUpcasedNames.reserve( oKey.m_arrValues.size() );
+	for (const auto& oValue : oKey.m_arrValues)
+	{
+		if (oValue.m_sName.size() > nMaxValueNameLength)
+		{
+			return E_INVALIDARG;
+		}
+		arrUpcasedNames.push_back( Upcase( ToUtf16( oValue.m_sName ) ) );
+	}
+	std::sort( arrUpcasedNames.begin(), arrUpcasedNames.end() );
+	if (std::adjacent_find( arrUpcasedNames.begin(), arrUpcasedNames.end() ) != arrUpcasedNames.end())
+	{
+		return E_INVALIDARG;
+	}
+	return SResult::Success;
+}
+
+void AppendSid( std::vector<uint8_t>& arrData, std::initializer_list<uint32_t> ilSubAuthorities )
+{
+	// S-1-5-...: revision 1, NT authority
+	arrData.push_back( 1 );
+	arrData.push_back( static_cast<uint8_t>(ilSubAuthorities.size()) );
+	arrData.insert( arrData.end(), { 0, 0, 0, 0, 0, 5 } );
+	for (auto nSubAuthority : ilSubAuthorities)
+	{
+		arrData.resize( arrData.size() + 4 );
+		Put32( arrData.data() + arrData.size() - 4, nSubAuthority );
+	}
+}
+
+std::vector<uint8_t> MakeDefaultSecurityDescriptor()
+{
+	static constexpr uint32_t nAccess_KeyAllAccess = 0xF003F;
+	static constexpr uint32_t nAccess_KeyRead = 0x20019;
+	static constexpr uint8_t nAceFlag_ContainerInherit = 0x02;
+
+	std::vector<uint8_t> arrAcl( 8 );
+	size_t nAceCount = 0;
+	auto fAppendAllowedAce = [&]( uint32_t nAccessMask, std::initializer_list<uint32_t> ilSubAuthorities )
+	{
+		auto nAceOffset = arrAcl.size();
+		arrAcl.resize( nAceOffset + 8 );
+		AppendSid( arrAcl, ilSubAuthorities );
+		arrAcl[nAceOffset] = 0; // ACCESS_ALLOWED_ACE_TYPE
+		arrAcl[nAceOffset + 1] = nAceFlag_ContainerInherit;
+		Put16( &arrAcl[nAceOffset + 2], static_cast<uint16_t>(arrAcl.size() - nAceOffset) );
+		Put32( &arrAcl[nAceOffset + 4], nAccessMask );
+		++nAceCount;
+	};
+	fAppendAllowedAce( nAccess_KeyAllAccess, { 18 } );
+	fAppendAllowedAce( nAccess_KeyAllAccess, { 32, 544 } );
+	fAppendAllowedAce( nAccess_KeyRead, { 32, 545 } );
+	arrAcl[0] = 2; // ACL_REVISION
+	Put16( &arrAcl[2], static_cast<uint16_t>(arrAcl.size()) );
+	Put16( &arrAcl[4], static_cast<uint16_t>(nAceCount) );
+
+	// Self-relative: header, DACL, owner (Administrators), group (SYSTEM)
+	std::vector<uint8_t> arrSecurityDescriptor( 20 );
+	arrSecurityDescriptor[0] = 1; // SECURITY_DESCRIPTOR_REVISION
+	Put16( &arrSecurityDescriptor[2], 0x8004 ); // SE_SELF_RELATIVE | SE_DACL_PRESENT
+	auto nDaclOffset = arrSecurityDescriptor.size();
+	arrSecurityDescriptor.insert( arrSecurityDescriptor.end(), arrAcl.begin(), arrAcl.end() );
+	auto nOwnerOffset = arrSecurityDescriptor.size();
+	AppendSid( arrSecurityDescriptor, { 32, 544 } );
+	auto nGroupOffset = arrSecurityDescriptor.size();
+	AppendSid( arrSecurityDescriptor, { 18 } );
+	Put32( &arrSecurityDescriptor[4], static_cast<uint32_t>(nOwnerOffset) );
+	Put32( &arrSecurityDescriptor[8], static_cast<uint32_t>(nGroupOffset) );
+	Put32( &arrSecurityDescriptor[16], static_cast<uint32_t>(nDaclOffset) );
+
+	return arrSecurityDescriptor;
+}
+
+uint64_t GetCurrentFileTime()
+{
+	// Note: FILETIME counts 100ns intervals since 1601-01-01; the system clock counts from 1970-01-01
+	static constexpr uint64_t nFileTimeUnixEpoch = 116444736000000000ULL;
+	auto nTicksSinceUnixEpoch = std::chrono::duration_cast<std::chrono::duration<int64_t, std::ratio<1, 10000000>>>(
+		std::chrono::system_clock::now().time_since_epoch() ).count();
+	return nFileTimeUnixEpoch + static_cast<uint64_t>(nTicksSinceUnixEpoch);
+}
+
+} // namespace
+
+// Note: The same sequence of cell allocations is made in both passes; the layout pass records the offsets which are
+// referenced before their cells are written, and the write pass fills in the cells and outputs each completed bin.
+struct CHiveWriter::WriteContext
+{
+	struct KeyLayout
+	{
+		uint32_t m_nKeyCell = nCellNil;
+		uint32_t m_nIndexCell = nCellNil;
+		uint32_t m_nValueListCell = nCellNil;
+		size_t m_nSubtreeKeyCount = 0;
+	};
+
+	const OnOutput* m_pfOnOutput = nullptr;
+	uint64_t m_nLastWriteTime = 0;
+	const std::vector<uint8_t>& m_arrSecurityDescriptor;
+
+	std::vector<KeyLayout> m_arrKeyLayouts;
+	size_t m_nNextKeyIndex = 0;
+	uint32_t m_nSecurityCell = nCellNil;
+
+	uint32_t m_nHiveBinsDataSize = 0;
+	uint32_t m_nBinOffset = 0;
+	uint32_t m_nBinSize = 0;
+	uint32_t m_nBinUsed = 0;
+	std::vector<uint8_t> m_arrBin;
+
+	Result_HiveWriter m_oResult;
+
+	inline bool IsWritePass() const
+	{
+		return (m_pfOnOutput != nullptr);
+	}
+
+	SResult closeBin()
+	{
+		if (m_nBinSize == 0)
+		{
+			return SResult::Success;
+		}
+
+		++m_oResult.m_nHiveBinCount;
+		if (!IsWritePass())
+		{
+			return SResult::Success;
+		}
+
+		// Note: The unused end of the bin is one free cell (positive size)
+		if (m_nBinUsed < m_nBinSize)
+		{
+			Put32( &m_arrBin[m_nBinUsed], m_nBinSize - m_nBinUsed );
+		}
+		return (*m_pfOnOutput)(cpp::span<const uint8_t>{ m_arrBin.data(), m_arrBin.size() });
+	}
+
+	SResult startBin( uint32_t nCellSize )
+	{
+		auto nBinSize = AlignUp( nHiveBinHeaderSize + nCellSize, nHiveBinAlignment );
+		if (nBinSize > nMaxHiveBinsDataSize - m_nHiveBinsDataSize)
+		{
+			return SResult::For_win32_ErrorCode( ERROR_FILE_TOO_LARGE );
+		}
+
+		m_nBinOffset = m_nHiveBinsDataSize;
+		m_nBinSize = nBinSize;
+		m_nBinUsed = nHiveBinHeaderSize;
+		m_nHiveBinsDataSize += nBinSize;
+		if (!IsWritePass())
+		{
+			return SResult::Success;
+		}
+
+		m_arrBin.assign( nBinSize, 0 );
+		std::memcpy( &m_arrBin[0], "hbin", 4 );
+		Put32( &m_arrBin[4], m_nBinOffset );
+		Put32( &m_arrBin[8], nBinSize );
+		if (m_nBinOffset == 0)
+		{
+			// Note: Only the first bin's timestamp is used
+			Put64( &m_arrBin[20], m_nLastWriteTime );
+		}
+		return SResult::Success;
+	}
+
+	// Note: The payload pointer is null in the layout pass; in the write pass, it is zero-filled
+	SResult allocateCell( size_t nPayloadSize, uint32_t& nCell, uint8_t*& pPayload )
+	{
+		SResult sr;
+
+		if (nPayloadSize > nMaxHiveBinsDataSize)
+		{
+			return SResult::For_win32_ErrorCode( ERROR_FILE_TOO_LARGE );
+		}
+		auto nCellSize = AlignUp( static_cast<uint32_t>(4 + nPayloadSize), 8 );
+		if (m_nBinSize == 0 || nCellSize > m_nBinSize - m_nBinUsed)
+		{
+			sr = closeBin();
+			VLR_ON_SR_ERROR_RETURN_VALUE( sr );
+			sr = startBin( nCellSize );
+			VLR_ON_SR_ERROR_RETURN_VALUE( sr );
+		}
+
+		nCell = m_nBinOffset + m_nBinUsed;
+		pPayload = nullptr;
+		if (IsWritePass())
+		{
+			// Note: Allocated cells have a negative size
+			Put32( &m_arrBin[m_nBinUsed], static_cast<uint32_t>(-static_cast<int32_t>(nCellSize)) );
+			pPayload = &m_arrBin[m_nBinUsed + 4];
+		}
+		m_nBinUsed += nCellSize;
+
+		return SResult::Success;
+	}
+
+	WriteContext( const OnOutput* pfOnOutput, uint64_t nLastWriteTime, const std::vector<uint8_t>& arrSecurityDescriptor )
+		: m_pfOnOutput{ pfOnOutput }
+		, m_nLastWriteTime{ nLastWriteTime }
+		, m_arrSecurityDescriptor{ arrSecurityDescriptor }
+	{}
+};
+
+HiveKey& HiveKey::AddSubkey( std::wstring_view svName )
+{
+	auto& oSubkey = m_arrSubkeys.emplace_back();
+	oSubkey.m_sName = svName;
+	return oSubkey;
+}
+
+HiveValue& HiveKey::AddValue( std::wstring_view svName, uint32_t dwType, std::vector<uint8_t> arrData )
+{
+	auto& oValue = m_arrValues.emplace_back();
+	oValue.m_sName = svName;
+	oValue.m_dwType = dwType;
+	oValue.m_arrData = std::move( arrData );
+	return oValue;
+}
+
+HiveValue& HiveKey::AddValue_DWORD( std::wstring_view svName, uint32_t dwValue )
+{
+	std::vector<uint8_t> arrData( 4 );
+	Put32( arrData.data(), dwValue );
+	return AddValue( svName, nRegType_DWORD, std::move( arrData ) );
+}
+
+HiveValue& HiveKey::AddValue_QWORD( std::wstring_view svName, uint64_t qwValue )
+{
+	std::vector<uint8_t> arrData( 8 );
+	Put64( arrData.data(), qwValue );
+	return AddValue( svName, nRegType_QWORD, std::move( arrData ) );
+}
+
+HiveValue& HiveKey::AddValue_String( std::wstring_view svName, std::wstring_view svValue, bool bExpandString /*= false*/ )
+{
+	std::vector<uint8_t> arrData;
+	AppendUtf16( svValue, arrData );
+	arrData.insert( arrData.end(), { 0, 0 } );
+	return AddValue( svName, bExpandString ? nRegType_EXPAND_SZ : nRegType_SZ, std::move( arrData ) );
+}
+
+HiveValue& HiveKey::AddValue_MultiString( std::wstring_view svName, const std::vector<std::wstring>& arrValues )
+{
+	std::vector<uint8_t> arrData;
+	for (const auto& sValue : arrValues)
+	{
+		AppendUtf16( sValue, arrData );
+		arrData.insert( arrData.end(), { 0, 0 } );
+	}
+	arrData.insert( arrData.end(), { 0, 0 } );
+	return AddValue( svName, nRegType_MULTI_SZ, std::move( arrData ) );
+}
+
+SResult CHiveWriter::writeValue(
+	WriteContext& oContext,
+	const HiveValue& oValue,
+	uint32_t& nValueCell ) const
+{
+	SResult sr;
+
+	const auto nDataSize = oValue.m_arrData.size();
+	if (nDataSize >= nResidentDataFlag)
+	{
+		return E_INVALIDARG;
+	}
+	const auto pData = oValue.m_arrData.data();
+
+	// Note: Data cells are written before the value, so the value can refer to them
+	uint32_t nDataCell = 0;
+	uint8_t* pPayload{};
+	if (nDataSize > nMaxDataCellSize)
+	{
+		auto nSegmentCount = (nDataSize + nMaxDataCellSize - 1) / nMaxDataCellSize;
+		if (nSegmentCount > nMaxBigDataSegmentCount)
+		{
+			return E_INVALIDARG;
+		}
+
+		std::vector<uint32_t> arrSegmentCells;
+		arrSegmentCells.reserve( nSegmentCount );
+		for (size_t nOffset = 0; nOffset < nDataSize; nOffset += nMaxDataCellSize)
+		{
+			auto nSegmentSize = std::min<size_t>( nMaxDataCellSize, nDataSize - nOffset );
+			uint32_t nSegmentCell{};
+			sr = oContext.allocateCell( nSegmentSize, nSegmentCell, pPayload );
+			VLR_ON_SR_ERROR_RETURN_VALUE( sr );
+			if (pPayload)
+			{
+				std::memcpy( pPayload, pData + nOffset, nSegmentSize );
+			}
+			arrSegmentCells.push_back( nSegmentCell );
+		}
+
+		uint32_t nSegmentListCell{};
+		sr = oContext.allocateCell( 4 * nSegmentCount, nSegmentListCell, pPayload );
+		VLR_ON_SR_ERROR_RETURN_VALUE( sr );
+		if (pPayload)
+		{
+			for (size_t i = 0; i < nSegmentCount; ++i)
+			{
+				Put32( pPayload + 4 * i, arrSegmentCells[i] );
+			}
+		}
+
+		sr = oContext.allocateCell( nBigDataHeaderSize, nDataCell, pPayload );
+		VLR_ON_SR_ERROR_RETURN_VALUE( sr );
+		if (pPayload)
+		{
+			std::memcpy( pPayload, "db", 2 );
+			Put16( pPayload + 2, static_cast<uint16_t>(nSegmentCount) );
+			Put32( pPayload + 4, nSegmentListCell );
+		}
+
+		++oContext.m_oResult.m_nBigDataValueCount;
+	}
+	else if (nDataSize > nResidentDataSize)
+	{
+		sr = oContext.allocateCell( nDataSize, nDataCell, pPayload );
+		VLR_ON_SR_ERROR_RETURN_VALUE( sr );
+		if (pPayload)
+		{
+			std::memcpy( pPayload, pData, nDataSize );
+		}
+	}
+
+	const auto oName = EncodedName{ oValue.m_sName };
+	sr = oContext.allocateCell( nValueHeaderSize + oName.GetByteCount(), nValueCell, pPayload );
+	VLR_ON_SR_ERROR_RETURN_VALUE( sr );
+	if (pPayload)
+	{
+		std::memcpy( pPayload, "vk", 2 );
+		Put16( pPayload + 2, static_cast<uint16_t>(oName.GetByteCount()) );
+		if (nDataSize <= nResidentDataSize)
+		{
+			// Note: Small data is stored in place of the data cell offset
+			Put32( pPayload + 4, static_cast<uint32_t>(nDataSize) | nResidentDataFlag );
+			if (nDataSize > 0)
+			{
+				std::memcpy( pPayload + 8, pData, nDataSize );
+			}
+		}
+		else
+		{
+			Put32( pPayload + 4, static_cast<uint32_t>(nDataSize) );
+			Put32( pPayload + 8, nDataCell );
+		}
+		Put32( pPayload + 12, oValue.m_dwType );
+		Put16( pPayload + 16, oName.m_bCompressed ? nValueFlag_CompressedName : 0 );
+		oName.WriteTo( pPayload + nValueHeaderSize );
+	}
+
+	++oContext.m_oResult.m_nValueCount;
+
+	return SResult::Success;
+}
+
+SResult CHiveWriter::writeKey(
+	WriteContext& oContext,
+	const HiveKey& oKey,
+	uint32_t nParentKeyCell,
+	size_t nDepth ) const
+{
+	SResult sr;
+
+	const bool bIsRootKey = (nDepth == 0);
+	if (nDepth >= nMaxKeyDepth)
+	{
+		return E_INVALIDARG;
+	}
+	// Note: The root key's name is not used to open the hive, but it still needs one
+	const auto svName = (bIsRootKey && oKey.m_sName.empty()) ? svRootKeyName_Default : std::wstring_view{ oKey.m_sName };
+	if (!IsValidKeyName( svName ))
+	{
+		return E_INVALIDARG;
+	}
+	if (oKey.m_arrValues.size() > nMaxHiveBinsDataSize / 4 || oKey.m_arrSubkeys.size() > nMaxHiveBinsDataSize / 8)
+	{
+		return E_INVALIDARG;
+	}
+
+	const auto nKeyIndex = oContext.m_nNextKeyIndex++;
+	if (!oContext.IsWritePass())
+	{
+		sr = CheckValueNames( oKey );
+		VLR_ON_SR_ERROR_RETURN_VALUE( sr );
+		oContext.m_arrKeyLayouts.emplace_back();
+	}
+	VLR_ASSERT_COMPARE_OR_RETURN_EUNEXPECTED( nKeyIndex, <, oContext.m_arrKeyLayouts.size() );
+
+	std::vector<size_t> arrSubkeyOrder;
+	std::vector<std::u16string> arrUpcasedSubkeyNames;
+	sr = GetSortedSubkeyOrder( oKey, arrSubkeyOrder, arrUpcasedSubkeyNames );
+	VLR_ON_SR_ERROR_RETURN_VALUE( sr );
+
+	// Key node
+
+	const auto oName = EncodedName{ svName };
+
+	uint32_t nKeyCell{};
+	uint8_t* pPayload{};
+	sr = oContext.allocateCell( nKeyNodeHeaderSize + oName.GetByteCount(), nKeyCell, pPayload );
+	VLR_ON_SR_ERROR_RETURN_VALUE( sr );
+	if (!oContext.IsWritePass())
+	{
+		oContext.m_arrKeyLayouts[nKeyIndex].m_nKeyCell = nKeyCell;
+	}
+	VLR_ASSERT_COMPARE_OR_RETURN_EUNEXPECTED( nKeyCell, ==, oContext.m_arrKeyLayouts[nKeyIndex].m_nKeyCell );
+
+	if (pPayload)
+	{
+		const auto& oKeyLayout = oContext.m_arrKeyLayouts[nKeyIndex];
+
+		uint32_t nMaxSubkeyNameSize = 0;
+		for (const auto& oSubkey : oKey.m_arrSubkeys)
+		{
+			nMaxSubkeyNameSize = std::max( nMaxSubkeyNameSize, EncodedName{ oSubkey.m_sName }.GetUtf16ByteCount() );
+		}
+		uint32_t nMaxValueNameSize = 0;
+		uint32_t nMaxValueDataSize = 0;
+		for (const auto& oValue : oKey.m_arrValues)
+		{
+			nMaxValueNameSize = std::max( nMaxValueNameSize, EncodedName{ oValue.m_sName }.GetUtf16ByteCount() );
+			nMaxValueDataSize = std::max( nMaxValueDataSize, static_cast<uint32_t>(oValue.m_arrData.size()) );
+		}
+
+		uint16_t nFlags = oName.m_bCompressed ? nKeyFlag_CompressedName : 0;
+		if (bIsRootKey)
+		{
+			nFlags |= nKeyFlag_HiveEntry | nKeyFlag_NoDelete;
+		}
+
+		std::memcpy( pPayload, "nk", 2 );
+		Put16( pPayload + 2, nFlags );
+		Put64( pPayload + 4, oContext.m_nLastWriteTime );
+		Put32( pPayload + 16, nParentKeyCell );
+		Put32( pPayload + 20, static_cast<uint32_t>(oKey.m_arrSubkeys.size()) );
+		Put32( pPayload + 28, oKeyLayout.m_nIndexCell );
+		Put32( pPayload + 32, nCellNil ); // Volatile subkeys
+		Put32( pPayload + 36, static_cast<uint32_t>(oKey.m_arrValues.size()) );
+		Put32( pPayload + 40, oKeyLayout.m_nValueListCell );
+		Put32( pPayload + 44, oContext.m_nSecurityCell );
+		Put32( pPayload + 48, nCellNil ); // Class name
+		Put32( pPayload + 52, nMaxSubkeyNameSize );
+		Put32( pPayload + 60, nMaxValueNameSize );
+		Put32( pPayload + 64, nMaxValueDataSize );
+		Put16( pPayload + 72, static_cast<uint16_t>(oName.GetByteCount()) );
+		oName.WriteTo( pPayload + nKeyNodeHeaderSize );
+	}
+
+	// Values, then the value list
+
+	if (!oKey.m_arrValues.empty())
+	{
+		std::vector<uint32_t> arrValueCells;
+		arrValueCells.reserve( oKey.m_arrValues.size() );
+		for (const auto& oValue : oKey.m_arrValues)
+		{
+			uint32_t nValueCell{};
+			sr = writeValue( oContext, oValue, nValueCell );
+			VLR_ON_SR_ERROR_RETURN_VALUE( sr );
+			arrValueCells.push_back( nValueCell );
+		}
+
+		uint32_t nValueListCell{};
+		sr = oContext.allocateCell( 4 * arrValueCells.size(), nValueListCell, pPayload );
+		VLR_ON_SR_ERROR_RETURN_VALUE( sr );
+		if (pPayload)
+		{
+			for (size_t i = 0; i < arrValueCells.size(); ++i)
+			{
+				Put32( pPayload + 4 * i, arrValueCells[i] );
+			}
+		}
+		if (!oContext.IsWritePass())
+		{
+			oContext.m_arrKeyLayouts[nKeyIndex].m_nValueListCell = nValueListCell;
+		}
+		VLR_ASSERT_COMPARE_OR_RETURN_EUNEXPECTED( nValueListCell, ==, oContext.m_arrKeyLayouts[nKeyIndex].m_nValueListCell );
+	}
+
+	// Subkey index: hash leaves, under an index root if there is more than one
+
+	if (!arrSubkeyOrder.empty())
+	{
+		// Note: The subkeys' key nodes are only known from the layout pass; in sorted order, each subkey's subtree
+		// follows the previous one's
+		std::vector<uint32_t> arrSubkeyCells;
+		if (oContext.IsWritePass())
+		{
+			arrSubkeyCells.reserve( arrSubkeyOrder.size() );
+			auto nSubkeyIndex = nKeyIndex + 1;
+			for (size_t i = 0; i < arrSubkeyOrder.size(); ++i)
+			{
+				VLR_ASSERT_COMPARE_OR_RETURN_EUNEXPECTED( nSubkeyIndex, <, oContext.m_arrKeyLayouts.size() );
+				const auto& oSubkeyLayout = oContext.m_arrKeyLayouts[nSubkeyIndex];
+				arrSubkeyCells.push_back( oSubkeyLayout.m_nKeyCell );
+				nSubkeyIndex += oSubkeyLayout.m_nSubtreeKeyCount;
+			}
+		}
+
+		std::vector<uint32_t> arrLeafCells;
+		for (size_t nLeafStart = 0; nLeafStart < arrSubkeyOrder.size(); nLeafStart += nMaxIndexLeafCount)
+		{
+			auto nLeafCount = std::min( nMaxIndexLeafCount, arrSubkeyOrder.size() - nLeafStart );
+			uint32_t nLeafCell{};
+			sr = oContext.allocateCell( nIndexHeaderSize + 8 * nLeafCount, nLeafCell, pPayload );
+			VLR_ON_SR_ERROR_RETURN_VALUE( sr );
+			if (pPayload)
+			{
+				std::memcpy( pPayload, "lh", 2 );
+				Put16( pPayload + 2, static_cast<uint16_t>(nLeafCount) );
+				for (size_t i = 0; i < nLeafCount; ++i)
+				{
+					auto nOrderIndex = nLeafStart + i;
+					Put32( pPayload + nIndexHeaderSize + 8 * i, arrSubkeyCells[nOrderIndex] );
+					Put32( pPayload + nIndexHeaderSize + 8 * i + 4, GetNameHash( arrUpcasedSubkeyNames[arrSubkeyOrder[nOrderIndex]] ) );
+				}
+			}
+			arrLeafCells.push_back( nLeafCell );
+		}
+
+		auto nIndexCell = arrLeafCells.front();
+		if (arrLeafCells.size() > 1)
+		{
+			if (arrLeafCells.size() > 0xFFFF)
+			{
+				return E_INVALIDARG;
+			}
+			sr = oContext.allocateCell( nIndexHeaderSize + 4 * arrLeafCells.size(), nIndexCell, pPayload );
+			VLR_ON_SR_ERROR_RETURN_VALUE( sr );
+			if (pPayload)
+			{
+				std::memcpy( pPayload, "ri", 2 );
+				Put16( pPayload + 2, static_cast<uint16_t>(arrLeafCells.size()) );
+				for (size_t i = 0; i < arrLeafCells.size(); ++i)
+				{
+					Put32( pPayload + nIndexHeaderSize + 4 * i, arrLeafCells[i] );
+				}
+			}
+		}
+		if (!oContext.IsWritePass())
+		{
+			oContext.m_arrKeyLayouts[nKeyIndex].m_nIndexCell = nIndexCell;
+		}
+		VLR_ASSERT_COMPARE_OR_RETURN_EUNEXPECTED( nIndexCell, ==, oContext.m_arrKeyLayouts[nKeyIndex].m_nIndexCell );
+	}
+
+	// Subkeys, in index order
+
+	for (auto nSubkeyOrderIndex : arrSubkeyOrder)
+	{
+		sr = writeKey( oContext, oKey.m_arrSubkeys[nSubkeyOrderIndex], nKeyCell, nDepth + 1 );
+		VLR_ON_SR_ERROR_RETURN_VALUE( sr );
+	}
+
+	if (!oContext.IsWritePass())
+	{
+		oContext.m_arrKeyLayouts[nKeyIndex].m_nSubtreeKeyCount = oContext.m_nNextKeyIndex - nKeyIndex;
+	}
+	++oContext.m_oResult.m_nKeyCount;
+
+	return SResult::Success;
+}
+
+SResult CHiveWriter::writeHive(
+	WriteContext& oContext,
+	const HiveKey& oRootKey ) const
+{
+	SResult sr;
+
+	// Note: One security cell, shared by all keys, written first so every key node can refer to it
+	const auto& arrSecurityDescriptor = oContext.m_arrSecurityDescriptor;
+	uint8_t* pPayload{};
+	sr = oContext.allocateCell( nSecurityHeaderSize + arrSecurityDescriptor.size(), oContext.m_nSecurityCell, pPayload );
+	VLR_ON_SR_ERROR_RETURN_VALUE( sr );
+	if (pPayload)
+	{
+		std::memcpy( pPayload, "sk", 2 );
+		Put32( pPayload + 4, oContext.m_nSecurityCell ); // Flink
+		Put32( pPayload + 8, oContext.m_nSecurityCell ); // Blink
+		Put32( pPayload + 12, static_cast<uint32_t>(oContext.m_arrKeyLayouts.size()) ); // Reference count
+		Put32( pPayload + 16, static_cast<uint32_t>(arrSecurityDescriptor.size()) );
+		std::memcpy( pPayload + nSecurityHeaderSize, arrSecurityDescriptor.data(), arrSecurityDescriptor.size() );
+	}
+
+	sr = writeKey( oContext, oRootKey, nCellNil, 0 );
+	VLR_ON_SR_ERROR_RETURN_VALUE( sr );
+
+	return oContext.closeBin();
+}
+
+SResult CHiveWriter::WriteToCallback(
+	const HiveKey& oRootKey,
+	const OnOutput& fOnOutput,
+	const Options_HiveWriter& options /*= {}*/,
+	Result_HiveWriter* pResult /*= nullptr*/ ) const
+{
+	SResult sr;
+
+	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED( fOnOutput );
+
+	const auto nLastWriteTime = (options.m_nLastWriteTime != 0) ? options.m_nLastWriteTime : GetCurrentFileTime();
+	const auto arrSecurityDescriptor = options.m_arrSecurityDescriptor.empty() ? MakeDefaultSecurityDescriptor() : options.m_arrSecurityDescriptor;
+	if (arrSecurityDescriptor.size() < 20)
+	{
+		return E_INVALIDARG;
+	}
+
+	// Layout pass (also validates the tree, so nothing is written for an invalid tree)
+
+	auto oLayoutContext = WriteContext{ nullptr, nLastWriteTime, arrSecurityDescriptor };
+	sr = writeHive( oLayoutContext, oRootKey );
+	VLR_ON_SR_ERROR_RETURN_VALUE( sr );
+
+	// Base block
+
+	std::vector<uint8_t> arrBaseBlock( nBaseBlockSize );
+	{
+		auto pBaseBlock = arrBaseBlock.data();
+		std::memcpy( pBaseBlock, "regf", 4 );
+		// Note: Equal sequence numbers mark the hive as consistent (no pending log)
+		Put32( pBaseBlock + 4, 1 );
+		Put32( pBaseBlock + 8, 1 );
+		Put64( pBaseBlock + 12, nLastWriteTime );
+		Put32( pBaseBlock + 20, 1 ); // Major version
+		Put32( pBaseBlock + 24, 5 ); // Minor version
+		Put32( pBaseBlock + 28, 0 ); // Primary file
+		Put32( pBaseBlock + 32, 1 ); // Direct memory load
+		Put32( pBaseBlock + 36, oLayoutContext.m_arrKeyLayouts.front().m_nKeyCell );
+		Put32( pBaseBlock + 40, oLayoutContext.m_nHiveBinsDataSize );
+		Put32( pBaseBlock + 44, 1 ); // Clustering factor
+
+		std::vector<uint8_t> arrFileName;
+		AppendUtf16( options.m_sFileName, arrFileName );
+		static constexpr size_t nMaxFileNameSize = 62;
+		auto nFileNameOffset = (arrFileName.size() > nMaxFileNameSize) ? arrFileName.size() - nMaxFileNameSize : 0;
+		std::copy( arrFileName.begin() + nFileNameOffset, arrFileName.end(), pBaseBlock + 48 );
+
+		uint32_t nChecksum = 0;
+		for (size_t nOffset = 0; nOffset < 508; nOffset += 4)
+		{
+			nChecksum ^= Get32( pBaseBlock + nOffset );
+		}
+		if (nChecksum == 0xFFFFFFFF)
+		{
+			nChecksum = 0xFFFFFFFE;
+		}
+		else if (nChecksum == 0)
+		{
+			nChecksum = 1;
+		}
+		Put32( pBaseBlock + 508, nChecksum );
+	}
+	sr = fOnOutput( cpp::span<const uint8_t>{ arrBaseBlock.data(), arrBaseBlock.size() } );
+	VLR_ON_SR_ERROR_RETURN_VALUE( sr );
+
+	// Write pass
+
+	auto oWriteContext = WriteContext{ &fOnOutput, nLastWriteTime, arrSecurityDescriptor };
+	oWriteContext.m_arrKeyLayouts = std::move( oLayoutContext.m_arrKeyLayouts );
+	sr = writeHive( oWriteContext, oRootKey );
+	VLR_ON_SR_ERROR_RETURN_VALUE( sr );
+	VLR_ASSERT_COMPARE_OR_RETURN_EUNEXPECTED( oWriteContext.m_nHiveBinsDataSize, ==, oLayoutContext.m_nHiveBinsDataSize );
+
+	if (pResult)
+	{
+		*pResult = oWriteContext.m_oResult;
+		pResult->m_nFileSize = uint64_t{ nBaseBlockSize } + oWriteContext.m_nHiveBinsDataSize;
+	}
+
+	return SResult::Success;
+}
+
+SResult CHiveWriter::WriteToFile(
+	const HiveKey& oRootKey,
+	const std::filesystem::path& pathFile,
+	const Options_HiveWriter& options /*= {}*/,
+	Result_HiveWriter* pResult /*= nullptr*/ ) const
+{
+	SResult sr;
+
+	auto oFile = std::ofstream{ pathFile, std::ios::binary | std::ios::trunc };
+	if (!oFile)
+	{
+		return SResult::For_win32_ErrorCode( ERROR_OPEN_FAILED );
+	}
+
+	sr = WriteToCallback( oRootKey, [&]( cpp::span<const uint8_t> spanOutput ) -> SResult
+	{
+		oFile.write( reinterpret_cast<const char*>(spanOutput.data()), static_cast<std::streamsize>(spanOutput.size()) );
+		return oFile ? SResult::Success : SResult::For_win32_ErrorCode( ERROR_WRITE_FAULT );
+	}, options, pResult );
+	if (sr.isSuccess())
+	{
+		oFile.close();
+		if (!oFile)
+		{
+			sr = SResult::For_win32_ErrorCode( ERROR_WRITE_FAULT );
+		}
+	}
+	if (!sr.isSuccess())
+	{
+		oFile.close();
+		std::error_code ec;
+		std::filesystem::remove( pathFile, ec );
+		return sr;
+	}
+
+	return SResult::Success;
+}
+
+} // namespace registry
+
+} // namespace win32
+
+} // namespace vlr
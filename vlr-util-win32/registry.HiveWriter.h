@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <vlr-util/cpp_namespace.h>
+#include <vlr-util/util.includes.h>
+#include <vlr-util/util.Result.h>
+
+namespace vlr {
+
+namespace win32 {
+
+namespace registry {
+
+// Offline writer for registry hive files (regf format 1.5, loadable with RegLoadKey/RegRestoreKey or the offline
+// registry library) from an in-memory key/value tree; eg: for image build pipelines which pre-provision keys.
+// This is data format code only; it does not use the registry APIs, so the hive is not loaded while it is written.
+// The tree is walked twice: a layout pass assigns every cell its offset (keeping a few offsets per key), then a write
+// pass writes the cells in the same order, one hive bin at a time; memory use beyond the tree itself is bounded by
+// the largest bin (4 KB, or the size of the largest cell).
+// Subkeys are indexed with hash leaves (lh), split under an index root (ri) for keys with many subkeys. Values larger
+// than 16344 bytes are written as big data (db) segments. All keys share one security descriptor.
+// Note: Names are sorted and hashed case-insensitively using ASCII and Latin-1 case mapping; names with other cased
+// characters may be ordered differently than Windows expects, so lookups of those names may fail.
+
+struct HiveValue
+{
+	// Note: Empty for the key's default value
+	std::wstring m_sName;
+	uint32_t m_dwType = 0;
+	std::vector<uint8_t> m_arrData;
+};
+
+struct HiveKey
+{
+	std::wstring m_sName;
+	std::vector<HiveValue> m_arrValues;
+	std::vector<HiveKey> m_arrSubkeys;
+
+	// Note: The returned references are valid until the next subkey (or value) is added to this key
+	HiveKey& AddSubkey( std::wstring_view svName );
+	HiveValue& AddValue( std::wstring_view svName, uint32_t dwType, std::vector<uint8_t> arrData );
+	HiveValue& AddValue_DWORD( std::wstring_view svName, uint32_t dwValue );
+	HiveValue& AddValue_QWORD( std::wstring_view svName, uint64_t qwValue );
+	// Note: Written as UTF-16LE, with a terminator
+	HiveValue& AddValue_String( std::wstring_view svName, std::wstring_view svValue, bool bExpandString = false );
+	HiveValue& AddValue_MultiString( std::wstring_view svName, const std::vector<std::wstring>& arrValues );
+};
+
+// Note: The options and result are declared outside the writer class, so they can be used as default arguments of
+// its members (a nested struct's default member initializers are not usable until the enclosing class is complete).
+
+struct Options_HiveWriter
+{
+	// Note: Last write time for the keys and the hive (FILETIME ticks); 0 uses the current time
+	uint64_t m_nLastWriteTime = 0;
+	// Note: Informational only; the last 31 chars are stored in the base block
+	std::wstring m_sFileName;
+	// Note: Self-relative security descriptor for all keys; empty uses owner Administrators, group SYSTEM, and
+	// (inherited by subkeys) full control for SYSTEM and Administrators, and read access for Users.
+	std::vector<uint8_t> m_arrSecurityDescriptor;
+
+	decltype(auto) withLastWriteTime( uint64_t nLastWriteTime )
+	{
+		m_nLastWriteTime = nLastWriteTime;
+		return *this;
+	}
+	decltype(auto) withFileName( std::wstring_view svFileName )
+	{
+		m_sFileName = svFileName;
+		return *this;
+	}
+	decltype(auto) withSecurityDescriptor( std::vector<uint8_t> arrSecurityDescriptor )
+	{
+		m_arrSecurityDescriptor = std::move( arrSecurityDescriptor );
+		return *this;
+	}
+};
+
+struct Result_HiveWriter
+{
+	size_t m_nKeyCount{};
+	size_t m_nValueCount{};
+	size_t m_nBigDataValueCount{};
+	size_t m_nHiveBinCount{};
+	uint64_t m_nFileSize{};
+};
+
+class CHiveWriter
+{
+public:
+	// Note: Called with the base block, then with each hive bin; returning failure stops the write, and is returned
+	// from it.
+	using OnOutput = std::function<SResult( cpp::span<const uint8_t> spanOutput )>;
+
+protected:
+	struct WriteContext;
+
+	SResult writeHive(
+		WriteContext& oContext,
+		const HiveKey& oRootKey ) const;
+	SResult writeKey(
+		WriteContext& oContext,
+		const HiveKey& oKey,
+		uint32_t nParentKeyCell,
+		size_t nDepth ) const;
+	SResult writeValue(
+		WriteContext& oContext,
+		const HiveValue& oValue,
+		uint32_t& nValueCell ) const;
+
+public:
+	// Note: The tree is validated before anything is written; invalid names (empty, too long, or containing '\'),
+	// duplicate names (case-insensitive), or keys nested too deeply fail with E_INVALIDARG.
+	SResult WriteToCallback(
+		const HiveKey& oRootKey,
+		const OnOutput& fOnOutput,
+		const Options_HiveWriter& options = {},
+		Result_HiveWriter* pResult = nullptr ) const;
+	// Note: Creates (or replaces) the file; on failure, the partially written file is removed
+	SResult WriteToFile(
+		const HiveKey& oRootKey,
+		const std::filesystem::path& pathFile,
+		const Options_HiveWriter& options = {},
+		Result_HiveWriter* pResult = nullptr ) const;
+};
+
+} // namespace registry
+
+} // namespace win32
+
+} // namespace vlr
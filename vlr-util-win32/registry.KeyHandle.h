@@ -0,0 +1,234 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+#include <vlr-util/util.includes.h>
+
+namespace vlr {
+
+namespace win32 {
+
+namespace registry {
+
+constexpr auto IsBaseKey( HKEY hKey )
+{
+	// Note: Must use C-style casts here, because C++ is still lacking in some areas...
+
+	switch ((ULONG_PTR)hKey)
+	{
+	case (ULONG_PTR)HKEY_CLASSES_ROOT:
+	case (ULONG_PTR)HKEY_CURRENT_USER:
+	case (ULONG_PTR)HKEY_LOCAL_MACHINE:
+	case (ULONG_PTR)HKEY_USERS:
+	case (ULONG_PTR)HKEY_PERFORMANCE_DATA:
+	case (ULONG_PTR)HKEY_PERFORMANCE_TEXT:
+	case (ULONG_PTR)HKEY_PERFORMANCE_NLSTEXT:
+	case (ULONG_PTR)HKEY_CURRENT_CONFIG:
+	case (ULONG_PTR)HKEY_DYN_DATA:
+	case (ULONG_PTR)HKEY_CURRENT_USER_LOCAL_SETTINGS:
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+// Note: Only predefined keys have an identity which is stable across processes (eg: for persisted data which refers
+// to a base key); other handles return 0.
+inline uint64_t GetPersistentBaseKeyId( HKEY hBaseKey )
+{
+	return IsBaseKey( hBaseKey ) ? static_cast<uint64_t>(reinterpret_cast<ULONG_PTR>(hBaseKey)) : 0;
+}
+
+// Move-only owning handle for an HKEY. Base (predefined) keys are held but never closed.
+// This does not allocate; it is the size of the HKEY plus the close flag.
+
+class CKeyHandle
+{
+protected:
+	HKEY m_hKey = {};
+	bool m_bCloseKey = false;
+
+public:
+	[[nodiscard]]
+	inline HKEY Get() const
+	{
+		return m_hKey;
+	}
+	[[nodiscard]]
+	inline bool IsValid() const
+	{
+		return (m_hKey != nullptr);
+	}
+	inline LSTATUS Close()
+	{
+		LSTATUS lStatus = ERROR_SUCCESS;
+		if (m_hKey && m_bCloseKey)
+		{
+			lStatus = ::RegCloseKey( m_hKey );
+		}
+		m_hKey = {};
+		m_bCloseKey = false;
+		return lStatus;
+	}
+	inline void Reset( HKEY hKey = {}, bool bCloseKey = true )
+	{
+		Close();
+		m_hKey = hKey;
+		m_bCloseKey = bCloseKey && (hKey != nullptr) && !IsBaseKey( hKey );
+	}
+	// Note: Returns the key without closing it; the caller takes over ownership.
+	[[nodiscard]]
+	inline HKEY Release()
+	{
+		auto hKey = m_hKey;
+		m_hKey = {};
+		m_bCloseKey = false;
+		return hKey;
+	}
+	// Note: Keeps the key, but it will no longer be closed by this instance.
+	inline HKEY ReleaseOwnership()
+	{
+		m_bCloseKey = false;
+		return m_hKey;
+	}
+
+public:
+	constexpr CKeyHandle() = default;
+	explicit CKeyHandle( HKEY hKey, bool bCloseKey = true )
+	{
+		Reset( hKey, bCloseKey );
+	}
+	CKeyHandle( const CKeyHandle& ) = delete;
+	CKeyHandle( CKeyHandle&& oOther ) noexcept
+		: m_hKey{ std::exchange( oOther.m_hKey, HKEY{} ) }
+		, m_bCloseKey{ std::exchange( oOther.m_bCloseKey, false ) }
+	{}
+	CKeyHandle& operator=( const CKeyHandle& ) = delete;
+	CKeyHandle& operator=( CKeyHandle&& oOther ) noexcept
+	{
+		if (this != &oOther)
+		{
+			Close();
+			m_hKey = std::exchange( oOther.m_hKey, HKEY{} );
+			m_bCloseKey = std::exchange( oOther.m_bCloseKey, false );
+		}
+		return *this;
+	}
+	~CKeyHandle()
+	{
+		Close();
+	}
+};
+
+// Shared ownership of an HKEY, for cases where the same open key needs to be held from more than one place.
+// The handle and reference count live in one allocation (made when the handle is first shared), and copies only
+// touch the reference count; there is no separate control block or deleter.
+
+class CSharedKeyHandle
+{
+protected:
+	struct SharedState
+	{
+		std::atomic<ULONG> m_nRefCount{ 1 };
+		CKeyHandle m_oKeyHandle;
+
+		explicit SharedState( CKeyHandle&& oKeyHandle )
+			: m_oKeyHandle{ std::move( oKeyHandle ) }
+		{}
+	};
+
+	SharedState* m_pSharedState = nullptr;
+
+protected:
+	inline void addRef()
+	{
+		if (m_pSharedState)
+		{
+			m_pSharedState->m_nRefCount.fetch_add( 1, std::memory_order_relaxed );
+		}
+	}
+	inline void release()
+	{
+		auto* pSharedState = std::exchange( m_pSharedState, nullptr );
+		if (pSharedState && (pSharedState->m_nRefCount.fetch_sub( 1, std::memory_order_acq_rel ) == 1))
+		{
+			delete pSharedState;
+		}
+	}
+
+public:
+	[[nodiscard]]
+	inline HKEY Get() const
+	{
+		return m_pSharedState ? m_pSharedState->m_oKeyHandle.Get() : HKEY{};
+	}
+	[[nodiscard]]
+	inline bool IsValid() const
+	{
+		return (Get() != nullptr);
+	}
+	// Note: Approximate if other threads hold references; intended for diagnostics/tests.
+	[[nodiscard]]
+	inline ULONG GetRefCount() const
+	{
+		return m_pSharedState ? m_pSharedState->m_nRefCount.load( std::memory_order_relaxed ) : 0;
+	}
+	inline void Reset()
+	{
+		release();
+	}
+	// Note: The key stays open for all current holders, but will not be closed when the last one releases it.
+	inline HKEY ReleaseOwnership()
+	{
+		return m_pSharedState ? m_pSharedState->m_oKeyHandle.ReleaseOwnership() : HKEY{};
+	}
+
+public:
+	constexpr CSharedKeyHandle() = default;
+	explicit CSharedKeyHandle( CKeyHandle&& oKeyHandle )
+	{
+		if (oKeyHandle.IsValid())
+		{
+			m_pSharedState = new SharedState{ std::move( oKeyHandle ) };
+		}
+	}
+	CSharedKeyHandle( const CSharedKeyHandle& oOther )
+		: m_pSharedState{ oOther.m_pSharedState }
+	{
+		addRef();
+	}
+	CSharedKeyHandle( CSharedKeyHandle&& oOther ) noexcept
+		: m_pSharedState{ std::exchange( oOther.m_pSharedState, nullptr ) }
+	{}
+	CSharedKeyHandle& operator=( const CSharedKeyHandle& oOther )
+	{
+		if (m_pSharedState != oOther.m_pSharedState)
+		{
+			release();
+			m_pSharedState = oOther.m_pSharedState;
+			addRef();
+		}
+		return *this;
+	}
+	CSharedKeyHandle& operator=( CSharedKeyHandle&& oOther ) noexcept
+	{
+		if (this != &oOther)
+		{
+			release();
+			m_pSharedState = std::exchange( oOther.m_pSharedState, nullptr );
+		}
+		return *this;
+	}
+	~CSharedKeyHandle()
+	{
+		release();
+	}
+};
+
+} // namespace registry
+
+} // namespace win32
+
+} // namespace vlr
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_set>
+#include <vector>
+
+#include <vlr-util/util.includes.h>
+#include <vlr-util/zstring_view.h>
+
+namespace vlr {
+
+namespace win32 {
+
+namespace registry {
+
+// Pool of interned key/value names, for bulk reads across many keys which repeat the same names (eg: per-service or
+// per-product keys). Each distinct name is stored once, and callers hold views of the pooled copy instead of their
+// own strings. Views are stable (and null-terminated) for the lifetime of the pool; names are never removed.
+// Names are pooled by exact spelling (case-sensitive), so names differing only in case are pooled separately.
+// Note: Thread-safe; lookups of names already in the pool only take a shared lock.
+
+class CNameInternPool
+{
+public:
+	// Note: Sized to hold several hundred typical names; names longer than this get their own block
+	static constexpr size_t m_nDefaultBlockSizeChars = 16 * 1024;
+
+	struct Stats
+	{
+		size_t m_nNameCount{};
+		size_t m_nLookupCount{};
+		// Note: Lookups which found the name already in the pool (no allocation)
+		size_t m_nHitCount{};
+		size_t m_nStorageBytes{};
+	};
+
+protected:
+	size_t m_nBlockSizeChars = m_nDefaultBlockSizeChars;
+
+	mutable std::shared_mutex m_mutexPool;
+	std::vector<std::unique_ptr<TCHAR[]>> m_arrBlocks;
+	size_t m_nCurrentBlockUsedChars{};
+	size_t m_nCurrentBlockSizeChars{};
+	// Note: Views into the blocks
+	std::unordered_set<vlr::tstring_view> m_setNames;
+	size_t m_nStorageBytes{};
+	std::atomic<size_t> m_nLookupCount{};
+	std::atomic<size_t> m_nHitCount{};
+
+	// Note: Caller holds the exclusive lock
+	inline vlr::tstring_view addName( vlr::tstring_view svName )
+	{
+		auto nRequiredChars = svName.size() + 1;
+		if ((m_arrBlocks.empty()) || (m_nCurrentBlockSizeChars - m_nCurrentBlockUsedChars < nRequiredChars))
+		{
+			auto nBlockSizeChars = (std::max)( m_nBlockSizeChars, nRequiredChars );
+			m_arrBlocks.push_back( std::make_unique<TCHAR[]>( nBlockSizeChars ) );
+			m_nCurrentBlockUsedChars = 0;
+			m_nCurrentBlockSizeChars = nBlockSizeChars;
+			m_nStorageBytes += nBlockSizeChars * sizeof( TCHAR );
+		}
+
+		auto pChars = m_arrBlocks.back().get() + m_nCurrentBlockUsedChars;
+		std::memcpy( pChars, svName.data(), svName.size() * sizeof( TCHAR ) );
+		pChars[svName.size()] = _T( '\0' );
+		m_nCurrentBlockUsedChars += nRequiredChars;
+
+		auto svPooledName = vlr::tstring_view{ pChars, svName.size() };
+		m_setNames.insert( svPooledName );
+		return svPooledName;
+	}
+
+public:
+	inline vlr::tzstring_view Intern( vlr::tstring_view svName )
+	{
+		auto fMakeResult = []( vlr::tstring_view svPooledName )
+		{
+			return vlr::tzstring_view{ svPooledName.data(), svPooledName.size(), vlr::tzstring_view::StringIsNullTerminated{} };
+		};
+
+		m_nLookupCount.fetch_add( 1, std::memory_order_relaxed );
+		{
+			auto oLock = std::shared_lock{ m_mutexPool };
+			auto iter = m_setNames.find( svName );
+			if (iter != m_setNames.end())
+			{
+				m_nHitCount.fetch_add( 1, std::memory_order_relaxed );
+				return fMakeResult( *iter );
+			}
+		}
+
+		auto oLock = std::unique_lock{ m_mutexPool };
+		// Note: Another thread may have added the name since the shared lookup
+		auto iter = m_setNames.find( svName );
+		if (iter != m_setNames.end())
+		{
+			m_nHitCount.fetch_add( 1, std::memory_order_relaxed );
+			return fMakeResult( *iter );
+		}
+		return fMakeResult( addName( svName ) );
+	}
+
+	inline Stats GetStats() const
+	{
+		auto oLock = std::shared_lock{ m_mutexPool };
+		auto oStats = Stats{};
+		oStats.m_nNameCount = m_setNames.size();
+		oStats.m_nLookupCount = m_nLookupCount.load( std::memory_order_relaxed );
+		oStats.m_nHitCount = m_nHitCount.load( std::memory_order_relaxed );
+		oStats.m_nStorageBytes = m_nStorageBytes;
+		return oStats;
+	}
+
+public:
+	CNameInternPool() = default;
+	explicit CNameInternPool( size_t nBlockSizeChars )
+		: m_nBlockSizeChars{ (std::max)( nBlockSizeChars, size_t{ 1 } ) }
+	{}
+	// Note: Not copyable or movable, since views refer to the pool's storage
+	CNameInternPool( const CNameInternPool& ) = delete;
+	CNameInternPool& operator=( const CNameInternPool& ) = delete;
+};
+
+} // namespace registry
+
+} // namespace win32
+
+} // namespace vlr
@@ -4,7 +4,9 @@
 #include <vlr-util/zstring_view.h>
 #include <vlr-util/util.convert.StringConversion.h>
 
+#include <vlr-util-win32/registry.KeyHandle.h>
 #include <vlr-util-win32/registry.RegValue.h>
+#include <vlr-util-win32/RegistryAccess_Instrumentation.h>
 
 namespace vlr {
 
@@ -12,29 +14,6 @@ namespace win32 {
 
 namespace registry {
 
-constexpr auto IsBaseKey( HKEY hKey )
-{
-	// Note: Must use C-style casts here, because C++ is still lacking in some areas...
-
-	switch ((ULONG_PTR)hKey)
-	{
-	case (ULONG_PTR)HKEY_CLASSES_ROOT:
-	case (ULONG_PTR)HKEY_CURRENT_USER:
-	case (ULONG_PTR)HKEY_LOCAL_MACHINE:
-	case (ULONG_PTR)HKEY_USERS:
-	case (ULONG_PTR)HKEY_PERFORMANCE_DATA:
-	case (ULONG_PTR)HKEY_PERFORMANCE_TEXT:
-	case (ULONG_PTR)HKEY_PERFORMANCE_NLSTEXT:
-	case (ULONG_PTR)HKEY_CURRENT_CONFIG:
-	case (ULONG_PTR)HKEY_DYN_DATA:
-	case (ULONG_PTR)HKEY_CURRENT_USER_LOCAL_SETTINGS:
-		return true;
-
-	default:
-		return false;
-	}
-}
-
 struct Options_OpenKey
 {
 public:
@@ -102,61 +81,29 @@ struct Result_GetValue
 	CRegValue m_oValue;
 };
 
+// Note: CRegKey owns its key exclusively (move-only, no allocation). If the same open key needs to be held in
+// more than one place, Share() switches the instance to a shared (intrusive refcounted) handle, and returns another
+// CRegKey referencing the same key.
+
 class CRegKey
 {
 protected:
-	struct KeyAndCleanupDisposition
-	{
-		HKEY m_hKey = {};
-		bool m_bCloseKey = false;
-
-		KeyAndCleanupDisposition(
-			HKEY hKey,
-			bool bCloseKey )
-			: m_hKey{ hKey }
-			, m_bCloseKey{ bCloseKey }
-		{}
-	};
+	CKeyHandle m_oKeyHandle;
+	// Note: Only set after Share(); then m_oKeyHandle is empty
+	CSharedKeyHandle m_oSharedKeyHandle;
 
 protected:
-	std::optional<HKEY> m_ohBaseKey;
-	cpp::shared_ptr<KeyAndCleanupDisposition> m_spKey;
-
-protected:
-	static LSTATUS CloseKey( KeyAndCleanupDisposition* pKey )
-	{
-		if (pKey && pKey->m_bCloseKey)
-		{
-			return ::RegCloseKey( pKey->m_hKey );
-		}
-		else
-		{
-			return 0;
-		}
-	}
 	void SetInternalHKEY( HKEY hKey, bool bCloseKey = true )
 	{
-		if (vlr::win32::registry::IsBaseKey( hKey ))
-		{
-			m_ohBaseKey = hKey;
-			m_spKey = {};
-		}
-		else if (hKey != nullptr)
-		{
-			m_ohBaseKey = {};
-			m_spKey = cpp::shared_ptr<KeyAndCleanupDisposition>{ new KeyAndCleanupDisposition( hKey, bCloseKey ), []( auto* pKey ) { CRegKey::CloseKey( pKey ); } };
-		}
-		else
-		{
-			Clear();
-		}
+		m_oSharedKeyHandle.Reset();
+		m_oKeyHandle.Reset( hKey, bCloseKey );
 	}
 
 public:
 	void Clear()
 	{
-		m_ohBaseKey = {};
-		m_spKey = {};
+		m_oSharedKeyHandle.Reset();
+		m_oKeyHandle.Reset();
 	}
 	void Attach( HKEY hKey )
 	{
@@ -164,31 +111,47 @@ public:
 	}
 	std::optional<HKEY> Detatch()
 	{
-		if (m_ohBaseKey.has_value())
+		if (m_oSharedKeyHandle.IsValid())
 		{
-			return m_ohBaseKey.value();
+			auto hKey = m_oSharedKeyHandle.ReleaseOwnership();
+			m_oSharedKeyHandle.Reset();
+			return hKey;
 		}
-		if (m_spKey)
+		if (m_oKeyHandle.IsValid())
 		{
-			auto hKey = m_spKey->m_hKey;
-			m_spKey->m_bCloseKey = false;
-			m_spKey = {};
-			return hKey;
+			return m_oKeyHandle.Release();
 		}
 		return {};
 	}
+	[[nodiscard]]
+	CRegKey Share()
+	{
+		if (m_oKeyHandle.IsValid())
+		{
+			if (vlr::win32::registry::IsBaseKey( m_oKeyHandle.Get() ))
+			{
+				// Note: Base keys are never closed, so there is no need for a shared handle
+				return CRegKey{ m_oKeyHandle.Get() };
+			}
+			m_oSharedKeyHandle = CSharedKeyHandle{ std::move( m_oKeyHandle ) };
+		}
+
+		CRegKey oRegKey;
+		oRegKey.m_oSharedKeyHandle = m_oSharedKeyHandle;
+		return oRegKey;
+	}
 
 public:
 	[[nodiscard]]
 	inline std::optional<HKEY> GetHKEY() const
 	{
-		if (m_ohBaseKey.has_value())
+		if (m_oKeyHandle.IsValid())
 		{
-			return m_ohBaseKey.value();
+			return m_oKeyHandle.Get();
 		}
-		if (m_spKey)
+		if (m_oSharedKeyHandle.IsValid())
 		{
-			return m_spKey->m_hKey;
+			return m_oSharedKeyHandle.Get();
 		}
 		return {};
 	}
@@ -200,13 +163,20 @@ public:
 	[[nodiscard]]
 	inline bool IsBaseKey() const
 	{
-		return IsValid() && m_ohBaseKey.has_value();
+		auto ohKey = GetHKEY();
+		return ohKey.has_value() && vlr::win32::registry::IsBaseKey( ohKey.value() );
+	}
+	[[nodiscard]]
+	inline bool IsShared() const
+	{
+		return m_oSharedKeyHandle.IsValid();
 	}
 
 protected:
-	using FOpenKeyAW = cpp::function<HRESULT( HKEY hKey, const Options_OpenKey& oOptions, HKEY& hkResult )>;
+	// Note: FOpenKey has signature HRESULT( HKEY hKey, const Options_OpenKey& oOptions, HKEY& hkResult )
+	template< typename FOpenKey >
 	HRESULT OpenKeyAW(
-		const FOpenKeyAW& fOpenKey,
+		const FOpenKey& fOpenKey,
 		const Options_OpenKey& oOptions,
 		CRegKey& oRegKey_Result );
 public:
@@ -256,14 +226,10 @@ public:
 	}
 
 protected:
-	using FGetValueAW = cpp::function<HRESULT(
-		HKEY hKey,
-		const Options_GetValue& oOptions,
-		DWORD* pdwType,
-		VOID* pBuffer,
-		DWORD* pdwBufferLength )>;
+	// Note: FGetValue has signature HRESULT( HKEY hKey, const Options_GetValue& oOptions, DWORD* pdwType, VOID* pBuffer, DWORD* pdwBufferLength )
+	template< typename FGetValue >
 	HRESULT GetValueAW(
-		const FGetValueAW& fGetValue,
+		const FGetValue& fGetValue,
 		const Options_GetValue& oOptions,
 		Result_GetValue& oResult );
 public:
@@ -369,48 +335,52 @@ public:
 	}
 
 public:
-	constexpr CRegKey() = default;
+	CRegKey() = default;
 	CRegKey( HKEY hKey )
 	{
 		SetInternalHKEY( hKey );
 	}
-	//CRegKey( const CRegKey& ) = default;
-	//CRegKey( CRegKey&& ) = default;
+	CRegKey( const CRegKey& ) = delete;
+	CRegKey( CRegKey&& ) = default;
+	CRegKey& operator=( const CRegKey& ) = delete;
+	CRegKey& operator=( CRegKey&& ) = default;
 	~CRegKey() = default;
 
 };
 
+template< typename FOpenKey >
 HRESULT CRegKey::OpenKeyAW(
-	const FOpenKeyAW& fOpenKey,
+	const FOpenKey& fOpenKey,
 	const Options_OpenKey& oOptions,
 	CRegKey& oRegKey_Result )
 {
-	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED( fOpenKey );
-
 	HRESULT hr;
 
 	auto ohKey = GetHKEY();
 	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED( ohKey.has_value() );
 
+	VLR_REGISTRY_INSTRUMENT_OPERATION( oInstrumentedOperation, Open );
+
 	HKEY hkResult = {};
 	hr = fOpenKey(
 		ohKey.value(),
 		oOptions,
 		hkResult );
+	VLR_REGISTRY_INSTRUMENT_ON_HRESULT( oInstrumentedOperation, hr );
 	VLR_ON_HR_NON_S_OK__RETURN_HRESULT( hr );
 
-	oRegKey_Result = CRegKey{ hkResult };
+	// Note: Result takes exclusive ownership; no allocation per opened key
+	oRegKey_Result.SetInternalHKEY( hkResult );
 
 	return S_OK;
 }
 
+template< typename FGetValue >
 HRESULT CRegKey::GetValueAW(
-	const FGetValueAW& fGetValue,
+	const FGetValue& fGetValue,
 	const Options_GetValue& oOptions,
 	Result_GetValue& oResult )
 {
-	VLR_ASSERT_NONZERO_OR_RETURN_EUNEXPECTED( fGetValue );
-
 	HRESULT hr;
 
 	auto ohKey = GetHKEY();
@@ -428,6 +398,8 @@ HRESULT CRegKey::GetValueAW(
 		dwBufferLength = oRegValue.m_oData.size();
 	}
 
+	VLR_REGISTRY_INSTRUMENT_OPERATION( oInstrumentedOperation, Query );
+
 	do
 	{
 		hr = fGetValue(
@@ -436,21 +408,27 @@ HRESULT CRegKey::GetValueAW(
 			&oRegValue.m_dwType,
 			pBuffer,
 			&dwBufferLength );
+		VLR_REGISTRY_INSTRUMENT_ON_HRESULT( oInstrumentedOperation, hr );
 		if (hr == S_OK)
 		{
 			VLR_ASSERT_COMPARE_OR_RETURN_EUNEXPECTED( dwBufferLength, <= , oRegValue.m_oData.size() );
 			oRegValue.m_oData.resize( dwBufferLength );
+			VLR_REGISTRY_INSTRUMENT_ADD_BYTES( oInstrumentedOperation, dwBufferLength );
 			return S_OK;
 		}
 		if (hr == HRESULT_FROM_WIN32( ERROR_MORE_DATA ))
 		{
 			if (dwBufferLength > oRegValue.m_oData.size())
 			{
+				VLR_REGISTRY_INSTRUMENT_ADD_RETRY( oInstrumentedOperation );
 				oRegValue.m_oData.resize( dwBufferLength );
+				// Note: The resize may have reallocated
+				pBuffer = oRegValue.m_oData.data();
 				continue;
 			}
 			// Other case: dynamic data, where we do not know the size
 			// No handling for this case; need to specify larger initial buffer in options.
+			VLR_REGISTRY_INSTRUMENT_ON_ERROR( oInstrumentedOperation );
 			return hr;
 		}
 
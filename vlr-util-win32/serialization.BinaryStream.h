@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include <vlr-util/util.includes.h>
+#include <vlr-util/util.Result.h>
+#include <vlr-util/cpp_namespace.h>
+
+namespace vlr {
+
+namespace win32 {
+
+namespace serialization {
+
+// Minimal binary serialization for on-disk caches. Values are written in native byte order and layout, so files are
+// only intended to be read back on the same platform/architecture (callers should include a format version).
+// Strings are written as a uint32_t char count followed by the chars (no terminator).
+
+class CBinaryWriter
+{
+protected:
+	std::vector<BYTE> m_arrData;
+
+public:
+	inline void WriteBytes( const void* pData, size_t nByteCount )
+	{
+		auto pBytes = static_cast<const BYTE*>(pData);
+		m_arrData.insert( m_arrData.end(), pBytes, pBytes + nByteCount );
+	}
+	template <typename TValue>
+	inline void Write( const TValue& tValue )
+	{
+		static_assert(std::is_trivially_copyable_v<TValue>, "Only trivially-copyable types can be written directly");
+		WriteBytes( &tValue, sizeof( tValue ) );
+	}
+	template <typename TChar>
+	inline void WriteString( std::basic_string_view<TChar> svValue )
+	{
+		Write( static_cast<uint32_t>(svValue.size()) );
+		WriteBytes( svValue.data(), svValue.size() * sizeof( TChar ) );
+	}
+
+	[[nodiscard]]
+	inline const std::vector<BYTE>& GetData() const
+	{
+		return m_arrData;
+	}
+	inline void Reserve( size_t nByteCount )
+	{
+		m_arrData.reserve( nByteCount );
+	}
+};
+
+// Note: All reads are bounds-checked; reading past the end returns ERROR_HANDLE_EOF (and does not advance).
+
+class CBinaryReader
+{
+protected:
+	cpp::span<const BYTE> m_spanData;
+	size_t m_nOffset = 0;
+
+public:
+	inline SResult ReadBytes( void* pData, size_t nByteCount )
+	{
+		if (nByteCount > GetRemainingSize())
+		{
+			return SResult::For_win32_ErrorCode( ERROR_HANDLE_EOF );
+		}
+		std::memcpy( pData, m_spanData.data() + m_nOffset, nByteCount );
+		m_nOffset += nByteCount;
+		return SResult::Success;
+	}
+	template <typename TValue>
+	inline SResult Read( TValue& tValue )
+	{
+		static_assert(std::is_trivially_copyable_v<TValue>, "Only trivially-copyable types can be read directly");
+		return ReadBytes( &tValue, sizeof( tValue ) );
+	}
+	template <typename TChar>
+	inline SResult ReadString( std::basic_string<TChar>& sValue )
+	{
+		uint32_t nCharCount{};
+		auto sr = Read( nCharCount );
+		if (!sr.isSuccess())
+		{
+			return sr;
+		}
+		if (nCharCount > GetRemainingSize() / sizeof( TChar ))
+		{
+			return SResult::For_win32_ErrorCode( ERROR_HANDLE_EOF );
+		}
+		sValue.resize( nCharCount );
+		return ReadBytes( sValue.data(), nCharCount * sizeof( TChar ) );
+	}
+
+	[[nodiscard]]
+	inline size_t GetRemainingSize() const
+	{
+		return m_spanData.size() - m_nOffset;
+	}
+	[[nodiscard]]
+	inline bool IsAtEnd() const
+	{
+		return (GetRemainingSize() == 0);
+	}
+
+public:
+	explicit CBinaryReader( cpp::span<const BYTE> spanData )
+		: m_spanData{ spanData }
+	{}
+};
+
+} // namespace serialization
+
+} // namespace win32
+
+} // namespace vlr
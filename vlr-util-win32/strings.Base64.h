@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstring>
+#include <string>
+
+#include <vlr-util/util.includes.h>
+
+#include "strings.FindSubstring.h"
+
+#if VLR_WIN32_STRINGS_HAS_SSE2
+#include <tmmintrin.h>
+#endif
+
+namespace vlr {
+
+namespace win32 {
+
+namespace strings {
+
+// Base64 encoding (RFC 4648 alphabet, with padding) of binary data, appended to a char string (eg: for JSON output).
+// On x86/x64 CPUs with SSSE3 (checked once, at runtime), 12 input bytes are encoded per step: the bytes are shuffled
+// so each 32-bit lane holds 3 input bytes, split into four 6-bit indices with multiplies, and the indices are mapped
+// to the alphabet with a byte shuffle lookup of per-range offsets. SSE2 alone has no byte shuffle, so CPUs without
+// SSSE3 (and the tail of the data) use the scalar table encoder.
+
+namespace detail {
+
+static constexpr char arrBase64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Note: Writes GetBase64EncodedLength( nDataSize ) chars
+inline void EncodeBase64_Scalar( const BYTE* pData, size_t nDataSize, char* pOutput )
+{
+	size_t nOffset = 0;
+	for (; nDataSize - nOffset >= 3; nOffset += 3)
+	{
+		auto nTriple = (static_cast<uint32_t>(pData[nOffset]) << 16) | (static_cast<uint32_t>(pData[nOffset + 1]) << 8) | pData[nOffset + 2];
+		*pOutput++ = arrBase64Alphabet[(nTriple >> 18) & 0x3F];
+		*pOutput++ = arrBase64Alphabet[(nTriple >> 12) & 0x3F];
+		*pOutput++ = arrBase64Alphabet[(nTriple >> 6) & 0x3F];
+		*pOutput++ = arrBase64Alphabet[nTriple & 0x3F];
+	}
+	if (nOffset == nDataSize)
+	{
+		return;
+	}
+
+	auto nRemaining = nDataSize - nOffset;
+	auto nTriple = static_cast<uint32_t>(pData[nOffset]) << 16;
+	if (nRemaining > 1)
+	{
+		nTriple |= static_cast<uint32_t>(pData[nOffset + 1]) << 8;
+	}
+	*pOutput++ = arrBase64Alphabet[(nTriple >> 18) & 0x3F];
+	*pOutput++ = arrBase64Alphabet[(nTriple >> 12) & 0x3F];
+	*pOutput++ = (nRemaining > 1) ? arrBase64Alphabet[(nTriple >> 6) & 0x3F] : '=';
+	*pOutput++ = '=';
+}
+
+#if VLR_WIN32_STRINGS_HAS_SSE2
+
+inline bool IsSSSE3Supported()
+{
+	static const bool bSupported = []
+	{
+		int arrCpuInfo[4]{};
+		__cpuid( arrCpuInfo, 1 );
+		return ((arrCpuInfo[2] & (1 << 9)) != 0);
+	}();
+	return bSupported;
+}
+
+// Encodes the first 12 bytes of the block into 16 chars
+inline __m128i EncodeBase64Block_SSSE3( __m128i vInput )
+{
+	// Note: Each 32-bit lane gets input bytes [1, 0, 2, 1] (of its triple), so each 6-bit index can be shifted into
+	// place within a 16-bit half with a single multiply
+	vInput = _mm_shuffle_epi8( vInput, _mm_set_epi8( 10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1 ) );
+	const auto vIndices_AC = _mm_mulhi_epu16( _mm_and_si128( vInput, _mm_set1_epi32( 0x0FC0FC00 ) ), _mm_set1_epi32( 0x04000040 ) );
+	const auto vIndices_BD = _mm_mullo_epi16( _mm_and_si128( vInput, _mm_set1_epi32( 0x003F03F0 ) ), _mm_set1_epi32( 0x01000010 ) );
+	const auto vIndices = _mm_or_si128( vIndices_AC, vIndices_BD );
+
+	// Maps each index to the offset to add for its range: [0, 26) 'A', [26, 52) 'a' - 26, [52, 62) '0' - 52, 62 '+',
+	// and 63 '/'. Saturating subtract gives 0 for [0, 52) and 1..12 for [52, 64); [0, 26) is then moved to 13.
+	auto vLookupIndex = _mm_subs_epu8( vIndices, _mm_set1_epi8( 51 ) );
+	const auto vIsUpper = _mm_cmpgt_epi8( _mm_set1_epi8( 26 ), vIndices );
+	vLookupIndex = _mm_or_si128( vLookupIndex, _mm_and_si128( vIsUpper, _mm_set1_epi8( 13 ) ) );
+	const auto vOffsets = _mm_setr_epi8(
+		'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+		'0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0 );
+	return _mm_add_epi8( vIndices, _mm_shuffle_epi8( vOffsets, vLookupIndex ) );
+}
+
+// Note: Returns the number of input bytes encoded (a multiple of 12); the caller encodes the rest
+inline size_t EncodeBase64_SSSE3( const BYTE* pData, size_t nDataSize, char* pOutput )
+{
+	size_t nOffset = 0;
+	// Note: Each step loads 16 bytes (and encodes 12), so stops while at least 16 bytes are still readable
+	for (; nDataSize - nOffset >= 16; nOffset += 12)
+	{
+		const auto vInput = _mm_loadu_si128( reinterpret_cast<const __m128i*>(pData + nOffset) );
+		_mm_storeu_si128( reinterpret_cast<__m128i*>(pOutput), EncodeBase64Block_SSSE3( vInput ) );
+		pOutput += 16;
+	}
+	return nOffset;
+}
+
+#endif // VLR_WIN32_STRINGS_HAS_SSE2
+
+} // namespace detail
+
+constexpr size_t GetBase64EncodedLength( size_t nDataSize )
+{
+	return ((nDataSize + 2) / 3) * 4;
+}
+
+inline void AppendBase64( const BYTE* pData, size_t nDataSize, std::string& sOutput )
+{
+	auto nOutputOffset = sOutput.size();
+	sOutput.resize( nOutputOffset + GetBase64EncodedLength( nDataSize ) );
+	auto pOutput = sOutput.data() + nOutputOffset;
+
+	size_t nEncodedSize = 0;
+#if VLR_WIN32_STRINGS_HAS_SSE2
+	if (detail::IsSSSE3Supported())
+	{
+		nEncodedSize = detail::EncodeBase64_SSSE3( pData, nDataSize, pOutput );
+		pOutput += (nEncodedSize / 3) * 4;
+	}
+#endif
+	detail::EncodeBase64_Scalar( pData + nEncodedSize, nDataSize - nEncodedSize, pOutput );
+}
+
+} // namespace strings
+
+} // namespace win32
+
+} // namespace vlr
@@ -0,0 +1,289 @@
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+
+#include <vlr-util/util.includes.h>
+
+#include "strings.FindSubstring.h"
+
+namespace vlr {
+
+namespace win32 {
+
+namespace strings {
+
+// Case-insensitive equality, ordering, prefix check and hash for names (registry key/value names, library names, etc).
+// Chars are folded to upper case: ASCII via a vectorized fold (SSE2 on x86/x64, 16 bytes at a time), and blocks which
+// contain any non-ASCII chars via the ordinal fold the registry uses (detail::ToOrdinalUpper, shared with the
+// case-insensitive substring search), so non-ASCII names still compare correctly. For char data, only ASCII is
+// folded (non-ASCII bytes must match exactly).
+// Hash, equality and ordering use the same fold, so they are consistent for use as container traits.
+
+namespace detail {
+
+inline void FoldToUpper_Scalar( wchar_t* pChars, size_t nCharCount )
+{
+	for (size_t i = 0; i < nCharCount; ++i)
+	{
+		pChars[i] = ToOrdinalUpper( pChars[i] );
+	}
+}
+inline void FoldToUpper_Scalar( char* pChars, size_t nCharCount )
+{
+	for (size_t i = 0; i < nCharCount; ++i)
+	{
+		pChars[i] = ToAsciiUpper( pChars[i] );
+	}
+}
+
+// Folds up to one block of chars into the (zero-padded) block buffer
+template <typename TChar>
+struct FoldedBlock
+{
+	static constexpr size_t nCharsPerBlock = 16 / sizeof( TChar );
+	alignas(16) TChar m_arrChars[nCharsPerBlock]{};
+
+	inline void Fold( const TChar* pChars, size_t nCharCount )
+	{
+		std::memcpy( m_arrChars, pChars, nCharCount * sizeof( TChar ) );
+		FoldToUpper_Scalar( m_arrChars, nCharCount );
+	}
+};
+
+#if VLR_WIN32_STRINGS_HAS_SSE2
+
+template <typename TChar>
+inline __m128i FoldAsciiToUpper( __m128i vBlock )
+{
+	// Note: Signed compares; non-ASCII chars compare as negative (or above 'z'), so are left unchanged
+	if constexpr (sizeof( TChar ) == 1)
+	{
+		const auto vIsLower = _mm_and_si128(
+			_mm_cmpgt_epi8( vBlock, _mm_set1_epi8( 'a' - 1 ) ),
+			_mm_cmplt_epi8( vBlock, _mm_set1_epi8( 'z' + 1 ) ) );
+		return _mm_sub_epi8( vBlock, _mm_and_si128( vIsLower, _mm_set1_epi8( 0x20 ) ) );
+	}
+	else
+	{
+		const auto vIsLower = _mm_and_si128(
+			_mm_cmpgt_epi16( vBlock, _mm_set1_epi16( 'a' - 1 ) ),
+			_mm_cmplt_epi16( vBlock, _mm_set1_epi16( 'z' + 1 ) ) );
+		return _mm_sub_epi16( vBlock, _mm_and_si128( vIsLower, _mm_set1_epi16( 0x20 ) ) );
+	}
+}
+
+#endif // VLR_WIN32_STRINGS_HAS_SSE2
+
+template <typename TChar>
+inline bool AreEqualBlocks_CaseInsensitive_Scalar( const TChar* pLHS, const TChar* pRHS, size_t nCharCount )
+{
+	FoldedBlock<TChar> oBlock_LHS;
+	FoldedBlock<TChar> oBlock_RHS;
+	oBlock_LHS.Fold( pLHS, nCharCount );
+	oBlock_RHS.Fold( pRHS, nCharCount );
+	return (std::memcmp( oBlock_LHS.m_arrChars, oBlock_RHS.m_arrChars, sizeof( oBlock_LHS.m_arrChars ) ) == 0);
+}
+
+inline uint64_t MixHash( uint64_t nHash, uint64_t nValue )
+{
+	nHash ^= nValue;
+	nHash *= 0x9E3779B97F4A7C15ULL;
+	return nHash ^ (nHash >> 29);
+}
+
+} // namespace detail
+
+template <typename TChar>
+inline bool AreEqual_CaseInsensitive( std::basic_string_view<TChar> svLHS, std::basic_string_view<TChar> svRHS )
+{
+	if (svLHS.size() != svRHS.size())
+	{
+		return false;
+	}
+
+	static constexpr size_t nCharsPerBlock = detail::FoldedBlock<TChar>::nCharsPerBlock;
+	const TChar* pLHS = svLHS.data();
+	const TChar* pRHS = svRHS.data();
+	size_t i = 0;
+
+#if VLR_WIN32_STRINGS_HAS_SSE2
+	for (; i + nCharsPerBlock <= svLHS.size(); i += nCharsPerBlock)
+	{
+		const auto vBlock_LHS = _mm_loadu_si128( reinterpret_cast<const __m128i*>(pLHS + i) );
+		const auto vBlock_RHS = _mm_loadu_si128( reinterpret_cast<const __m128i*>(pRHS + i) );
+		const auto vEqual = _mm_cmpeq_epi8( detail::FoldAsciiToUpper<TChar>( vBlock_LHS ), detail::FoldAsciiToUpper<TChar>( vBlock_RHS ) );
+		if (_mm_movemask_epi8( vEqual ) == 0xFFFF)
+		{
+			continue;
+		}
+		// Note: A difference in an all-ASCII block is a real difference; otherwise fold the non-ASCII chars too
+		if (!detail::BlockHasNonAsciiChars<TChar>( _mm_or_si128( vBlock_LHS, vBlock_RHS ) ))
+		{
+			return false;
+		}
+		if (!detail::AreEqualBlocks_CaseInsensitive_Scalar( pLHS + i, pRHS + i, nCharsPerBlock ))
+		{
+			return false;
+		}
+	}
+#endif
+
+	for (; i < svLHS.size(); i += nCharsPerBlock)
+	{
+		auto nCharCount = (std::min)( nCharsPerBlock, svLHS.size() - i );
+		if (!detail::AreEqualBlocks_CaseInsensitive_Scalar( pLHS + i, pRHS + i, nCharCount ))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+template <typename TChar>
+inline bool HasPrefix_CaseInsensitive( std::basic_string_view<TChar> svValue, std::basic_string_view<TChar> svPrefix )
+{
+	return (svValue.size() >= svPrefix.size()) && AreEqual_CaseInsensitive( svValue.substr( 0, svPrefix.size() ), svPrefix );
+}
+
+// Note: Ordinal order of the folded chars (not a linguistic order), so names which compare equal here are exactly the
+// names which AreEqual_CaseInsensitive matches. Returns < 0, 0 or > 0, as for memcmp.
+template <typename TChar>
+inline int Compare_CaseInsensitive( std::basic_string_view<TChar> svLHS, std::basic_string_view<TChar> svRHS )
+{
+	using TUnsignedChar = std::make_unsigned_t<TChar>;
+	static constexpr size_t nCharsPerBlock = detail::FoldedBlock<TChar>::nCharsPerBlock;
+	const TChar* pLHS = svLHS.data();
+	const TChar* pRHS = svRHS.data();
+	const size_t nCommonSize = (std::min)( svLHS.size(), svRHS.size() );
+
+	for (size_t i = 0; i < nCommonSize; i += nCharsPerBlock)
+	{
+		auto nCharCount = (std::min)( nCharsPerBlock, nCommonSize - i );
+		// Note: Blocks which are exactly equal are also equal folded, so only differing blocks are folded
+		if (std::memcmp( pLHS + i, pRHS + i, nCharCount * sizeof( TChar ) ) == 0)
+		{
+			continue;
+		}
+		detail::FoldedBlock<TChar> oBlock_LHS;
+		detail::FoldedBlock<TChar> oBlock_RHS;
+		oBlock_LHS.Fold( pLHS + i, nCharCount );
+		oBlock_RHS.Fold( pRHS + i, nCharCount );
+		for (size_t j = 0; j < nCharCount; ++j)
+		{
+			auto chLHS = static_cast<TUnsignedChar>(oBlock_LHS.m_arrChars[j]);
+			auto chRHS = static_cast<TUnsignedChar>(oBlock_RHS.m_arrChars[j]);
+			if (chLHS != chRHS)
+			{
+				return (chLHS < chRHS) ? -1 : 1;
+			}
+		}
+	}
+
+	if (svLHS.size() == svRHS.size())
+	{
+		return 0;
+	}
+	return (svLHS.size() < svRHS.size()) ? -1 : 1;
+}
+
+// Note: The same value in 32-bit and 64-bit processes, so usable for names shared between processes (eg: named
+// kernel objects); Hash_CaseInsensitive is this value truncated to size_t.
+template <typename TChar>
+inline uint64_t Hash64_CaseInsensitive( std::basic_string_view<TChar> svValue )
+{
+	static constexpr size_t nCharsPerBlock = detail::FoldedBlock<TChar>::nCharsPerBlock;
+	const TChar* pChars = svValue.data();
+	uint64_t nHash = 0xCBF29CE484222325ULL ^ svValue.size();
+	size_t i = 0;
+
+	auto fMixFoldedBlock = [&]( const void* pFoldedBlock )
+	{
+		uint64_t arrLanes[2];
+		std::memcpy( arrLanes, pFoldedBlock, sizeof( arrLanes ) );
+		nHash = detail::MixHash( nHash, arrLanes[0] );
+		nHash = detail::MixHash( nHash, arrLanes[1] );
+	};
+
+#if VLR_WIN32_STRINGS_HAS_SSE2
+	for (; i + nCharsPerBlock <= svValue.size(); i += nCharsPerBlock)
+	{
+		const auto vBlock = _mm_loadu_si128( reinterpret_cast<const __m128i*>(pChars + i) );
+		if (!detail::BlockHasNonAsciiChars<TChar>( vBlock ))
+		{
+			alignas(16) BYTE arrFolded[16];
+			_mm_store_si128( reinterpret_cast<__m128i*>(arrFolded), detail::FoldAsciiToUpper<TChar>( vBlock ) );
+			fMixFoldedBlock( arrFolded );
+			continue;
+		}
+		detail::FoldedBlock<TChar> oBlock;
+		oBlock.Fold( pChars + i, nCharsPerBlock );
+		fMixFoldedBlock( oBlock.m_arrChars );
+	}
+#endif
+
+	for (; i < svValue.size(); i += nCharsPerBlock)
+	{
+		detail::FoldedBlock<TChar> oBlock;
+		oBlock.Fold( pChars + i, (std::min)( nCharsPerBlock, svValue.size() - i ) );
+		fMixFoldedBlock( oBlock.m_arrChars );
+	}
+
+	return nHash;
+}
+
+template <typename TChar>
+inline size_t Hash_CaseInsensitive( std::basic_string_view<TChar> svValue )
+{
+	return static_cast<size_t>(Hash64_CaseInsensitive( svValue ));
+}
+
+// Traits for unordered containers keyed by case-insensitive names. These are marked transparent, so that string_view
+// lookups do not construct a string once heterogeneous unordered lookup is available (C++20).
+
+template <typename TChar = TCHAR>
+struct hash_CaseInsensitive
+{
+	using is_transparent = void;
+
+	inline size_t operator()( std::basic_string_view<TChar> svValue ) const
+	{
+		return Hash_CaseInsensitive( svValue );
+	}
+};
+
+template <typename TChar = TCHAR>
+struct equal_to_CaseInsensitive
+{
+	using is_transparent = void;
+
+	inline bool operator()( std::basic_string_view<TChar> svLHS, std::basic_string_view<TChar> svRHS ) const
+	{
+		return AreEqual_CaseInsensitive( svLHS, svRHS );
+	}
+};
+
+// Note: For sorted containers and std::sort; see Compare_CaseInsensitive for the order
+template <typename TChar = TCHAR>
+struct less_CaseInsensitive
+{
+	using is_transparent = void;
+
+	inline bool operator()( std::basic_string_view<TChar> svLHS, std::basic_string_view<TChar> svRHS ) const
+	{
+		return (Compare_CaseInsensitive( svLHS, svRHS ) < 0);
+	}
+};
+
+template <typename TValue, typename TChar = TCHAR>
+using unordered_map_CaseInsensitive = std::unordered_map<std::basic_string<TChar>, TValue, hash_CaseInsensitive<TChar>, equal_to_CaseInsensitive<TChar>>;
+
+} // namespace strings
+
+} // namespace win32
+
+} // namespace vlr
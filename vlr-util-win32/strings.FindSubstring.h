@@ -0,0 +1,267 @@
+#pragma once
+
+#include <cstring>
+#include <string_view>
+
+#include <vlr-util/util.includes.h>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <emmintrin.h>
+#include <intrin.h>
+#define VLR_WIN32_STRINGS_HAS_SSE2 1
+#else
+#define VLR_WIN32_STRINGS_HAS_SSE2 0
+#endif
+
+namespace vlr {
+
+namespace win32 {
+
+namespace strings {
+
+// Substring search, for char / wchar_t data. Returns the offset of the first match, or npos.
+// On x86/x64 this uses an SSE2 kernel: the first and last chars of the needle are compared against a full block of
+// candidate positions at once, and only positions where both match are fully compared.
+// Case-insensitive matching uses ordinal case folding (same as the registry uses for names); blocks containing
+// only ASCII are filtered with the vectorized compare, and any block with non-ASCII chars is checked per position.
+
+namespace detail {
+
+template <typename TChar>
+constexpr bool IsAsciiChar( TChar tChar )
+{
+	return (static_cast<std::make_unsigned_t<TChar>>(tChar) < 0x80);
+}
+template <typename TChar>
+constexpr TChar ToAsciiLower( TChar tChar )
+{
+	return ((tChar >= 'A') && (tChar <= 'Z')) ? static_cast<TChar>(tChar - 'A' + 'a') : tChar;
+}
+template <typename TChar>
+constexpr TChar ToAsciiUpper( TChar tChar )
+{
+	return ((tChar >= 'a') && (tChar <= 'z')) ? static_cast<TChar>(tChar - 'a' + 'A') : tChar;
+}
+
+// Note: Ordinal upper case per UTF-16 unit, via the OS upper case table (RtlUpcaseUnicodeChar); this is the fold the
+// registry uses for names (and CompareStringOrdinal uses when ignoring case), and is not locale-dependent.
+inline wchar_t ToOrdinalUpper( wchar_t wch )
+{
+	if (IsAsciiChar( wch ))
+	{
+		return ToAsciiUpper( wch );
+	}
+
+	using F_RtlUpcaseUnicodeChar = WCHAR( NTAPI* )(WCHAR);
+	// Note: ntdll is loaded in every process, so the lookup does not fail in practice
+	static const auto fRtlUpcaseUnicodeChar = reinterpret_cast<F_RtlUpcaseUnicodeChar>(
+		::GetProcAddress( ::GetModuleHandleW( L"ntdll.dll" ), "RtlUpcaseUnicodeChar" ));
+	return fRtlUpcaseUnicodeChar ? fRtlUpcaseUnicodeChar( wch ) : wch;
+}
+
+inline bool AreEqualChars_CaseInsensitive( const wchar_t* pLHS, const wchar_t* pRHS, size_t nLength )
+{
+	for (size_t i = 0; i < nLength; ++i)
+	{
+		if ((pLHS[i] != pRHS[i]) && (ToOrdinalUpper( pLHS[i] ) != ToOrdinalUpper( pRHS[i] )))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+// Note: Only ASCII is folded for char data (not locale-dependent), same as the case-insensitive name compare
+inline bool AreEqualChars_CaseInsensitive( const char* pLHS, const char* pRHS, size_t nLength )
+{
+	for (size_t i = 0; i < nLength; ++i)
+	{
+		if (ToAsciiUpper( pLHS[i] ) != ToAsciiUpper( pRHS[i] ))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+template <bool bCaseInsensitive, typename TChar>
+inline bool AreEqualChars( const TChar* pLHS, const TChar* pRHS, size_t nLength )
+{
+	if constexpr (bCaseInsensitive)
+	{
+		return AreEqualChars_CaseInsensitive( pLHS, pRHS, nLength );
+	}
+	else
+	{
+		return (std::memcmp( pLHS, pRHS, nLength * sizeof( TChar ) ) == 0);
+	}
+}
+
+template <bool bCaseInsensitive, typename TChar>
+inline size_t FindSubstring_Scalar( const TChar* pHaystack, size_t nStartIndex, size_t nLastStartIndex, const TChar* pNeedle, size_t nNeedleLength )
+{
+	for (size_t i = nStartIndex; i <= nLastStartIndex; ++i)
+	{
+		if (AreEqualChars<bCaseInsensitive>( pHaystack + i, pNeedle, nNeedleLength ))
+		{
+			return i;
+		}
+	}
+	return std::basic_string_view<TChar>::npos;
+}
+
+#if VLR_WIN32_STRINGS_HAS_SSE2
+
+template <typename TChar>
+inline __m128i BroadcastChar( TChar tChar )
+{
+	if constexpr (sizeof( TChar ) == 1)
+	{
+		return _mm_set1_epi8( static_cast<char>(tChar) );
+	}
+	else
+	{
+		return _mm_set1_epi16( static_cast<short>(tChar) );
+	}
+}
+template <typename TChar>
+inline __m128i CompareEqualChars( __m128i vLHS, __m128i vRHS )
+{
+	if constexpr (sizeof( TChar ) == 1)
+	{
+		return _mm_cmpeq_epi8( vLHS, vRHS );
+	}
+	else
+	{
+		return _mm_cmpeq_epi16( vLHS, vRHS );
+	}
+}
+template <typename TChar>
+inline bool BlockHasNonAsciiChars( __m128i vBlock )
+{
+	if constexpr (sizeof( TChar ) == 1)
+	{
+		return (_mm_movemask_epi8( vBlock ) != 0);
+	}
+	else
+	{
+		const auto vNonAsciiMask = _mm_set1_epi16( static_cast<short>(0xFF80) );
+		const auto vIsAscii = _mm_cmpeq_epi16( _mm_and_si128( vBlock, vNonAsciiMask ), _mm_setzero_si128() );
+		return (_mm_movemask_epi8( vIsAscii ) != 0xFFFF);
+	}
+}
+
+template <bool bCaseInsensitive, typename TChar>
+inline size_t FindSubstring_SSE2( const TChar* pHaystack, size_t nHaystackLength, const TChar* pNeedle, size_t nNeedleLength )
+{
+	static constexpr size_t nCharsPerBlock = sizeof( __m128i ) / sizeof( TChar );
+	static constexpr unsigned int nCharBitMask = (1U << sizeof( TChar )) - 1;
+
+	const TChar tFirst = pNeedle[0];
+	const TChar tLast = pNeedle[nNeedleLength - 1];
+	const size_t nLastStartIndex = nHaystackLength - nNeedleLength;
+
+	// Note: For case-insensitive, the filter compares against both ASCII cases; this is only valid if the needle's
+	// first/last chars are ASCII, so otherwise the whole search is done per position.
+	if constexpr (bCaseInsensitive)
+	{
+		if (!IsAsciiChar( tFirst ) || !IsAsciiChar( tLast ))
+		{
+			return FindSubstring_Scalar<bCaseInsensitive>( pHaystack, 0, nLastStartIndex, pNeedle, nNeedleLength );
+		}
+	}
+
+	const auto vFirst_Lower = BroadcastChar( bCaseInsensitive ? ToAsciiLower( tFirst ) : tFirst );
+	const auto vFirst_Upper = BroadcastChar( bCaseInsensitive ? ToAsciiUpper( tFirst ) : tFirst );
+	const auto vLast_Lower = BroadcastChar( bCaseInsensitive ? ToAsciiLower( tLast ) : tLast );
+	const auto vLast_Upper = BroadcastChar( bCaseInsensitive ? ToAsciiUpper( tLast ) : tLast );
+
+	size_t i = 0;
+	for (; i + nCharsPerBlock <= nLastStartIndex + 1; i += nCharsPerBlock)
+	{
+		const auto vBlock_First = _mm_loadu_si128( reinterpret_cast<const __m128i*>(pHaystack + i) );
+		const auto vBlock_Last = _mm_loadu_si128( reinterpret_cast<const __m128i*>(pHaystack + i + nNeedleLength - 1) );
+
+		if constexpr (bCaseInsensitive)
+		{
+			if (BlockHasNonAsciiChars<TChar>( _mm_or_si128( vBlock_First, vBlock_Last ) ))
+			{
+				auto nIndex = FindSubstring_Scalar<bCaseInsensitive>( pHaystack, i, i + nCharsPerBlock - 1, pNeedle, nNeedleLength );
+				if (nIndex != std::basic_string_view<TChar>::npos)
+				{
+					return nIndex;
+				}
+				continue;
+			}
+		}
+
+		auto vMatch_First = CompareEqualChars<TChar>( vBlock_First, vFirst_Lower );
+		auto vMatch_Last = CompareEqualChars<TChar>( vBlock_Last, vLast_Lower );
+		if constexpr (bCaseInsensitive)
+		{
+			vMatch_First = _mm_or_si128( vMatch_First, CompareEqualChars<TChar>( vBlock_First, vFirst_Upper ) );
+			vMatch_Last = _mm_or_si128( vMatch_Last, CompareEqualChars<TChar>( vBlock_Last, vLast_Upper ) );
+		}
+		auto nCandidateMask = static_cast<unsigned int>(_mm_movemask_epi8( _mm_and_si128( vMatch_First, vMatch_Last ) ));
+		while (nCandidateMask != 0)
+		{
+			unsigned long nBitIndex{};
+			_BitScanForward( &nBitIndex, nCandidateMask );
+			const size_t nCandidateIndex = i + (nBitIndex / sizeof( TChar ));
+			// Note: First and last already match; only the middle remains to be compared
+			if ((nNeedleLength <= 2) || AreEqualChars<bCaseInsensitive>( pHaystack + nCandidateIndex + 1, pNeedle + 1, nNeedleLength - 2 ))
+			{
+				return nCandidateIndex;
+			}
+			nCandidateMask &= ~(nCharBitMask << nBitIndex);
+		}
+	}
+
+	if (i > nLastStartIndex)
+	{
+		return std::basic_string_view<TChar>::npos;
+	}
+	return FindSubstring_Scalar<bCaseInsensitive>( pHaystack, i, nLastStartIndex, pNeedle, nNeedleLength );
+}
+
+#endif // VLR_WIN32_STRINGS_HAS_SSE2
+
+template <bool bCaseInsensitive, typename TChar>
+inline size_t FindSubstring( std::basic_string_view<TChar> svHaystack, std::basic_string_view<TChar> svNeedle )
+{
+	static_assert((sizeof( TChar ) == 1) || (sizeof( TChar ) == 2), "Only char and wchar_t (UTF-16) data are supported");
+
+	if (svNeedle.empty())
+	{
+		return 0;
+	}
+	if (svNeedle.size() > svHaystack.size())
+	{
+		return std::basic_string_view<TChar>::npos;
+	}
+
+#if VLR_WIN32_STRINGS_HAS_SSE2
+	return FindSubstring_SSE2<bCaseInsensitive>( svHaystack.data(), svHaystack.size(), svNeedle.data(), svNeedle.size() );
+#else
+	return FindSubstring_Scalar<bCaseInsensitive>( svHaystack.data(), 0, svHaystack.size() - svNeedle.size(), svNeedle.data(), svNeedle.size() );
+#endif
+}
+
+} // namespace detail
+
+template <typename TChar>
+inline size_t FindSubstring( std::basic_string_view<TChar> svHaystack, std::basic_string_view<TChar> svNeedle )
+{
+	return detail::FindSubstring<false>( svHaystack, svNeedle );
+}
+
+template <typename TChar>
+inline size_t FindSubstring_CaseInsensitive( std::basic_string_view<TChar> svHaystack, std::basic_string_view<TChar> svNeedle )
+{
+	return detail::FindSubstring<true>( svHaystack, svNeedle );
+}
+
+} // namespace strings
+
+} // namespace win32
+
+} // namespace vlr